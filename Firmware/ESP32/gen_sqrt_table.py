@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+"""Writes main/sqrt-table-secp224r1.inc, the roots of unity for the table-driven square root.
+
+p - 1 = 2^96 * q for secp224r1. With g = 11^q, a generator of the 2^96-th roots of unity, row e of
+the table holds g^(-d * 2^(W * e)) for d = 0 .. 2^W - 1, one row per W-bit digit of a discrete log.
+
+    ./gen_sqrt_table.py [--window W] > main/sqrt-table-secp224r1.inc
+"""
+
+import argparse
+
+P = 2**224 - 2**96 + 1
+TWO_ADICITY = 96
+Q = (P - 1) >> TWO_ADICITY
+NON_RESIDUE = 11
+
+
+def words(value):
+    b = ["%02X" % ((value >> (8 * i)) & 0xFF) for i in range(28)]
+    return "BYTES_TO_WORDS_8(%s), BYTES_TO_WORDS_8(%s), BYTES_TO_WORDS_8(%s), BYTES_TO_WORDS_4(%s)" % (
+        ", ".join(b[0:8]), ", ".join(b[8:16]), ", ".join(b[16:24]), ", ".join(b[24:28]))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--window", type=int, default=6)
+    window = parser.parse_args().window
+    if window < 1 or window > 8 or TWO_ADICITY % window:
+        parser.error("the window must divide 96 and be at most 8 bits")
+    digits = TWO_ADICITY // window
+
+    assert pow(NON_RESIDUE, (P - 1) // 2, P) == P - 1
+    g = pow(NON_RESIDUE, Q, P)
+
+    print("/* Generated by gen_sqrt_table.py --window %d; do not edit. */" % window)
+    print()
+    print("#define SQRT_WINDOW_secp224r1 %d" % window)
+    print("#define SQRT_DIGITS_secp224r1 %d" % digits)
+    print()
+    print("/* sqrt_table_secp224r1[e][d] = g^(-d * 2^(%d * e)), g = 11^((p - 1) / 2^96). */" % window)
+    print("static const uECC_word_t sqrt_table_secp224r1[%d][%d][num_words_secp224r1] = {" % (digits, 1 << window))
+    for e in range(digits):
+        print("    {")
+        for d in range(1 << window):
+            print("        { %s }," % words(pow(g, (-d << (window * e)) % (P - 1), P)))
+        print("    },")
+    print("};")
+
+
+if __name__ == "__main__":
+    main()
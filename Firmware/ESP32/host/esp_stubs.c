@@ -0,0 +1,52 @@
+/* Host implementations of the ESP-IDF and FreeRTOS calls the modem core makes, except for the
+   GAP (gap_pcap.c). */
+
+#include <stdarg.h>
+#include <stdio.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/task.h"
+
+esp_log_level_t host_log_level = ESP_LOG_NONE;
+
+static TickType_t tick_count = 0;
+
+const char *esp_err_to_name(esp_err_t code) {
+    switch (code) {
+        case ESP_OK:
+            return "ESP_OK";
+        case ESP_FAIL:
+            return "ESP_FAIL";
+        case ESP_ERR_INVALID_ARG:
+            return "ESP_ERR_INVALID_ARG";
+        default:
+            return "UNKNOWN ERROR";
+    }
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level) {
+    (void)tag;
+    host_log_level = level;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...) {
+    static const char letters[] = "NEWIDV";
+    va_list args;
+    fprintf(stderr, "%c (%u) %s: ", letters[level], (unsigned)(tick_count * portTICK_PERIOD_MS), tag);
+    va_start(args, format);
+    vfprintf(stderr, format, args);
+    va_end(args);
+}
+
+void vTaskDelay(const TickType_t ticks_to_delay) {
+    tick_count += ticks_to_delay;
+}
+
+TickType_t xTaskGetTickCount(void) {
+    return tick_count;
+}
+
+void host_reset_tick_count(void) {
+    tick_count = 0;
+}
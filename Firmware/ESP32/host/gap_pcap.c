@@ -0,0 +1,221 @@
+/* Host GAP backend: simulated advertising events, written to a BTLE pcap. See gap_pcap.h. */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "freertos/task.h"
+#include "modem_gap.h"
+
+#include "gap_pcap.h"
+
+#define LINKTYPE_BLUETOOTH_LE_LL 251
+
+#define ADV_ACCESS_ADDRESS 0x8E89BED6u
+#define ADV_CRC_INIT 0x555555u
+#define PDU_ADV_NONCONN_IND 0x2
+#define PDU_TXADD_RANDOM 0x40
+
+/* 1 Mbit/s: preamble, access address, header, AdvA, 31 bytes of AdvData and CRC take 376 us,
+   plus the time to switch to the next channel. */
+#define ADV_CHANNEL_SPACING_US 500
+#define ADV_DELAY_MAX_US 10000
+#define ADV_CHANNELS 3
+
+#define MAX_ADV_DATA 31
+#define MAX_FRAME (4 + 2 + 6 + MAX_ADV_DATA + 3)
+
+static FILE *capture = NULL;
+static uint64_t epoch = 0;
+static gap_pcap_sink_t sink = NULL;
+static void *sink_ctx = NULL;
+static uint64_t sink_epoch = 0;
+static uint32_t rng_state = 1;
+
+static gap_pcap_stats_t stats;
+static esp_bd_addr_t addr;
+static uint8_t adv_data[MAX_ADV_DATA];
+static uint32_t adv_len = 0;
+static int advertising = 0;
+static uint64_t next_event_us = 0;
+static uint16_t adv_int_min = MODEM_ADV_INT_MIN;
+
+static uint64_t now_us(void) {
+    return (uint64_t)xTaskGetTickCount() * portTICK_PERIOD_MS * 1000;
+}
+
+static uint32_t next_random(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/* The link layer CRC: x^24 + x^10 + x^9 + x^6 + x^4 + x^3 + x + 1 over the PDU, least significant
+   bit first, sent from register position 23 down, which makes it little endian once reflected. */
+static uint32_t ble_crc24(const uint8_t *data, size_t len) {
+    uint32_t lfsr = ADV_CRC_INIT;
+    uint32_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        for (int bit = 0; bit < 8; bit++) {
+            uint32_t feedback = ((data[i] >> bit) ^ (lfsr >> 23)) & 1;
+            lfsr = (lfsr << 1) & 0xffffff;
+            if (feedback) {
+                lfsr ^= 0x00065b;
+            }
+        }
+    }
+    for (int bit = 0; bit < 24; bit++) {
+        crc |= ((lfsr >> bit) & 1) << (23 - bit);
+    }
+    return crc;
+}
+
+static void write_frame(uint64_t t_us) {
+    uint8_t frame[MAX_FRAME];
+    uint8_t record[16];
+    size_t len = 0;
+
+    put_le32(frame, ADV_ACCESS_ADDRESS);
+    len = 4;
+    frame[len++] = PDU_ADV_NONCONN_IND | PDU_TXADD_RANDOM;
+    frame[len++] = (uint8_t)(ESP_BD_ADDR_LEN + adv_len);
+    /* esp_bd_addr_t holds the most significant byte first, the air the least significant. */
+    for (int i = ESP_BD_ADDR_LEN - 1; i >= 0; i--) {
+        frame[len++] = addr[i];
+    }
+    memcpy(&frame[len], adv_data, adv_len);
+    len += adv_len;
+    uint32_t crc = ble_crc24(&frame[4], len - 4);
+    frame[len++] = (uint8_t)crc;
+    frame[len++] = (uint8_t)(crc >> 8);
+    frame[len++] = (uint8_t)(crc >> 16);
+
+    if (sink) {
+        sink(sink_ctx, t_us + sink_epoch, frame, len);
+    }
+    if (!capture) {
+        return;
+    }
+    t_us += epoch;
+    put_le32(record, (uint32_t)(t_us / 1000000));
+    put_le32(record + 4, (uint32_t)(t_us % 1000000));
+    put_le32(record + 8, (uint32_t)len);
+    put_le32(record + 12, (uint32_t)len);
+    fwrite(record, 1, sizeof(record), capture);
+    fwrite(frame, 1, len, capture);
+}
+
+/* Sends the advertising events that started before now. */
+static void advance(uint64_t now) {
+    while (advertising && next_event_us < now) {
+        for (int channel = 0; channel < ADV_CHANNELS; channel++) {
+            if (capture || sink) {
+                write_frame(next_event_us + (uint64_t)channel * ADV_CHANNEL_SPACING_US);
+            }
+            stats.frames++;
+        }
+        stats.events++;
+        next_event_us += (uint64_t)adv_int_min * 625 + next_random() % (ADV_DELAY_MAX_US + 1);
+    }
+}
+
+esp_err_t modem_gap_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t modem_gap_set_rand_addr(esp_bd_addr_t rand_addr) {
+    advance(now_us());
+    memcpy(addr, rand_addr, sizeof(addr));
+    stats.addresses++;
+    return ESP_OK;
+}
+
+esp_err_t modem_gap_set_adv_interval(uint16_t int_min, uint16_t int_max) {
+    if (int_min < 0x0020 || int_max > 0x4000 || int_min > int_max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* Like Bluedroid, the running advertisement keeps its interval until it is restarted. */
+    adv_int_min = int_min;
+    return ESP_OK;
+}
+
+esp_err_t modem_gap_config_adv_data_raw(uint8_t *data, uint32_t len) {
+    uint64_t now = now_us();
+    if (len > MAX_ADV_DATA) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    advance(now);
+    memcpy(adv_data, data, len);
+    adv_len = len;
+    stats.advertisements++;
+    /* The Bluedroid callback starts advertising once the data is set; the first event is sent
+       right away. */
+    advertising = 1;
+    next_event_us = now;
+    return ESP_OK;
+}
+
+esp_err_t modem_gap_stop_advertising(void) {
+    advance(now_us());
+    advertising = 0;
+    return ESP_OK;
+}
+
+int gap_pcap_open(const char *path, uint64_t epoch_us) {
+    uint8_t header[24];
+
+    if (capture) {
+        gap_pcap_close();
+    }
+    capture = fopen(path, "wb");
+    if (!capture) {
+        return -1;
+    }
+    epoch = epoch_us;
+    put_le32(header, 0xa1b2c3d4);
+    header[4] = 2; /* version 2.4 */
+    header[5] = 0;
+    header[6] = 4;
+    header[7] = 0;
+    put_le32(header + 8, 0);  /* thiszone */
+    put_le32(header + 12, 0); /* sigfigs */
+    put_le32(header + 16, 65535);
+    put_le32(header + 20, LINKTYPE_BLUETOOTH_LE_LL);
+    fwrite(header, 1, sizeof(header), capture);
+    return 0;
+}
+
+int gap_pcap_close(void) {
+    int err;
+
+    advance(now_us());
+    if (!capture) {
+        return 0;
+    }
+    err = ferror(capture);
+    err |= fclose(capture);
+    capture = NULL;
+    return err ? -1 : 0;
+}
+
+void gap_pcap_set_sink(gap_pcap_sink_t fn, void *ctx, uint64_t epoch_us) {
+    advance(now_us());
+    sink = fn;
+    sink_ctx = ctx;
+    sink_epoch = epoch_us;
+}
+
+void gap_pcap_seed(uint32_t seed) {
+    rng_state = seed ? seed : 1;
+}
+
+void gap_pcap_get_stats(gap_pcap_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,38 @@
+#ifndef _SENDMY_GAP_PCAP_H_
+#define _SENDMY_GAP_PCAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Host GAP backend of the modem core (main/modem_gap.h). Advertising is simulated on the virtual
+   FreeRTOS clock: every minimum advertising interval plus a random advDelay of up to 10 ms, an
+   event sends one ADV_NONCONN_IND PDU on each of channels 37, 38 and 39. With a capture file open, every PDU
+   is written as a LINKTYPE_BLUETOOTH_LE_LL record (access address, header, AdvA, AdvData, CRC)
+   with its virtual timestamp. The output only depends on the modem's calls and the seed. */
+
+typedef struct {
+    uint64_t addresses;      /* random addresses configured */
+    uint64_t advertisements; /* advertisements configured, one per chunk */
+    uint64_t events;         /* advertising events sent */
+    uint64_t frames;         /* PDUs sent, three per event */
+} gap_pcap_stats_t;
+
+/** Starts writing PDUs to path, with virtual time 0 at epoch_us since 1970. Returns 0 on success. */
+int gap_pcap_open(const char *path, uint64_t epoch_us);
+
+/** Sends the events due up to the current virtual time and closes the capture file. */
+int gap_pcap_close(void);
+
+/** Receives every PDU like it is written to the capture, with its time in microseconds since 1970. */
+typedef void (*gap_pcap_sink_t)(void *ctx, uint64_t t_us, const uint8_t *frame, size_t len);
+
+/** Passes every PDU to fn as well, or to nobody if fn is NULL, with virtual time 0 at epoch_us.
+    Moving the epoch between messages gives each simulated modem a clock of its own. */
+void gap_pcap_set_sink(gap_pcap_sink_t fn, void *ctx, uint64_t epoch_us);
+
+/** Seeds the advDelay generator. */
+void gap_pcap_seed(uint32_t seed);
+
+void gap_pcap_get_stats(gap_pcap_stats_t *stats);
+
+#endif /* _SENDMY_GAP_PCAP_H_ */
@@ -0,0 +1,11 @@
+/* Host stand-in for ESP-IDF's esp_bt_defs.h, enough for the modem core (see ../README.md). */
+#ifndef _HOST_ESP_BT_DEFS_H_
+#define _HOST_ESP_BT_DEFS_H_
+
+#include <stdint.h>
+
+#define ESP_BD_ADDR_LEN 6
+
+typedef uint8_t esp_bd_addr_t[ESP_BD_ADDR_LEN];
+
+#endif /* _HOST_ESP_BT_DEFS_H_ */
@@ -0,0 +1,13 @@
+/* Host stand-in for ESP-IDF's esp_err.h, enough for the modem core (see ../README.md). */
+#ifndef _HOST_ESP_ERR_H_
+#define _HOST_ESP_ERR_H_
+
+typedef int esp_err_t;
+
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+
+const char *esp_err_to_name(esp_err_t code);
+
+#endif /* _HOST_ESP_ERR_H_ */
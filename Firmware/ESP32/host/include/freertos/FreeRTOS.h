@@ -0,0 +1,13 @@
+/* Host stand-in for FreeRTOS.h, enough for the modem core (see ../../README.md). */
+#ifndef _HOST_FREERTOS_H_
+#define _HOST_FREERTOS_H_
+
+#include <stdint.h>
+
+typedef uint32_t TickType_t;
+
+/* CONFIG_FREERTOS_HZ defaults to 100 in ESP-IDF. */
+#define configTICK_RATE_HZ 100
+#define portTICK_PERIOD_MS ((TickType_t)1000 / configTICK_RATE_HZ)
+
+#endif /* _HOST_FREERTOS_H_ */
@@ -0,0 +1,14 @@
+/* Host stand-in for FreeRTOS' task.h. Delays do not sleep, they advance a virtual tick count. */
+#ifndef _HOST_FREERTOS_TASK_H_
+#define _HOST_FREERTOS_TASK_H_
+
+#include "freertos/FreeRTOS.h"
+
+void vTaskDelay(const TickType_t ticks_to_delay);
+TickType_t xTaskGetTickCount(void);
+
+/* Host only: puts the tick count back to 0 between independent runs, before it wraps. Advertising
+   must be stopped. */
+void host_reset_tick_count(void);
+
+#endif /* _HOST_FREERTOS_TASK_H_ */
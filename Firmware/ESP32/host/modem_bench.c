@@ -0,0 +1,316 @@
+/* Times the modem core on the host: key validation, the per-chunk key derivation and whole
+   messages, for every chunk length from 1 to 8 and several payload sizes.
+
+     sendmy-modem-bench [--format csv|json] [--payloads 1,8,32] [--scale N] [--repeat N]
+                        [--baseline old.csv] [--threshold PCT] [--verbose]
+
+   Every row is the best of --repeat runs over a fixed, seeded workload, so tries_per_chunk is
+   exact and only ns_per_op carries noise. With --baseline, a CSV written by an earlier run, rows
+   slower by more than --threshold percent (default 10) or with different tries_per_chunk (the
+   modem's output changed) are reported on stderr and the exit status is 1. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "modem.h"
+#include "uECC.h"
+#include "uECC_vli.h"
+
+#define MAX_ROWS 256
+#define MAX_PAYLOADS 16
+#define MAX_PAYLOAD_LEN 100
+
+typedef struct {
+    char name[40];
+    unsigned chunk_len;
+    unsigned payload_len;
+    double ns_per_op;
+    double tries_per_chunk;
+    double chunks_per_s;
+} bench_row;
+
+static bench_row rows[MAX_ROWS];
+static int num_rows = 0;
+static unsigned scale = 1;
+static unsigned repeat = 5;
+
+static uint64_t rng_state;
+
+/* Every row draws its inputs from its own seed, so a row's workload does not depend on which rows
+   ran before it and rows compare with a baseline taken with other --payloads. */
+static void seed_rng(const char *name, unsigned chunk_len, unsigned payload_len) {
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (const char *c = name; *c; c++) {
+        h = (h ^ (uint8_t)*c) * 0x100000001b3ull;
+    }
+    h = (h ^ chunk_len) * 0x100000001b3ull;
+    h = (h ^ payload_len) * 0x100000001b3ull;
+    rng_state = h ? h : 0x5e0d5e0d5e0d0001ull;
+}
+
+static uint8_t next_byte(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint8_t)(rng_state >> 32);
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bench_row *add_row(const char *name, unsigned chunk_len, unsigned payload_len) {
+    bench_row *row = &rows[num_rows++];
+    memset(row, 0, sizeof(*row));
+    snprintf(row->name, sizeof(row->name), "%s", name);
+    row->chunk_len = chunk_len;
+    row->payload_len = payload_len;
+    return row;
+}
+
+static void bench_validation(void) {
+    enum { KEYS = 4096 };
+    static uint8_t keys[KEYS][29];
+    uint8_t point[56];
+    unsigned n = KEYS * scale;
+    double best_valid = 1e30, best_decompress = 1e30;
+
+    seed_rng("is_valid_pubkey", 0, 0);
+    for (unsigned i = 0; i < KEYS; i++) {
+        keys[i][0] = 0x02;
+        for (unsigned j = 1; j < sizeof(keys[i]); j++) {
+            keys[i][j] = next_byte();
+        }
+    }
+    for (unsigned r = 0; r < repeat; r++) {
+        volatile int valid = 0;
+        double t0 = now_ns();
+        for (unsigned i = 0; i < n; i++) {
+            valid += is_valid_pubkey(&keys[i % KEYS][1]);
+        }
+        double t1 = now_ns();
+        for (unsigned i = 0; i < n; i++) {
+            uECC_decompress(keys[i % KEYS], point, uECC_secp224r1());
+        }
+        double t2 = now_ns();
+        if (t1 - t0 < best_valid) {
+            best_valid = t1 - t0;
+        }
+        if (t2 - t1 < best_decompress) {
+            best_decompress = t2 - t1;
+        }
+    }
+    add_row("is_valid_pubkey", 0, 0)->ns_per_op = best_valid / n;
+    add_row("uECC_decompress", 0, 0)->ns_per_op = best_decompress / n;
+}
+
+static void bench_chunks(unsigned chunk_len) {
+    /* A message of 160 chunks, the most the 20 payload bytes hold for chunk_len 1. */
+    enum { CHUNKS = 160 };
+    uint8_t values[CHUNKS];
+    unsigned messages = 16 * scale;
+    double best = 1e30;
+    uint64_t tries = 0;
+
+    seed_rng("set_addr_and_payload_for_byte", chunk_len, 0);
+    for (unsigned i = 0; i < CHUNKS; i++) {
+        values[i] = next_byte() & (0xff >> (8 - chunk_len));
+    }
+    for (unsigned r = 0; r < repeat; r++) {
+        tries = 0;
+        double t0 = now_ns();
+        for (unsigned m = 0; m < messages; m++) {
+            for (unsigned i = 0; i < CHUNKS; i++) {
+                tries += set_addr_and_payload_for_byte(i, 0, values[i], chunk_len);
+            }
+        }
+        double t = now_ns() - t0;
+        if (t < best) {
+            best = t;
+        }
+    }
+    bench_row *row = add_row("set_addr_and_payload_for_byte", chunk_len, 0);
+    row->ns_per_op = best / ((double)messages * CHUNKS);
+    row->tries_per_chunk = (double)tries / ((double)messages * CHUNKS);
+    row->chunks_per_s = 1e9 / row->ns_per_op;
+}
+
+static void bench_message(unsigned chunk_len, unsigned payload_len) {
+    uint8_t payload[MAX_PAYLOAD_LEN];
+    unsigned chunks = (payload_len * 8 + chunk_len - 1) / chunk_len;
+    unsigned messages = (4096 * scale + chunks - 1) / chunks;
+    double best = 1e30;
+    uint64_t tries = 0;
+
+    seed_rng("send_data_once_blocking", chunk_len, payload_len);
+    for (unsigned i = 0; i < sizeof(payload); i++) {
+        payload[i] = next_byte();
+    }
+    for (unsigned r = 0; r < repeat; r++) {
+        tries = 0;
+        double t0 = now_ns();
+        for (unsigned m = 0; m < messages; m++) {
+            tries += send_data_once_blocking(payload, payload_len, chunk_len, 0);
+        }
+        double t = now_ns() - t0;
+        if (t < best) {
+            best = t;
+        }
+    }
+    bench_row *row = add_row("send_data_once_blocking", chunk_len, payload_len);
+    row->ns_per_op = best / messages;
+    row->tries_per_chunk = (double)tries / ((double)messages * chunks);
+    row->chunks_per_s = 1e9 * chunks / row->ns_per_op;
+}
+
+static void print_csv(void) {
+    printf("# uECC_WORD_SIZE=%d uECC_SQRT_TABLE_secp224r1=%d\n", (int)uECC_WORD_SIZE,
+           (int)uECC_SQRT_TABLE_secp224r1);
+    printf("name,chunk_len,payload_len,ns_per_op,tries_per_chunk,chunks_per_s\n");
+    for (int i = 0; i < num_rows; i++) {
+        printf("%s,%u,%u,%.1f,%.6f,%.1f\n", rows[i].name, rows[i].chunk_len, rows[i].payload_len,
+               rows[i].ns_per_op, rows[i].tries_per_chunk, rows[i].chunks_per_s);
+    }
+}
+
+static void print_json(void) {
+    printf("{\"config\":{\"uECC_WORD_SIZE\":%d,\"uECC_SQRT_TABLE_secp224r1\":%d},\"results\":[\n",
+           (int)uECC_WORD_SIZE, (int)uECC_SQRT_TABLE_secp224r1);
+    for (int i = 0; i < num_rows; i++) {
+        printf("  {\"name\":\"%s\",\"chunk_len\":%u,\"payload_len\":%u,\"ns_per_op\":%.1f,"
+               "\"tries_per_chunk\":%.6f,\"chunks_per_s\":%.1f}%s\n",
+               rows[i].name, rows[i].chunk_len, rows[i].payload_len, rows[i].ns_per_op,
+               rows[i].tries_per_chunk, rows[i].chunks_per_s, i + 1 < num_rows ? "," : "");
+    }
+    printf("]}\n");
+}
+
+/* Returns the number of rows that regressed against the CSV at path, or -1 if it can't be read. */
+static int compare_baseline(const char *path, double threshold) {
+    FILE *f = fopen(path, "r");
+    char line[256];
+    int regressions = 0;
+
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        bench_row base;
+        char *comma = strchr(line, ',');
+        if (line[0] == '#' || !comma || (size_t)(comma - line) >= sizeof(base.name)) {
+            continue;
+        }
+        memcpy(base.name, line, comma - line);
+        base.name[comma - line] = 0;
+        if (sscanf(comma + 1, "%u,%u,%lf,%lf,%lf", &base.chunk_len, &base.payload_len, &base.ns_per_op,
+                   &base.tries_per_chunk, &base.chunks_per_s) != 5) {
+            continue;
+        }
+        for (int i = 0; i < num_rows; i++) {
+            const bench_row *row = &rows[i];
+            if (strcmp(row->name, base.name) || row->chunk_len != base.chunk_len ||
+                row->payload_len != base.payload_len) {
+                continue;
+            }
+            double change = 100.0 * (row->ns_per_op / base.ns_per_op - 1.0);
+            int slower = change > threshold;
+            int changed = row->tries_per_chunk - base.tries_per_chunk > 1e-6 ||
+                          base.tries_per_chunk - row->tries_per_chunk > 1e-6;
+            fprintf(stderr, "%-30s %u %3u  %10.1f -> %10.1f ns/op  %+6.1f%%%s%s\n", row->name,
+                    row->chunk_len, row->payload_len, base.ns_per_op, row->ns_per_op, change,
+                    slower ? "  REGRESSION" : "", changed ? "  OUTPUT CHANGED" : "");
+            regressions += slower || changed;
+        }
+    }
+    fclose(f);
+    return regressions;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--format csv|json] [--payloads 1,8,32] [--scale N] [--repeat N]\n"
+            "          [--baseline old.csv] [--threshold PCT] [--verbose]\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *format = "csv";
+    const char *baseline = NULL;
+    double threshold = 10.0;
+    unsigned payloads[MAX_PAYLOADS] = {1, 8, 32};
+    unsigned num_payloads = 3;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "--verbose")) {
+            esp_log_level_set("*", ESP_LOG_INFO);
+            continue;
+        }
+        const char *val = i + 1 < argc ? argv[++i] : NULL;
+        if (!val) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (!strcmp(arg, "--format") && (!strcmp(val, "csv") || !strcmp(val, "json"))) {
+            format = val;
+        } else if (!strcmp(arg, "--payloads")) {
+            char *end = (char *)val;
+            num_payloads = 0;
+            while (*end && num_payloads < MAX_PAYLOADS) {
+                unsigned long len = strtoul(end, &end, 10);
+                if (len == 0 || len > MAX_PAYLOAD_LEN) {
+                    usage(argv[0]);
+                    return 2;
+                }
+                payloads[num_payloads++] = (unsigned)len;
+                end += (*end == ',');
+            }
+        } else if (!strcmp(arg, "--scale")) {
+            scale = (unsigned)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--repeat")) {
+            repeat = (unsigned)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--baseline")) {
+            baseline = val;
+        } else if (!strcmp(arg, "--threshold")) {
+            threshold = strtod(val, NULL);
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (scale == 0 || repeat == 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    bench_validation();
+    for (unsigned chunk_len = 1; chunk_len <= 8; chunk_len++) {
+        bench_chunks(chunk_len);
+    }
+    for (unsigned chunk_len = 1; chunk_len <= 8; chunk_len++) {
+        for (unsigned p = 0; p < num_payloads; p++) {
+            bench_message(chunk_len, payloads[p]);
+        }
+    }
+
+    if (!strcmp(format, "json")) {
+        print_json();
+    } else {
+        print_csv();
+    }
+    if (baseline) {
+        int regressions = compare_baseline(baseline, threshold);
+        if (regressions != 0) {
+            fprintf(stderr, regressions < 0 ? "baseline not readable\n" : "%d regression(s)\n", regressions);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+/* Runs the modem core like send_post_handler() does for one POST and records what it advertises.
+
+     sendmy-modem-capture --message TEXT [--modem cafe0000] [--message-id N] [--chunk-len 4]
+                          [--repetitions 50] [--dwell-ms 20] [--adv-interval-ms 1000]
+                          [--epoch-ms T] [--seed N] [--out capture.pcap]
+
+   The transmit profile options are those of the firmware's /profile endpoint (see modem.h).
+
+   The capture (LINKTYPE_BLUETOOTH_LE_LL, see gap_pcap.h) is stamped with virtual time starting at
+   --epoch-ms and is the same for the same arguments, so comparing it against an earlier one checks
+   the modem's output bit for bit. On exit the tool prints the key and frame counts, the virtual
+   airtime, and the keys/s and frames/s the host produced them at. */
+
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "gap_pcap.h"
+#include "modem.h"
+
+#define MAX_MESSAGE_LEN 100
+
+static double now_s(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s --message TEXT [--modem <hex id>] [--message-id N] [--chunk-len N]\n"
+            "          [--repetitions N] [--dwell-ms MS] [--adv-interval-ms MS] [--epoch-ms T] [--seed N]\n"
+            "          [--out capture.pcap] [--verbose]\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *message = NULL;
+    const char *out = NULL;
+    uint32_t message_id = 0;
+    modem_profile_t profile = MODEM_PROFILE_DEFAULT;
+    uint64_t epoch_ms = 0;
+    uint32_t seed = 1;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        if (!strcmp(arg, "--verbose")) {
+            esp_log_level_set("*", ESP_LOG_INFO);
+            continue;
+        }
+        const char *val = i + 1 < argc ? argv[++i] : NULL;
+        if (!val) {
+            usage(argv[0]);
+            return 2;
+        }
+        if (!strcmp(arg, "--message")) {
+            message = val;
+        } else if (!strcmp(arg, "--modem")) {
+            modem_id = (uint32_t)strtoul(val, NULL, 16);
+        } else if (!strcmp(arg, "--message-id")) {
+            message_id = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--chunk-len")) {
+            profile.chunk_len = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--repetitions")) {
+            profile.repetitions = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--dwell-ms")) {
+            profile.dwell_ms = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--adv-interval-ms")) {
+            profile.adv_interval_ms = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--epoch-ms")) {
+            epoch_ms = strtoull(val, NULL, 10);
+        } else if (!strcmp(arg, "--seed")) {
+            seed = (uint32_t)strtoul(val, NULL, 10);
+        } else if (!strcmp(arg, "--out")) {
+            out = val;
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!message || !*message || strlen(message) > MAX_MESSAGE_LEN || modem_set_profile(&profile) != ESP_OK) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    /* NUL-terminated like the HTTP handler's buffer. */
+    uint8_t payload[MAX_MESSAGE_LEN + 1];
+    uint32_t len = (uint32_t)strlen(message);
+    memcpy(payload, message, len + 1);
+
+    gap_pcap_seed(seed);
+    if (out && gap_pcap_open(out, epoch_ms * 1000) != 0) {
+        perror(out);
+        return 1;
+    }
+
+    uint64_t tries = 0;
+    double t0 = now_s();
+    for (uint32_t r = 0; r < modem_profile.repetitions; r++) {
+        tries += send_data_once_blocking(payload, len, modem_profile.chunk_len, message_id);
+    }
+    double wall = now_s() - t0;
+    if (gap_pcap_close() != 0) {
+        perror(out);
+        return 1;
+    }
+
+    gap_pcap_stats_t stats;
+    gap_pcap_get_stats(&stats);
+    double airtime = (double)xTaskGetTickCount() * portTICK_PERIOD_MS / 1000;
+    fprintf(stderr,
+            "%" PRIu64 " keys (%" PRIu64 " tried), %" PRIu64 " advertising events, %" PRIu64 " frames\n"
+            "virtual airtime %.2f s, %.1f keys/s on air\n"
+            "host %.3f s, %.0f keys/s, %.0f frames/s\n",
+            stats.advertisements, tries, stats.events, stats.frames, airtime,
+            airtime > 0 ? (double)stats.advertisements / airtime : 0.0, wall,
+            wall > 0 ? (double)stats.advertisements / wall : 0.0,
+            wall > 0 ? (double)stats.frames / wall : 0.0);
+    return 0;
+}
@@ -2,3 +2,15 @@
 # "main" pseudo-component makefile.
 #
 # (Uses default behaviour of compiling all source files in directory, adding 'include' to include path.)
+
+# Only secp224r1 is ever used; resolve uECC's curve dispatch at compile time.
+CFLAGS += -DuECC_SPECIALIZE_secp224r1=1
+# MULL/MULUH multiply and square kernels from asm_xtensa.inc; squaring takes 28 word products
+# instead of 49. Not selected from __XTENSA__: the kernels still have to be verified on a device.
+ifdef CONFIG_SENDMY_UECC_XTENSA_ASM
+CFLAGS += -DuECC_PLATFORM=uECC_xtensa -DuECC_SQUARE_FUNC=1
+endif
+# uECC_decompress() with 28 KB of roots of unity instead of the NIST square root routine.
+ifdef CONFIG_SENDMY_UECC_SQRT_TABLE
+CFLAGS += -DuECC_SQRT_TABLE_secp224r1=1
+endif
@@ -0,0 +1,89 @@
+/* GAP backend of the modem on the ESP32's Bluedroid stack. */
+
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_gap_ble_api.h"
+#include "esp_log.h"
+
+#include "modem_gap.h"
+
+static const char* LOG_TAG = "findmy_modem";
+
+/* https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/bluetooth/esp_gap_ble.html#_CPPv420esp_ble_adv_params_t */
+static esp_ble_adv_params_t ble_adv_params = {
+    // Advertising min interval:
+    // Minimum advertising interval for undirected and low duty cycle
+    // directed advertising. Range: 0x0020 to 0x4000 Default: N = 0x0800
+    // (1.28 second) Time = N * 0.625 msec Time Range: 20 ms to 10.24 sec
+    .adv_int_min        = MODEM_ADV_INT_MIN,
+    // Advertising max interval:
+    // Maximum advertising interval for undirected and low duty cycle
+    // directed advertising. Range: 0x0020 to 0x4000 Default: N = 0x0800
+    // (1.28 second) Time = N * 0.625 msec Time Range: 20 ms to 10.24 sec
+    .adv_int_max        = MODEM_ADV_INT_MAX,
+    // Advertisement type
+    .adv_type           = ADV_TYPE_NONCONN_IND,
+    // Use the random address
+    .own_addr_type      = BLE_ADDR_TYPE_RANDOM,
+    // All channels
+    .channel_map        = ADV_CHNL_ALL,
+    // Allow both scan and connection requests from anyone. 
+    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
+};
+
+static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
+{
+    esp_err_t err;
+
+    switch (event) {
+        case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
+            esp_ble_gap_start_advertising(&ble_adv_params);
+            break;
+
+        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
+            // is it running?
+            if ((err = param->adv_start_cmpl.status) != ESP_BT_STATUS_SUCCESS) {
+                ESP_LOGE(LOG_TAG, "advertising start failed: %s", esp_err_to_name(err));
+            } else {
+                ESP_LOGI(LOG_TAG, "advertising started");
+            }
+            break;
+
+        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
+            if ((err = param->adv_stop_cmpl.status) != ESP_BT_STATUS_SUCCESS){
+                ESP_LOGE(LOG_TAG, "adv stop failed: %s", esp_err_to_name(err));
+            }
+            else {
+                ESP_LOGI(LOG_TAG, "advertising stopped");
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+esp_err_t modem_gap_init(void) {
+    return esp_ble_gap_register_callback(esp_gap_cb);
+}
+
+esp_err_t modem_gap_set_rand_addr(esp_bd_addr_t addr) {
+    return esp_ble_gap_set_rand_addr(addr);
+}
+
+esp_err_t modem_gap_set_adv_interval(uint16_t int_min, uint16_t int_max) {
+    if (int_min < 0x0020 || int_max > 0x4000 || int_min > int_max) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ble_adv_params.adv_int_min = int_min;
+    ble_adv_params.adv_int_max = int_max;
+    return ESP_OK;
+}
+
+esp_err_t modem_gap_config_adv_data_raw(uint8_t *data, uint32_t len) {
+    return esp_ble_gap_config_adv_data_raw(data, len);
+}
+
+esp_err_t modem_gap_stop_advertising(void) {
+    return esp_ble_gap_stop_advertising();
+}
@@ -0,0 +1,218 @@
+#include <stdint.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "uECC.h"
+#include "modem.h"
+#include "modem_gap.h"
+
+static const char* LOG_TAG = "findmy_modem";
+
+// Set custom modem id before flashing:
+uint32_t modem_id = 0xcafe0000;
+
+/** Random device address */
+esp_bd_addr_t rnd_addr = { 0xFF, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
+
+/** Advertisement payload */
+uint8_t adv_data[31] = {
+    0x1e, /* Length (30) */
+    0xff, /* Manufacturer Specific Data (type 0xff) */
+    0x4c, 0x00, /* Company ID (Apple) */
+    0x12, 0x19, /* Offline Finding type and length */
+    0x00, /* State */
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, /* First two bits */
+    0x00, /* Hint (0x00) */
+};
+
+uint8_t start_addr[20] = {
+    0x00, 0x00, 0x00, 0x00, 
+    0x00, 0x00, 0x00, 0x00, 
+    0x00, 0x00, 0x00, 0x00, 
+    0x00, 0x00, 0x00, 0x00, 
+    0x00, 0x00, 0x00, 0x00 
+};
+
+uint8_t curr_addr[20];  
+uint32_t current_message_id = 0;
+
+modem_profile_t modem_profile = MODEM_PROFILE_DEFAULT;
+
+esp_err_t modem_set_profile(const modem_profile_t *profile) {
+    if (profile->chunk_len < 1 || profile->chunk_len > 8 ||
+        profile->repetitions < 1 || profile->repetitions > MODEM_MAX_REPETITIONS ||
+        profile->dwell_ms < portTICK_PERIOD_MS || profile->dwell_ms % portTICK_PERIOD_MS ||
+        profile->adv_interval_ms < 20 || profile->adv_interval_ms > 10240) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    /* 0.625 ms units, with the same 1:2 spread as the default interval. */
+    uint16_t int_min = (uint16_t)(profile->adv_interval_ms * 8 / 5);
+    uint16_t int_max = int_min > 0x2000 ? 0x4000 : 2 * int_min;
+    esp_err_t err = modem_gap_set_adv_interval(int_min, int_max);
+    if (err != ESP_OK) {
+        return err;
+    }
+    modem_profile = *profile;
+    return ESP_OK;
+}
+
+int is_valid_pubkey(uint8_t *pub_key_compressed) {
+   uint8_t with_sign_byte[29];
+   const struct uECC_Curve_t * curve = uECC_secp224r1();
+   with_sign_byte[0] = 0x02;
+   memcpy(&with_sign_byte[1], pub_key_compressed, 28);
+   /* Same result as uECC_decompress() + uECC_valid_public_key(), without the square root. */
+   if(!uECC_valid_compressed_public_key(with_sign_byte, curve)) {
+       //ESP_LOGW(LOG_TAG, "Generated public key tested as invalid");
+       return 0;
+   }
+   return 1;
+}
+
+void pub_from_priv(uint8_t *pub_compressed, uint8_t *priv) {
+   const struct uECC_Curve_t * curve = uECC_secp224r1();
+   uint8_t pub_key_tmp[128];
+   uECC_compute_public_key(priv, pub_key_tmp, curve);
+   uECC_compress(pub_key_tmp, pub_compressed, curve);
+}
+
+void set_addr_from_key(esp_bd_addr_t addr, uint8_t *public_key) {
+    addr[0] = public_key[0] | 0b11000000;
+    addr[1] = public_key[1];
+    addr[2] = public_key[2];
+    addr[3] = public_key[3];
+    addr[4] = public_key[4];
+    addr[5] = public_key[5];
+}
+
+void set_payload_from_key(uint8_t *payload, uint8_t *public_key) {
+    /* copy last 22 bytes */
+    memcpy(&payload[7], &public_key[6], 22);
+    /* append two bits of public key */
+    payload[29] = public_key[0] >> 6;
+}
+
+void copy_4b_big_endian(uint8_t *dst, uint8_t *src) {
+    dst[0] = src[3]; dst[1] = src[2]; dst[2] = src[1]; dst[3] = src[0];
+}
+
+void copy_2b_big_endian(uint8_t *dst, uint8_t *src) {
+    dst[0] = src[1]; dst[1] = src[0];
+}
+
+// index as first part of payload to have an often changing MAC address
+// [2 byte magic] [4 byte modem_id] [2 byte tweak] [20 byte payload]
+uint16_t set_addr_and_payload_for_byte(uint32_t index, uint32_t msg_id, uint8_t val, uint32_t chunk_len) {
+    uint16_t valid_key_counter = 0;
+    /* One spare byte: when the offset wraps to 0, the chunk is XORed at [28], outside the key. */
+    static uint8_t public_key[29] = {0};
+    public_key[0] = 0xBA; // magic value
+    public_key[1] = 0xBE;
+    copy_4b_big_endian(&public_key[2], (uint8_t *)&modem_id);
+    public_key[6] = 0x00;
+    public_key[7] = 0x00;
+    if (index) {
+        memcpy(&public_key[8], &curr_addr, 20);
+    } else {
+        memcpy(&public_key[8], &start_addr, 20);
+    }
+
+    uint32_t offset = (chunk_len * (index + 1)) % (8 * chunk_len * (20 / chunk_len)); // mod the offset correctly
+    uint32_t remain = 8 - ((chunk_len * index) % 8);
+    
+    if (remain == chunk_len) {
+        uint8_t xor_val = val << (8 - remain);
+        public_key[28 - (offset/8)] ^= xor_val;
+    } else if (remain > chunk_len) {
+        uint8_t xor_val = val << (8 - remain);
+        public_key[28 - ((offset/8) + 1)] ^= xor_val;
+    } else { 
+        uint8_t xor_val_lo = val << (8 - remain);
+        uint8_t xor_val_hi = val >> remain;
+        public_key[28 - ((offset/8))] ^= xor_val_lo;
+        public_key[28 - ((offset/8) + 1)] ^= xor_val_hi;
+    }
+
+    memcpy(&curr_addr, &public_key[8], 20);
+
+    do {
+      copy_2b_big_endian(&public_key[6], (uint8_t *)&valid_key_counter);
+	    valid_key_counter++;
+    } while (!is_valid_pubkey(public_key));
+
+    ESP_LOGI(LOG_TAG, "  pub key to use (%d. try): %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x", valid_key_counter, public_key[0], public_key[1], public_key[2], public_key[3], public_key[4], public_key[5], public_key[6], public_key[7], public_key[8], public_key[9], public_key[10], public_key[11], public_key[12], public_key[13],public_key[14], public_key[15],public_key[16],public_key[17],public_key[18], public_key[19], public_key[20], public_key[21], public_key[22], public_key[23], public_key[24], public_key[25], public_key[26],  public_key[27]);
+
+    set_addr_from_key(rnd_addr, public_key);
+    set_payload_from_key(adv_data, public_key);
+    return valid_key_counter;
+}
+
+void reset_advertising(void) {
+    esp_err_t status;
+    modem_gap_stop_advertising();
+    if ((status = modem_gap_set_rand_addr(rnd_addr)) != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "couldn't set random address: %s", esp_err_to_name(status));
+        return;
+    }
+    if ((modem_gap_config_adv_data_raw((uint8_t*)&adv_data, sizeof(adv_data))) != ESP_OK) {
+        ESP_LOGE(LOG_TAG, "couldn't configure BLE adv: %s", esp_err_to_name(status));
+        return;
+    }
+}
+
+uint32_t send_data_once_blocking(uint8_t* data_to_send, uint32_t len, uint32_t chunk_len, uint32_t msg_id) {
+    ESP_LOGI(LOG_TAG, "Data to send (msg_id: %d): %.*s", msg_id, (int)len, data_to_send);
+    ESP_LOGI(LOG_TAG, "Length %d", len);
+
+    int num_chunks = ((len * 8) / chunk_len);
+    ESP_LOGI(LOG_TAG, "Num chunks %d", num_chunks);
+    if ((len * 8) % chunk_len) { num_chunks++; }
+    
+    uint8_t mask = 0xff >> (8 - chunk_len);
+
+    uint32_t end = len - 1;   
+    uint32_t tries = 0;
+
+    for (int chunk_i = 0; chunk_i < num_chunks; chunk_i++) {
+        uint8_t val = 0;
+
+        uint32_t offset = chunk_i * chunk_len;
+        uint32_t remain = offset % 8;
+
+        
+        bool overlap = ((chunk_len * (chunk_i + 1)) / 8) != ((chunk_len * chunk_i) / 8);
+    
+        if (!overlap) {
+            val = data_to_send[end - (offset/8)] >> remain;
+            val &= mask;
+        } else { 
+            /* The last chunk can reach past the first byte of the message; those bits are 0. */
+            uint8_t val_hi = (offset/8) < end ? data_to_send[end - (offset/8) - 1] : 0;
+            val_hi = val_hi << (8 - remain);
+            val_hi &= mask; 
+            uint8_t val_lo = data_to_send[end - (offset/8)];
+            val_lo = val_lo >> remain;
+            val_lo &= mask;
+            val = val_lo ^ val_hi;
+        }
+
+
+        tries += set_addr_and_payload_for_byte(chunk_i, msg_id, val, chunk_len);
+        ESP_LOGD(LOG_TAG, "    resetting. Will now use device address: %02x %02x %02x %02x %02x %02x", rnd_addr[0], rnd_addr[1], rnd_addr[2], rnd_addr[3], rnd_addr[4], rnd_addr[5]);
+        reset_advertising();
+        vTaskDelay(modem_profile.dwell_ms / portTICK_PERIOD_MS);
+    }
+    modem_gap_stop_advertising();
+    return tries;
+}
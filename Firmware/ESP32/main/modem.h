@@ -0,0 +1,53 @@
+#ifndef _SENDMY_MODEM_H_
+#define _SENDMY_MODEM_H_
+
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+/* Encoding core of the modem: derives the public key advertised for every chunk of a message and
+   hands its address and payload to the BLE stack. It only needs the GAP, logging and task delay
+   APIs, so it also builds on a host against the stubs in ../host. */
+
+/** Modem id, part of every advertised key. Set a custom one before flashing. */
+extern uint32_t modem_id;
+extern uint32_t current_message_id;
+
+/** Random device address and advertisement payload of the current chunk */
+extern esp_bd_addr_t rnd_addr;
+extern uint8_t adv_data[31];
+
+/** How messages are put on the air. HostDecoder's sendmy-autotune picks one for a channel and a
+    mix of message sizes. */
+typedef struct {
+    uint32_t chunk_len;       /* bits per advertised key, 1 to 8 */
+    uint32_t repetitions;     /* times every message is sent */
+    uint32_t dwell_ms;        /* time every key is advertised, a multiple of the tick period */
+    uint32_t adv_interval_ms; /* minimum advertising interval, 20 to 10240 ms; the maximum is twice that,
+                                 at most 10240 ms */
+} modem_profile_t;
+
+#define MODEM_PROFILE_DEFAULT { .chunk_len = 4, .repetitions = 50, .dwell_ms = 20, .adv_interval_ms = 1000 }
+#define MODEM_MAX_REPETITIONS 1000
+
+/** The profile in use. Change it with modem_set_profile(). */
+extern modem_profile_t modem_profile;
+
+/** Makes profile the one in use and passes its advertising interval to the GAP. Returns
+    ESP_ERR_INVALID_ARG, and keeps the old one, if a field is out of range. */
+esp_err_t modem_set_profile(const modem_profile_t *profile);
+
+int is_valid_pubkey(uint8_t *pub_key_compressed);
+void pub_from_priv(uint8_t *pub_compressed, uint8_t *priv);
+
+/** Sets rnd_addr and adv_data for one chunk. Returns the number of keys tried until one was on
+    the curve. */
+uint16_t set_addr_and_payload_for_byte(uint32_t index, uint32_t msg_id, uint8_t val, uint32_t chunk_len);
+
+void reset_advertising(void);
+
+/** Advertises every chunk of data_to_send once, each for modem_profile.dwell_ms. Returns the number of keys tried. */
+uint32_t send_data_once_blocking(uint8_t* data_to_send, uint32_t len, uint32_t chunk_len, uint32_t msg_id);
+
+#endif /* _SENDMY_MODEM_H_ */
@@ -0,0 +1,29 @@
+#ifndef _SENDMY_MODEM_GAP_H_
+#define _SENDMY_MODEM_GAP_H_
+
+#include <stdint.h>
+
+#include "esp_bt_defs.h"
+#include "esp_err.h"
+
+/* The GAP calls the modem core makes. gap_esp32.c implements them on Bluedroid; on a host,
+   ../host/gap_pcap.c records the advertisements to a capture file instead. */
+
+/* Default advertising interval, in units of 0.625 ms (1 s to 2 s) */
+#define MODEM_ADV_INT_MIN 0x0640
+#define MODEM_ADV_INT_MAX 0x0C80
+
+esp_err_t modem_gap_init(void);
+esp_err_t modem_gap_set_rand_addr(esp_bd_addr_t addr);
+
+/** Sets the advertising interval, in units of 0.625 ms (0x0020 to 0x4000), for the next
+    advertisement. */
+esp_err_t modem_gap_set_adv_interval(uint16_t int_min, uint16_t int_max);
+
+/** Sets the raw advertisement and (re)starts non-connectable advertising with it and the last
+    random address. */
+esp_err_t modem_gap_config_adv_data_raw(uint8_t *data, uint32_t len);
+
+esp_err_t modem_gap_stop_advertising(void);
+
+#endif /* _SENDMY_MODEM_GAP_H_ */
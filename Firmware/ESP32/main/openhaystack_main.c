@@ -2,8 +2,10 @@
 #include <string.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "nvs_flash.h"
+#include "nvs.h"
 #include "esp_partition.h"
 
 #include "esp_bt.h"
@@ -22,6 +24,8 @@
 #include "sdkconfig.h"
 
 #include "uECC.h"
+#include "modem.h"
+#include "modem_gap.h"
 
 #include <esp_wifi.h>
 #include <esp_http_server.h>
@@ -86,101 +90,14 @@ static const char *TAG = "wifi station";
 static int s_retry_num = 0;
 
 
-// Set custom modem id before flashing:
-static uint32_t modem_id = 0xcafe0000;
-
 static const char* LOG_TAG = "findmy_modem";
 
-/** Callback function for BT events */
-static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
-
-/** Random device address */
-static esp_bd_addr_t rnd_addr = { 0xFF, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF };
-
-/** Advertisement payload */
-static uint8_t adv_data[31] = {
-    0x1e, /* Length (30) */
-    0xff, /* Manufacturer Specific Data (type 0xff) */
-    0x4c, 0x00, /* Company ID (Apple) */
-    0x12, 0x19, /* Offline Finding type and length */
-    0x00, /* State */
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-    0x00, /* First two bits */
-    0x00, /* Hint (0x00) */
-};
-
-uint8_t start_addr[20] = {
-    0x00, 0x00, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00, 
-    0x00, 0x00, 0x00, 0x00 
-};
-
-uint8_t curr_addr[20];  
-uint32_t current_message_id = 0;
-
 uint32_t swap_uint32( uint32_t val )
 {
     val = ((val << 8) & 0xFF00FF00 ) | ((val >> 8) & 0xFF00FF );
     return (val << 16) | (val >> 16);
 };
 
-/* https://docs.espressif.com/projects/esp-idf/en/latest/esp32/api-reference/bluetooth/esp_gap_ble.html#_CPPv420esp_ble_adv_params_t */
-static esp_ble_adv_params_t ble_adv_params = {
-    // Advertising min interval:
-    // Minimum advertising interval for undirected and low duty cycle
-    // directed advertising. Range: 0x0020 to 0x4000 Default: N = 0x0800
-    // (1.28 second) Time = N * 0.625 msec Time Range: 20 ms to 10.24 sec
-    .adv_int_min        = 0x0640, 
-    // Advertising max interval:
-    // Maximum advertising interval for undirected and low duty cycle
-    // directed advertising. Range: 0x0020 to 0x4000 Default: N = 0x0800
-    // (1.28 second) Time = N * 0.625 msec Time Range: 20 ms to 10.24 sec
-    .adv_int_max        = 0x0C80, 
-    // Advertisement type
-    .adv_type           = ADV_TYPE_NONCONN_IND,
-    // Use the random address
-    .own_addr_type      = BLE_ADDR_TYPE_RANDOM,
-    // All channels
-    .channel_map        = ADV_CHNL_ALL,
-    // Allow both scan and connection requests from anyone. 
-    .adv_filter_policy = ADV_FILTER_ALLOW_SCAN_ANY_CON_ANY,
-};
-
-static void esp_gap_cb(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
-{
-    esp_err_t err;
-
-    switch (event) {
-        case ESP_GAP_BLE_ADV_DATA_RAW_SET_COMPLETE_EVT:
-            esp_ble_gap_start_advertising(&ble_adv_params);
-            break;
-
-        case ESP_GAP_BLE_ADV_START_COMPLETE_EVT:
-            // is it running?
-            if ((err = param->adv_start_cmpl.status) != ESP_BT_STATUS_SUCCESS) {
-                ESP_LOGE(LOG_TAG, "advertising start failed: %s", esp_err_to_name(err));
-            } else {
-                ESP_LOGI(LOG_TAG, "advertising started");
-            }
-            break;
-
-        case ESP_GAP_BLE_ADV_STOP_COMPLETE_EVT:
-            if ((err = param->adv_stop_cmpl.status) != ESP_BT_STATUS_SUCCESS){
-                ESP_LOGE(LOG_TAG, "adv stop failed: %s", esp_err_to_name(err));
-            }
-            else {
-                ESP_LOGI(LOG_TAG, "advertising stopped");
-            }
-            break;
-        default:
-            break;
-    }
-}
-
 static void event_handler(void* arg, esp_event_base_t event_base,
                                 int32_t event_id, void* event_data)
 {
@@ -268,95 +185,89 @@ void wifi_init_sta(void)
     }
 }
 
-int is_valid_pubkey(uint8_t *pub_key_compressed) {
-   uint8_t with_sign_byte[29];
-   uint8_t pub_key_uncompressed[128];
-   const struct uECC_Curve_t * curve = uECC_secp224r1();
-   with_sign_byte[0] = 0x02;
-   memcpy(&with_sign_byte[1], pub_key_compressed, 28);
-   uECC_decompress(with_sign_byte, pub_key_uncompressed, curve);
-   if(!uECC_valid_public_key(pub_key_uncompressed, curve)) {
-       //ESP_LOGW(LOG_TAG, "Generated public key tested as invalid");
-       return 0;
-   }
-   return 1;
-}
+#if CONFIG_SENDMY_UECC_BENCHMARK
+#include "xtensa/hal.h"
 
-void pub_from_priv(uint8_t *pub_compressed, uint8_t *priv) {
-   const struct uECC_Curve_t * curve = uECC_secp224r1();
-   uint8_t pub_key_tmp[128];
-   uECC_compute_public_key(priv, pub_key_tmp, curve);
-   uECC_compress(pub_key_tmp, pub_compressed, curve);
-}
-
-void set_addr_from_key(esp_bd_addr_t addr, uint8_t *public_key) {
-    addr[0] = public_key[0] | 0b11000000;
-    addr[1] = public_key[1];
-    addr[2] = public_key[2];
-    addr[3] = public_key[3];
-    addr[4] = public_key[4];
-    addr[5] = public_key[5];
-}
+#define UECC_BENCHMARK_KEYS 64
+#define UECC_BENCHMARK_PRIVS 8
+/* FNV-1a of the results below from the generic C build of uECC (uECC_arch_other, 32-bit words),
+ * so that the Xtensa kernels can be checked bit for bit on the device or under QEMU. Points are
+ * only hashed for valid keys: the square root of a non-residue is not specified. */
+#define UECC_BENCHMARK_DIGEST 0xbf137223u
 
-void set_payload_from_key(uint8_t *payload, uint8_t *public_key) {
-    /* copy last 22 bytes */
-    memcpy(&payload[7], &public_key[6], 22);
-    /* append two bits of public key */
-    payload[29] = public_key[0] >> 6;
-}
-
-void copy_4b_big_endian(uint8_t *dst, uint8_t *src) {
-    dst[0] = src[3]; dst[1] = src[2]; dst[2] = src[1]; dst[3] = src[0];
-}
-
-void copy_2b_big_endian(uint8_t *dst, uint8_t *src) {
-    dst[0] = src[1]; dst[1] = src[0];
+static uint32_t uecc_benchmark_hash(uint32_t hash, const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
 }
 
-// index as first part of payload to have an often changing MAC address
-// [2 byte magic] [4 byte modem_id] [2 byte tweak] [20 byte payload]
-void set_addr_and_payload_for_byte(uint32_t index, uint32_t msg_id, uint8_t val, uint32_t chunk_len) {
-    uint16_t valid_key_counter = 0;
-    static uint8_t public_key[28] = {0};
-    public_key[0] = 0xBA; // magic value
-    public_key[1] = 0xBE;
-    copy_4b_big_endian(&public_key[2], &modem_id);
-    public_key[6] = 0x00;
-    public_key[7] = 0x00;
-    if (index) {
-        memcpy(&public_key[8], &curr_addr, 20);
-    } else {
-        memcpy(&public_key[8], &start_addr, 20);
+void uecc_benchmark(void) {
+    static uint8_t key[UECC_BENCHMARK_KEYS][29];
+    static uint8_t point[UECC_BENCHMARK_KEYS][56];
+    static uint8_t priv[UECC_BENCHMARK_PRIVS][28];
+    static uint8_t pub[UECC_BENCHMARK_PRIVS][56];
+    uint8_t valid_key[UECC_BENCHMARK_KEYS];
+    uint8_t valid_priv[UECC_BENCHMARK_PRIVS];
+    uint32_t state = 0x5e0d0001;
+    uint32_t valid = 0;
+    for (int i = 0; i < UECC_BENCHMARK_KEYS; i++) {
+        key[i][0] = 0x02;
+        for (size_t j = 1; j < sizeof(key[i]); j++) {
+            state = state * 1664525 + 1013904223;
+            key[i][j] = state >> 24;
+        }
     }
-
-    uint32_t offset = (chunk_len * (index + 1)) % (8 * chunk_len * (20 / chunk_len)); // mod the offset correctly
-    uint32_t remain = 8 - ((chunk_len * index) % 8);
-    
-    if (remain == chunk_len) {
-        uint8_t xor_val = val << (8 - remain);
-        public_key[28 - (offset/8)] ^= xor_val;
-    } else if (remain > chunk_len) {
-        uint8_t xor_val = val << (8 - remain);
-        public_key[28 - ((offset/8) + 1)] ^= xor_val;
-    } else { 
-        uint8_t xor_val_lo = val << (8 - remain);
-        uint8_t xor_val_hi = val >> remain;
-        public_key[28 - ((offset/8))] ^= xor_val_lo;
-        public_key[28 - ((offset/8) + 1)] ^= xor_val_hi;
+    for (int i = 0; i < UECC_BENCHMARK_PRIVS; i++) {
+        for (size_t j = 0; j < sizeof(priv[i]); j++) {
+            state = state * 1664525 + 1013904223;
+            priv[i][j] = state >> 24;
+        }
     }
+    uint32_t start = xthal_get_ccount();
+    for (int i = 0; i < UECC_BENCHMARK_KEYS; i++) {
+        valid_key[i] = is_valid_pubkey(&key[i][1]);
+    }
+    uint32_t cycles = xthal_get_ccount() - start;
+    for (int i = 0; i < UECC_BENCHMARK_KEYS; i++) {
+        valid += valid_key[i];
+    }
+    ESP_LOGI(LOG_TAG, "is_valid_pubkey: %u cycles per call (%u of %d keys valid)",
+             (unsigned) (cycles / UECC_BENCHMARK_KEYS), (unsigned) valid, UECC_BENCHMARK_KEYS);
 
-    memcpy(&curr_addr, &public_key[8], 20);
-
-    do {
-      copy_2b_big_endian(&public_key[6], &valid_key_counter);
-	    valid_key_counter++;
-    } while (!is_valid_pubkey(public_key));
-
-    ESP_LOGI(LOG_TAG, "  pub key to use (%d. try): %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x %02x", valid_key_counter, public_key[0], public_key[1], public_key[2], public_key[3], public_key[4], public_key[5], public_key[6], public_key[7], public_key[8], public_key[9], public_key[10], public_key[11], public_key[12], public_key[13],public_key[14], public_key[15],public_key[16],public_key[17],public_key[18], public_key[19], public_key[20], public_key[21], public_key[22], public_key[23], public_key[24], public_key[25], public_key[26],  public_key[27]);
+    start = xthal_get_ccount();
+    for (int i = 0; i < UECC_BENCHMARK_KEYS; i++) {
+        uECC_decompress(key[i], point[i], uECC_secp224r1());
+    }
+    cycles = xthal_get_ccount() - start;
+    ESP_LOGI(LOG_TAG, "uECC_decompress: %u cycles per call", (unsigned) (cycles / UECC_BENCHMARK_KEYS));
 
-    set_addr_from_key(rnd_addr, public_key);
-    set_payload_from_key(adv_data, public_key);
+    start = xthal_get_ccount();
+    for (int i = 0; i < UECC_BENCHMARK_PRIVS; i++) {
+        valid_priv[i] = uECC_compute_public_key(priv[i], pub[i], uECC_secp224r1());
+    }
+    cycles = xthal_get_ccount() - start;
+    ESP_LOGI(LOG_TAG, "uECC_compute_public_key: %u cycles per call", (unsigned) (cycles / UECC_BENCHMARK_PRIVS));
+
+    uint32_t digest = 2166136261u;
+    for (int i = 0; i < UECC_BENCHMARK_KEYS; i++) {
+        digest = uecc_benchmark_hash(digest, &valid_key[i], 1);
+        if (valid_key[i]) {
+            digest = uecc_benchmark_hash(digest, point[i], sizeof(point[i]));
+        }
+    }
+    for (int i = 0; i < UECC_BENCHMARK_PRIVS; i++) {
+        digest = uecc_benchmark_hash(digest, &valid_priv[i], 1);
+        digest = uecc_benchmark_hash(digest, pub[i], sizeof(pub[i]));
+    }
+    if (digest == UECC_BENCHMARK_DIGEST) {
+        ESP_LOGI(LOG_TAG, "uECC results match the generic build");
+    } else {
+        ESP_LOGE(LOG_TAG, "uECC results differ from the generic build: digest %08x, expected %08x",
+                 (unsigned) digest, (unsigned) UECC_BENCHMARK_DIGEST);
+    }
 }
+#endif
 
 // No error handling yet
 uint8_t* read_line_or_dismiss(int* len) {
@@ -376,63 +287,6 @@ uint8_t* read_line_or_dismiss(int* len) {
         else { free(line); ESP_LOGI(LOG_TAG, "Dismissing line"); return 0; }
     }
 }
-void reset_advertising() {
-    esp_err_t status;
-    esp_ble_gap_stop_advertising();
-    if ((status = esp_ble_gap_set_rand_addr(rnd_addr)) != ESP_OK) {
-        ESP_LOGE(LOG_TAG, "couldn't set random address: %s", esp_err_to_name(status));
-        return;
-    }
-    if ((esp_ble_gap_config_adv_data_raw((uint8_t*)&adv_data, sizeof(adv_data))) != ESP_OK) {
-        ESP_LOGE(LOG_TAG, "couldn't configure BLE adv: %s", esp_err_to_name(status));
-        return;
-    }
-}
-
-void send_data_once_blocking(uint8_t* data_to_send, uint32_t len, uint32_t chunk_len, uint32_t msg_id) {
-    ESP_LOGI(LOG_TAG, "Data to send (msg_id: %d): %s", msg_id, data_to_send);
-    ESP_LOGI(LOG_TAG, "Length %d", len);
-
-    int num_chunks = ((len * 8) / chunk_len);
-    ESP_LOGI(LOG_TAG, "Num chunks %d", num_chunks);
-    if ((len * 8) % chunk_len) { num_chunks++; }
-    
-    uint8_t mask = 0xff >> (8 - chunk_len);
-
-    uint8_t* data = data_to_send;
-    uint32_t end = len - 1;   
-
-    for (int chunk_i = 0; chunk_i < num_chunks; chunk_i++) {
-        uint8_t val = 0;
-
-        uint32_t offset = chunk_i * chunk_len;
-        uint32_t remain = offset % 8;
-
-        
-        bool overlap = ((chunk_len * (chunk_i + 1)) / 8) != ((chunk_len * chunk_i) / 8);
-    
-        if (!overlap) {
-            val = data_to_send[end - (offset/8)] >> remain;
-            val &= mask;
-        } else { 
-            uint8_t val_hi = data_to_send[end - (offset/8) - 1];
-            val_hi = val_hi << (8 - remain);
-            val_hi &= mask; 
-            uint8_t val_lo = data_to_send[end - (offset/8)];
-            val_lo = val_lo >> remain;
-            val_lo &= mask;
-            val = val_lo ^ val_hi;
-        }
-
-
-        set_addr_and_payload_for_byte(chunk_i, msg_id, val, chunk_len);
-        ESP_LOGD(LOG_TAG, "    resetting. Will now use device address: %02x %02x %02x %02x %02x %02x", rnd_addr[0], rnd_addr[1], rnd_addr[2], rnd_addr[3], rnd_addr[4], rnd_addr[5]);
-        reset_advertising();
-        vTaskDelay(2);    
-    }
-    esp_ble_gap_stop_advertising();
-}
-
 void init_serial() {
     uart_config_t uart_config = {
         .baud_rate = UART_BAUD_RATE,
@@ -482,8 +336,8 @@ static esp_err_t send_post_handler(httpd_req_t *req)
         ESP_LOGI(TAG, "%s", payload);
         
         ESP_LOGI(TAG, "Advertising with message ID %d", current_message_id);
-        for (int i = 0; i < 50; i++) {
-            send_data_once_blocking(payload, payload_len, 4, current_message_id);
+        for (int i = 0; i < modem_profile.repetitions; i++) {
+            send_data_once_blocking(payload, payload_len, modem_profile.chunk_len, current_message_id);
         }
     }    
     current_message_id++;
@@ -501,6 +355,116 @@ static const httpd_uri_t send = {
     .user_ctx  = NULL
 };
 
+/* The transmit profile survives reboots in NVS, as a modem_profile_t blob. */
+#define PROFILE_NVS_NAMESPACE "sendmy"
+#define PROFILE_NVS_KEY "profile"
+
+static void load_profile(void)
+{
+    nvs_handle_t nvs;
+    modem_profile_t profile;
+    size_t size = sizeof(profile);
+
+    if (nvs_open(PROFILE_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_blob(nvs, PROFILE_NVS_KEY, &profile, &size) == ESP_OK && size == sizeof(profile) &&
+        modem_set_profile(&profile) != ESP_OK) {
+        ESP_LOGW(LOG_TAG, "Ignoring the stored profile");
+    }
+    nvs_close(nvs);
+}
+
+static esp_err_t save_profile(void)
+{
+    nvs_handle_t nvs;
+    esp_err_t err = nvs_open(PROFILE_NVS_NAMESPACE, NVS_READWRITE, &nvs);
+
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(nvs, PROFILE_NVS_KEY, &modem_profile, sizeof(modem_profile));
+    if (err == ESP_OK) {
+        err = nvs_commit(nvs);
+    }
+    nvs_close(nvs);
+    return err;
+}
+
+static esp_err_t send_profile(httpd_req_t *req)
+{
+    char line[96];
+
+    snprintf(line, sizeof(line), "chunk_len=%u&repetitions=%u&dwell_ms=%u&adv_interval_ms=%u\n",
+             (unsigned) modem_profile.chunk_len, (unsigned) modem_profile.repetitions,
+             (unsigned) modem_profile.dwell_ms, (unsigned) modem_profile.adv_interval_ms);
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_sendstr(req, line);
+}
+
+static esp_err_t profile_get_handler(httpd_req_t *req)
+{
+    return send_profile(req);
+}
+
+/* Takes the fields to change as a form, e.g. chunk_len=5&repetitions=20 (what sendmy-autotune
+   prints), and answers with the whole profile. */
+static esp_err_t profile_post_handler(httpd_req_t *req)
+{
+    static const char *fields[] = { "chunk_len", "repetitions", "dwell_ms", "adv_interval_ms" };
+    char buf[128];
+    char val[12];
+    size_t len = 0;
+    int ret;
+
+    if (req->content_len >= sizeof(buf)) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "profile too long");
+    }
+    while (len < req->content_len) {
+        if ((ret = httpd_req_recv(req, buf + len, req->content_len - len)) <= 0) {
+            if (ret == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            return ESP_FAIL;
+        }
+        len += ret;
+    }
+    buf[len] = 0;
+
+    modem_profile_t profile = modem_profile;
+    uint32_t *values[] = { &profile.chunk_len, &profile.repetitions, &profile.dwell_ms, &profile.adv_interval_ms };
+    for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++) {
+        if (httpd_query_key_value(buf, fields[i], val, sizeof(val)) == ESP_OK) {
+            *values[i] = (uint32_t) strtoul(val, NULL, 10);
+        }
+    }
+    if (modem_set_profile(&profile) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "profile out of range");
+    }
+    esp_err_t err = save_profile();
+    if (err != ESP_OK) {
+        ESP_LOGW(LOG_TAG, "Profile not saved: %s", esp_err_to_name(err));
+    }
+    ESP_LOGI(LOG_TAG, "Profile: chunk_len %u, %u repetitions, dwell %u ms, interval %u ms",
+             (unsigned) profile.chunk_len, (unsigned) profile.repetitions, (unsigned) profile.dwell_ms,
+             (unsigned) profile.adv_interval_ms);
+    return send_profile(req);
+}
+
+static const httpd_uri_t profile_get = {
+    .uri       = "/profile",
+    .method    = HTTP_GET,
+    .handler   = profile_get_handler,
+    .user_ctx  = NULL
+};
+
+static const httpd_uri_t profile_post = {
+    .uri       = "/profile",
+    .method    = HTTP_POST,
+    .handler   = profile_post_handler,
+    .user_ctx  = NULL
+};
+
 static httpd_handle_t start_webserver(void)
 {
     httpd_handle_t server = NULL;
@@ -513,6 +477,8 @@ static httpd_handle_t start_webserver(void)
         // Set URI handlers
         ESP_LOGI(TAG, "Registering URI handlers");
         httpd_register_uri_handler(server, &send);
+        httpd_register_uri_handler(server, &profile_get);
+        httpd_register_uri_handler(server, &profile_post);
         #if CONFIG_EXAMPLE_BASIC_AUTH
         httpd_register_basic_auth(server);
         #endif
@@ -532,6 +498,9 @@ static esp_err_t stop_webserver(httpd_handle_t server)
 void app_main(void)
 {
     static httpd_handle_t server = NULL;
+#if CONFIG_SENDMY_UECC_BENCHMARK
+    uecc_benchmark();
+#endif
     ESP_ERROR_CHECK(nvs_flash_init());
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
     esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
@@ -543,10 +512,11 @@ void app_main(void)
 
     esp_err_t status;
     //register the scan callback function to the gap module
-    if ((status = esp_ble_gap_register_callback(esp_gap_cb)) != ESP_OK) {
+    if ((status = modem_gap_init()) != ESP_OK) {
         ESP_LOGE(LOG_TAG, "gap register error: %s", esp_err_to_name(status));
         return;
     }
+    load_profile();
 
     ESP_LOGI(TAG, "ESP_WIFI_MODE_STA");
     wifi_init_sta();
@@ -556,6 +526,6 @@ void app_main(void)
 
     server = start_webserver();
 
-    esp_ble_gap_stop_advertising();
+    modem_gap_stop_advertising();
 }
 
@@ -88,6 +88,20 @@
 
 #include "platform-specific.inc"
 
+#if uECC_SPECIALIZE_secp224r1 && defined(__GNUC__)
+    /* num_words is a compile-time constant then; have the word loops unrolled completely. */
+    #define uECC_UNROLL _Pragma("GCC unroll 8")
+#else
+    #define uECC_UNROLL
+#endif
+
+#if uECC_SPECIALIZE_secp224r1 && defined(__GNUC__) && !uECC_ENABLE_VLI_API
+    /* The small word routines and the reduction are inlined into the field operations. */
+    #define uECC_SPECIALIZED_INLINE inline __attribute__((always_inline))
+#else
+    #define uECC_SPECIALIZED_INLINE
+#endif
+
 #if (uECC_WORD_SIZE == 1)
     #if uECC_SUPPORTS_secp160r1
         #define uECC_MAX_WORDS 21 /* Due to the size of curve_n. */
@@ -162,6 +176,20 @@ struct uECC_Curve_t {
 #endif
 };
 
+#if uECC_SPECIALIZE_secp224r1
+    #if !uECC_SUPPORTS_secp224r1 || uECC_SUPPORTS_secp160r1 || uECC_SUPPORTS_secp192r1 || \
+        uECC_SUPPORTS_secp256r1 || uECC_SUPPORTS_secp256k1
+        #error "uECC_SPECIALIZE_secp224r1 requires secp224r1 to be the only supported curve"
+    #endif
+    /* Every curve argument is secp224r1. Reading the parameters and function pointers from the
+       constant struct itself lets the compiler fold num_words to a constant, turn the indirect
+       calls into direct ones it can inline, and unroll the word loops. */
+    static const struct uECC_Curve_t curve_secp224r1;
+    #define uECC_CURVE(curve) ((void)(curve), &curve_secp224r1)
+#else
+    #define uECC_CURVE(curve) (curve)
+#endif
+
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
 static void bcopy(uint8_t *dst,
                   const uint8_t *src,
@@ -173,7 +201,7 @@ static void bcopy(uint8_t *dst,
 }
 #endif
 
-static cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
+static uECC_SPECIALIZED_INLINE cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
                                        const uECC_word_t *right,
                                        wordcount_t num_words);
 
@@ -186,6 +214,14 @@ static cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
     #include "asm_avr.inc"
 #endif
 
+#if (uECC_PLATFORM == uECC_xtensa)
+    #include "asm_xtensa.inc"
+#endif
+
+#if (uECC_PLATFORM == uECC_x86_64)
+    #include "asm_x86_64.inc"
+#endif
+
 #if default_RNG_defined
 static uECC_RNG_Function g_rng_function = &default_RNG;
 #else
@@ -201,16 +237,17 @@ uECC_RNG_Function uECC_get_rng(void) {
 }
 
 int uECC_curve_private_key_size(uECC_Curve curve) {
-    return BITS_TO_BYTES(curve->num_n_bits);
+    return BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits);
 }
 
 int uECC_curve_public_key_size(uECC_Curve curve) {
-    return 2 * curve->num_bytes;
+    return 2 * uECC_CURVE(curve)->num_bytes;
 }
 
 #if !asm_clear
-uECC_VLI_API void uECC_vli_clear(uECC_word_t *vli, wordcount_t num_words) {
+uECC_VLI_API uECC_SPECIALIZED_INLINE void uECC_vli_clear(uECC_word_t *vli, wordcount_t num_words) {
     wordcount_t i;
+    uECC_UNROLL
     for (i = 0; i < num_words; ++i) {
         vli[i] = 0;
     }
@@ -219,9 +256,10 @@ uECC_VLI_API void uECC_vli_clear(uECC_word_t *vli, wordcount_t num_words) {
 
 /* Constant-time comparison to zero - secure way to compare long integers */
 /* Returns 1 if vli == 0, 0 otherwise. */
-uECC_VLI_API uECC_word_t uECC_vli_isZero(const uECC_word_t *vli, wordcount_t num_words) {
+uECC_VLI_API uECC_SPECIALIZED_INLINE uECC_word_t uECC_vli_isZero(const uECC_word_t *vli, wordcount_t num_words) {
     uECC_word_t bits = 0;
     wordcount_t i;
+    uECC_UNROLL
     for (i = 0; i < num_words; ++i) {
         bits |= vli[i];
     }
@@ -264,8 +302,9 @@ uECC_VLI_API bitcount_t uECC_vli_numBits(const uECC_word_t *vli, const wordcount
 
 /* Sets dest = src. */
 #if !asm_set
-uECC_VLI_API void uECC_vli_set(uECC_word_t *dest, const uECC_word_t *src, wordcount_t num_words) {
+uECC_VLI_API uECC_SPECIALIZED_INLINE void uECC_vli_set(uECC_word_t *dest, const uECC_word_t *src, wordcount_t num_words) {
     wordcount_t i;
+    uECC_UNROLL
     for (i = 0; i < num_words; ++i) {
         dest[i] = src[i];
     }
@@ -273,10 +312,11 @@ uECC_VLI_API void uECC_vli_set(uECC_word_t *dest, const uECC_word_t *src, wordco
 #endif /* !asm_set */
 
 /* Returns sign of left - right. */
-static cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
+static uECC_SPECIALIZED_INLINE cmpresult_t uECC_vli_cmp_unsafe(const uECC_word_t *left,
                                        const uECC_word_t *right,
                                        wordcount_t num_words) {
     wordcount_t i;
+    uECC_UNROLL
     for (i = num_words - 1; i >= 0; --i) {
         if (left[i] > right[i]) {
             return 1;
@@ -294,13 +334,14 @@ uECC_VLI_API uECC_word_t uECC_vli_equal(const uECC_word_t *left,
                                         wordcount_t num_words) {
     uECC_word_t diff = 0;
     wordcount_t i;
+    uECC_UNROLL
     for (i = num_words - 1; i >= 0; --i) {
         diff |= (left[i] ^ right[i]);
     }
     return (diff == 0);
 }
 
-uECC_VLI_API uECC_word_t uECC_vli_sub(uECC_word_t *result,
+uECC_VLI_API uECC_SPECIALIZED_INLINE uECC_word_t uECC_vli_sub(uECC_word_t *result,
                                       const uECC_word_t *left,
                                       const uECC_word_t *right,
                                       wordcount_t num_words);
@@ -332,12 +373,13 @@ uECC_VLI_API void uECC_vli_rshift1(uECC_word_t *vli, wordcount_t num_words) {
 
 /* Computes result = left + right, returning carry. Can modify in place. */
 #if !asm_add
-uECC_VLI_API uECC_word_t uECC_vli_add(uECC_word_t *result,
+uECC_VLI_API uECC_SPECIALIZED_INLINE uECC_word_t uECC_vli_add(uECC_word_t *result,
                                       const uECC_word_t *left,
                                       const uECC_word_t *right,
                                       wordcount_t num_words) {
     uECC_word_t carry = 0;
     wordcount_t i;
+    uECC_UNROLL
     for (i = 0; i < num_words; ++i) {
         uECC_word_t sum = left[i] + right[i] + carry;
         if (sum != left[i]) {
@@ -351,12 +393,13 @@ uECC_VLI_API uECC_word_t uECC_vli_add(uECC_word_t *result,
 
 /* Computes result = left - right, returning borrow. Can modify in place. */
 #if !asm_sub
-uECC_VLI_API uECC_word_t uECC_vli_sub(uECC_word_t *result,
+uECC_VLI_API uECC_SPECIALIZED_INLINE uECC_word_t uECC_vli_sub(uECC_word_t *result,
                                       const uECC_word_t *left,
                                       const uECC_word_t *right,
                                       wordcount_t num_words) {
     uECC_word_t borrow = 0;
     wordcount_t i;
+    uECC_UNROLL
     for (i = 0; i < num_words; ++i) {
         uECC_word_t diff = left[i] - right[i] - borrow;
         if (diff != left[i]) {
@@ -423,7 +466,9 @@ uECC_VLI_API void uECC_vli_mult(uECC_word_t *result,
     wordcount_t i, k;
 
     /* Compute each digit of result in sequence, maintaining the carries. */
+    uECC_UNROLL
     for (k = 0; k < num_words; ++k) {
+        uECC_UNROLL
         for (i = 0; i <= k; ++i) {
             muladd(left[i], right[k - i], &r0, &r1, &r2);
         }
@@ -432,7 +477,9 @@ uECC_VLI_API void uECC_vli_mult(uECC_word_t *result,
         r1 = r2;
         r2 = 0;
     }
+    uECC_UNROLL
     for (k = num_words; k < num_words * 2 - 1; ++k) {
+        uECC_UNROLL
         for (i = (k + 1) - num_words; i < num_words; ++i) {
             muladd(left[i], right[k - i], &r0, &r1, &r2);
         }
@@ -504,6 +551,7 @@ uECC_VLI_API void uECC_vli_square(uECC_word_t *result,
 
     wordcount_t i, k;
 
+    uECC_UNROLL
     for (k = 0; k < num_words * 2 - 1; ++k) {
         uECC_word_t min = (k < num_words ? 0 : (k + 1) - num_words);
         for (i = min; i <= k && i <= k - i; ++i) {
@@ -537,7 +585,7 @@ uECC_VLI_API void uECC_vli_square(uECC_word_t *result,
 
 /* Computes result = (left + right) % mod.
    Assumes that left < mod and right < mod, and that result does not overlap mod. */
-uECC_VLI_API void uECC_vli_modAdd(uECC_word_t *result,
+uECC_VLI_API uECC_SPECIALIZED_INLINE void uECC_vli_modAdd(uECC_word_t *result,
                                   const uECC_word_t *left,
                                   const uECC_word_t *right,
                                   const uECC_word_t *mod,
@@ -551,7 +599,7 @@ uECC_VLI_API void uECC_vli_modAdd(uECC_word_t *result,
 
 /* Computes result = (left - right) % mod.
    Assumes that left < mod and right < mod, and that result does not overlap mod. */
-uECC_VLI_API void uECC_vli_modSub(uECC_word_t *result,
+uECC_VLI_API uECC_SPECIALIZED_INLINE void uECC_vli_modSub(uECC_word_t *result,
                                   const uECC_word_t *left,
                                   const uECC_word_t *right,
                                   const uECC_word_t *mod,
@@ -624,11 +672,11 @@ uECC_VLI_API void uECC_vli_modMult_fast(uECC_word_t *result,
                                         const uECC_word_t *right,
                                         uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
-    uECC_vli_mult(product, left, right, curve->num_words);
+    uECC_vli_mult(product, left, right, uECC_CURVE(curve)->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
-    curve->mmod_fast(result, product);
+    uECC_CURVE(curve)->mmod_fast(result, product);
 #else
-    uECC_vli_mmod(result, product, curve->p, curve->num_words);
+    uECC_vli_mmod(result, product, uECC_CURVE(curve)->p, uECC_CURVE(curve)->num_words);
 #endif
 }
 
@@ -650,11 +698,11 @@ uECC_VLI_API void uECC_vli_modSquare_fast(uECC_word_t *result,
                                           const uECC_word_t *left,
                                           uECC_Curve curve) {
     uECC_word_t product[2 * uECC_MAX_WORDS];
-    uECC_vli_square(product, left, curve->num_words);
+    uECC_vli_square(product, left, uECC_CURVE(curve)->num_words);
 #if (uECC_OPTIMIZATION_LEVEL > 0)
-    curve->mmod_fast(result, product);
+    uECC_CURVE(curve)->mmod_fast(result, product);
 #else
-    uECC_vli_mmod(result, product, curve->p, curve->num_words);
+    uECC_vli_mmod(result, product, uECC_CURVE(curve)->p, uECC_CURVE(curve)->num_words);
 #endif
 }
 
@@ -738,6 +786,417 @@ uECC_VLI_API void uECC_vli_modInv(uECC_word_t *result,
     uECC_vli_set(result, u, num_words);
 }
 
+#if uECC_VARTIME_PUBLIC
+/* Variable-time inversion and Jacobi symbol after Bernstein and Yang, "Fast constant-time gcd
+   computation and modular inversion" (safegcd), in the form of libsecp256k1's modinv32_var and
+   jacobi32_maybe_var. Values are held in signed 30-bit limbs whatever the word size, so every
+   matrix product fits an int64_t. Batches of up to 30 divsteps run on the low bits of f and g
+   only and are then applied to the full numbers as a 2x2 matrix. */
+
+#define VT_LIMBS 9 /* 270 bits, for moduli up to 256 bits */
+#define VT_M30 ((int32_t)0x3FFFFFFF)
+#define VT_JACOBI_ITERATIONS 25
+
+typedef struct {
+    int32_t v[VT_LIMBS];
+} vt_signed30;
+
+/* [f', g'] * 2^30 = [[u, v], [q, r]] * [f, g] */
+typedef struct {
+    int32_t u, v, q, r;
+} vt_trans2x2;
+
+/* -(2 * i + 1)^-1 mod 256 */
+static const uint8_t vt_neg_inv256[128] = {
+    0xFF, 0x55, 0x33, 0x49, 0xC7, 0x5D, 0x3B, 0x11, 0x0F, 0xE5, 0xC3, 0x59, 0xD7, 0xED, 0xCB, 0x21,
+    0x1F, 0x75, 0x53, 0x69, 0xE7, 0x7D, 0x5B, 0x31, 0x2F, 0x05, 0xE3, 0x79, 0xF7, 0x0D, 0xEB, 0x41,
+    0x3F, 0x95, 0x73, 0x89, 0x07, 0x9D, 0x7B, 0x51, 0x4F, 0x25, 0x03, 0x99, 0x17, 0x2D, 0x0B, 0x61,
+    0x5F, 0xB5, 0x93, 0xA9, 0x27, 0xBD, 0x9B, 0x71, 0x6F, 0x45, 0x23, 0xB9, 0x37, 0x4D, 0x2B, 0x81,
+    0x7F, 0xD5, 0xB3, 0xC9, 0x47, 0xDD, 0xBB, 0x91, 0x8F, 0x65, 0x43, 0xD9, 0x57, 0x6D, 0x4B, 0xA1,
+    0x9F, 0xF5, 0xD3, 0xE9, 0x67, 0xFD, 0xDB, 0xB1, 0xAF, 0x85, 0x63, 0xF9, 0x77, 0x8D, 0x6B, 0xC1,
+    0xBF, 0x15, 0xF3, 0x09, 0x87, 0x1D, 0xFB, 0xD1, 0xCF, 0xA5, 0x83, 0x19, 0x97, 0xAD, 0x8B, 0xE1,
+    0xDF, 0x35, 0x13, 0x29, 0xA7, 0x3D, 0x1B, 0xF1, 0xEF, 0xC5, 0xA3, 0x39, 0xB7, 0xCD, 0xAB, 0x01
+};
+
+static int vt_ctz32(uint32_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(x);
+#else
+    int n = 0;
+    while (!(x & 1)) {
+        x >>= 1;
+        ++n;
+    }
+    return n;
+#endif
+}
+
+static void vli_to_signed30(vt_signed30 *out, const uECC_word_t *vli, wordcount_t num_words) {
+    uint64_t acc = 0;
+    int bits = 0;
+    int byte = 0;
+    int num_bytes = num_words * uECC_WORD_SIZE;
+    int i;
+    for (i = 0; i < VT_LIMBS; ++i) {
+        while (bits < 30 && byte < num_bytes) {
+            acc |= (uint64_t)(uint8_t)(vli[byte / uECC_WORD_SIZE] >> (8 * (byte % uECC_WORD_SIZE)))
+                   << bits;
+            bits += 8;
+            ++byte;
+        }
+        out->v[i] = (int32_t)(acc & VT_M30);
+        acc >>= 30;
+        bits = bits > 30 ? bits - 30 : 0;
+    }
+}
+
+/* in must be normalized (0 <= in < 2^(num_words * uECC_WORD_BITS)). */
+static void vli_from_signed30(uECC_word_t *vli, const vt_signed30 *in, wordcount_t num_words) {
+    uint64_t acc = 0;
+    int bits = 0;
+    int limb = 0;
+    int byte;
+    uECC_vli_clear(vli, num_words);
+    for (byte = 0; byte < num_words * uECC_WORD_SIZE; ++byte) {
+        if (bits < 8 && limb < VT_LIMBS) {
+            acc |= (uint64_t)(uint32_t)in->v[limb++] << bits;
+            bits += 30;
+        }
+        vli[byte / uECC_WORD_SIZE] |= (uECC_word_t)(acc & 0xFF) << (8 * (byte % uECC_WORD_SIZE));
+        acc >>= 8;
+        bits -= 8;
+    }
+}
+
+/* r += k * m, for k = 1 or -1. */
+static void signed30_add(vt_signed30 *r, const vt_signed30 *m, int32_t k) {
+    int64_t c = 0;
+    int i;
+    for (i = 0; i < VT_LIMBS - 1; ++i) {
+        c += (int64_t)r->v[i] + (int64_t)k * m->v[i];
+        r->v[i] = (int32_t)c & VT_M30;
+        c >>= 30;
+    }
+    r->v[VT_LIMBS - 1] = (int32_t)(c + r->v[VT_LIMBS - 1] + (int64_t)k * m->v[VT_LIMBS - 1]);
+}
+
+/* Brings r from (-2 * m, m) into [0, m), negated first if sign < 0. */
+static void signed30_normalize(vt_signed30 *r, int32_t sign, const vt_signed30 *m) {
+    vt_signed30 t;
+    int64_t c = 0;
+    int i;
+    if (sign < 0) {
+        for (i = 0; i < VT_LIMBS - 1; ++i) {
+            c -= r->v[i];
+            r->v[i] = (int32_t)c & VT_M30;
+            c >>= 30;
+        }
+        r->v[VT_LIMBS - 1] = (int32_t)(c - r->v[VT_LIMBS - 1]);
+    }
+    while (r->v[VT_LIMBS - 1] < 0) {
+        signed30_add(r, m, 1);
+    }
+    for (;;) {
+        t = *r;
+        signed30_add(&t, m, -1);
+        if (t.v[VT_LIMBS - 1] < 0) {
+            break;
+        }
+        *r = t;
+    }
+}
+
+/* Runs 30 divsteps on the low bits of f and g. eta is -delta. */
+static int32_t divsteps_30_vartime(int32_t eta, uint32_t f0, uint32_t g0, vt_trans2x2 *t) {
+    uint32_t u = 1, v = 0, q = 0, r = 1;
+    uint32_t f = f0, g = g0, m, w, tmp;
+    int i = 30, limit, zeros;
+
+    for (;;) {
+        /* The steps that only halve g, all at once; the sentinel bit stops at i. */
+        zeros = vt_ctz32(g | (UINT32_MAX << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        if (i == 0) {
+            break;
+        }
+        if (eta < 0) {
+            eta = -eta;
+            tmp = f; f = g; g = -tmp;
+            tmp = u; u = q; q = -tmp;
+            tmp = v; v = r; r = -tmp;
+        }
+        /* Cancel up to 8 bottom bits of g with a multiple of f, no more than eta + 1 (eta changes
+           sign then) or i (the batch ends). */
+        limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+        m = (UINT32_MAX >> (32 - limit)) & 255U;
+        w = (g * vt_neg_inv256[(f >> 1) & 127]) & m;
+        g += f * w;
+        q += u * w;
+        r += v * w;
+    }
+    t->u = (int32_t)u;
+    t->v = (int32_t)v;
+    t->q = (int32_t)q;
+    t->r = (int32_t)r;
+    return eta;
+}
+
+/* The same for posdivsteps (f and g stay positive), tracking the sign changes of the Jacobi
+   symbol (g | f) in the bottom bit of *jac. f0 and g0 need 32 valid bits. */
+static int32_t posdivsteps_30_vartime(int32_t eta,
+                                      uint32_t f0,
+                                      uint32_t g0,
+                                      vt_trans2x2 *t,
+                                      int *jac) {
+    uint32_t u = 1, v = 0, q = 0, r = 1;
+    uint32_t f = f0, g = g0, m, w, tmp;
+    int i = 30, limit, zeros;
+    int j = *jac;
+
+    for (;;) {
+        zeros = vt_ctz32(g | (UINT32_MAX << i));
+        g >>= zeros;
+        u <<= zeros;
+        v <<= zeros;
+        eta -= zeros;
+        i -= zeros;
+        /* (2 | f) = -1 for f = 3, 5 mod 8 */
+        j ^= (zeros & ((f >> 1) ^ (f >> 2)));
+        if (i == 0) {
+            break;
+        }
+        if (eta < 0) {
+            eta = -eta;
+            /* Quadratic reciprocity: the sign flips if f = g = 3 mod 4. */
+            j ^= ((f & g) >> 1);
+            tmp = f; f = g; g = tmp;
+            tmp = u; u = q; q = tmp;
+            tmp = v; v = r; r = tmp;
+        }
+        limit = ((int)eta + 1) > i ? i : ((int)eta + 1);
+        m = (UINT32_MAX >> (32 - limit)) & 255U;
+        w = (g * vt_neg_inv256[(f >> 1) & 127]) & m;
+        g += f * w;
+        q += u * w;
+        r += v * w;
+    }
+    t->u = (int32_t)u;
+    t->v = (int32_t)v;
+    t->q = (int32_t)q;
+    t->r = (int32_t)r;
+    *jac = j;
+    return eta;
+}
+
+/* [d, e] = (t * [d, e] + m * [md, me]) / 2^30 (mod m), with md, me chosen to make it exact. */
+static void update_de_30(vt_signed30 *d,
+                         vt_signed30 *e,
+                         const vt_trans2x2 *t,
+                         const vt_signed30 *m,
+                         uint32_t m_inv30) {
+    const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int32_t di, ei, md, me, sd, se;
+    int64_t cd, ce;
+    int i;
+
+    /* Keeps d and e within (-2 * m, m). */
+    sd = d->v[VT_LIMBS - 1] >> 31;
+    se = e->v[VT_LIMBS - 1] >> 31;
+    md = (u & sd) + (v & se);
+    me = (q & sd) + (r & se);
+    di = d->v[0];
+    ei = e->v[0];
+    cd = (int64_t)u * di + (int64_t)v * ei;
+    ce = (int64_t)q * di + (int64_t)r * ei;
+    md -= (int32_t)((m_inv30 * (uint32_t)cd + (uint32_t)md) & VT_M30);
+    me -= (int32_t)((m_inv30 * (uint32_t)ce + (uint32_t)me) & VT_M30);
+    cd += (int64_t)m->v[0] * md;
+    ce += (int64_t)m->v[0] * me;
+    cd >>= 30;
+    ce >>= 30;
+    for (i = 1; i < VT_LIMBS; ++i) {
+        di = d->v[i];
+        ei = e->v[i];
+        cd += (int64_t)u * di + (int64_t)v * ei + (int64_t)m->v[i] * md;
+        ce += (int64_t)q * di + (int64_t)r * ei + (int64_t)m->v[i] * me;
+        d->v[i - 1] = (int32_t)cd & VT_M30;
+        e->v[i - 1] = (int32_t)ce & VT_M30;
+        cd >>= 30;
+        ce >>= 30;
+    }
+    d->v[VT_LIMBS - 1] = (int32_t)cd;
+    e->v[VT_LIMBS - 1] = (int32_t)ce;
+}
+
+/* [f, g] = t * [f, g] / 2^30 on the bottom len limbs. */
+static void update_fg_30(int len, vt_signed30 *f, vt_signed30 *g, const vt_trans2x2 *t) {
+    const int32_t u = t->u, v = t->v, q = t->q, r = t->r;
+    int32_t fi, gi;
+    int64_t cf, cg;
+    int i;
+
+    fi = f->v[0];
+    gi = g->v[0];
+    cf = (int64_t)u * fi + (int64_t)v * gi;
+    cg = (int64_t)q * fi + (int64_t)r * gi;
+    cf >>= 30;
+    cg >>= 30;
+    for (i = 1; i < len; ++i) {
+        fi = f->v[i];
+        gi = g->v[i];
+        cf += (int64_t)u * fi + (int64_t)v * gi;
+        cg += (int64_t)q * fi + (int64_t)r * gi;
+        f->v[i - 1] = (int32_t)cf & VT_M30;
+        g->v[i - 1] = (int32_t)cg & VT_M30;
+        cf >>= 30;
+        cg >>= 30;
+    }
+    f->v[len - 1] = (int32_t)cf;
+    g->v[len - 1] = (int32_t)cg;
+}
+
+uECC_VLI_API void uECC_vli_modInv_vartime(uECC_word_t *result,
+                                          const uECC_word_t *input,
+                                          const uECC_word_t *mod,
+                                          wordcount_t num_words) {
+    vt_signed30 d = {{0}}, e = {{1}}, f, g, m;
+    uint32_t m_inv30;
+    int32_t eta = -1; /* delta = 1 */
+    int32_t cond, fn, gn;
+    int len = VT_LIMBS;
+    int i;
+
+    if (uECC_vli_isZero(input, num_words)) {
+        uECC_vli_clear(result, num_words);
+        return;
+    }
+
+    vli_to_signed30(&m, mod, num_words);
+    vli_to_signed30(&g, input, num_words);
+    f = m;
+    /* Newton's iteration, from the 3 bits every odd number is its own inverse to. */
+    m_inv30 = (uint32_t)m.v[0];
+    for (i = 0; i < 4; ++i) {
+        m_inv30 *= 2 - (uint32_t)m.v[0] * m_inv30;
+    }
+
+    for (;;) {
+        vt_trans2x2 t;
+        eta = divsteps_30_vartime(eta, (uint32_t)f.v[0], (uint32_t)g.v[0], &t);
+        update_de_30(&d, &e, &t, &m, m_inv30);
+        update_fg_30(len, &f, &g, &t);
+        if (g.v[0] == 0) {
+            cond = 0;
+            for (i = 1; i < len; ++i) {
+                cond |= g.v[i];
+            }
+            if (cond == 0) {
+                break;
+            }
+        }
+        /* Drop the top limb once both f and g fit in the ones below. */
+        fn = f.v[len - 1];
+        gn = g.v[len - 1];
+        cond = ((int32_t)len - 2) >> 31;
+        cond |= fn ^ (fn >> 31);
+        cond |= gn ^ (gn >> 31);
+        if (cond == 0) {
+            f.v[len - 2] |= (int32_t)((uint32_t)fn << 30);
+            g.v[len - 2] |= (int32_t)((uint32_t)gn << 30);
+            --len;
+        }
+    }
+    /* f is now +-1 and d +-1 / input. */
+    signed30_normalize(&d, f.v[len - 1], &m);
+    vli_from_signed30(result, &d, num_words);
+}
+
+/* Binary Jacobi algorithm, for the rare inputs the posdivsteps do not finish in time. */
+static int vli_jacobi_binary(const uECC_word_t *input, const uECC_word_t *mod, wordcount_t num_words) {
+    uECC_word_t a[uECC_MAX_WORDS], n[uECC_MAX_WORDS], t[uECC_MAX_WORDS];
+    uECC_word_t r;
+    int jac = 1;
+
+    uECC_vli_set(a, input, num_words);
+    uECC_vli_set(n, mod, num_words);
+    while (!uECC_vli_isZero(a, num_words)) {
+        while (EVEN(a)) {
+            uECC_vli_rshift1(a, num_words);
+            r = n[0] & 7;
+            if (r == 3 || r == 5) {
+                jac = -jac;
+            }
+        }
+        if (uECC_vli_cmp_unsafe(a, n, num_words) < 0) {
+            uECC_vli_set(t, a, num_words);
+            uECC_vli_set(a, n, num_words);
+            uECC_vli_set(n, t, num_words);
+            if ((a[0] & 3) == 3 && (n[0] & 3) == 3) {
+                jac = -jac;
+            }
+        }
+        uECC_vli_sub(a, a, n, num_words);
+    }
+    uECC_vli_clear(t, num_words);
+    t[0] = 1;
+    return uECC_vli_cmp_unsafe(n, t, num_words) == 0 ? jac : 0;
+}
+
+uECC_VLI_API int uECC_vli_jacobi_vartime(const uECC_word_t *input,
+                                         const uECC_word_t *mod,
+                                         wordcount_t num_words) {
+    vt_signed30 f, g;
+    int32_t eta = -1;
+    int32_t cond;
+    int len = VT_LIMBS;
+    int jac = 0;
+    int count, i;
+
+    if (uECC_vli_isZero(input, num_words)) {
+        return 0;
+    }
+
+    vli_to_signed30(&f, mod, num_words);
+    vli_to_signed30(&g, input, num_words);
+    for (count = 0; count < VT_JACOBI_ITERATIONS; ++count) {
+        vt_trans2x2 t;
+        eta = posdivsteps_30_vartime(eta,
+                                     (uint32_t)f.v[0] | ((uint32_t)f.v[1] << 30),
+                                     (uint32_t)g.v[0] | ((uint32_t)g.v[1] << 30),
+                                     &t,
+                                     &jac);
+        update_fg_30(len, &f, &g, &t);
+        if (f.v[0] == 1) {
+            cond = 0;
+            for (i = 1; i < len; ++i) {
+                cond |= f.v[i];
+            }
+            if (cond == 0) {
+                return 1 - 2 * (jac & 1);
+            }
+        }
+        cond = ((int32_t)len - 2) >> 31;
+        cond |= f.v[len - 1];
+        cond |= g.v[len - 1];
+        if (cond == 0) {
+            --len;
+        }
+    }
+    return vli_jacobi_binary(input, mod, num_words);
+}
+#endif /* uECC_VARTIME_PUBLIC */
+
+/* Inversion of values that are public anyway. */
+#if uECC_VARTIME_PUBLIC
+    #define vli_modInv_public uECC_vli_modInv_vartime
+#else
+    #define vli_modInv_public uECC_vli_modInv
+#endif
+
 /* ------ Point operations ------ */
 
 #include "curve-specific.inc"
@@ -770,7 +1229,7 @@ static void XYcZ_initial_double(uECC_word_t * X1,
                                 const uECC_word_t * const initial_Z,
                                 uECC_Curve curve) {
     uECC_word_t z[uECC_MAX_WORDS];
-    wordcount_t num_words = curve->num_words;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
     if (initial_Z) {
         uECC_vli_set(z, initial_Z, num_words);
     } else {
@@ -782,7 +1241,7 @@ static void XYcZ_initial_double(uECC_word_t * X1,
     uECC_vli_set(Y2, Y1, num_words);
 
     apply_z(X1, Y1, z, curve);
-    curve->double_jacobian(X1, Y1, z, curve);
+    uECC_CURVE(curve)->double_jacobian(X1, Y1, z, curve);
     apply_z(X2, Y2, z, curve);
 }
 
@@ -797,22 +1256,22 @@ static void XYcZ_add(uECC_word_t * X1,
                      uECC_Curve curve) {
     /* t1 = X1, t2 = Y1, t3 = X2, t4 = Y2 */
     uECC_word_t t5[uECC_MAX_WORDS];
-    wordcount_t num_words = curve->num_words;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
 
-    uECC_vli_modSub(t5, X2, X1, curve->p, num_words); /* t5 = x2 - x1 */
+    uECC_vli_modSub(t5, X2, X1, uECC_CURVE(curve)->p, num_words); /* t5 = x2 - x1 */
     uECC_vli_modSquare_fast(t5, t5, curve);                  /* t5 = (x2 - x1)^2 = A */
     uECC_vli_modMult_fast(X1, X1, t5, curve);                /* t1 = x1*A = B */
     uECC_vli_modMult_fast(X2, X2, t5, curve);                /* t3 = x2*A = C */
-    uECC_vli_modSub(Y2, Y2, Y1, curve->p, num_words); /* t4 = y2 - y1 */
+    uECC_vli_modSub(Y2, Y2, Y1, uECC_CURVE(curve)->p, num_words); /* t4 = y2 - y1 */
     uECC_vli_modSquare_fast(t5, Y2, curve);                  /* t5 = (y2 - y1)^2 = D */
 
-    uECC_vli_modSub(t5, t5, X1, curve->p, num_words); /* t5 = D - B */
-    uECC_vli_modSub(t5, t5, X2, curve->p, num_words); /* t5 = D - B - C = x3 */
-    uECC_vli_modSub(X2, X2, X1, curve->p, num_words); /* t3 = C - B */
+    uECC_vli_modSub(t5, t5, X1, uECC_CURVE(curve)->p, num_words); /* t5 = D - B */
+    uECC_vli_modSub(t5, t5, X2, uECC_CURVE(curve)->p, num_words); /* t5 = D - B - C = x3 */
+    uECC_vli_modSub(X2, X2, X1, uECC_CURVE(curve)->p, num_words); /* t3 = C - B */
     uECC_vli_modMult_fast(Y1, Y1, X2, curve);                /* t2 = y1*(C - B) */
-    uECC_vli_modSub(X2, X1, t5, curve->p, num_words); /* t3 = B - x3 */
+    uECC_vli_modSub(X2, X1, t5, uECC_CURVE(curve)->p, num_words); /* t3 = B - x3 */
     uECC_vli_modMult_fast(Y2, Y2, X2, curve);                /* t4 = (y2 - y1)*(B - x3) */
-    uECC_vli_modSub(Y2, Y2, Y1, curve->p, num_words); /* t4 = y3 */
+    uECC_vli_modSub(Y2, Y2, Y1, uECC_CURVE(curve)->p, num_words); /* t4 = y3 */
 
     uECC_vli_set(X2, t5, num_words);
 }
@@ -830,30 +1289,30 @@ static void XYcZ_addC(uECC_word_t * X1,
     uECC_word_t t5[uECC_MAX_WORDS];
     uECC_word_t t6[uECC_MAX_WORDS];
     uECC_word_t t7[uECC_MAX_WORDS];
-    wordcount_t num_words = curve->num_words;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
 
-    uECC_vli_modSub(t5, X2, X1, curve->p, num_words); /* t5 = x2 - x1 */
+    uECC_vli_modSub(t5, X2, X1, uECC_CURVE(curve)->p, num_words); /* t5 = x2 - x1 */
     uECC_vli_modSquare_fast(t5, t5, curve);                  /* t5 = (x2 - x1)^2 = A */
     uECC_vli_modMult_fast(X1, X1, t5, curve);                /* t1 = x1*A = B */
     uECC_vli_modMult_fast(X2, X2, t5, curve);                /* t3 = x2*A = C */
-    uECC_vli_modAdd(t5, Y2, Y1, curve->p, num_words); /* t5 = y2 + y1 */
-    uECC_vli_modSub(Y2, Y2, Y1, curve->p, num_words); /* t4 = y2 - y1 */
+    uECC_vli_modAdd(t5, Y2, Y1, uECC_CURVE(curve)->p, num_words); /* t5 = y2 + y1 */
+    uECC_vli_modSub(Y2, Y2, Y1, uECC_CURVE(curve)->p, num_words); /* t4 = y2 - y1 */
 
-    uECC_vli_modSub(t6, X2, X1, curve->p, num_words); /* t6 = C - B */
+    uECC_vli_modSub(t6, X2, X1, uECC_CURVE(curve)->p, num_words); /* t6 = C - B */
     uECC_vli_modMult_fast(Y1, Y1, t6, curve);                /* t2 = y1 * (C - B) = E */
-    uECC_vli_modAdd(t6, X1, X2, curve->p, num_words); /* t6 = B + C */
+    uECC_vli_modAdd(t6, X1, X2, uECC_CURVE(curve)->p, num_words); /* t6 = B + C */
     uECC_vli_modSquare_fast(X2, Y2, curve);                  /* t3 = (y2 - y1)^2 = D */
-    uECC_vli_modSub(X2, X2, t6, curve->p, num_words); /* t3 = D - (B + C) = x3 */
+    uECC_vli_modSub(X2, X2, t6, uECC_CURVE(curve)->p, num_words); /* t3 = D - (B + C) = x3 */
 
-    uECC_vli_modSub(t7, X1, X2, curve->p, num_words); /* t7 = B - x3 */
+    uECC_vli_modSub(t7, X1, X2, uECC_CURVE(curve)->p, num_words); /* t7 = B - x3 */
     uECC_vli_modMult_fast(Y2, Y2, t7, curve);                /* t4 = (y2 - y1)*(B - x3) */
-    uECC_vli_modSub(Y2, Y2, Y1, curve->p, num_words); /* t4 = (y2 - y1)*(B - x3) - E = y3 */
+    uECC_vli_modSub(Y2, Y2, Y1, uECC_CURVE(curve)->p, num_words); /* t4 = (y2 - y1)*(B - x3) - E = y3 */
 
     uECC_vli_modSquare_fast(t7, t5, curve);                  /* t7 = (y2 + y1)^2 = F */
-    uECC_vli_modSub(t7, t7, t6, curve->p, num_words); /* t7 = F - (B + C) = x3' */
-    uECC_vli_modSub(t6, t7, X1, curve->p, num_words); /* t6 = x3' - B */
+    uECC_vli_modSub(t7, t7, t6, uECC_CURVE(curve)->p, num_words); /* t7 = F - (B + C) = x3' */
+    uECC_vli_modSub(t6, t7, X1, uECC_CURVE(curve)->p, num_words); /* t6 = x3' - B */
     uECC_vli_modMult_fast(t6, t6, t5, curve);                /* t6 = (y2+y1)*(x3' - B) */
-    uECC_vli_modSub(Y1, t6, Y1, curve->p, num_words); /* t2 = (y2+y1)*(x3' - B) - E = y3' */
+    uECC_vli_modSub(Y1, t6, Y1, uECC_CURVE(curve)->p, num_words); /* t2 = (y2+y1)*(x3' - B) - E = y3' */
 
     uECC_vli_set(X1, t7, num_words);
 }
@@ -871,7 +1330,7 @@ static void EccPoint_mult(uECC_word_t * result,
     uECC_word_t z[uECC_MAX_WORDS];
     bitcount_t i;
     uECC_word_t nb;
-    wordcount_t num_words = curve->num_words;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
 
     uECC_vli_set(Rx[1], point, num_words);
     uECC_vli_set(Ry[1], point + num_words, num_words);
@@ -888,10 +1347,10 @@ static void EccPoint_mult(uECC_word_t * result,
     XYcZ_addC(Rx[1 - nb], Ry[1 - nb], Rx[nb], Ry[nb], curve);
 
     /* Find final 1/Z value. */
-    uECC_vli_modSub(z, Rx[1], Rx[0], curve->p, num_words); /* X1 - X0 */
+    uECC_vli_modSub(z, Rx[1], Rx[0], uECC_CURVE(curve)->p, num_words); /* X1 - X0 */
     uECC_vli_modMult_fast(z, z, Ry[1 - nb], curve);               /* Yb * (X1 - X0) */
     uECC_vli_modMult_fast(z, z, point, curve);                    /* xP * Yb * (X1 - X0) */
-    uECC_vli_modInv(z, z, curve->p, num_words);            /* 1 / (xP * Yb * (X1 - X0)) */
+    uECC_vli_modInv(z, z, uECC_CURVE(curve)->p, num_words);            /* 1 / (xP * Yb * (X1 - X0)) */
     /* yP / (xP * Yb * (X1 - X0)) */
     uECC_vli_modMult_fast(z, z, point + num_words, curve);
     uECC_vli_modMult_fast(z, z, Rx[1 - nb], curve); /* Xb * yP / (xP * Yb * (X1 - X0)) */
@@ -908,12 +1367,12 @@ static uECC_word_t regularize_k(const uECC_word_t * const k,
                                 uECC_word_t *k0,
                                 uECC_word_t *k1,
                                 uECC_Curve curve) {
-    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
-    bitcount_t num_n_bits = curve->num_n_bits;
-    uECC_word_t carry = uECC_vli_add(k0, k, curve->n, num_n_words) ||
+    wordcount_t num_n_words = BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
+    bitcount_t num_n_bits = uECC_CURVE(curve)->num_n_bits;
+    uECC_word_t carry = uECC_vli_add(k0, k, uECC_CURVE(curve)->n, num_n_words) ||
         (num_n_bits < ((bitcount_t)num_n_words * uECC_WORD_SIZE * 8) &&
          uECC_vli_testBit(k0, num_n_bits));
-    uECC_vli_add(k1, k0, curve->n, num_n_words);
+    uECC_vli_add(k1, k0, uECC_CURVE(curve)->n, num_n_words);
     return carry;
 }
 
@@ -959,12 +1418,12 @@ static uECC_word_t EccPoint_compute_public_key(uECC_word_t *result,
     /* If an RNG function was specified, try to get a random initial Z value to improve
        protection against side-channel attacks. */
     if (g_rng_function) {
-        if (!uECC_generate_random_int(p2[carry], curve->p, curve->num_words)) {
+        if (!uECC_generate_random_int(p2[carry], uECC_CURVE(curve)->p, uECC_CURVE(curve)->num_words)) {
             return 0;
         }
         initial_Z = p2[carry];
     }
-    EccPoint_mult(result, curve->G, p2[!carry], initial_Z, curve->num_n_bits + 1, curve);
+    EccPoint_mult(result, uECC_CURVE(curve)->G, p2[!carry], initial_Z, uECC_CURVE(curve)->num_n_bits + 1, curve);
 
     if (EccPoint_isZero(result, curve)) {
         return 0;
@@ -1028,16 +1487,16 @@ int uECC_make_key(uint8_t *public_key,
     uECC_word_t tries;
 
     for (tries = 0; tries < uECC_RNG_MAX_TRIES; ++tries) {
-        if (!uECC_generate_random_int(_private, curve->n, BITS_TO_WORDS(curve->num_n_bits))) {
+        if (!uECC_generate_random_int(_private, uECC_CURVE(curve)->n, BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits))) {
             return 0;
         }
 
         if (EccPoint_compute_public_key(_public, _private, curve)) {
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-            uECC_vli_nativeToBytes(private_key, BITS_TO_BYTES(curve->num_n_bits), _private);
-            uECC_vli_nativeToBytes(public_key, curve->num_bytes, _public);
+            uECC_vli_nativeToBytes(private_key, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits), _private);
+            uECC_vli_nativeToBytes(public_key, uECC_CURVE(curve)->num_bytes, _public);
             uECC_vli_nativeToBytes(
-                public_key + curve->num_bytes, curve->num_bytes, _public + curve->num_words);
+                public_key + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes, _public + uECC_CURVE(curve)->num_words);
 #endif
             return 1;
         }
@@ -1056,14 +1515,14 @@ int uECC_shared_secret(const uint8_t *public_key,
     uECC_word_t *p2[2] = {_private, tmp};
     uECC_word_t *initial_Z = 0;
     uECC_word_t carry;
-    wordcount_t num_words = curve->num_words;
-    wordcount_t num_bytes = curve->num_bytes;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
+    wordcount_t num_bytes = uECC_CURVE(curve)->num_bytes;
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
     bcopy((uint8_t *) _private, private_key, num_bytes);
     bcopy((uint8_t *) _public, public_key, num_bytes*2);
 #else
-    uECC_vli_bytesToNative(_private, private_key, BITS_TO_BYTES(curve->num_n_bits));
+    uECC_vli_bytesToNative(_private, private_key, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits));
     uECC_vli_bytesToNative(_public, public_key, num_bytes);
     uECC_vli_bytesToNative(_public + num_words, public_key + num_bytes, num_bytes);
 #endif
@@ -1075,13 +1534,13 @@ int uECC_shared_secret(const uint8_t *public_key,
     /* If an RNG function was specified, try to get a random initial Z value to improve
        protection against side-channel attacks. */
     if (g_rng_function) {
-        if (!uECC_generate_random_int(p2[carry], curve->p, num_words)) {
+        if (!uECC_generate_random_int(p2[carry], uECC_CURVE(curve)->p, num_words)) {
             return 0;
         }
         initial_Z = p2[carry];
     }
 
-    EccPoint_mult(_public, _public, p2[!carry], initial_Z, curve->num_n_bits + 1, curve);
+    EccPoint_mult(_public, _public, p2[!carry], initial_Z, uECC_CURVE(curve)->num_n_bits + 1, curve);
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
     bcopy((uint8_t *) secret, (uint8_t *) _public, num_bytes);
 #else
@@ -1093,13 +1552,13 @@ int uECC_shared_secret(const uint8_t *public_key,
 #if uECC_SUPPORT_COMPRESSED_POINT
 void uECC_compress(const uint8_t *public_key, uint8_t *compressed, uECC_Curve curve) {
     wordcount_t i;
-    for (i = 0; i < curve->num_bytes; ++i) {
+    for (i = 0; i < uECC_CURVE(curve)->num_bytes; ++i) {
         compressed[i+1] = public_key[i];
     }
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    compressed[0] = 2 + (public_key[curve->num_bytes] & 0x01);
+    compressed[0] = 2 + (public_key[uECC_CURVE(curve)->num_bytes] & 0x01);
 #else
-    compressed[0] = 2 + (public_key[curve->num_bytes * 2 - 1] & 0x01);
+    compressed[0] = 2 + (public_key[uECC_CURVE(curve)->num_bytes * 2 - 1] & 0x01);
 #endif
 }
 
@@ -1109,22 +1568,59 @@ void uECC_decompress(const uint8_t *compressed, uint8_t *public_key, uECC_Curve
 #else
     uECC_word_t point[uECC_MAX_WORDS * 2];
 #endif
-    uECC_word_t *y = point + curve->num_words;
+    uECC_word_t *y = point + uECC_CURVE(curve)->num_words;
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    bcopy(public_key, compressed+1, curve->num_bytes);
+    bcopy(public_key, compressed+1, uECC_CURVE(curve)->num_bytes);
 #else
-    uECC_vli_bytesToNative(point, compressed + 1, curve->num_bytes);
+    uECC_vli_bytesToNative(point, compressed + 1, uECC_CURVE(curve)->num_bytes);
 #endif
-    curve->x_side(y, point, curve);
-    curve->mod_sqrt(y, curve);
+    uECC_CURVE(curve)->x_side(y, point, curve);
+    uECC_CURVE(curve)->mod_sqrt(y, curve);
 
     if ((y[0] & 0x01) != (compressed[0] & 0x01)) {
-        uECC_vli_sub(y, curve->p, y, curve->num_words);
+        uECC_vli_sub(y, uECC_CURVE(curve)->p, y, uECC_CURVE(curve)->num_words);
     }
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-    uECC_vli_nativeToBytes(public_key, curve->num_bytes, point);
-    uECC_vli_nativeToBytes(public_key + curve->num_bytes, curve->num_bytes, y);
+    uECC_vli_nativeToBytes(public_key, uECC_CURVE(curve)->num_bytes, point);
+    uECC_vli_nativeToBytes(public_key + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes, y);
+#endif
+}
+
+int uECC_valid_compressed_public_key(const uint8_t *compressed, uECC_Curve curve) {
+    uECC_word_t x[uECC_MAX_WORDS];
+    uECC_word_t y2[uECC_MAX_WORDS];
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
+#if uECC_VARTIME_PUBLIC == 0
+    uECC_word_t y[uECC_MAX_WORDS];
+#endif
+
+    if (compressed[0] != 0x02 && compressed[0] != 0x03) {
+        return 0;
+    }
+#if uECC_VLI_NATIVE_LITTLE_ENDIAN
+    {
+        wordcount_t i;
+        uECC_vli_clear(x, num_words);
+        for (i = 0; i < uECC_CURVE(curve)->num_bytes; ++i) {
+            ((uint8_t *)x)[i] = compressed[1 + i];
+        }
+    }
+#else
+    uECC_vli_bytesToNative(x, compressed + 1, uECC_CURVE(curve)->num_bytes);
+#endif
+    if (uECC_vli_cmp_unsafe(uECC_CURVE(curve)->p, x, num_words) != 1) {
+        return 0;
+    }
+    uECC_CURVE(curve)->x_side(y2, x, curve);
+#if uECC_VARTIME_PUBLIC
+    /* x is on the curve iff x^3 + ax + b is a square (or 0). */
+    return uECC_vli_jacobi_vartime(y2, uECC_CURVE(curve)->p, num_words) != -1;
+#else
+    uECC_vli_set(y, y2, num_words);
+    uECC_CURVE(curve)->mod_sqrt(y, curve);
+    uECC_vli_modSquare_fast(x, y, curve);
+    return (int)uECC_vli_equal(x, y2, num_words);
 #endif
 }
 #endif /* uECC_SUPPORT_COMPRESSED_POINT */
@@ -1132,7 +1628,7 @@ void uECC_decompress(const uint8_t *compressed, uint8_t *public_key, uECC_Curve
 uECC_VLI_API int uECC_valid_point(const uECC_word_t *point, uECC_Curve curve) {
     uECC_word_t tmp1[uECC_MAX_WORDS];
     uECC_word_t tmp2[uECC_MAX_WORDS];
-    wordcount_t num_words = curve->num_words;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
 
     /* The point at infinity is invalid. */
     if (EccPoint_isZero(point, curve)) {
@@ -1140,13 +1636,13 @@ uECC_VLI_API int uECC_valid_point(const uECC_word_t *point, uECC_Curve curve) {
     }
 
     /* x and y must be smaller than p. */
-    if (uECC_vli_cmp_unsafe(curve->p, point, num_words) != 1 ||
-            uECC_vli_cmp_unsafe(curve->p, point + num_words, num_words) != 1) {
+    if (uECC_vli_cmp_unsafe(uECC_CURVE(curve)->p, point, num_words) != 1 ||
+            uECC_vli_cmp_unsafe(uECC_CURVE(curve)->p, point + num_words, num_words) != 1) {
         return 0;
     }
 
     uECC_vli_modSquare_fast(tmp1, point + num_words, curve);
-    curve->x_side(tmp2, point, curve); /* tmp2 = x^3 + ax + b */
+    uECC_CURVE(curve)->x_side(tmp2, point, curve); /* tmp2 = x^3 + ax + b */
 
     /* Make sure that y^2 == x^3 + ax + b */
     return (int)(uECC_vli_equal(tmp1, tmp2, num_words));
@@ -1160,9 +1656,9 @@ int uECC_valid_public_key(const uint8_t *public_key, uECC_Curve curve) {
 #endif
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(_public, public_key, uECC_CURVE(curve)->num_bytes);
     uECC_vli_bytesToNative(
-        _public + curve->num_words, public_key + curve->num_bytes, curve->num_bytes);
+        _public + uECC_CURVE(curve)->num_words, public_key + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes);
 #endif
     return uECC_valid_point(_public, curve);
 }
@@ -1177,15 +1673,15 @@ int uECC_compute_public_key(const uint8_t *private_key, uint8_t *public_key, uEC
 #endif
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-    uECC_vli_bytesToNative(_private, private_key, BITS_TO_BYTES(curve->num_n_bits));
+    uECC_vli_bytesToNative(_private, private_key, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits));
 #endif
 
     /* Make sure the private key is in the range [1, n-1]. */
-    if (uECC_vli_isZero(_private, BITS_TO_WORDS(curve->num_n_bits))) {
+    if (uECC_vli_isZero(_private, BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits))) {
         return 0;
     }
 
-    if (uECC_vli_cmp(curve->n, _private, BITS_TO_WORDS(curve->num_n_bits)) != 1) {
+    if (uECC_vli_cmp(uECC_CURVE(curve)->n, _private, BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits)) != 1) {
         return 0;
     }
 
@@ -1195,9 +1691,9 @@ int uECC_compute_public_key(const uint8_t *private_key, uint8_t *public_key, uEC
     }
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-    uECC_vli_nativeToBytes(public_key, curve->num_bytes, _public);
+    uECC_vli_nativeToBytes(public_key, uECC_CURVE(curve)->num_bytes, _public);
     uECC_vli_nativeToBytes(
-        public_key + curve->num_bytes, curve->num_bytes, _public + curve->num_words);
+        public_key + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes, _public + uECC_CURVE(curve)->num_words);
 #endif
     return 1;
 }
@@ -1209,8 +1705,8 @@ static void bits2int(uECC_word_t *native,
                      const uint8_t *bits,
                      unsigned bits_size,
                      uECC_Curve curve) {
-    unsigned num_n_bytes = BITS_TO_BYTES(curve->num_n_bits);
-    unsigned num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+    unsigned num_n_bytes = BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits);
+    unsigned num_n_words = BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
     int shift;
     uECC_word_t carry;
     uECC_word_t *ptr;
@@ -1225,10 +1721,10 @@ static void bits2int(uECC_word_t *native,
 #else
     uECC_vli_bytesToNative(native, bits, bits_size);
 #endif
-    if (bits_size * 8 <= (unsigned)curve->num_n_bits) {
+    if (bits_size * 8 <= (unsigned)uECC_CURVE(curve)->num_n_bits) {
         return;
     }
-    shift = bits_size * 8 - curve->num_n_bits;
+    shift = bits_size * 8 - uECC_CURVE(curve)->num_n_bits;
     carry = 0;
     ptr = native + num_n_words;
     while (ptr-- > native) {
@@ -1238,8 +1734,8 @@ static void bits2int(uECC_word_t *native,
     }
 
     /* Reduce mod curve_n */
-    if (uECC_vli_cmp_unsafe(curve->n, native, num_n_words) != 1) {
-        uECC_vli_sub(native, native, curve->n, num_n_words);
+    if (uECC_vli_cmp_unsafe(uECC_CURVE(curve)->n, native, num_n_words) != 1) {
+        uECC_vli_sub(native, native, uECC_CURVE(curve)->n, num_n_words);
     }
 }
 
@@ -1260,12 +1756,12 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
     uECC_word_t p[uECC_MAX_WORDS * 2];
 #endif
     uECC_word_t carry;
-    wordcount_t num_words = curve->num_words;
-    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
-    bitcount_t num_n_bits = curve->num_n_bits;
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
+    wordcount_t num_n_words = BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
+    bitcount_t num_n_bits = uECC_CURVE(curve)->num_n_bits;
 
     /* Make sure 0 < k < curve_n */
-    if (uECC_vli_isZero(k, num_words) || uECC_vli_cmp(curve->n, k, num_n_words) != 1) {
+    if (uECC_vli_isZero(k, num_words) || uECC_vli_cmp(uECC_CURVE(curve)->n, k, num_n_words) != 1) {
         return 0;
     }
 
@@ -1273,12 +1769,12 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
     /* If an RNG function was specified, try to get a random initial Z value to improve
        protection against side-channel attacks. */
     if (g_rng_function) {
-        if (!uECC_generate_random_int(k2[carry], curve->p, num_words)) {
+        if (!uECC_generate_random_int(k2[carry], uECC_CURVE(curve)->p, num_words)) {
             return 0;
         }
         initial_Z = k2[carry];
     }
-    EccPoint_mult(p, curve->G, k2[!carry], initial_Z, num_n_bits + 1, curve);
+    EccPoint_mult(p, uECC_CURVE(curve)->G, k2[!carry], initial_Z, num_n_bits + 1, curve);
     if (uECC_vli_isZero(p, num_words)) {
         return 0;
     }
@@ -1288,40 +1784,40 @@ static int uECC_sign_with_k_internal(const uint8_t *private_key,
     if (!g_rng_function) {
         uECC_vli_clear(tmp, num_n_words);
         tmp[0] = 1;
-    } else if (!uECC_generate_random_int(tmp, curve->n, num_n_words)) {
+    } else if (!uECC_generate_random_int(tmp, uECC_CURVE(curve)->n, num_n_words)) {
         return 0;
     }
 
     /* Prevent side channel analysis of uECC_vli_modInv() to determine
        bits of k / the private key by premultiplying by a random number */
-    uECC_vli_modMult(k, k, tmp, curve->n, num_n_words); /* k' = rand * k */
-    uECC_vli_modInv(k, k, curve->n, num_n_words);       /* k = 1 / k' */
-    uECC_vli_modMult(k, k, tmp, curve->n, num_n_words); /* k = 1 / k */
+    uECC_vli_modMult(k, k, tmp, uECC_CURVE(curve)->n, num_n_words); /* k' = rand * k */
+    uECC_vli_modInv(k, k, uECC_CURVE(curve)->n, num_n_words);       /* k = 1 / k' */
+    uECC_vli_modMult(k, k, tmp, uECC_CURVE(curve)->n, num_n_words); /* k = 1 / k */
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN == 0
-    uECC_vli_nativeToBytes(signature, curve->num_bytes, p); /* store r */
+    uECC_vli_nativeToBytes(signature, uECC_CURVE(curve)->num_bytes, p); /* store r */
 #endif
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    bcopy((uint8_t *) tmp, private_key, BITS_TO_BYTES(curve->num_n_bits));
+    bcopy((uint8_t *) tmp, private_key, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits));
 #else
-    uECC_vli_bytesToNative(tmp, private_key, BITS_TO_BYTES(curve->num_n_bits)); /* tmp = d */
+    uECC_vli_bytesToNative(tmp, private_key, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits)); /* tmp = d */
 #endif
 
     s[num_n_words - 1] = 0;
     uECC_vli_set(s, p, num_words);
-    uECC_vli_modMult(s, tmp, s, curve->n, num_n_words); /* s = r*d */
+    uECC_vli_modMult(s, tmp, s, uECC_CURVE(curve)->n, num_n_words); /* s = r*d */
 
     bits2int(tmp, message_hash, hash_size, curve);
-    uECC_vli_modAdd(s, tmp, s, curve->n, num_n_words); /* s = e + r*d */
-    uECC_vli_modMult(s, s, k, curve->n, num_n_words);  /* s = (e + r*d) / k */
-    if (uECC_vli_numBits(s, num_n_words) > (bitcount_t)curve->num_bytes * 8) {
+    uECC_vli_modAdd(s, tmp, s, uECC_CURVE(curve)->n, num_n_words); /* s = e + r*d */
+    uECC_vli_modMult(s, s, k, uECC_CURVE(curve)->n, num_n_words);  /* s = (e + r*d) / k */
+    if (uECC_vli_numBits(s, num_n_words) > (bitcount_t)uECC_CURVE(curve)->num_bytes * 8) {
         return 0;
     }
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    bcopy((uint8_t *) signature + curve->num_bytes, (uint8_t *) s, curve->num_bytes);
+    bcopy((uint8_t *) signature + uECC_CURVE(curve)->num_bytes, (uint8_t *) s, uECC_CURVE(curve)->num_bytes);
 #else
-    uECC_vli_nativeToBytes(signature + curve->num_bytes, curve->num_bytes, s);
+    uECC_vli_nativeToBytes(signature + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes, s);
 #endif
     return 1;
 }
@@ -1334,7 +1830,7 @@ int uECC_sign_with_k(const uint8_t *private_key,
                             uint8_t *signature,
                             uECC_Curve curve) {
     uECC_word_t k2[uECC_MAX_WORDS];
-    bits2int(k2, k, BITS_TO_BYTES(curve->num_n_bits), curve);
+    bits2int(k2, k, BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits), curve);
     return uECC_sign_with_k_internal(private_key, message_hash, hash_size, k2, signature, curve);
 }
 
@@ -1347,7 +1843,7 @@ int uECC_sign(const uint8_t *private_key,
     uECC_word_t tries;
 
     for (tries = 0; tries < uECC_RNG_MAX_TRIES; ++tries) {
-        if (!uECC_generate_random_int(k, curve->n, BITS_TO_WORDS(curve->num_n_bits))) {
+        if (!uECC_generate_random_int(k, uECC_CURVE(curve)->n, BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits))) {
             return 0;
         }
 
@@ -1417,9 +1913,9 @@ int uECC_sign_deterministic(const uint8_t *private_key,
                             uECC_Curve curve) {
     uint8_t *K = hash_context->tmp;
     uint8_t *V = K + hash_context->result_size;
-    wordcount_t num_bytes = curve->num_bytes;
-    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
-    bitcount_t num_n_bits = curve->num_n_bits;
+    wordcount_t num_bytes = uECC_CURVE(curve)->num_bytes;
+    wordcount_t num_n_words = BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
+    bitcount_t num_n_bits = uECC_CURVE(curve)->num_n_bits;
     uECC_word_t tries;
     unsigned i;
     for (i = 0; i < hash_context->result_size; ++i) {
@@ -1509,22 +2005,22 @@ int uECC_verify(const uint8_t *public_key,
     uECC_word_t _public[uECC_MAX_WORDS * 2];
 #endif
     uECC_word_t r[uECC_MAX_WORDS], s[uECC_MAX_WORDS];
-    wordcount_t num_words = curve->num_words;
-    wordcount_t num_n_words = BITS_TO_WORDS(curve->num_n_bits);
+    wordcount_t num_words = uECC_CURVE(curve)->num_words;
+    wordcount_t num_n_words = BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
 
     rx[num_n_words - 1] = 0;
     r[num_n_words - 1] = 0;
     s[num_n_words - 1] = 0;
 
 #if uECC_VLI_NATIVE_LITTLE_ENDIAN
-    bcopy((uint8_t *) r, signature, curve->num_bytes);
-    bcopy((uint8_t *) s, signature + curve->num_bytes, curve->num_bytes);
+    bcopy((uint8_t *) r, signature, uECC_CURVE(curve)->num_bytes);
+    bcopy((uint8_t *) s, signature + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes);
 #else
-    uECC_vli_bytesToNative(_public, public_key, curve->num_bytes);
+    uECC_vli_bytesToNative(_public, public_key, uECC_CURVE(curve)->num_bytes);
     uECC_vli_bytesToNative(
-        _public + num_words, public_key + curve->num_bytes, curve->num_bytes);
-    uECC_vli_bytesToNative(r, signature, curve->num_bytes);
-    uECC_vli_bytesToNative(s, signature + curve->num_bytes, curve->num_bytes);
+        _public + num_words, public_key + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes);
+    uECC_vli_bytesToNative(r, signature, uECC_CURVE(curve)->num_bytes);
+    uECC_vli_bytesToNative(s, signature + uECC_CURVE(curve)->num_bytes, uECC_CURVE(curve)->num_bytes);
 #endif
 
     /* r, s must not be 0. */
@@ -1533,31 +2029,31 @@ int uECC_verify(const uint8_t *public_key,
     }
 
     /* r, s must be < n. */
-    if (uECC_vli_cmp_unsafe(curve->n, r, num_n_words) != 1 ||
-            uECC_vli_cmp_unsafe(curve->n, s, num_n_words) != 1) {
+    if (uECC_vli_cmp_unsafe(uECC_CURVE(curve)->n, r, num_n_words) != 1 ||
+            uECC_vli_cmp_unsafe(uECC_CURVE(curve)->n, s, num_n_words) != 1) {
         return 0;
     }
 
     /* Calculate u1 and u2. */
-    uECC_vli_modInv(z, s, curve->n, num_n_words); /* z = 1/s */
+    vli_modInv_public(z, s, uECC_CURVE(curve)->n, num_n_words); /* z = 1/s */
     u1[num_n_words - 1] = 0;
     bits2int(u1, message_hash, hash_size, curve);
-    uECC_vli_modMult(u1, u1, z, curve->n, num_n_words); /* u1 = e/s */
-    uECC_vli_modMult(u2, r, z, curve->n, num_n_words); /* u2 = r/s */
+    uECC_vli_modMult(u1, u1, z, uECC_CURVE(curve)->n, num_n_words); /* u1 = e/s */
+    uECC_vli_modMult(u2, r, z, uECC_CURVE(curve)->n, num_n_words); /* u2 = r/s */
 
     /* Calculate sum = G + Q. */
     uECC_vli_set(sum, _public, num_words);
     uECC_vli_set(sum + num_words, _public + num_words, num_words);
-    uECC_vli_set(tx, curve->G, num_words);
-    uECC_vli_set(ty, curve->G + num_words, num_words);
-    uECC_vli_modSub(z, sum, tx, curve->p, num_words); /* z = x2 - x1 */
+    uECC_vli_set(tx, uECC_CURVE(curve)->G, num_words);
+    uECC_vli_set(ty, uECC_CURVE(curve)->G + num_words, num_words);
+    uECC_vli_modSub(z, sum, tx, uECC_CURVE(curve)->p, num_words); /* z = x2 - x1 */
     XYcZ_add(tx, ty, sum, sum + num_words, curve);
-    uECC_vli_modInv(z, z, curve->p, num_words); /* z = 1/z */
+    vli_modInv_public(z, z, uECC_CURVE(curve)->p, num_words); /* z = 1/z */
     apply_z(sum, sum + num_words, z, curve);
 
     /* Use Shamir's trick to calculate u1*G + u2*Q */
     points[0] = 0;
-    points[1] = curve->G;
+    points[1] = uECC_CURVE(curve)->G;
     points[2] = _public;
     points[3] = sum;
     num_bits = smax(uECC_vli_numBits(u1, num_n_words),
@@ -1572,7 +2068,7 @@ int uECC_verify(const uint8_t *public_key,
 
     for (i = num_bits - 2; i >= 0; --i) {
         uECC_word_t index;
-        curve->double_jacobian(rx, ry, z, curve);
+        uECC_CURVE(curve)->double_jacobian(rx, ry, z, curve);
 
         index = (!!uECC_vli_testBit(u1, i)) | ((!!uECC_vli_testBit(u2, i)) << 1);
         point = points[index];
@@ -1580,18 +2076,18 @@ int uECC_verify(const uint8_t *public_key,
             uECC_vli_set(tx, point, num_words);
             uECC_vli_set(ty, point + num_words, num_words);
             apply_z(tx, ty, z, curve);
-            uECC_vli_modSub(tz, rx, tx, curve->p, num_words); /* Z = x2 - x1 */
+            uECC_vli_modSub(tz, rx, tx, uECC_CURVE(curve)->p, num_words); /* Z = x2 - x1 */
             XYcZ_add(tx, ty, rx, ry, curve);
             uECC_vli_modMult_fast(z, z, tz, curve);
         }
     }
 
-    uECC_vli_modInv(z, z, curve->p, num_words); /* Z = 1/Z */
+    vli_modInv_public(z, z, uECC_CURVE(curve)->p, num_words); /* Z = 1/Z */
     apply_z(rx, ry, z, curve);
 
     /* v = x1 (mod n) */
-    if (uECC_vli_cmp_unsafe(curve->n, rx, num_n_words) != 1) {
-        uECC_vli_sub(rx, rx, curve->n, num_n_words);
+    if (uECC_vli_cmp_unsafe(uECC_CURVE(curve)->n, rx, num_n_words) != 1) {
+        uECC_vli_sub(rx, rx, uECC_CURVE(curve)->n, num_n_words);
     }
 
     /* Accept only if v == r. */
@@ -1601,56 +2097,56 @@ int uECC_verify(const uint8_t *public_key,
 #if uECC_ENABLE_VLI_API
 
 unsigned uECC_curve_num_words(uECC_Curve curve) {
-    return curve->num_words;
+    return uECC_CURVE(curve)->num_words;
 }
 
 unsigned uECC_curve_num_bytes(uECC_Curve curve) {
-    return curve->num_bytes;
+    return uECC_CURVE(curve)->num_bytes;
 }
 
 unsigned uECC_curve_num_bits(uECC_Curve curve) {
-    return curve->num_bytes * 8;
+    return uECC_CURVE(curve)->num_bytes * 8;
 }
 
 unsigned uECC_curve_num_n_words(uECC_Curve curve) {
-    return BITS_TO_WORDS(curve->num_n_bits);
+    return BITS_TO_WORDS(uECC_CURVE(curve)->num_n_bits);
 }
 
 unsigned uECC_curve_num_n_bytes(uECC_Curve curve) {
-    return BITS_TO_BYTES(curve->num_n_bits);
+    return BITS_TO_BYTES(uECC_CURVE(curve)->num_n_bits);
 }
 
 unsigned uECC_curve_num_n_bits(uECC_Curve curve) {
-    return curve->num_n_bits;
+    return uECC_CURVE(curve)->num_n_bits;
 }
 
 const uECC_word_t *uECC_curve_p(uECC_Curve curve) {
-    return curve->p;
+    return uECC_CURVE(curve)->p;
 }
 
 const uECC_word_t *uECC_curve_n(uECC_Curve curve) {
-    return curve->n;
+    return uECC_CURVE(curve)->n;
 }
 
 const uECC_word_t *uECC_curve_G(uECC_Curve curve) {
-    return curve->G;
+    return uECC_CURVE(curve)->G;
 }
 
 const uECC_word_t *uECC_curve_b(uECC_Curve curve) {
-    return curve->b;
+    return uECC_CURVE(curve)->b;
 }
 
 #if uECC_SUPPORT_COMPRESSED_POINT
 void uECC_vli_mod_sqrt(uECC_word_t *a, uECC_Curve curve) {
-    curve->mod_sqrt(a, curve);
+    uECC_CURVE(curve)->mod_sqrt(a, curve);
 }
 #endif
 
 void uECC_vli_mmod_fast(uECC_word_t *result, uECC_word_t *product, uECC_Curve curve) {
 #if (uECC_OPTIMIZATION_LEVEL > 0)
-    curve->mmod_fast(result, product);
+    uECC_CURVE(curve)->mmod_fast(result, product);
 #else
-    uECC_vli_mmod(result, product, curve->p, curve->num_words);
+    uECC_vli_mmod(result, product, uECC_CURVE(curve)->p, uECC_CURVE(curve)->num_words);
 #endif
 }
 
@@ -1663,7 +2159,7 @@ void uECC_point_mult(uECC_word_t *result,
     uECC_word_t *p2[2] = {tmp1, tmp2};
     uECC_word_t carry = regularize_k(scalar, tmp1, tmp2, curve);
 
-    EccPoint_mult(result, point, p2[!carry], 0, curve->num_n_bits + 1, curve);
+    EccPoint_mult(result, point, p2[!carry], 0, uECC_CURVE(curve)->num_n_bits + 1, curve);
 }
 
 #endif /* uECC_ENABLE_VLI_API */
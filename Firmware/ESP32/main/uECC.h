@@ -16,6 +16,7 @@ Possible values for uECC_PLATFORM are defined below: */
 #define uECC_arm_thumb2 5
 #define uECC_arm64      6
 #define uECC_avr        7
+#define uECC_xtensa     8
 
 /* If desired, you can define uECC_WORD_SIZE as appropriate for your platform (1, 4, or 8 bytes).
 If uECC_WORD_SIZE is not explicitly defined then it will be automatically set based on your
@@ -52,21 +53,49 @@ the same endianness. */
     #define uECC_VLI_NATIVE_LITTLE_ENDIAN 0
 #endif
 
+/* uECC_SPECIALIZE_secp224r1 - If enabled (defined as nonzero), secp224r1 must be the only supported
+curve. The curve parameters and curve-specific functions (x_side, mod_sqrt, mmod_fast,
+double_jacobian) are then resolved at compile time instead of through struct uECC_Curve_t, so
+the word loops run a constant number of times and can be unrolled, and no call is indirect. The
+API is unchanged; the curve arguments are ignored. */
+#ifndef uECC_SPECIALIZE_secp224r1
+    #define uECC_SPECIALIZE_secp224r1 0
+#endif
+
+/* uECC_VARTIME_PUBLIC - If enabled (defined as nonzero), operations that only ever see public
+values (point decompression, signature verification and uECC_valid_compressed_public_key()) use a
+variable-time safegcd inversion and Jacobi symbol instead of the binary extended Euclid and the
+square root. Secret values (private keys, nonces, shared secrets) always take the original
+routines. Disable to save code size. */
+#ifndef uECC_VARTIME_PUBLIC
+    #define uECC_VARTIME_PUBLIC 1
+#endif
+
+/* uECC_SQRT_TABLE_secp224r1 - If enabled (defined as nonzero), square roots modulo the secp224r1
+prime (point decompression) use Tonelli-Shanks with precomputed roots of unity from
+sqrt-table-secp224r1.inc instead of the NIST routine. This takes about a third of the field
+multiplications but adds the table, 28 KB of constant data with the default 6-bit window
+(regenerate it with gen_sqrt_table.py to change the window). Its running time depends on the
+input, which is public wherever uECC takes a square root. */
+#ifndef uECC_SQRT_TABLE_secp224r1
+    #define uECC_SQRT_TABLE_secp224r1 0
+#endif
+
 /* Curve support selection. Set to 0 to remove that curve. */
 #ifndef uECC_SUPPORTS_secp160r1
-    #define uECC_SUPPORTS_secp160r1 1
+    #define uECC_SUPPORTS_secp160r1 !uECC_SPECIALIZE_secp224r1
 #endif
 #ifndef uECC_SUPPORTS_secp192r1
-    #define uECC_SUPPORTS_secp192r1 1
+    #define uECC_SUPPORTS_secp192r1 !uECC_SPECIALIZE_secp224r1
 #endif
 #ifndef uECC_SUPPORTS_secp224r1
     #define uECC_SUPPORTS_secp224r1 1
 #endif
 #ifndef uECC_SUPPORTS_secp256r1
-    #define uECC_SUPPORTS_secp256r1 1
+    #define uECC_SUPPORTS_secp256r1 !uECC_SPECIALIZE_secp224r1
 #endif
 #ifndef uECC_SUPPORTS_secp256k1
-    #define uECC_SUPPORTS_secp256k1 1
+    #define uECC_SUPPORTS_secp256k1 !uECC_SPECIALIZE_secp224r1
 #endif
 
 /* Specifies whether compressed point format is supported.
@@ -211,6 +240,19 @@ Outputs:
     public_key - Will be filled in with the decompressed public key.
 */
 void uECC_decompress(const uint8_t *compressed, uint8_t *public_key, uECC_Curve curve);
+
+/* uECC_valid_compressed_public_key() function.
+Check whether a compressed public key is a point on the curve, without decompressing it. This is
+equivalent to uECC_decompress() followed by uECC_valid_public_key(), but only needs a Jacobi
+symbol instead of a square root when uECC_VARTIME_PUBLIC is enabled. Runs in variable time; only
+use it on public keys.
+
+Inputs:
+    compressed - The compressed public key.
+
+Returns 1 if the key is valid, 0 if it is invalid.
+*/
+int uECC_valid_compressed_public_key(const uint8_t *compressed, uECC_Curve curve);
 #endif /* uECC_SUPPORT_COMPRESSED_POINT */
 
 /* uECC_valid_public_key() function.
@@ -125,6 +125,19 @@ void uECC_vli_modInv(uECC_word_t *result,
                      const uECC_word_t *mod,
                      wordcount_t num_words);
 
+#if uECC_VARTIME_PUBLIC
+/* Computes result = (1 / input) % mod in variable time (safegcd). mod must be odd and at most
+   256 bits, input < mod. Only use on public values. */
+void uECC_vli_modInv_vartime(uECC_word_t *result,
+                             const uECC_word_t *input,
+                             const uECC_word_t *mod,
+                             wordcount_t num_words);
+
+/* Returns the Jacobi symbol (input | mod): 1, -1, or 0 if they are not coprime. mod must be odd
+   and at most 256 bits, input < mod. Variable time; only use on public values. */
+int uECC_vli_jacobi_vartime(const uECC_word_t *input, const uECC_word_t *mod, wordcount_t num_words);
+#endif
+
 #if uECC_SUPPORT_COMPRESSED_POINT
 /* Calculates a = sqrt(a) (mod curve->p) */
 void uECC_vli_mod_sqrt(uECC_word_t *a, uECC_Curve curve);
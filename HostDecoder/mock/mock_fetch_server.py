@@ -0,0 +1,168 @@
+"""Local stand-in for acsnservice/fetch, serving reports from FindMyReportResults dumps.
+
+    python3 mock_fetch_server.py reports.json [more.json ...] [--port 8081] [--replay [--speed 10]]
+
+Reports are only returned once their datePublished has passed, like on the real backend. With
+--replay the dumps are shifted to start being published now (sped up by --speed), which simulates
+a modem that is sending right now.
+
+Throttling can be simulated like a rate-limited backend: --latency-ms delays every response,
+--capacity makes responses slower when more requests are in flight, --rate-limit answers 429 with
+a Retry-After once the token bucket (--burst) is empty and --max-inflight answers 503 beyond that
+many concurrent requests.
+"""
+
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+import argparse
+import json
+import math
+import threading
+import time
+
+host = "127.0.0.1"
+port = 8081
+
+reports_by_id = {}
+stats = {"requests": 0, "ids": 0, "results": 0, "bytes": 0, "throttled": 0}
+throttle = {"latency_ms": 0, "capacity": 0, "rate_limit": 0, "burst": 1, "max_inflight": 0}
+lock = threading.Lock()
+bucket = {"tokens": 0.0, "updated": time.time()}
+inflight = [0]
+
+
+def admit():
+    """Returns None if the request may proceed, else (status, retry_after_seconds)."""
+    with lock:
+        if throttle["max_inflight"] and inflight[0] > throttle["max_inflight"]:
+            return 503, 1
+        if throttle["rate_limit"]:
+            now = time.time()
+            bucket["tokens"] = min(throttle["burst"],
+                                   bucket["tokens"] + (now - bucket["updated"]) * throttle["rate_limit"])
+            bucket["updated"] = now
+            if bucket["tokens"] < 1:
+                return 429, max(1, math.ceil((1 - bucket["tokens"]) / throttle["rate_limit"]))
+            bucket["tokens"] -= 1
+    return None
+
+
+def load_reports(paths):
+    count = 0
+    for path in paths:
+        with open(path) as f:
+            for report in json.load(f)["results"]:
+                reports_by_id.setdefault(report["id"], []).append(report)
+                count += 1
+    return count
+
+
+def replay(delay_s, speed):
+    reports = [r for rs in reports_by_id.values() for r in rs]
+    if not reports:
+        return
+    first = min(r["datePublished"] for r in reports)
+    start = int((time.time() + delay_s) * 1000)
+    for r in reports:
+        r["datePublished"] = start + int((r["datePublished"] - first) / speed)
+
+
+def search(ids, start_ms, end_ms):
+    now_ms = int(time.time() * 1000)
+    results = []
+    for report_id in ids:
+        for report in reports_by_id.get(report_id, []):
+            published = report["datePublished"]
+            if start_ms <= published < end_ms and published <= now_ms:
+                results.append(report)
+    return results
+
+
+class server(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+
+    def do_POST(self):
+        if self.path != "/acsnservice/fetch":
+            self.send_error(404)
+            return
+
+        length = int(self.headers["Content-Length"])
+        with lock:
+            inflight[0] += 1
+        try:
+            self.fetch(length)
+        finally:
+            with lock:
+                inflight[0] -= 1
+
+    def fetch(self, length):
+        request = self.rfile.read(length)
+        denied = admit()
+        if denied:
+            stats["throttled"] += 1
+            self.send_response(denied[0])
+            self.send_header("Retry-After", str(denied[1]))
+            self.send_header("Content-Length", "0")
+            self.end_headers()
+            return
+
+        delay = throttle["latency_ms"] / 1000.0
+        if throttle["capacity"]:
+            delay *= max(1.0, inflight[0] / throttle["capacity"])
+        time.sleep(delay)
+
+        try:
+            query = json.loads(request.decode("utf-8"))
+            results = []
+            for s in query["search"]:
+                ids = s["ids"]
+                stats["ids"] += len(ids)
+                results += search(ids, int(s["startDate"]), int(s["endDate"]))
+        except (KeyError, ValueError):
+            self.send_error(400)
+            return
+
+        body = json.dumps({"results": results, "statusCode": "200"}).encode("utf-8")
+        stats["requests"] += 1
+        stats["results"] += len(results)
+        stats["bytes"] += len(body)
+
+        self.send_response(200)
+        self.send_header("Content-type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def log_message(self, format, *args):
+        print("%s %s (total: %d ids -> %d results, %d requests, %d throttled, %d bytes)" % (
+            self.requestline, args[1], stats["ids"], stats["results"], stats["requests"], stats["throttled"],
+            stats["bytes"]), flush=True)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("reports", nargs="+")
+    parser.add_argument("--port", type=int, default=port)
+    parser.add_argument("--replay", action="store_true")
+    parser.add_argument("--delay", type=float, default=1.0)
+    parser.add_argument("--speed", type=float, default=1.0)
+    parser.add_argument("--latency-ms", type=float, default=0)
+    parser.add_argument("--capacity", type=int, default=0)
+    parser.add_argument("--rate-limit", type=float, default=0)
+    parser.add_argument("--burst", type=float, default=1)
+    parser.add_argument("--max-inflight", type=int, default=0)
+    args = parser.parse_args()
+    for key in throttle:
+        throttle[key] = getattr(args, key)
+    bucket["tokens"] = args.burst
+
+    print("loaded %d reports" % load_reports(args.reports), flush=True)
+    if args.replay:
+        replay(args.delay, args.speed)
+    serv = ThreadingHTTPServer((host, args.port), server)
+
+    try:
+        serv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+
+    serv.server_close()
@@ -0,0 +1,145 @@
+#include "adv_capture.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "report_source.h"
+#include "sha256.h"
+
+namespace sendmy {
+
+namespace {
+
+constexpr uint32_t kLinktypeBluetoothLeLl = 251;
+constexpr uint32_t kPcapMagicUs = 0xa1b2c3d4;
+constexpr uint32_t kPcapMagicNs = 0xa1b23c4d;
+constexpr size_t kPcapHeaderLen = 24;
+constexpr size_t kRecordHeaderLen = 16;
+
+constexpr uint8_t kPduTypeMask = 0x0f;
+constexpr uint8_t kPduAdvNonconnInd = 0x2;
+constexpr size_t kAddrLen = 6;
+// AdvData of an Offline Finding advertisement: length, type 0xff, Apple, type 0x12, length 25,
+// status, 22 key bytes, the top two bits of key byte 0, hint.
+constexpr size_t kOfDataLen = 31;
+constexpr uint8_t kOfPrefix[] = {0x1e, 0xff, 0x4c, 0x00, 0x12, 0x19};
+
+constexpr uint32_t kCrcInit = 0x555555;
+
+// Link layer CRC over the PDU, see ble_crc24() in the firmware's host GAP backend.
+uint32_t ble_crc24(const uint8_t *data, size_t len) {
+  uint32_t lfsr = kCrcInit;
+  for (size_t i = 0; i < len; i++) {
+    for (int bit = 0; bit < 8; bit++) {
+      uint32_t feedback = ((data[i] >> bit) ^ (lfsr >> 23)) & 1;
+      lfsr = (lfsr << 1) & 0xffffff;
+      if (feedback) {
+        lfsr ^= 0x00065b;
+      }
+    }
+  }
+  uint32_t crc = 0;
+  for (int bit = 0; bit < 24; bit++) {
+    crc |= ((lfsr >> bit) & 1) << (23 - bit);
+  }
+  return crc;
+}
+
+uint32_t load32(const uint8_t *p, bool swap) {
+  uint32_t v = uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+  return swap ? __builtin_bswap32(v) : v;
+}
+
+} // namespace
+
+bool adv_key_from_pdu(const uint8_t *pdu, size_t len, AdvKey &key) {
+  if (len != 2 + kAddrLen + kOfDataLen || (pdu[0] & kPduTypeMask) != kPduAdvNonconnInd ||
+      pdu[1] != kAddrLen + kOfDataLen) {
+    return false;
+  }
+  const uint8_t *adv_a = pdu + 2;
+  const uint8_t *data = adv_a + kAddrLen;
+  if (memcmp(data, kOfPrefix, sizeof(kOfPrefix)) != 0) {
+    return false;
+  }
+  // The address goes on the air least significant byte first.
+  key[0] = uint8_t((adv_a[5] & 0x3f) | (data[29] << 6));
+  for (size_t i = 1; i < kAddrLen; i++) {
+    key[i] = adv_a[kAddrLen - 1 - i];
+  }
+  memcpy(&key[kAddrLen], &data[7], kAdvKeyLen - kAddrLen);
+  return true;
+}
+
+bool add_adv_frame(AdvCapture &capture, int64_t time_us, const uint8_t *frame, size_t len) {
+  AdvKey key;
+  if (len < 4 + 2 + 3 || !adv_key_from_pdu(frame + 4, len - 4 - 3, key) ||
+      ble_crc24(frame + 4, len - 4 - 3) !=
+          (uint32_t(frame[len - 3]) | (uint32_t(frame[len - 2]) << 8) | (uint32_t(frame[len - 1]) << 16))) {
+    capture.skipped++;
+    return false;
+  }
+  Digest digest = sha256(key.data(), key.size());
+  auto [it, added] = capture.index.emplace(digest, uint32_t(capture.keys.size()));
+  if (added) {
+    capture.keys.push_back(key);
+    capture.digests.push_back(digest);
+  }
+  capture.frames.push_back(AdvFrame{time_us, it->second});
+  return true;
+}
+
+bool read_adv_capture(const std::string &path, AdvCapture &out, std::string *error) {
+  auto fail = [error](const std::string &message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  std::string file;
+  if (!read_file(path, file)) {
+    return fail("cannot read " + path);
+  }
+  const uint8_t *p = reinterpret_cast<const uint8_t *>(file.data());
+  if (file.size() < kPcapHeaderLen) {
+    return fail(path + ": not a pcap file");
+  }
+  uint32_t magic = load32(p, false);
+  bool swap = magic == __builtin_bswap32(kPcapMagicUs) || magic == __builtin_bswap32(kPcapMagicNs);
+  magic = load32(p, swap);
+  if (magic != kPcapMagicUs && magic != kPcapMagicNs) {
+    return fail(path + ": not a pcap file");
+  }
+  if ((load32(p + 20, swap) & 0xffff) != kLinktypeBluetoothLeLl) {
+    return fail(path + ": not a LINKTYPE_BLUETOOTH_LE_LL capture");
+  }
+  int64_t fraction_per_us = magic == kPcapMagicNs ? 1000 : 1;
+
+  size_t first = out.frames.size();
+  bool sorted = true;
+  size_t pos = kPcapHeaderLen;
+  while (pos + kRecordHeaderLen <= file.size()) {
+    int64_t time_us = int64_t(load32(p + pos, swap)) * 1000000 + load32(p + pos + 4, swap) / fraction_per_us;
+    size_t len = load32(p + pos + 8, swap);
+    pos += kRecordHeaderLen;
+    if (len > file.size() - pos) {
+      return fail(path + ": truncated record");
+    }
+    const uint8_t *frame = p + pos;
+    pos += len;
+
+    // Sniffers don't always write in time order.
+    if (out.frames.size() > first && time_us < out.frames.back().time_us) {
+      sorted = false;
+    }
+    add_adv_frame(out, time_us, frame, len);
+  }
+  if (!sorted) {
+    std::stable_sort(out.frames.begin() + first, out.frames.end(),
+                     [](const AdvFrame &a, const AdvFrame &b) { return a.time_us < b.time_us; });
+  }
+  return true;
+}
+
+} // namespace sendmy
@@ -0,0 +1,51 @@
+#ifndef SENDMY_ADV_CAPTURE_H
+#define SENDMY_ADV_CAPTURE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// One advertising PDU on the air.
+struct AdvFrame {
+  // Microseconds since the Unix epoch.
+  int64_t time_us;
+  // Index into AdvCapture::keys.
+  uint32_t key;
+};
+
+// The advertisement stream of a modem, as recorded by a scanner or by the firmware's host build
+// (sendmy-modem-capture, see Firmware/ESP32/host).
+struct AdvCapture {
+  // Distinct advertised keys in the order they first appeared, and their report ids.
+  std::vector<AdvKey> keys;
+  std::vector<Digest> digests;
+  // All Offline Finding frames in time order.
+  std::vector<AdvFrame> frames;
+  // Records that were not an Offline Finding ADV_NONCONN_IND or failed the CRC.
+  uint64_t skipped = 0;
+  // Report id to index into keys.
+  std::unordered_map<Digest, uint32_t, DigestHash> index;
+};
+
+// Recovers the advertised key from an ADV_NONCONN_IND with Offline Finding data, without access
+// address and CRC: the random address holds bytes 0-5 (minus the top two bits of byte 0), the
+// manufacturer data the rest. Returns false for any other PDU.
+bool adv_key_from_pdu(const uint8_t *pdu, size_t len, AdvKey &key);
+
+// Adds one over-the-air frame (access address, PDU, CRC), e.g. from the firmware's host GAP backend.
+// Returns false and counts the frame as skipped if it carries no key or fails the CRC. Frames must
+// be added in time order.
+bool add_adv_frame(AdvCapture &capture, int64_t time_us, const uint8_t *frame, size_t len);
+
+// Reads a LINKTYPE_BLUETOOTH_LE_LL pcap (access address, PDU, CRC per record) into out.
+bool read_adv_capture(const std::string &path, AdvCapture &out, std::string *error = nullptr);
+
+} // namespace sendmy
+
+#endif // SENDMY_ADV_CAPTURE_H
@@ -0,0 +1,131 @@
+#include "aimd.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+namespace sendmy {
+
+AimdController::AimdController(const AimdParams &params) : params_(params), limit_(params.initial_limit) {
+  limit_ = std::max(params_.min_limit, std::min(limit_, params_.max_limit));
+}
+
+void AimdController::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    Clock::time_point now = Clock::now();
+    if (now < paused_until_) {
+      cv_.wait_until(lock, paused_until_);
+    } else if (in_flight_ >= uint32_t(limit_)) {
+      cv_.wait(lock);
+    } else {
+      break;
+    }
+  }
+  in_flight_++;
+  counters_.requests++;
+}
+
+void AimdController::decrease_locked(Clock::time_point now) {
+  // One cut per round trip: the requests already in flight saw the same congestion.
+  auto rtt = std::chrono::milliseconds(int64_t(latency_ms_));
+  if (now - last_decrease_ < rtt) {
+    return;
+  }
+  limit_ = std::max(params_.min_limit, limit_ * params_.decrease);
+  last_decrease_ = now;
+  counters_.decreases++;
+}
+
+void AimdController::release(int status, int64_t latency_ms, int64_t retry_after_ms) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Clock::time_point now = Clock::now();
+  in_flight_--;
+
+  if (status == 429 || status == 503 || status == 0) {
+    if (status == 0) {
+      counters_.errors++;
+    } else {
+      counters_.throttled++;
+    }
+    decrease_locked(now);
+    int64_t pause = retry_after_ms >= 0 ? retry_after_ms : params_.default_retry_after_ms;
+    paused_until_ = std::max(paused_until_, now + std::chrono::milliseconds(pause));
+  } else if (status >= 500) {
+    // A failing server is as good a reason to back off as an overloaded one.
+    counters_.errors++;
+    decrease_locked(now);
+  } else if (status < 200 || status >= 300) {
+    // Our own fault (4xx) or a response we don't understand: it says nothing about capacity.
+    counters_.errors++;
+  } else if (latency_ms_ > 0 && double(latency_ms) > params_.latency_spike_factor * latency_ms_) {
+    counters_.latency_spikes++;
+    decrease_locked(now);
+  } else {
+    counters_.successes++;
+    limit_ = std::min(params_.max_limit, limit_ + params_.increase / limit_);
+  }
+  // Spikes are kept out of the average so a run of them keeps counting as congestion.
+  if (latency_ms_ == 0) {
+    latency_ms_ = double(latency_ms);
+  } else if (status != 0 && double(latency_ms) <= params_.latency_spike_factor * latency_ms_) {
+    latency_ms_ += 0.125 * (double(latency_ms) - latency_ms_);
+  }
+  cv_.notify_all();
+}
+
+AimdMetrics AimdController::metrics() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  AimdMetrics m = counters_;
+  m.limit = limit_;
+  m.in_flight = in_flight_;
+  m.latency_ms = latency_ms_;
+  Clock::time_point now = Clock::now();
+  m.paused_ms = paused_until_ > now
+                    ? std::chrono::duration_cast<std::chrono::milliseconds>(paused_until_ - now).count()
+                    : 0;
+  return m;
+}
+
+std::string AimdController::metrics_text(const std::string &prefix) const {
+  AimdMetrics m = metrics();
+  std::string out;
+  char value[32];
+  auto entry = [&](const char *name, const char *help, const char *type) {
+    out += "# HELP " + prefix + name + " " + help + "\n# TYPE " + prefix + name + " " + type + "\n" + prefix +
+           name + " " + value + "\n";
+  };
+  auto gauge = [&](const char *name, const char *help, double v) {
+    snprintf(value, sizeof(value), "%g", v);
+    entry(name, help, "gauge");
+  };
+  auto counter = [&](const char *name, const char *help, uint64_t v) {
+    snprintf(value, sizeof(value), "%llu", static_cast<unsigned long long>(v));
+    entry(name, help, "counter");
+  };
+  gauge("concurrency_limit", "Current limit on requests in flight.", m.limit);
+  gauge("in_flight", "Requests in flight.", m.in_flight);
+  gauge("latency_ms", "Smoothed request latency.", m.latency_ms);
+  gauge("paused_ms", "Remaining Retry-After pause.", double(m.paused_ms));
+  counter("requests_total", "Requests sent.", m.requests);
+  counter("successes_total", "2xx responses that completed in time.", m.successes);
+  counter("throttled_total", "Responses with status 429 or 503.", m.throttled);
+  counter("latency_spikes_total", "Responses slower than the spike threshold.", m.latency_spikes);
+  counter("errors_total", "Network errors and error responses other than 429 and 503.", m.errors);
+  counter("limit_decreases_total", "Multiplicative decreases of the limit.", m.decreases);
+  return out;
+}
+
+int64_t parse_retry_after_ms(const std::string *value) {
+  if (!value || value->empty()) {
+    return -1;
+  }
+  char *end;
+  double seconds = strtod(value->c_str(), &end);
+  if (*end != '\0' || seconds < 0) {
+    return -1;
+  }
+  return int64_t(seconds * 1000);
+}
+
+} // namespace sendmy
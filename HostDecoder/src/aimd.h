@@ -0,0 +1,85 @@
+#ifndef SENDMY_AIMD_H
+#define SENDMY_AIMD_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace sendmy {
+
+struct AimdParams {
+  double initial_limit = 2;
+  double min_limit = 1;
+  double max_limit = 32;
+  // The limit grows by this much per limit's worth of successful requests, i.e. per round trip.
+  double increase = 1;
+  // And is multiplied by this on throttling or congestion, at most once per round trip.
+  double decrease = 0.5;
+  // A response slower than this many times the smoothed latency signals congestion.
+  double latency_spike_factor = 3;
+  // Pause after a 429/503 without a usable Retry-After, or after a network error.
+  int64_t default_retry_after_ms = 1000;
+};
+
+// Snapshot of the controller state.
+struct AimdMetrics {
+  double limit = 0;
+  uint32_t in_flight = 0;
+  uint64_t requests = 0;
+  uint64_t successes = 0;
+  uint64_t throttled = 0;
+  uint64_t latency_spikes = 0;
+  // Network errors and responses other than 2xx, 429 and 503.
+  uint64_t errors = 0;
+  uint64_t decreases = 0;
+  double latency_ms = 0;
+  // Remaining pause requested by the server, 0 if none.
+  int64_t paused_ms = 0;
+};
+
+// Additive-increase, multiplicative-decrease limit on the number of requests in flight.
+//
+// Every request takes a permit with acquire() and reports back with release(). The limit creeps up
+// with every 2xx response and is cut on 429/503, other 5xx, network errors and latency spikes.
+// Other 4xx responses count as errors but leave the limit alone. A Retry-After pauses all new
+// requests until it has passed. Thread-safe.
+class AimdController {
+ public:
+  explicit AimdController(const AimdParams &params = AimdParams());
+
+  // Blocks until a request may be sent.
+  void acquire();
+  // Reports the outcome of an acquired request: the HTTP status (0 for a network error), its
+  // latency and the Retry-After delay in milliseconds (negative if absent).
+  void release(int status, int64_t latency_ms, int64_t retry_after_ms = -1);
+
+  AimdMetrics metrics() const;
+  // The metrics in Prometheus text exposition format, names prefixed with prefix.
+  std::string metrics_text(const std::string &prefix = "sendmy_fetch_") const;
+
+  const AimdParams &params() const { return params_; }
+
+ private:
+  using Clock = std::chrono::steady_clock;
+
+  void decrease_locked(Clock::time_point now);
+
+  AimdParams params_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  double limit_;
+  uint32_t in_flight_ = 0;
+  double latency_ms_ = 0;
+  Clock::time_point paused_until_{};
+  Clock::time_point last_decrease_{};
+  AimdMetrics counters_;
+};
+
+// Parses a Retry-After value given in seconds. Returns -1 for anything else, e.g. an HTTP date.
+int64_t parse_retry_after_ms(const std::string *value);
+
+} // namespace sendmy
+
+#endif // SENDMY_AIMD_H
@@ -0,0 +1,84 @@
+#include "base64.h"
+
+namespace sendmy {
+
+namespace {
+
+const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int8_t decode_char(char c) {
+  if (c >= 'A' && c <= 'Z') return int8_t(c - 'A');
+  if (c >= 'a' && c <= 'z') return int8_t(c - 'a' + 26);
+  if (c >= '0' && c <= '9') return int8_t(c - '0' + 52);
+  if (c == '+') return 62;
+  if (c == '/') return 63;
+  return -1;
+}
+
+void encode_into(const uint8_t *data, size_t len, char *out) {
+  size_t o = 0;
+  size_t i = 0;
+  for (; i + 3 <= len; i += 3) {
+    uint32_t v = (uint32_t(data[i]) << 16) | (uint32_t(data[i + 1]) << 8) | data[i + 2];
+    out[o++] = kAlphabet[(v >> 18) & 0x3f];
+    out[o++] = kAlphabet[(v >> 12) & 0x3f];
+    out[o++] = kAlphabet[(v >> 6) & 0x3f];
+    out[o++] = kAlphabet[v & 0x3f];
+  }
+  if (i < len) {
+    uint32_t v = uint32_t(data[i]) << 16;
+    if (i + 1 < len) {
+      v |= uint32_t(data[i + 1]) << 8;
+    }
+    out[o++] = kAlphabet[(v >> 18) & 0x3f];
+    out[o++] = kAlphabet[(v >> 12) & 0x3f];
+    out[o++] = i + 1 < len ? kAlphabet[(v >> 6) & 0x3f] : '=';
+    out[o++] = '=';
+  }
+}
+
+} // namespace
+
+long base64_decode(std::string_view in, uint8_t *out, size_t cap) {
+  while (!in.empty() && in.back() == '=') {
+    in.remove_suffix(1);
+  }
+  size_t o = 0;
+  uint32_t acc = 0;
+  int bits = 0;
+  for (char c : in) {
+    int8_t v = decode_char(c);
+    if (v < 0) {
+      return -1;
+    }
+    acc = (acc << 6) | uint32_t(v);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      if (o == cap) {
+        return -1;
+      }
+      out[o++] = uint8_t(acc >> bits);
+    }
+  }
+  return long(o);
+}
+
+bool base64_decode_digest(std::string_view in, Digest &out) {
+  if (in.size() != kDigestBase64Len) {
+    return false;
+  }
+  return base64_decode(in, out.data(), out.size()) == long(kDigestLen);
+}
+
+std::string base64_encode(const uint8_t *data, size_t len) {
+  std::string out(((len + 2) / 3) * 4, '\0');
+  encode_into(data, len, out.data());
+  return out;
+}
+
+void base64_encode_digest(const Digest &digest, char *out) {
+  encode_into(digest.data(), digest.size(), out);
+}
+
+} // namespace sendmy
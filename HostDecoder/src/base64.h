@@ -0,0 +1,30 @@
+#ifndef SENDMY_BASE64_H
+#define SENDMY_BASE64_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "types.h"
+
+namespace sendmy {
+
+// Length of the padded base64 encoding of a digest.
+constexpr size_t kDigestBase64Len = 44;
+
+// Decodes standard (padded) base64 into out. Returns the number of bytes written, or -1 if the
+// input is malformed or does not fit into cap bytes.
+long base64_decode(std::string_view in, uint8_t *out, size_t cap);
+
+// Decodes a report id straight into a digest without allocating.
+bool base64_decode_digest(std::string_view in, Digest &out);
+
+std::string base64_encode(const uint8_t *data, size_t len);
+
+// Writes the 44 character encoding of a digest into out (not NUL terminated).
+void base64_encode_digest(const Digest &digest, char *out);
+
+} // namespace sendmy
+
+#endif // SENDMY_BASE64_H
@@ -0,0 +1,225 @@
+#include "beam_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sendmy {
+
+BeamDecoder::BeamDecoder(uint32_t handle, const MessageParams &params, const BeamParams &beam,
+                         DigestIndex &index)
+    : handle_(handle), params_(params), beam_params_(beam), index_(index) {
+  if (params_.chunk_len == 0 || params_.chunk_len > kMaxChunkLen) {
+    params_.chunk_len = 4;
+  }
+  beam_params_.width = std::clamp<uint32_t>(beam_params_.width, 1, UINT16_MAX);
+  committed_ = MessageState(params_.chunk_len);
+  beam_.emplace_back();
+  beam_.back().vote = ChunkVote(params_.vote);
+}
+
+uint32_t BeamDecoder::resolved_chunks() const {
+  if (finished_) {
+    return chunk_of(best_ended_);
+  }
+  return chunk_of(beam_.front());
+}
+
+void BeamDecoder::prepare_step(std::vector<Digest> &ids) {
+  if (finished_) {
+    return;
+  }
+  size_t first_id = ids.size();
+  for (size_t lane = 0; lane < beam_.size(); lane++) {
+    Hypothesis &h = beam_[lane];
+    if (!prepared_) {
+      h.candidates.clear();
+      CandidateKey key{params_.modem_id, params_.message_id, params_.chunk_len, chunk_of(h), h.prefix};
+      generate_candidates_cached(cache_, key, h.candidates);
+      for (const Candidate &c : h.candidates) {
+        index_.insert(c.digest, IndexEntry{handle_, c.chunk, c.value, uint16_t(lane)});
+      }
+      h.vote.reset();
+    }
+    for (const Candidate &c : h.candidates) {
+      ids.push_back(c.digest);
+    }
+  }
+  prepared_ = true;
+  // Hypotheses share keys through aliasing, ask for each only once.
+  std::sort(ids.begin() + long(first_id), ids.end());
+  ids.erase(std::unique(ids.begin() + long(first_id), ids.end()), ids.end());
+}
+
+void BeamDecoder::add_report(const IndexEntry &entry, const Report &report) {
+  if (entry.message != handle_ || !prepared_ || entry.lane >= beam_.size()) {
+    return;
+  }
+  Hypothesis &h = beam_[entry.lane];
+  if (entry.chunk == chunk_of(h)) {
+    h.vote.add(entry.value, report);
+  }
+}
+
+void BeamDecoder::retire_step() {
+  for (size_t lane = 0; lane < beam_.size(); lane++) {
+    for (const Candidate &c : beam_[lane].candidates) {
+      index_.erase(c.digest, IndexEntry{handle_, c.chunk, c.value, uint16_t(lane)});
+    }
+  }
+}
+
+void BeamDecoder::commit_common_tail() {
+  while (true) {
+    const Hypothesis &ref = beam_.empty() ? best_ended_ : beam_.front();
+    if (ref.tail.empty()) {
+      return;
+    }
+    uint8_t v = ref.tail.front();
+    for (const Hypothesis &h : beam_) {
+      if (h.tail.empty() || h.tail.front() != v) {
+        return;
+      }
+    }
+    if (have_ended_ && (best_ended_.tail.empty() || best_ended_.tail.front() != v)) {
+      return;
+    }
+    committed_.append(v);
+    for (Hypothesis &h : beam_) {
+      h.tail.erase(h.tail.begin());
+    }
+    if (have_ended_) {
+      best_ended_.tail.erase(best_ended_.tail.begin());
+    }
+  }
+}
+
+bool BeamDecoder::resolve_step() {
+  if (finished_ || !prepared_) {
+    return !finished_;
+  }
+  prepared_ = false;
+
+  std::vector<Hypothesis> children;
+  double scores[256];
+  for (const Hypothesis &h : beam_) {
+    uint32_t chunk = chunk_of(h);
+    auto extend = [&](const Candidate &c, double score, bool solid, const TimeSpan &span) {
+      Hypothesis child;
+      child.prefix = h.prefix;
+      place_chunk(child.prefix, chunk, c.value, params_.chunk_len);
+      child.tail = h.tail;
+      child.tail.push_back(c.value);
+      child.prev_digest = c.digest;
+      child.has_prev = true;
+      size_t bits = size_t(chunk + 1) * params_.chunk_len;
+      child.solid_bits = solid ? bits : h.solid_bits;
+      child.span = span;
+      child.score = score;
+      child.vote = ChunkVote(params_.vote);
+
+      // A whole byte of zero chunks is indistinguishable from the modem having stopped sending.
+      if (bits - child.solid_bits >= 8 || chunk + 1 >= params_.max_chunks) {
+        child.ended = true;
+        if (!have_ended_ || child.score > best_ended_.score) {
+          best_ended_ = std::move(child);
+          have_ended_ = true;
+        }
+        return;
+      }
+      children.push_back(std::move(child));
+    };
+
+    // A wrapped chunk offset leaves the key unchanged for every value, see MessageDecoder.
+    bool blind = !h.candidates.empty();
+    for (const Candidate &c : h.candidates) {
+      blind = blind && c.digest == h.candidates.front().digest;
+    }
+    if (blind) {
+      Candidate zero = h.candidates.front();
+      zero.value = 0;
+      extend(zero, h.score, true, h.span);
+      continue;
+    }
+
+    const Candidate *alias = nullptr;
+    for (const Candidate &c : h.candidates) {
+      if (h.has_prev && c.digest == h.prev_digest) {
+        alias = &c;
+      }
+    }
+    h.vote.score(h.span, scores);
+    double total = 0;
+    for (const Candidate &c : h.candidates) {
+      if (&c != alias) {
+        total += scores[c.value];
+      }
+    }
+    for (const Candidate &c : h.candidates) {
+      if (&c != alias && scores[c.value] > 0) {
+        extend(c, h.score + std::log1p(scores[c.value]), true, h.vote.span(c.value, h.span));
+      }
+    }
+    // Reports for the aliased key only prove that the previous chunk was sent.
+    if (alias && total < params_.vote.min_score && scores[alias->value] > 0) {
+      extend(*alias, h.score + std::log(beam_params_.alias_penalty), false, h.span);
+    }
+  }
+  retire_step();
+
+  if (children.empty()) {
+    // Without an ended hypothesis, no continuation was reported at all: the message ended with
+    // the best current hypothesis.
+    if (!have_ended_) {
+      best_ended_ = std::move(beam_.front());
+      have_ended_ = true;
+    }
+    beam_.clear();
+    finished_ = true;
+    commit_common_tail();
+    return false;
+  }
+
+  std::stable_sort(children.begin(), children.end(),
+                   [](const Hypothesis &a, const Hypothesis &b) { return a.score > b.score; });
+  if (children.size() > beam_params_.width) {
+    children.resize(beam_params_.width);
+  }
+  beam_ = std::move(children);
+  commit_common_tail();
+  return true;
+}
+
+std::vector<uint8_t> BeamDecoder::message() const {
+  const Hypothesis &best = finished_ ? best_ended_ : beam_.front();
+  MessageState state = committed_;
+  for (uint8_t v : best.tail) {
+    state.append(v);
+  }
+  std::vector<uint8_t> out(complete_message_bits(state, best.solid_bits, best.ended) / 8);
+  state.copy_message(out.size(), out.data());
+  return out;
+}
+
+std::vector<uint8_t> decode_message_beam(ReportSource &source, const MessageParams &params,
+                                         const BeamParams &beam, int64_t start_ms, int64_t end_ms,
+                                         CandidateCache *cache) {
+  DigestIndex index;
+  BeamDecoder decoder(0, params, beam, index);
+  decoder.set_cache(cache);
+  std::vector<Digest> ids;
+  std::vector<Report> reports;
+  do {
+    ids.clear();
+    reports.clear();
+    decoder.prepare_step(ids);
+    if (!source.query(ids, start_ms, end_ms, reports)) {
+      break;
+    }
+    for (const Report &r : reports) {
+      index.for_each(r.id, [&](const IndexEntry &entry) { decoder.add_report(entry, r); });
+    }
+  } while (decoder.resolve_step());
+  return decoder.message();
+}
+
+} // namespace sendmy
@@ -0,0 +1,105 @@
+#ifndef SENDMY_BEAM_DECODER_H
+#define SENDMY_BEAM_DECODER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "chunk_vote.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "message_state.h"
+#include "report.h"
+#include "report_source.h"
+#include "types.h"
+
+namespace sendmy {
+
+struct BeamParams {
+  // Number of hypotheses kept per step.
+  uint32_t width = 4;
+  // Likelihood factor charged for continuing through the aliased key of the previous chunk.
+  double alias_penalty = 0.1;
+};
+
+// Decodes one message while keeping the best `width` hypotheses for its chain prefix.
+//
+// A wrong chunk value silently changes every later key, so a greedy decoder that picks a stale or
+// colliding value finds nothing for the next chunk and stops. Here every hypothesis proposes the
+// candidates of its next chunk, all of them go out in a single query, and each hypothesis is
+// extended by the values that received reports. Hypotheses whose continuation receives no report
+// are dropped. A hypothesis scores the evidence for it: each step adds log(1 + vote weight of the
+// chosen value), so a path that keeps being confirmed by reports overtakes one that won a single
+// contested chunk and then ran dry.
+//
+// Chunks that all surviving hypotheses agree on are committed to a shared MessageState, so the
+// per-hypothesis state is only the short tail where they still disagree.
+class BeamDecoder {
+ public:
+  BeamDecoder(uint32_t handle, const MessageParams &params, const BeamParams &beam, DigestIndex &index);
+
+  void set_cache(CandidateCache *cache) { cache_ = cache; }
+
+  // Generates the next chunk's candidates for every live hypothesis, indexes them with the
+  // hypothesis as lane, and appends the distinct digests to ids.
+  void prepare_step(std::vector<Digest> &ids);
+
+  void add_report(const IndexEntry &entry, const Report &report);
+
+  // Extends and prunes the hypotheses. Returns false once no hypothesis has a continuation left,
+  // i.e. the beam has collapsed onto the ended hypotheses; the best of them is then final. An
+  // ended hypothesis that leads while others are still live is not: a live one can overtake it
+  // as long as its continuations keep receiving reports.
+  bool resolve_step();
+
+  bool finished() const { return finished_; }
+  uint32_t handle() const { return handle_; }
+  size_t live_hypotheses() const { return beam_.size(); }
+  uint32_t resolved_chunks() const;
+
+  // The message of the best hypothesis, in original byte order.
+  std::vector<uint8_t> message() const;
+
+ private:
+  struct Hypothesis {
+    // Chain prefix after the last chunk of this hypothesis.
+    Payload prefix{};
+    // Values after the committed chunks.
+    std::vector<uint8_t> tail;
+    Digest prev_digest{};
+    bool has_prev = false;
+    size_t solid_bits = 0;
+    TimeSpan span;
+    double score = 0;
+    bool ended = false;
+
+    std::vector<Candidate> candidates;
+    ChunkVote vote;
+  };
+
+  uint32_t chunk_of(const Hypothesis &h) const { return committed_.chunks() + uint32_t(h.tail.size()); }
+  void retire_step();
+  void commit_common_tail();
+
+  uint32_t handle_;
+  MessageParams params_;
+  BeamParams beam_params_;
+  DigestIndex &index_;
+  CandidateCache *cache_ = nullptr;
+
+  MessageState committed_;
+  std::vector<Hypothesis> beam_;
+  Hypothesis best_ended_;
+  bool have_ended_ = false;
+  bool prepared_ = false;
+  bool finished_ = false;
+};
+
+// Decodes a single message with beam search, issuing one query per step.
+std::vector<uint8_t> decode_message_beam(ReportSource &source, const MessageParams &params,
+                                         const BeamParams &beam, int64_t start_ms, int64_t end_ms,
+                                         CandidateCache *cache = nullptr);
+
+} // namespace sendmy
+
+#endif // SENDMY_BEAM_DECODER_H
@@ -0,0 +1,234 @@
+#include "candidate_cache.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sendmy {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x43434d53; // "SMCC"
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kMaxCandidates = 1u << kMaxChunkLen;
+
+enum RecordState : uint32_t { kEmpty = 0, kCommitted = 1 };
+
+uint64_t hash_key(const CandidateKey &key) {
+  // FNV-1a over the key fields.
+  uint64_t h = 0xcbf29ce484222325ull;
+  auto mix = [&h](const void *data, size_t len) {
+    const uint8_t *p = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < len; i++) {
+      h = (h ^ p[i]) * 0x100000001b3ull;
+    }
+  };
+  mix(&key.modem_id, sizeof(key.modem_id));
+  mix(&key.message_id, sizeof(key.message_id));
+  mix(&key.chunk_len, sizeof(key.chunk_len));
+  mix(&key.chunk, sizeof(key.chunk));
+  mix(key.prefix.data(), key.prefix.size());
+  return h;
+}
+
+} // namespace
+
+struct CandidateCache::FileHeader {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t record_size;
+  uint32_t capacity;
+  uint8_t reserved[48];
+};
+
+struct CandidateCache::Record {
+  uint32_t state;
+  uint32_t modem_id;
+  uint32_t message_id;
+  uint32_t chunk_len;
+  uint32_t chunk;
+  uint8_t prefix[kPayloadLen];
+  // Bit v is set if the digest for value v is present.
+  uint8_t present[kMaxCandidates / 8];
+  uint8_t digests[kMaxCandidates][kDigestLen];
+
+  bool matches(const CandidateKey &key) const {
+    return modem_id == key.modem_id && message_id == key.message_id && chunk_len == key.chunk_len &&
+           chunk == key.chunk && memcmp(prefix, key.prefix.data(), kPayloadLen) == 0;
+  }
+};
+
+
+CandidateCache::~CandidateCache() { close(); }
+
+const CandidateCache::FileHeader *CandidateCache::header() const {
+  return reinterpret_cast<const FileHeader *>(base_);
+}
+
+const CandidateCache::Record *CandidateCache::record(uint32_t slot) const {
+  return reinterpret_cast<const Record *>(base_ + sizeof(FileHeader) + size_t(slot) * sizeof(Record));
+}
+
+CandidateCache::Record *CandidateCache::record(uint32_t slot) {
+  return reinterpret_cast<Record *>(base_ + sizeof(FileHeader) + size_t(slot) * sizeof(Record));
+}
+
+bool CandidateCache::open(const std::string &path, Mode mode, uint32_t capacity, std::string *error) {
+  close();
+  auto fail = [&](const char *what) {
+    if (error) {
+      *error = std::string(what) + " " + path + ": " + strerror(errno);
+    }
+    close();
+    return false;
+  };
+
+  mode_ = mode;
+  fd_ = ::open(path.c_str(), mode == Mode::ReadWrite ? (O_RDWR | O_CREAT | O_CLOEXEC) : (O_RDONLY | O_CLOEXEC),
+               0644);
+  if (fd_ < 0) {
+    return fail("cannot open");
+  }
+
+  if (mode == Mode::ReadWrite) {
+    // Creation is serialized with other writers; the file is sparse until records are stored.
+    flock(fd_, LOCK_EX);
+    struct stat st;
+    if (fstat(fd_, &st) == 0 && st.st_size == 0) {
+      FileHeader h = {};
+      h.magic = kMagic;
+      h.version = kVersion;
+      h.record_size = sizeof(Record);
+      h.capacity = capacity ? capacity : kDefaultCapacity;
+      if (ftruncate(fd_, off_t(sizeof(FileHeader) + size_t(h.capacity) * sizeof(Record))) != 0 ||
+          pwrite(fd_, &h, sizeof(h), 0) != ssize_t(sizeof(h))) {
+        flock(fd_, LOCK_UN);
+        return fail("cannot initialize");
+      }
+    }
+    flock(fd_, LOCK_UN);
+  }
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    return fail("cannot stat");
+  }
+  FileHeader h;
+  if (size_t(st.st_size) < sizeof(h) || pread(fd_, &h, sizeof(h), 0) != ssize_t(sizeof(h)) || h.magic != kMagic ||
+      h.version != kVersion || h.record_size != sizeof(Record) ||
+      size_t(st.st_size) < sizeof(FileHeader) + size_t(h.capacity) * sizeof(Record)) {
+    errno = EINVAL;
+    return fail("not a candidate cache:");
+  }
+
+  size_ = sizeof(FileHeader) + size_t(h.capacity) * sizeof(Record);
+  int prot = mode == Mode::ReadWrite ? (PROT_READ | PROT_WRITE) : PROT_READ;
+  void *p = mmap(nullptr, size_, prot, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED) {
+    return fail("cannot map");
+  }
+  base_ = static_cast<uint8_t *>(p);
+  capacity_ = h.capacity;
+  return true;
+}
+
+void CandidateCache::close() {
+  if (base_) {
+    munmap(base_, size_);
+    base_ = nullptr;
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  size_ = 0;
+  capacity_ = 0;
+}
+
+bool CandidateCache::lookup(const CandidateKey &key, std::vector<Candidate> &out) const {
+  if (!base_) {
+    return false;
+  }
+  uint32_t slot = uint32_t(hash_key(key) % capacity_);
+  for (uint32_t probe = 0; probe < capacity_; probe++, slot = (slot + 1) % capacity_) {
+    const Record *r = record(slot);
+    // atomic_ref needs a non-const object; the load does not write to it.
+    uint32_t state = std::atomic_ref<uint32_t>(const_cast<uint32_t &>(r->state)).load(std::memory_order_acquire);
+    if (state == kEmpty) {
+      break;
+    }
+    if (!r->matches(key)) {
+      continue;
+    }
+    for (uint32_t v = 0; v < (1u << key.chunk_len); v++) {
+      if (r->present[v / 8] & (1u << (v % 8))) {
+        Candidate c{key.chunk, uint8_t(v), {}};
+        memcpy(c.digest.data(), r->digests[v], kDigestLen);
+        out.push_back(c);
+      }
+    }
+    hits_++;
+    return true;
+  }
+  misses_++;
+  return false;
+}
+
+bool CandidateCache::store(const CandidateKey &key, const std::vector<Candidate> &candidates) {
+  if (!base_ || mode_ != Mode::ReadWrite || key.chunk_len == 0 || key.chunk_len > kMaxChunkLen) {
+    return false;
+  }
+  flock(fd_, LOCK_EX);
+  bool stored = false, full = true;
+  uint32_t slot = uint32_t(hash_key(key) % capacity_);
+  for (uint32_t probe = 0; probe < capacity_; probe++, slot = (slot + 1) % capacity_) {
+    Record *r = record(slot);
+    if (r->state != kEmpty) {
+      if (r->matches(key)) {
+        full = false; // another writer got there first
+        break;
+      }
+      continue;
+    }
+    r->modem_id = key.modem_id;
+    r->message_id = key.message_id;
+    r->chunk_len = key.chunk_len;
+    r->chunk = key.chunk;
+    memcpy(r->prefix, key.prefix.data(), kPayloadLen);
+    memset(r->present, 0, sizeof(r->present));
+    for (const Candidate &c : candidates) {
+      r->present[c.value / 8] |= uint8_t(1u << (c.value % 8));
+      memcpy(r->digests[c.value], c.digest.data(), kDigestLen);
+    }
+    // Publish the record only after its contents are in place.
+    std::atomic_ref<uint32_t>(r->state).store(kCommitted, std::memory_order_release);
+    stored = true;
+    full = false;
+    break;
+  }
+  flock(fd_, LOCK_UN);
+  if (full) {
+    rejected_++;
+  }
+  return stored;
+}
+
+void generate_candidates_cached(CandidateCache *cache, const CandidateKey &key, std::vector<Candidate> &out) {
+  if (cache && cache->lookup(key, out)) {
+    return;
+  }
+  size_t first = out.size();
+  generate_candidates(key.modem_id, key.prefix, key.chunk, key.chunk_len, out);
+  if (cache && cache->writable()) {
+    std::vector<Candidate> generated(out.begin() + long(first), out.end());
+    cache->store(key, generated);
+  }
+}
+
+} // namespace sendmy
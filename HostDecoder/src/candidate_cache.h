@@ -0,0 +1,83 @@
+#ifndef SENDMY_CANDIDATE_CACHE_H
+#define SENDMY_CANDIDATE_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "encoding.h"
+#include "types.h"
+
+namespace sendmy {
+
+// Identifies the candidate set of one chunk. The prefix pins down every chunk resolved before it.
+struct CandidateKey {
+  uint32_t modem_id;
+  uint32_t message_id;
+  uint32_t chunk_len;
+  uint32_t chunk;
+  Payload prefix;
+};
+
+// Persistent cache of generated candidate digests, so re-decoding or resuming a message skips
+// all EC and hash work.
+//
+// The file is a header followed by a fixed number of fixed-size records, addressed by a hash of
+// the CandidateKey with linear probing. It is memory-mapped; any number of processes can map it
+// read-only while writers serialize on flock(). A record becomes visible to readers only once it
+// is complete. The layout uses native byte order and is not meant to be copied between hosts.
+class CandidateCache {
+ public:
+  enum class Mode { ReadOnly, ReadWrite };
+
+  static constexpr uint32_t kDefaultCapacity = 4096;
+
+  CandidateCache() = default;
+  ~CandidateCache();
+  CandidateCache(const CandidateCache &) = delete;
+  CandidateCache &operator=(const CandidateCache &) = delete;
+
+  // Opens (and in ReadWrite mode creates) the cache file. capacity is only used on creation.
+  bool open(const std::string &path, Mode mode, uint32_t capacity = kDefaultCapacity,
+            std::string *error = nullptr);
+  void close();
+  bool is_open() const { return base_ != nullptr; }
+  bool writable() const { return mode_ == Mode::ReadWrite; }
+
+  // Appends the cached candidates for key to out. Returns false on a miss.
+  bool lookup(const CandidateKey &key, std::vector<Candidate> &out) const;
+
+  // Stores the candidates of one chunk. Fails if the cache is read-only, already holds the key, or
+  // is full; the last case is counted in rejected().
+  bool store(const CandidateKey &key, const std::vector<Candidate> &candidates);
+
+  uint64_t hits() const { return hits_; }
+  uint64_t misses() const { return misses_; }
+  // Stores dropped because every slot was taken; a new file with a larger capacity takes them.
+  uint64_t rejected() const { return rejected_; }
+
+ private:
+  struct FileHeader;
+  struct Record;
+
+  const FileHeader *header() const;
+  const Record *record(uint32_t slot) const;
+  Record *record(uint32_t slot);
+
+  int fd_ = -1;
+  Mode mode_ = Mode::ReadOnly;
+  uint8_t *base_ = nullptr;
+  size_t size_ = 0;
+  uint32_t capacity_ = 0;
+  mutable uint64_t hits_ = 0;
+  mutable uint64_t misses_ = 0;
+  uint64_t rejected_ = 0;
+};
+
+// generate_candidates() backed by a cache: serves hits from the cache and stores misses if writable.
+void generate_candidates_cached(CandidateCache *cache, const CandidateKey &key, std::vector<Candidate> &out);
+
+} // namespace sendmy
+
+#endif // SENDMY_CANDIDATE_CACHE_H
@@ -0,0 +1,32 @@
+#include "candidate_store.h"
+
+namespace sendmy {
+
+void CandidateStore::range(uint32_t chunk, size_t &first, size_t &last) const {
+  first = head_;
+  while (first < end() && this->chunk(first) < chunk) {
+    first++;
+  }
+  last = first;
+  while (last < end() && this->chunk(last) == chunk) {
+    last++;
+  }
+}
+
+void CandidateStore::drop_before(uint32_t chunk) {
+  while (head_ < end() && this->chunk(head_) < chunk) {
+    head_++;
+  }
+  // Compact once the dead prefix dominates so the arrays do not keep growing.
+  if (head_ == end()) {
+    digests_.clear();
+    keys_.clear();
+    head_ = 0;
+  } else if (head_ > size()) {
+    digests_.erase(digests_.begin(), digests_.begin() + long(head_));
+    keys_.erase(keys_.begin(), keys_.begin() + long(head_));
+    head_ = 0;
+  }
+}
+
+} // namespace sendmy
@@ -0,0 +1,49 @@
+#ifndef SENDMY_CANDIDATE_STORE_H
+#define SENDMY_CANDIDATE_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "encoding.h"
+#include "types.h"
+
+namespace sendmy {
+
+// Structure-of-arrays storage for the candidates of the chunks of one message that are still
+// unresolved. Digests and packed (chunk, value) pairs live in two flat arrays, in chunk order;
+// resolved chunks are dropped from the front, so memory stays bounded by the unresolved window
+// rather than growing with the message.
+class CandidateStore {
+ public:
+  void add(const Candidate &c) {
+    digests_.push_back(c.digest);
+    keys_.push_back(pack(c.chunk, c.value));
+  }
+
+  // Live candidates are addressed by [begin(), end()).
+  size_t begin() const { return head_; }
+  size_t end() const { return keys_.size(); }
+  size_t size() const { return end() - begin(); }
+
+  const Digest &digest(size_t i) const { return digests_[i]; }
+  uint32_t chunk(size_t i) const { return keys_[i] >> 8; }
+  uint8_t value(size_t i) const { return uint8_t(keys_[i]); }
+
+  // Returns the range [first, last) of the candidates of one chunk.
+  void range(uint32_t chunk, size_t &first, size_t &last) const;
+
+  // Drops all candidates of chunks before `chunk`.
+  void drop_before(uint32_t chunk);
+
+ private:
+  static uint32_t pack(uint32_t chunk, uint8_t value) { return (chunk << 8) | value; }
+
+  std::vector<Digest> digests_;
+  std::vector<uint32_t> keys_;
+  size_t head_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_CANDIDATE_STORE_H
@@ -0,0 +1,176 @@
+#include "channel_sim.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <random>
+#include <unordered_map>
+
+namespace sendmy {
+
+namespace {
+
+constexpr size_t kReportPayloadLen = 88;
+
+// Finders that arrived this many mean dwell times before the first frame are as good as gone, so
+// starting the arrivals there puts the crowd in its steady state when the modem starts.
+constexpr double kWarmupDwells = 10;
+
+// The distributions of <random> differ between standard libraries; these are the same everywhere.
+class Rng {
+ public:
+  explicit Rng(uint64_t seed) : engine_(seed) {}
+
+  uint64_t next() { return engine_(); }
+  // Uniform in [0, 1).
+  double uniform() { return double(engine_() >> 11) * 0x1.0p-53; }
+  double exponential(double mean) { return -std::log1p(-uniform()) * mean; }
+  double normal() {
+    double u = 1 - uniform();
+    return std::sqrt(-2 * std::log(u)) * std::cos(2 * M_PI * uniform());
+  }
+
+ private:
+  std::mt19937_64 engine_;
+};
+
+struct Finder {
+  uint8_t confidence;
+  // Time of the last upload per key index.
+  std::unordered_map<uint32_t, int64_t> uploaded;
+};
+
+struct Event {
+  enum class Kind { Arrive, Leave };
+  int64_t time_us;
+  uint64_t seq;
+  Kind kind;
+  uint32_t finder;
+
+  bool operator>(const Event &o) const { return time_us != o.time_us ? time_us > o.time_us : seq > o.seq; }
+};
+
+int32_t cocoa_seconds(int64_t time_us) { return int32_t(time_us / 1000000 - kCocoaEpochOffset); }
+
+void put_timestamp(std::vector<uint8_t> &payload, int32_t timestamp) {
+  payload[0] = uint8_t(uint32_t(timestamp) >> 24);
+  payload[1] = uint8_t(uint32_t(timestamp) >> 16);
+  payload[2] = uint8_t(uint32_t(timestamp) >> 8);
+  payload[3] = uint8_t(timestamp);
+}
+
+} // namespace
+
+ChannelStats simulate_channel(const AdvCapture &capture, const ChannelParams &params, uint64_t seed,
+                              std::vector<Report> &out) {
+  ChannelStats stats;
+  if (capture.frames.empty()) {
+    return stats;
+  }
+  Rng rng(seed);
+  int64_t start_us = capture.frames.front().time_us;
+  int64_t end_us = capture.frames.back().time_us;
+  double arrival_mean_us = params.finders_per_hour > 0 ? 3600e6 / params.finders_per_hour : 0;
+  double delay_mu = std::log(std::max(params.delay_median_s, 1e-3) * 1e6);
+  int64_t interval_us = int64_t(params.report_interval_s * 1e6);
+
+  std::vector<Finder> finders;
+  std::vector<uint32_t> present;
+  std::vector<bool> reported(capture.keys.size());
+  std::priority_queue<Event, std::vector<Event>, std::greater<Event>> queue;
+  uint64_t seq = 0;
+  if (arrival_mean_us > 0) {
+    int64_t first = start_us - int64_t(kWarmupDwells * params.dwell_s * 1e6) + int64_t(rng.exponential(arrival_mean_us));
+    queue.push(Event{first, seq++, Event::Kind::Arrive, 0});
+  }
+
+  auto publish = [&](const Report &report, int64_t seen_us) {
+    Report r = report;
+    r.date_published_ms = (seen_us + int64_t(std::exp(delay_mu + params.delay_sigma * rng.normal()))) / 1000;
+    out.push_back(std::move(r));
+  };
+
+  size_t first_report = out.size();
+  for (const AdvFrame &frame : capture.frames) {
+    while (!queue.empty() && queue.top().time_us <= frame.time_us) {
+      Event e = queue.top();
+      queue.pop();
+      if (e.kind == Event::Kind::Arrive) {
+        uint32_t id = uint32_t(finders.size());
+        finders.push_back(Finder{uint8_t(rng.next()), {}});
+        present.push_back(id);
+        stats.finders++;
+        queue.push(Event{e.time_us + int64_t(rng.exponential(params.dwell_s * 1e6)), seq++, Event::Kind::Leave, id});
+        int64_t next = e.time_us + int64_t(rng.exponential(arrival_mean_us));
+        if (next <= end_us) {
+          queue.push(Event{next, seq++, Event::Kind::Arrive, 0});
+        }
+      } else {
+        auto it = std::find(present.begin(), present.end(), e.finder);
+        *it = present.back();
+        present.pop_back();
+        // Nothing is kept about finders that left.
+        finders[e.finder].uploaded = {};
+      }
+    }
+
+    for (uint32_t id : present) {
+      if (rng.uniform() >= params.pickup) {
+        continue;
+      }
+      stats.pickups++;
+      Finder &finder = finders[id];
+      auto [last, first_time] = finder.uploaded.emplace(frame.key, frame.time_us);
+      if (!first_time) {
+        if (frame.time_us - last->second < interval_us) {
+          continue;
+        }
+        last->second = frame.time_us;
+      }
+
+      Report report;
+      report.id = capture.digests[frame.key];
+      report.payload.resize(kReportPayloadLen);
+      report.timestamp = cocoa_seconds(frame.time_us);
+      report.confidence = finder.confidence;
+      put_timestamp(report.payload, report.timestamp);
+      report.payload[4] = report.confidence;
+      for (size_t i = 5; i < kReportPayloadLen; i++) {
+        report.payload[i] = uint8_t(rng.next());
+      }
+      publish(report, frame.time_us);
+      stats.uploads++;
+      while (rng.uniform() < params.duplicate) {
+        publish(report, frame.time_us);
+        stats.duplicates++;
+      }
+      if (!reported[frame.key]) {
+        reported[frame.key] = true;
+        stats.keys_reported++;
+      }
+    }
+  }
+
+  std::stable_sort(out.begin() + first_report, out.end(),
+                   [](const Report &a, const Report &b) { return a.date_published_ms < b.date_published_ms; });
+  return stats;
+}
+
+void ideal_channel(const AdvCapture &capture, std::vector<Report> &out) {
+  std::vector<bool> reported(capture.keys.size());
+  for (const AdvFrame &frame : capture.frames) {
+    if (reported[frame.key]) {
+      continue;
+    }
+    reported[frame.key] = true;
+    Report report;
+    report.id = capture.digests[frame.key];
+    report.date_published_ms = frame.time_us / 1000;
+    report.timestamp = cocoa_seconds(frame.time_us);
+    report.payload.resize(kReportPayloadLen);
+    put_timestamp(report.payload, report.timestamp);
+    out.push_back(std::move(report));
+  }
+}
+
+} // namespace sendmy
@@ -0,0 +1,53 @@
+#ifndef SENDMY_CHANNEL_SIM_H
+#define SENDMY_CHANNEL_SIM_H
+
+#include <cstdint>
+#include <vector>
+
+#include "adv_capture.h"
+#include "report.h"
+
+namespace sendmy {
+
+// The crowd of finder devices between a modem and the reports backend.
+struct ChannelParams {
+  // Finders come into range as a Poisson process and stay for an exponentially distributed time.
+  double finders_per_hour = 60;
+  double dwell_s = 120;
+  // Chance that a finder in range receives a given advertising PDU (scan duty cycle, range, loss).
+  double pickup = 0.1;
+  // A finder uploads a key at most once per interval, however often it hears it.
+  double report_interval_s = 900;
+  // Chance that an upload is published once more, with the same payload.
+  double duplicate = 0.05;
+  // Time from the sighting to datePublished is log-normal.
+  double delay_median_s = 300;
+  double delay_sigma = 1;
+};
+
+struct ChannelStats {
+  uint64_t finders = 0;
+  uint64_t pickups = 0;
+  uint64_t uploads = 0;
+  uint64_t duplicates = 0;
+  // Distinct keys that got at least one report.
+  uint64_t keys_reported = 0;
+};
+
+// Runs the finders against an advertisement stream as a discrete-event simulation and appends the
+// reports the backend would publish to out, in datePublished order. The result only depends on the
+// capture, the parameters and the seed.
+//
+// Report payloads are 88 bytes like the real ones: the sighting time in Cocoa seconds and the
+// finder's confidence byte, then random bytes for the encrypted part, so that reports of
+// different sightings never count as duplicates of each other.
+ChannelStats simulate_channel(const AdvCapture &capture, const ChannelParams &params, uint64_t seed,
+                              std::vector<Report> &out);
+
+// One report per key, published as soon as the key is first advertised: what a lossless channel
+// delivers.
+void ideal_channel(const AdvCapture &capture, std::vector<Report> &out);
+
+} // namespace sendmy
+
+#endif // SENDMY_CHANNEL_SIM_H
@@ -0,0 +1,192 @@
+#include "checkpoint.h"
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "message_decoder.h"
+
+namespace sendmy {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x4b434d53; // "SMCK"
+constexpr uint32_t kVersion = 1;
+
+struct Header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t modem_id;
+  uint32_t message_id;
+  uint32_t chunk_len;
+  uint32_t body_len;
+  uint32_t crc;
+  uint32_t reserved;
+};
+
+// Built at compile time, so stores saving from several threads never race on it.
+constexpr std::array<uint32_t, 256> kCrcTable = [] {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t c = i;
+    for (int k = 0; k < 8; k++) {
+      c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+    }
+    table[i] = c;
+  }
+  return table;
+}();
+static_assert(kCrcTable[1] == 0x77073096 && kCrcTable[255] == 0x2d02ef8d, "not the IEEE 802.3 CRC-32");
+
+uint32_t crc32(const void *data, size_t len) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  uint32_t crc = 0xffffffff;
+  for (size_t i = 0; i < len; i++) {
+    crc = kCrcTable[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+bool write_all(int fd, const void *data, size_t len) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= size_t(n);
+  }
+  return true;
+}
+
+} // namespace
+
+bool write_file_atomic(const std::string &path, const void *data, size_t len, std::string *error) {
+  auto fail = [&](const std::string &what) {
+    if (error) {
+      *error = what + ": " + strerror(errno);
+    }
+    return false;
+  };
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return fail("cannot create " + tmp);
+  }
+  bool ok = write_all(fd, data, len) && fsync(fd) == 0;
+  ::close(fd);
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    int saved = errno;
+    unlink(tmp.c_str());
+    errno = saved;
+    return fail("cannot write " + path);
+  }
+  // The rename itself only survives a crash once the directory is synced.
+  size_t slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : path.substr(0, slash ? slash : 1);
+  int dfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (dfd >= 0) {
+    fsync(dfd);
+    ::close(dfd);
+  }
+  return true;
+}
+
+bool CheckpointStore::open(const std::string &dir, std::string *error) {
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    if (error) {
+      *error = "cannot create " + dir + ": " + strerror(errno);
+    }
+    return false;
+  }
+  dir_ = dir;
+  return true;
+}
+
+bool CheckpointStore::due(int64_t &last_ms, bool finished) const {
+  int64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+  if (!finished && last_ms >= 0 && now_ms - last_ms < interval_ms_) {
+    return false;
+  }
+  last_ms = now_ms;
+  return true;
+}
+
+std::string CheckpointStore::path(const MessageParams &params) const {
+  char name[64];
+  snprintf(name, sizeof(name), "/%08x-%u-%u.ckpt", params.modem_id, params.message_id, params.chunk_len);
+  return dir_ + name;
+}
+
+bool CheckpointStore::save(const MessageDecoder &decoder) {
+  if (!is_open()) {
+    return false;
+  }
+  const MessageParams &params = decoder.params();
+  std::string buffer(sizeof(Header), '\0');
+  decoder.save_state(buffer);
+  Header h = {kMagic,
+              kVersion,
+              params.modem_id,
+              params.message_id,
+              params.chunk_len,
+              uint32_t(buffer.size() - sizeof(Header)),
+              crc32(buffer.data() + sizeof(Header), buffer.size() - sizeof(Header)),
+              0};
+  memcpy(buffer.data(), &h, sizeof(h));
+  if (!write_file_atomic(path(params), buffer.data(), buffer.size())) {
+    return false;
+  }
+  saves_++;
+  return true;
+}
+
+bool CheckpointStore::load(MessageDecoder &decoder) {
+  if (!is_open()) {
+    return false;
+  }
+  const MessageParams &params = decoder.params();
+  int fd = ::open(path(params).c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return false;
+  }
+  std::string buffer;
+  struct stat st;
+  bool ok = fstat(fd, &st) == 0 && size_t(st.st_size) >= sizeof(Header);
+  if (ok) {
+    buffer.resize(size_t(st.st_size));
+    ok = pread(fd, buffer.data(), buffer.size(), 0) == ssize_t(buffer.size());
+  }
+  ::close(fd);
+  if (!ok) {
+    return false;
+  }
+  Header h;
+  memcpy(&h, buffer.data(), sizeof(h));
+  std::string_view body(buffer.data() + sizeof(Header), buffer.size() - sizeof(Header));
+  if (h.magic != kMagic || h.version != kVersion || h.modem_id != params.modem_id ||
+      h.message_id != params.message_id || h.chunk_len != params.chunk_len || h.body_len != body.size() ||
+      h.crc != crc32(body.data(), body.size())) {
+    return false;
+  }
+  if (!decoder.restore_state(body)) {
+    return false;
+  }
+  restores_++;
+  return true;
+}
+
+} // namespace sendmy
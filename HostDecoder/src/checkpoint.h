@@ -0,0 +1,63 @@
+#ifndef SENDMY_CHECKPOINT_H
+#define SENDMY_CHECKPOINT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sendmy {
+
+class MessageDecoder;
+struct MessageParams;
+
+// Writes data to path so that readers see either the old or the complete new contents, even
+// across a crash: a temporary file is synced and renamed over path.
+bool write_file_atomic(const std::string &path, const void *data, size_t len, std::string *error = nullptr);
+
+// Directory of per-message decode checkpoints, one file per (modem, message, chunk length).
+//
+// A checkpoint holds the resolved chunk values packed at chunk_len bits, the chain prefix they
+// lead to and the last vote, which is all a decoder needs to carry on with the next chunk; a
+// kilobyte covers a message of a few thousand chunks. Files are replaced atomically and carry a
+// CRC, so a restart resumes from the last checkpoint and a damaged file is ignored rather than
+// trusted. Every checkpoint costs two fsyncs, so a message is checkpointed at most once per
+// interval, plus once when it finishes; a restart queries the chunks resolved since again.
+// Checkpoints of finished messages are kept, which makes decoding them again free.
+//
+// After open(), save() and load() may be called from several threads at once, for different
+// messages.
+class CheckpointStore {
+ public:
+  // Opens (and creates) the directory.
+  bool open(const std::string &dir, std::string *error = nullptr);
+  bool is_open() const { return !dir_.empty(); }
+
+  // Minimum time between two checkpoints of a message; 0 writes one after every resolved chunk.
+  void set_interval_ms(int64_t ms) { interval_ms_ = ms; }
+  int64_t interval_ms() const { return interval_ms_; }
+
+  // Whether a message last checkpointed at last_ms (steady clock, -1 for never) is due for another
+  // one. If so, last_ms becomes the current time. A finished message is always due.
+  bool due(int64_t &last_ms, bool finished) const;
+
+  // Replaces the checkpoint of decoder's message with its current state.
+  bool save(const MessageDecoder &decoder);
+  // Restores the checkpoint of decoder's message, if there is a valid one, into a fresh decoder.
+  bool load(MessageDecoder &decoder);
+
+  std::string path(const MessageParams &params) const;
+
+  uint64_t saves() const { return saves_; }
+  uint64_t restores() const { return restores_; }
+
+ private:
+  std::string dir_;
+  int64_t interval_ms_ = 1000;
+  std::atomic<uint64_t> saves_{0};
+  std::atomic<uint64_t> restores_{0};
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_CHECKPOINT_H
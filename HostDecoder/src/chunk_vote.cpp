@@ -0,0 +1,124 @@
+#include "chunk_vote.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sendmy {
+
+bool ChunkVote::Entry::operator==(const Entry &o) const {
+  return value == o.value && timestamp == o.timestamp && confidence == o.confidence &&
+         payload_hash == o.payload_hash;
+}
+
+size_t ChunkVote::EntryHash::operator()(const Entry &e) const {
+  return size_t(e.payload_hash ^ ((uint64_t(uint32_t(e.timestamp)) << 8 | e.value) * 0x9e3779b97f4a7c15ull));
+}
+
+void ChunkVote::reset() {
+  reports_.clear();
+  seen_.clear();
+}
+
+void ChunkVote::add(uint8_t value, const Report &report) {
+  uint64_t h = 0xcbf29ce484222325ull;
+  for (uint8_t b : report.payload) {
+    h = (h ^ b) * 0x100000001b3ull;
+  }
+  Entry e{value, report.confidence, report.timestamp, h};
+  if (!seen_.insert(e).second) {
+    return;
+  }
+  newest_ = reports_.empty() ? e.timestamp : std::max(newest_, e.timestamp);
+  reports_.push_back(e);
+}
+
+double ChunkVote::weight(const Entry &e, const TimeSpan &reference) const {
+  double w = 1 + params_.confidence_weight * e.confidence / 255.0;
+  if (!reference.valid) {
+    return w;
+  }
+  double distance = 0;
+  if (e.timestamp < reference.lo) {
+    distance = double(reference.lo - e.timestamp);
+  } else if (e.timestamp > reference.hi) {
+    distance = double(e.timestamp - reference.hi);
+  }
+  distance = std::max(0.0, distance - params_.time_slack_s);
+  return w * std::exp(-distance / params_.time_decay_s);
+}
+
+TimeSpan ChunkVote::anchor(const TimeSpan &given) const {
+  // Without a neighbour to compare with (the first chunk), anchor on the newest report: the
+  // firmware restarts its ids on reboot, so older transmissions under the same keys are stale.
+  if (!given.valid && !reports_.empty()) {
+    return TimeSpan{newest_, newest_, true};
+  }
+  return given;
+}
+
+void ChunkVote::score_anchored(const TimeSpan &reference, double *scores) const {
+  std::fill(scores, scores + 256, 0.0);
+  for (const Entry &e : reports_) {
+    scores[e.value] += weight(e, reference);
+  }
+}
+
+TimeSpan ChunkVote::span_anchored(int value, const TimeSpan &reference, const TimeSpan &fallback) const {
+  TimeSpan out;
+  // The winner's well-timed reports become the reference for the next chunk.
+  for (const Entry &e : reports_) {
+    if (e.value != value || weight(e, reference) < 0.5) {
+      continue;
+    }
+    if (!out.valid) {
+      out = TimeSpan{e.timestamp, e.timestamp, true};
+    } else {
+      out.lo = std::min(out.lo, e.timestamp);
+      out.hi = std::max(out.hi, e.timestamp);
+    }
+  }
+  return out.valid ? out : fallback;
+}
+
+void ChunkVote::score(const TimeSpan &given, double *scores) const { score_anchored(anchor(given), scores); }
+
+TimeSpan ChunkVote::span(int value, const TimeSpan &given) const {
+  return span_anchored(value, anchor(given), given);
+}
+
+Vote ChunkVote::decide(const TimeSpan &given, int alias_value) const {
+  TimeSpan reference = anchor(given);
+  double scores[256];
+  score_anchored(reference, scores);
+  double total = 0;
+  for (double s : scores) {
+    total += s;
+  }
+
+  Vote vote;
+  for (int v = 0; v < 256; v++) {
+    if (v == alias_value || scores[v] <= 0) {
+      continue;
+    }
+    if (vote.value < 0 || scores[v] > vote.score) {
+      vote.value = v;
+      vote.score = scores[v];
+    }
+  }
+  if ((vote.value < 0 || vote.score < params_.min_score) && alias_value >= 0 && scores[alias_value] > 0) {
+    vote.value = alias_value;
+    vote.score = scores[alias_value];
+  }
+  if (vote.value < 0) {
+    return vote;
+  }
+  // The aliased key's reports belong to the previous chunk; they only compete if they won.
+  if (alias_value >= 0 && vote.value != alias_value) {
+    total -= scores[alias_value];
+  }
+  vote.margin = total > 0 ? vote.score / total : 0;
+  vote.span = span_anchored(vote.value, reference, given);
+  return vote;
+}
+
+} // namespace sendmy
@@ -0,0 +1,97 @@
+#ifndef SENDMY_CHUNK_VOTE_H
+#define SENDMY_CHUNK_VOTE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_set>
+#include <vector>
+
+#include "report.h"
+
+namespace sendmy {
+
+struct VoteParams {
+  // Reports within this many seconds of the neighbouring chunk's reports count fully.
+  double time_slack_s = 600;
+  // Beyond the slack, a report's weight decays as exp(-distance / time_decay_s).
+  double time_decay_s = 1800;
+  // How much a report's confidence byte adds to its weight, at most 1 + confidence_weight.
+  double confidence_weight = 1;
+  // Minimum score a value needs to beat the aliased key of the previous chunk.
+  double min_score = 0.5;
+};
+
+// Time span (Cocoa seconds) in which the neighbouring chunk was seen by finders.
+struct TimeSpan {
+  int32_t lo = 0;
+  int32_t hi = 0;
+  bool valid = false;
+};
+
+// Outcome of voting on one chunk.
+struct Vote {
+  // -1 if no value received any report.
+  int value = -1;
+  double score = 0;
+  // Share of the total score that went to the winner, in [0, 1]. The aliased value only counts
+  // towards the total when it won.
+  double margin = 0;
+  // Span of the winning reports, the reference for the next chunk.
+  TimeSpan span;
+};
+
+// Scores the candidate values of one chunk from the reports they received.
+//
+// Every distinct report contributes a weight that grows with its confidence and shrinks with the
+// distance of its timestamp from the neighbouring chunk's reports: the modem sends chunks back to
+// back, so reports from another transmission (a stale message, a reused id) stand out in time.
+// Exact duplicates, e.g. the same report fetched twice, are dropped as they are added, so the const
+// methods only read and may be called from several threads at once.
+class ChunkVote {
+ public:
+  explicit ChunkVote(const VoteParams &params = VoteParams()) : params_(params) {}
+
+  void reset();
+  void add(uint8_t value, const Report &report);
+  bool empty() const { return reports_.empty(); }
+
+  // Picks the maximum score value. `reference` is the span of the previous chunk, if any.
+  // Reports for `alias_value` (if >= 0) only prove that the previous chunk was sent, so that
+  // value only wins if nothing else scores at least min_score.
+  Vote decide(const TimeSpan &reference, int alias_value) const;
+
+  // Fills scores[v] for all 256 values. Used by callers that keep several values per chunk.
+  void score(const TimeSpan &reference, double *scores) const;
+
+  // Span of the well-timed reports for value, falling back to reference if there are none.
+  TimeSpan span(int value, const TimeSpan &reference) const;
+
+ private:
+  struct Entry {
+    uint8_t value;
+    uint8_t confidence;
+    int32_t timestamp;
+    uint64_t payload_hash;
+
+    bool operator==(const Entry &o) const;
+  };
+  struct EntryHash {
+    size_t operator()(const Entry &e) const;
+  };
+
+  double weight(const Entry &e, const TimeSpan &reference) const;
+  // The given reference, or the newest report without one, see decide().
+  TimeSpan anchor(const TimeSpan &reference) const;
+  void score_anchored(const TimeSpan &reference, double *scores) const;
+  TimeSpan span_anchored(int value, const TimeSpan &reference, const TimeSpan &fallback) const;
+
+  VoteParams params_;
+  // Distinct reports in the order they were added.
+  std::vector<Entry> reports_;
+  std::unordered_set<Entry, EntryHash> seen_;
+  int32_t newest_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_CHUNK_VOTE_H
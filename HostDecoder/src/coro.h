@@ -0,0 +1,257 @@
+#ifndef SENDMY_CORO_H
+#define SENDMY_CORO_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace sendmy {
+
+// Just enough coroutine machinery for the decode pipeline. Coroutines only ever run on the thread
+// that drives the EventLoop, so their state needs no locking; blocking or CPU heavy work is handed
+// to a WorkerPool as a plain function, and the coroutine continues on the loop once it is done.
+
+// A coroutine that starts suspended and is destroyed with its Task. It is resumed by posting
+// handle() to an EventLoop.
+class Task {
+ public:
+  struct promise_type {
+    Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() {}
+    void unhandled_exception() { std::terminate(); }
+  };
+
+  Task(Task &&other) noexcept : handle_(std::exchange(other.handle_, {})) {}
+  Task &operator=(Task &&) = delete;
+  ~Task() {
+    if (handle_) {
+      handle_.destroy();
+    }
+  }
+
+  std::coroutine_handle<> handle() const { return handle_; }
+  bool done() const { return handle_.done(); }
+
+ private:
+  explicit Task(std::coroutine_handle<promise_type> handle) : handle_(handle) {}
+  std::coroutine_handle<promise_type> handle_;
+};
+
+// Resumes coroutines on the thread that calls run().
+class EventLoop {
+ public:
+  // Queues a coroutine to be resumed. Any thread.
+  void post(std::coroutine_handle<> h) {
+    std::lock_guard<std::mutex> lock(mu_);
+    ready_.push_back(h);
+    cv_.notify_one();
+  }
+  // A coroutine leaves for a worker thread, and comes back through arrive().
+  void depart() {
+    std::lock_guard<std::mutex> lock(mu_);
+    away_++;
+  }
+  void arrive(std::coroutine_handle<> h) {
+    std::lock_guard<std::mutex> lock(mu_);
+    away_--;
+    ready_.push_back(h);
+    cv_.notify_one();
+  }
+
+  // Resumes queued coroutines until none is queued or away. Coroutines still suspended then wait
+  // on something that will not happen any more, e.g. after a failed query.
+  void run() {
+    for (;;) {
+      std::coroutine_handle<> h;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [&] { return !ready_.empty() || away_ == 0; });
+        if (ready_.empty()) {
+          return;
+        }
+        h = ready_.front();
+        ready_.pop_front();
+      }
+      h.resume();
+    }
+  }
+
+ private:
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::coroutine_handle<>> ready_;
+  size_t away_ = 0;
+};
+
+// Threads that run functions on behalf of suspended coroutines: `co_await pool.run(fn)` calls fn on
+// a worker and continues the coroutine on the loop afterwards.
+class WorkerPool {
+ public:
+  WorkerPool(EventLoop &loop, unsigned threads) : loop_(loop) {
+    for (unsigned i = 0; i < std::max(threads, 1u); i++) {
+      threads_.emplace_back([this] { work(); });
+    }
+  }
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (std::thread &t : threads_) {
+      t.join();
+    }
+  }
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  unsigned size() const { return unsigned(threads_.size()); }
+
+  struct Awaiter {
+    WorkerPool &pool;
+    std::function<void()> fn;
+    bool await_ready() const noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) { pool.submit(std::move(fn), h); }
+    void await_resume() const noexcept {}
+  };
+  Awaiter run(std::function<void()> fn) { return Awaiter{*this, std::move(fn)}; }
+
+ private:
+  void submit(std::function<void()> fn, std::coroutine_handle<> h) {
+    loop_.depart();
+    std::lock_guard<std::mutex> lock(mu_);
+    jobs_.emplace_back(std::move(fn), h);
+    cv_.notify_one();
+  }
+
+  void work() {
+    for (;;) {
+      std::pair<std::function<void()>, std::coroutine_handle<>> job;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+          return;
+        }
+        job = std::move(jobs_.front());
+        jobs_.pop_front();
+      }
+      job.first();
+      loop_.arrive(job.second);
+    }
+  }
+
+  EventLoop &loop_;
+  std::mutex mu_;
+  std::condition_variable cv_;
+  std::deque<std::pair<std::function<void()>, std::coroutine_handle<>>> jobs_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Bounded FIFO between coroutines of one EventLoop. push() suspends while the channel is full and
+// pop() while it is empty; pop() yields nothing once the channel is closed and drained.
+template <typename T> class Channel {
+ public:
+  Channel(EventLoop &loop, size_t capacity) : loop_(loop), capacity_(std::max<size_t>(capacity, 1)) {}
+
+  struct PushAwaiter {
+    Channel &channel;
+    T value;
+    bool await_ready() { return channel.try_push(value); }
+    void await_suspend(std::coroutine_handle<> h) { channel.pushers_.push_back({h, &value}); }
+    void await_resume() const noexcept {}
+  };
+  PushAwaiter push(T value) { return PushAwaiter{*this, std::move(value)}; }
+
+  struct PopAwaiter {
+    Channel &channel;
+    std::optional<T> slot;
+    bool await_ready() {
+      slot = channel.try_pop();
+      return slot || channel.closed_;
+    }
+    void await_suspend(std::coroutine_handle<> h) { channel.poppers_.push_back({h, &slot}); }
+    std::optional<T> await_resume() { return std::move(slot); }
+  };
+  PopAwaiter pop() { return PopAwaiter{*this, std::nullopt}; }
+
+  // Takes the next item without waiting.
+  std::optional<T> try_pop() {
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> value = std::move(items_.front());
+    items_.pop_front();
+    if (!pushers_.empty()) {
+      items_.push_back(std::move(*pushers_.front().value));
+      loop_.post(pushers_.front().handle);
+      pushers_.pop_front();
+    }
+    return value;
+  }
+
+  // Wakes every waiting coroutine; items pushed from now on are dropped.
+  void close() {
+    closed_ = true;
+    for (const Popper &p : poppers_) {
+      loop_.post(p.handle);
+    }
+    for (const Pusher &p : pushers_) {
+      loop_.post(p.handle);
+    }
+    poppers_.clear();
+    pushers_.clear();
+  }
+
+  size_t size() const { return items_.size(); }
+
+ private:
+  struct Pusher {
+    std::coroutine_handle<> handle;
+    T *value;
+  };
+  struct Popper {
+    std::coroutine_handle<> handle;
+    std::optional<T> *slot;
+  };
+
+  bool try_push(T &value) {
+    if (closed_) {
+      return true;
+    }
+    if (!poppers_.empty()) {
+      *poppers_.front().slot = std::move(value);
+      loop_.post(poppers_.front().handle);
+      poppers_.pop_front();
+      return true;
+    }
+    if (items_.size() < capacity_) {
+      items_.push_back(std::move(value));
+      return true;
+    }
+    return false;
+  }
+
+  EventLoop &loop_;
+  size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  std::deque<Pusher> pushers_;
+  std::deque<Popper> poppers_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_CORO_H
@@ -0,0 +1,96 @@
+#include "digest_index.h"
+
+namespace sendmy {
+
+namespace {
+
+size_t round_up_pow2(size_t n) {
+  size_t p = 16;
+  while (p < n) {
+    p <<= 1;
+  }
+  return p;
+}
+
+} // namespace
+
+DigestIndex::DigestIndex(size_t expected_entries)
+    : slots_(round_up_pow2(expected_entries * 2)), mask_(slots_.size() - 1) {}
+
+void DigestIndex::insert(const Digest &digest, const IndexEntry &entry) {
+  uint64_t h = hash(digest);
+  size_t i = h & mask_;
+  for (; slots_[i].used; i = (i + 1) & mask_) {
+    if (same(slots_[i], h, digest, entry)) {
+      return;
+    }
+  }
+  // Keep the load factor at or below 1/2 so probe sequences stay short.
+  if ((size_ + 1) * 2 > slots_.size()) {
+    grow();
+    place(Slot{h, digest, entry, true});
+  } else {
+    slots_[i] = Slot{h, digest, entry, true};
+  }
+  size_++;
+}
+
+bool DigestIndex::erase(const Digest &digest, const IndexEntry &entry) {
+  uint64_t h = hash(digest);
+  size_t i = h & mask_;
+  for (; slots_[i].used; i = (i + 1) & mask_) {
+    if (same(slots_[i], h, digest, entry)) {
+      break;
+    }
+  }
+  if (!slots_[i].used) {
+    return false;
+  }
+  // Backward-shift deletion: pull later members of the probe run into the hole so lookups never
+  // need tombstones.
+  for (size_t j = (i + 1) & mask_; slots_[j].used; j = (j + 1) & mask_) {
+    size_t home = slots_[j].hash & mask_;
+    bool movable = i <= j ? (home <= i || home > j) : (home <= i && home > j);
+    if (movable) {
+      slots_[i] = slots_[j];
+      i = j;
+    }
+  }
+  slots_[i].used = false;
+  size_--;
+  return true;
+}
+
+const IndexEntry *DigestIndex::find(const Digest &digest) const {
+  uint64_t h = hash(digest);
+  for (size_t i = h & mask_;; i = (i + 1) & mask_) {
+    const Slot &slot = slots_[i];
+    if (!slot.used) {
+      return nullptr;
+    }
+    if (slot.hash == h && memcmp(slot.digest.data(), digest.data(), kDigestLen) == 0) {
+      return &slot.entry;
+    }
+  }
+}
+
+void DigestIndex::place(const Slot &slot) {
+  size_t i = slot.hash & mask_;
+  while (slots_[i].used) {
+    i = (i + 1) & mask_;
+  }
+  slots_[i] = slot;
+}
+
+void DigestIndex::grow() {
+  std::vector<Slot> old(slots_.size() * 2);
+  old.swap(slots_);
+  mask_ = slots_.size() - 1;
+  for (const Slot &slot : old) {
+    if (slot.used) {
+      place(slot);
+    }
+  }
+}
+
+} // namespace sendmy
@@ -0,0 +1,88 @@
+#ifndef SENDMY_DIGEST_INDEX_H
+#define SENDMY_DIGEST_INDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// What a report id resolves to: which message, which chunk of it and which chunk value.
+// Decoders that follow several hypotheses for a message tell them apart by lane.
+struct IndexEntry {
+  uint32_t message;
+  uint32_t chunk;
+  uint8_t value;
+  uint16_t lane = 0;
+};
+
+// Open-addressing hash table from raw SHA-256 digests to candidate keys.
+//
+// The same digest may legitimately map to several entries: a chunk value of 0 leaves the payload
+// untouched and therefore reuses the key of the previous chunk. Lookups visit all of them.
+// Digests are uniformly distributed, so their first 8 bytes serve as the hash directly.
+class DigestIndex {
+ public:
+  explicit DigestIndex(size_t expected_entries = 256);
+
+  // Adds an entry. Inserting an identical (digest, entry) pair twice is a no-op.
+  void insert(const Digest &digest, const IndexEntry &entry);
+
+  // Calls fn(const IndexEntry &) for every entry stored under digest. Does not allocate.
+  template <typename Fn>
+  void for_each(const Digest &digest, Fn &&fn) const {
+    uint64_t h = hash(digest);
+    for (size_t i = h & mask_;; i = (i + 1) & mask_) {
+      const Slot &slot = slots_[i];
+      if (!slot.used) {
+        return;
+      }
+      if (slot.hash == h && memcmp(slot.digest.data(), digest.data(), kDigestLen) == 0) {
+        fn(slot.entry);
+      }
+    }
+  }
+
+  // Removes one (digest, entry) pair. Returns false if it was not present.
+  bool erase(const Digest &digest, const IndexEntry &entry);
+
+  // Returns the first entry stored under digest, or nullptr.
+  const IndexEntry *find(const Digest &digest) const;
+
+  size_t size() const { return size_; }
+  size_t capacity() const { return slots_.size(); }
+
+ private:
+  struct Slot {
+    uint64_t hash;
+    Digest digest;
+    IndexEntry entry;
+    bool used;
+  };
+
+  static bool same(const Slot &slot, uint64_t h, const Digest &digest, const IndexEntry &entry) {
+    return slot.hash == h && slot.entry.message == entry.message && slot.entry.chunk == entry.chunk &&
+           slot.entry.value == entry.value && slot.entry.lane == entry.lane &&
+           memcmp(slot.digest.data(), digest.data(), kDigestLen) == 0;
+  }
+
+  static uint64_t hash(const Digest &digest) {
+    uint64_t h;
+    memcpy(&h, digest.data(), sizeof(h));
+    return h;
+  }
+
+  void grow();
+  void place(const Slot &slot);
+
+  std::vector<Slot> slots_;
+  size_t mask_;
+  size_t size_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_DIGEST_INDEX_H
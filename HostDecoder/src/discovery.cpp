@@ -0,0 +1,113 @@
+#include "discovery.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "digest_index.h"
+#include "encoding.h"
+
+namespace sendmy {
+
+namespace {
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+} // namespace
+
+std::vector<ActiveModem> discover_modems(ReportSource &source, const DiscoveryParams &params, int64_t start_ms,
+                                         int64_t end_ms, CandidateCache *cache, DiscoveryStats *stats) {
+  DiscoveryStats local;
+  DiscoveryStats &st = stats ? *stats : local;
+  auto t0 = std::chrono::steady_clock::now();
+
+  auto key_for = [&](uint32_t i) {
+    return CandidateKey{params.first_modem + i, 0, params.chunk_len, 0, Payload{}};
+  };
+  std::vector<std::vector<Candidate>> sets(params.count);
+  std::vector<uint32_t> missing;
+  for (uint32_t i = 0; i < params.count; i++) {
+    if (!cache || !cache->lookup(key_for(i), sets[i])) {
+      missing.push_back(i);
+    }
+  }
+
+  // Every candidate costs a point decompression or two, by far the dominant cost of a scan.
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t n; (n = next++) < missing.size();) {
+      uint32_t i = missing[n];
+      generate_candidates(params.first_modem + i, Payload{}, 0, params.chunk_len, sets[i]);
+    }
+  };
+  unsigned threads = params.threads ? params.threads : std::max(1u, std::thread::hardware_concurrency());
+  std::vector<std::thread> workers;
+  for (unsigned t = 1; t < threads && t < missing.size(); t++) {
+    workers.emplace_back(work);
+  }
+  work();
+  for (std::thread &w : workers) {
+    w.join();
+  }
+  if (cache && cache->writable()) {
+    for (uint32_t i : missing) {
+      cache->store(key_for(i), sets[i]);
+    }
+  }
+
+  DigestIndex index(size_t(params.count) << params.chunk_len);
+  std::vector<Digest> ids;
+  ids.reserve(size_t(params.count) << params.chunk_len);
+  for (uint32_t i = 0; i < params.count; i++) {
+    for (const Candidate &c : sets[i]) {
+      index.insert(c.digest, IndexEntry{i, 0, c.value});
+      ids.push_back(c.digest);
+    }
+    st.candidates += sets[i].size();
+  }
+  sets.clear();
+  st.generate_s += seconds_since(t0);
+
+  t0 = std::chrono::steady_clock::now();
+  std::vector<ActiveModem> found(params.count);
+  std::vector<Report> reports;
+  size_t batch = std::max<size_t>(params.batch_ids, 1);
+  for (size_t first = 0; first < ids.size(); first += batch) {
+    std::vector<Digest> part(ids.begin() + first, ids.begin() + std::min(ids.size(), first + batch));
+    reports.clear();
+    st.queries++;
+    if (!source.query(part, start_ms, end_ms, reports)) {
+      break;
+    }
+    st.reports += reports.size();
+    for (const Report &r : reports) {
+      index.for_each(r.id, [&](const IndexEntry &entry) {
+        ActiveModem &m = found[entry.message];
+        if (m.reports++ == 0) {
+          m.first_seen = m.last_seen = r.timestamp;
+          m.last_published_ms = r.date_published_ms;
+        }
+        m.first_seen = std::min(m.first_seen, r.timestamp);
+        m.last_seen = std::max(m.last_seen, r.timestamp);
+        m.last_published_ms = std::max(m.last_published_ms, r.date_published_ms);
+      });
+    }
+  }
+  st.query_s += seconds_since(t0);
+
+  std::vector<ActiveModem> active;
+  for (uint32_t i = 0; i < params.count; i++) {
+    if (found[i].reports) {
+      found[i].modem_id = params.first_modem + i;
+      found[i].message_id = found[i].modem_id - kDefaultModemBase;
+      found[i].chunk_len = params.chunk_len;
+      active.push_back(found[i]);
+    }
+  }
+  return active;
+}
+
+} // namespace sendmy
@@ -0,0 +1,62 @@
+#ifndef SENDMY_DISCOVERY_H
+#define SENDMY_DISCOVERY_H
+
+#include <cstdint>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "report_source.h"
+
+namespace sendmy {
+
+// The firmware starts counting modem ids here and bumps modem_id and current_message_id together
+// after every POST, so since boot a modem id's message id is its distance from this base.
+constexpr uint32_t kDefaultModemBase = 0xcafe0000;
+
+struct DiscoveryParams {
+  uint32_t first_modem = kDefaultModemBase;
+  uint32_t count = 1024;
+  // The chunk_len of the modem's transmit profile, 1 to 8. It is 4 unless it was changed through
+  // the firmware's /profile endpoint; a scan with another length finds nothing.
+  uint32_t chunk_len = 4;
+  // Ids per query; a source may split a query into several requests.
+  size_t batch_ids = 2048;
+  // Candidate generation threads, 0 for one per core.
+  unsigned threads = 0;
+};
+
+// A modem id whose first chunk has reports.
+struct ActiveModem {
+  uint32_t modem_id = 0;
+  // current_message_id the firmware sent it with, assuming no reboot in between.
+  uint32_t message_id = 0;
+  // Chunk length the first chunk was found with.
+  uint32_t chunk_len = 0;
+  uint32_t reports = 0;
+  // Cocoa timestamps of the first chunk's reports.
+  int32_t first_seen = 0;
+  int32_t last_seen = 0;
+  int64_t last_published_ms = 0;
+};
+
+struct DiscoveryStats {
+  uint64_t candidates = 0;
+  uint64_t queries = 0;
+  uint64_t reports = 0;
+  double generate_s = 0;
+  double query_s = 0;
+};
+
+// Finds which of a range of modem ids carry a message.
+//
+// Message ids never enter the advertised keys (set_addr_and_payload_for_byte ignores msg_id), so
+// every message is found through its modem id: the first chunk of each id in the range has
+// 2^chunk_len candidate keys, all of them are generated (in parallel, through the cache if given)
+// and queried in packed batches. Returns the ids with reports, in order.
+std::vector<ActiveModem> discover_modems(ReportSource &source, const DiscoveryParams &params, int64_t start_ms,
+                                         int64_t end_ms, CandidateCache *cache = nullptr,
+                                         DiscoveryStats *stats = nullptr);
+
+} // namespace sendmy
+
+#endif // SENDMY_DISCOVERY_H
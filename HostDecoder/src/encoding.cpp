@@ -0,0 +1,80 @@
+#include "encoding.h"
+
+#include <cstring>
+
+#include "sha256.h"
+#include "uECC.h"
+
+namespace sendmy {
+
+void place_chunk(Payload &payload, uint32_t index, uint8_t val, uint32_t chunk_len) {
+  // Offsets are computed on the full 28 byte key like the firmware does, the payload starts at byte 8.
+  uint32_t offset = (chunk_len * (index + 1)) % (8 * chunk_len * (kPayloadLen / chunk_len));
+  uint32_t remain = 8 - ((chunk_len * index) % 8);
+
+  auto xor_at = [&payload](uint32_t key_pos, uint8_t v) {
+    // When the offset wraps to zero the firmware writes one byte past the key, so the chunk is
+    // not reflected in the key at all. Mirror that instead of guessing what was meant.
+    if (key_pos >= kPayloadOffset && key_pos < kAdvKeyLen) {
+      payload[key_pos - kPayloadOffset] ^= v;
+    }
+  };
+
+  if (remain == chunk_len) {
+    xor_at(28 - (offset / 8), uint8_t(val << (8 - remain)));
+  } else if (remain > chunk_len) {
+    xor_at(28 - ((offset / 8) + 1), uint8_t(val << (8 - remain)));
+  } else {
+    xor_at(28 - (offset / 8), uint8_t(val << (8 - remain)));
+    xor_at(28 - ((offset / 8) + 1), uint8_t(val >> remain));
+  }
+}
+
+AdvKey make_adv_key(uint32_t modem_id, uint16_t counter, const Payload &payload) {
+  AdvKey key;
+  key[0] = 0xBA;
+  key[1] = 0xBE;
+  key[2] = uint8_t(modem_id >> 24);
+  key[3] = uint8_t(modem_id >> 16);
+  key[4] = uint8_t(modem_id >> 8);
+  key[5] = uint8_t(modem_id);
+  key[6] = uint8_t(counter >> 8);
+  key[7] = uint8_t(counter);
+  memcpy(&key[kPayloadOffset], payload.data(), kPayloadLen);
+  return key;
+}
+
+bool is_valid_pubkey(const uint8_t *key) {
+  uint8_t with_sign_byte[29];
+  with_sign_byte[0] = 0x02;
+  memcpy(&with_sign_byte[1], key, kAdvKeyLen);
+  return uECC_valid_compressed_public_key(with_sign_byte, uECC_secp224r1()) != 0;
+}
+
+bool find_valid_key(uint32_t modem_id, const Payload &payload, AdvKey &key) {
+  key = make_adv_key(modem_id, 0, payload);
+  for (uint32_t counter = 0; counter <= UINT16_MAX; counter++) {
+    key[6] = uint8_t(counter >> 8);
+    key[7] = uint8_t(counter);
+    if (is_valid_pubkey(key.data())) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void generate_candidates(uint32_t modem_id, const Payload &prefix, uint32_t index, uint32_t chunk_len,
+                         std::vector<Candidate> &out) {
+  uint32_t num_values = 1u << chunk_len;
+  for (uint32_t val = 0; val < num_values; val++) {
+    Payload payload = prefix;
+    place_chunk(payload, index, uint8_t(val), chunk_len);
+    AdvKey key;
+    if (!find_valid_key(modem_id, payload, key)) {
+      continue;
+    }
+    out.push_back(Candidate{index, uint8_t(val), sha256(key.data(), key.size())});
+  }
+}
+
+} // namespace sendmy
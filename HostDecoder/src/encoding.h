@@ -0,0 +1,41 @@
+#ifndef SENDMY_ENCODING_H
+#define SENDMY_ENCODING_H
+
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// Host-side mirror of the key derivation in Firmware/ESP32/main/modem.c.
+// The modem XORs every chunk value into a running 20 byte payload (the chain prefix) and
+// advertises the first valid secp224r1 public key for that payload.
+
+// XORs chunk `index` with value `val` into the payload, exactly like set_addr_and_payload_for_byte().
+void place_chunk(Payload &payload, uint32_t index, uint8_t val, uint32_t chunk_len);
+
+// Assembles [0xBA 0xBE] [modem_id] [counter] [payload], both integers big endian.
+AdvKey make_adv_key(uint32_t modem_id, uint16_t counter, const Payload &payload);
+
+// Same check as is_valid_pubkey() in the firmware: the key is the x coordinate of a point on the curve.
+bool is_valid_pubkey(const uint8_t *key);
+
+// Searches the first valid key for the payload by bumping the tweak counter, like the firmware does.
+// Returns false if no counter value yields a valid key.
+bool find_valid_key(uint32_t modem_id, const Payload &payload, AdvKey &key);
+
+// One possible value of a chunk and the report id it would be published under.
+struct Candidate {
+  uint32_t chunk;
+  uint8_t value;
+  Digest digest;
+};
+
+// Generates the 2^chunk_len candidates for chunk `index` given the payload after chunk index - 1.
+void generate_candidates(uint32_t modem_id, const Payload &prefix, uint32_t index, uint32_t chunk_len,
+                         std::vector<Candidate> &out);
+
+} // namespace sendmy
+
+#endif // SENDMY_ENCODING_H
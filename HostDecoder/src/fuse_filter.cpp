@@ -0,0 +1,126 @@
+#include "fuse_filter.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sendmy {
+
+namespace {
+
+constexpr int kMaxAttempts = 100;
+
+uint64_t splitmix(uint64_t &state) {
+  uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+} // namespace
+
+bool BinaryFuseFilter::build(std::vector<uint64_t> keys) {
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+  size_ = keys.size();
+  fingerprints_.clear();
+  if (keys.empty()) {
+    return true;
+  }
+
+  // Sizing as in the reference implementation for arity 3.
+  constexpr uint32_t kArity = 3;
+  double n = double(keys.size());
+  segment_length_ = keys.size() < 2 ? 4 : 1u << int(std::floor(std::log(n) / std::log(3.33) + 2.25));
+  segment_length_ = std::min<uint32_t>(segment_length_, 1u << 18);
+  double size_factor = keys.size() < 2 ? 0 : std::max(1.125, 0.875 + 0.25 * std::log(1e6) / std::log(n));
+  size_t capacity = keys.size() < 2 ? 0 : size_t(std::round(n * size_factor));
+  size_t segment_count = (capacity + segment_length_ - 1) / segment_length_;
+  segment_count = segment_count <= kArity - 1 ? 1 : segment_count - (kArity - 1);
+  size_t array_length = (segment_count + kArity - 1) * segment_length_;
+  segment_length_mask_ = segment_length_ - 1;
+  segment_count_length_ = uint32_t(segment_count * segment_length_);
+
+  // Peeling: a slot hit by exactly one key determines that key's fingerprint last. t2count keeps
+  // the number of keys per slot above bit 2 and the xor of their positions (0, 1, 2) below it;
+  // t2hash the xor of their hashes, which is the hash itself once one key is left.
+  std::vector<uint8_t> t2count(array_length);
+  std::vector<uint64_t> t2hash(array_length);
+  std::vector<uint32_t> alone(array_length);
+  std::vector<uint64_t> order(keys.size());
+  std::vector<uint8_t> order_position(keys.size());
+  uint64_t rng = 0x726b2b9d438b9d4dULL;
+
+  for (int attempt = 0;; attempt++) {
+    if (attempt == kMaxAttempts) {
+      size_ = 0;
+      return false;
+    }
+    seed_ = splitmix(rng);
+    std::fill(t2count.begin(), t2count.end(), 0);
+    std::fill(t2hash.begin(), t2hash.end(), 0);
+
+    bool overflow = false;
+    for (uint64_t k : keys) {
+      uint64_t hash = mix(k + seed_);
+      uint32_t h[3];
+      positions(hash, h[0], h[1], h[2]);
+      for (uint32_t p = 0; p < kArity; p++) {
+        t2count[h[p]] = uint8_t((t2count[h[p]] + 4) ^ p);
+        t2hash[h[p]] ^= hash;
+        overflow = overflow || t2count[h[p]] < 4;
+      }
+    }
+    if (overflow) {
+      continue;
+    }
+
+    size_t queued = 0;
+    for (size_t i = 0; i < array_length; i++) {
+      if (t2count[i] >> 2 == 1) {
+        alone[queued++] = uint32_t(i);
+      }
+    }
+    size_t peeled = 0;
+    while (queued > 0) {
+      uint32_t index = alone[--queued];
+      if (t2count[index] >> 2 != 1) {
+        continue;
+      }
+      uint64_t hash = t2hash[index];
+      uint8_t found = t2count[index] & 3;
+      order[peeled] = hash;
+      order_position[peeled] = found;
+      peeled++;
+      uint32_t h[5];
+      positions(hash, h[0], h[1], h[2]);
+      h[3] = h[0];
+      h[4] = h[1];
+      for (uint32_t step = 1; step < kArity; step++) {
+        uint32_t other = h[found + step];
+        if (t2count[other] >> 2 == 2) {
+          alone[queued++] = other;
+        }
+        t2count[other] = uint8_t((t2count[other] - 4) ^ ((found + step) % 3));
+        t2hash[other] ^= hash;
+      }
+    }
+    if (peeled == keys.size()) {
+      break;
+    }
+  }
+
+  // Assign in reverse peeling order, so every key's slot is still free when it is its turn.
+  fingerprints_.assign(array_length, 0);
+  for (size_t i = keys.size(); i-- > 0;) {
+    uint64_t hash = order[i];
+    uint8_t found = order_position[i];
+    uint32_t h[5];
+    positions(hash, h[0], h[1], h[2]);
+    h[3] = h[0];
+    h[4] = h[1];
+    fingerprints_[h[found]] = fingerprint(hash) ^ fingerprints_[h[found + 1]] ^ fingerprints_[h[found + 2]];
+  }
+  return true;
+}
+
+} // namespace sendmy
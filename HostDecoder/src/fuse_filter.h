@@ -0,0 +1,76 @@
+#ifndef SENDMY_FUSE_FILTER_H
+#define SENDMY_FUSE_FILTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// Static 3-wise binary fuse filter with 8 bit fingerprints (Graf and Lemire, "Binary Fuse
+// Filters: Fast and Smaller Than Xor Filters", 2022).
+//
+// About 9 bits per key and a false positive rate of 1/256. A lookup reads three bytes from
+// three neighbouring segments, so the filter of tens of thousands of digests stays in L2 and a
+// miss costs one cache-friendly probe instead of a walk through the 80 byte slots of a
+// DigestIndex. The set is fixed at build(); there are no false negatives.
+class BinaryFuseFilter {
+ public:
+  // Builds the filter over keys (duplicates are fine). Fails only if construction keeps failing
+  // for fresh seeds, which is vanishingly unlikely.
+  bool build(std::vector<uint64_t> keys);
+
+  bool contains(uint64_t key) const {
+    if (fingerprints_.empty()) {
+      return false;
+    }
+    uint64_t hash = mix(key + seed_);
+    uint32_t h0, h1, h2;
+    positions(hash, h0, h1, h2);
+    return (fingerprint(hash) ^ fingerprints_[h0] ^ fingerprints_[h1] ^ fingerprints_[h2]) == 0;
+  }
+  bool contains(const Digest &digest) const { return contains(key(digest)); }
+
+  // Digests are uniformly distributed, their first 8 bytes are as good a key as any.
+  static uint64_t key(const Digest &digest) {
+    uint64_t k;
+    memcpy(&k, digest.data(), sizeof(k));
+    return k;
+  }
+
+  size_t size() const { return size_; }
+  size_t size_bytes() const { return fingerprints_.size(); }
+
+ private:
+  static uint64_t mix(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+  }
+  static uint8_t fingerprint(uint64_t hash) { return uint8_t(hash ^ (hash >> 32)); }
+
+  void positions(uint64_t hash, uint32_t &h0, uint32_t &h1, uint32_t &h2) const {
+    h0 = uint32_t((unsigned __int128)hash * segment_count_length_ >> 64);
+    h1 = h0 + segment_length_;
+    h2 = h1 + segment_length_;
+    h1 ^= uint32_t(hash >> 18) & segment_length_mask_;
+    h2 ^= uint32_t(hash) & segment_length_mask_;
+  }
+
+  uint64_t seed_ = 0;
+  size_t size_ = 0;
+  uint32_t segment_length_ = 0;
+  uint32_t segment_length_mask_ = 0;
+  uint32_t segment_count_length_ = 0;
+  std::vector<uint8_t> fingerprints_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_FUSE_FILTER_H
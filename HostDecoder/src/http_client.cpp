@@ -0,0 +1,198 @@
+#include "http_client.h"
+
+#include <cerrno>
+#include <cstring>
+#include <strings.h>
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace sendmy {
+
+namespace {
+
+bool fail(std::string *error, const std::string &what) {
+  if (error) {
+    *error = what;
+  }
+  return false;
+}
+
+// Waits until fd is ready for `events`, false on timeout.
+bool wait_fd(int fd, short events, int timeout_ms) {
+  struct pollfd p = {fd, events, 0};
+  int r;
+  do {
+    r = poll(&p, 1, timeout_ms);
+  } while (r < 0 && errno == EINTR);
+  return r > 0;
+}
+
+int connect_to(const Url &url, int timeout_ms, std::string *error) {
+  struct addrinfo hints = {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  struct addrinfo *res = nullptr;
+  std::string port = std::to_string(url.port);
+  int rc = getaddrinfo(url.host.c_str(), port.c_str(), &hints, &res);
+  if (rc != 0) {
+    fail(error, std::string("cannot resolve ") + url.host + ": " + gai_strerror(rc));
+    return -1;
+  }
+  int fd = -1;
+  for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+    fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+    if (fd < 0) {
+      continue;
+    }
+    if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+      break;
+    }
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(res);
+  if (fd < 0) {
+    fail(error, "cannot connect to " + url.host + ":" + port + ": " + strerror(errno));
+    return -1;
+  }
+  struct timeval tv = {timeout_ms / 1000, (timeout_ms % 1000) * 1000};
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+  return fd;
+}
+
+bool decode_chunked(const std::string &in, std::string &out) {
+  size_t pos = 0;
+  while (true) {
+    size_t eol = in.find("\r\n", pos);
+    if (eol == std::string::npos) {
+      return false;
+    }
+    size_t len = strtoul(in.c_str() + pos, nullptr, 16);
+    pos = eol + 2;
+    if (len == 0) {
+      return true;
+    }
+    if (pos + len > in.size()) {
+      return false;
+    }
+    out.append(in, pos, len);
+    pos += len + 2;
+  }
+}
+
+} // namespace
+
+const std::string *HttpResponse::header(std::string_view name) const {
+  for (const auto &h : headers) {
+    if (h.first.size() == name.size() && strncasecmp(h.first.c_str(), name.data(), name.size()) == 0) {
+      return &h.second;
+    }
+  }
+  return nullptr;
+}
+
+bool parse_url(const std::string &text, Url &out) {
+  const std::string scheme = "http://";
+  if (text.compare(0, scheme.size(), scheme) != 0) {
+    return false;
+  }
+  size_t host_start = scheme.size();
+  size_t path_start = text.find('/', host_start);
+  std::string authority = text.substr(host_start, path_start == std::string::npos ? std::string::npos
+                                                                                  : path_start - host_start);
+  out.path = path_start == std::string::npos ? "/" : text.substr(path_start);
+  size_t colon = authority.rfind(':');
+  if (colon != std::string::npos && authority.find(']') == std::string::npos) {
+    out.host = authority.substr(0, colon);
+    out.port = uint16_t(strtoul(authority.c_str() + colon + 1, nullptr, 10));
+  } else {
+    out.host = authority;
+    out.port = 80;
+  }
+  return !out.host.empty() && out.port != 0;
+}
+
+bool http_request(const Url &url, const std::string &method, const HttpHeaders &headers, const std::string &body,
+                  HttpResponse &response, int timeout_ms, std::string *error) {
+  response = HttpResponse();
+  int fd = connect_to(url, timeout_ms, error);
+  if (fd < 0) {
+    return false;
+  }
+
+  std::string request = method + " " + url.path + " HTTP/1.1\r\nHost: " + url.host + ":" +
+                        std::to_string(url.port) + "\r\nConnection: close\r\nContent-Length: " +
+                        std::to_string(body.size()) + "\r\n";
+  for (const auto &h : headers) {
+    request += h.first + ": " + h.second + "\r\n";
+  }
+  request += "\r\n";
+  request += body;
+
+  for (size_t sent = 0; sent < request.size();) {
+    ssize_t n = send(fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      close(fd);
+      return fail(error, std::string("send failed: ") + strerror(errno));
+    }
+    sent += size_t(n);
+  }
+
+  std::string raw;
+  char buf[16384];
+  while (true) {
+    if (!wait_fd(fd, POLLIN, timeout_ms)) {
+      close(fd);
+      return fail(error, "timed out waiting for response");
+    }
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0) {
+      close(fd);
+      return fail(error, std::string("recv failed: ") + strerror(errno));
+    }
+    if (n == 0) {
+      break;
+    }
+    raw.append(buf, size_t(n));
+  }
+  close(fd);
+
+  size_t head_end = raw.find("\r\n\r\n");
+  if (raw.compare(0, 5, "HTTP/") != 0 || head_end == std::string::npos) {
+    return fail(error, "malformed response");
+  }
+  size_t sp = raw.find(' ');
+  response.status = atoi(raw.c_str() + sp + 1);
+  size_t line = raw.find("\r\n") + 2;
+  while (line < head_end) {
+    size_t eol = raw.find("\r\n", line);
+    size_t colon = raw.find(':', line);
+    if (colon != std::string::npos && colon < eol) {
+      size_t value = raw.find_first_not_of(' ', colon + 1);
+      response.headers.emplace_back(raw.substr(line, colon - line), raw.substr(value, eol - value));
+    }
+    line = eol + 2;
+  }
+
+  std::string payload = raw.substr(head_end + 4);
+  const std::string *te = response.header("Transfer-Encoding");
+  if (te && strcasecmp(te->c_str(), "chunked") == 0) {
+    if (!decode_chunked(payload, response.body)) {
+      return fail(error, "malformed chunked body");
+    }
+  } else {
+    response.body = std::move(payload);
+  }
+  return true;
+}
+
+} // namespace sendmy
@@ -0,0 +1,39 @@
+#ifndef SENDMY_HTTP_CLIENT_H
+#define SENDMY_HTTP_CLIENT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sendmy {
+
+using HttpHeaders = std::vector<std::pair<std::string, std::string>>;
+
+struct HttpResponse {
+  int status = 0;
+  HttpHeaders headers;
+  std::string body;
+
+  // Case-insensitive header lookup, nullptr if absent.
+  const std::string *header(std::string_view name) const;
+};
+
+struct Url {
+  std::string host;
+  uint16_t port = 80;
+  std::string path = "/";
+};
+
+// Parses an http:// URL. TLS endpoints are not supported; talk to them through a local relay.
+bool parse_url(const std::string &text, Url &out);
+
+// Sends a single request on a fresh connection and reads the whole response.
+// Returns false on connection or protocol errors, with a description in error.
+bool http_request(const Url &url, const std::string &method, const HttpHeaders &headers, const std::string &body,
+                  HttpResponse &response, int timeout_ms = 30000, std::string *error = nullptr);
+
+} // namespace sendmy
+
+#endif // SENDMY_HTTP_CLIENT_H
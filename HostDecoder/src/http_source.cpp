@@ -0,0 +1,210 @@
+#include "http_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "base64.h"
+
+namespace sendmy {
+
+std::string build_fetch_body(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms) {
+  std::string body = "{\"search\":[{\"endDate\":\"" + std::to_string(end_ms) + "\",\"ids\":[";
+  char id[kDigestBase64Len + 1];
+  for (size_t i = 0; i < ids.size(); i++) {
+    base64_encode_digest(ids[i], id);
+    body += i ? ",\"" : "\"";
+    body.append(id, kDigestBase64Len);
+    body += '"';
+  }
+  body += "],\"startDate\":\"" + std::to_string(start_ms) + "\"}]}";
+  return body;
+}
+
+HttpSource::~HttpSource() {
+  {
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    stop_ = true;
+  }
+  pool_cv_.notify_all();
+  for (std::thread &t : threads_) {
+    t.join();
+  }
+}
+
+bool HttpSource::open(const std::string &url, std::string *error) {
+  if (!parse_url(url, url_)) {
+    if (error) {
+      *error = "unsupported url " + url;
+    }
+    return false;
+  }
+  headers_ = {{"Content-Type", "application/json"}, {"Accept", "application/json"}};
+  return true;
+}
+
+void HttpSource::add_header(const std::string &name, const std::string &value) {
+  headers_.emplace_back(name, value);
+}
+
+int HttpSource::last_status() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_status_;
+}
+
+std::string HttpSource::last_error() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return last_error_;
+}
+
+bool HttpSource::fetch(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                       std::vector<Report> &out) {
+  std::string body = build_fetch_body(ids, start_ms, end_ms);
+  for (int attempt = 0;; attempt++) {
+    if (controller_) {
+      controller_->acquire();
+    }
+    HttpResponse response;
+    std::string error;
+    auto t0 = std::chrono::steady_clock::now();
+    bool ok = http_request(url_, "POST", headers_, body, response, 30000, &error);
+    int64_t latency_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    int64_t retry_after_ms = parse_retry_after_ms(response.header("Retry-After"));
+    int status = ok ? response.status : 0;
+    if (controller_) {
+      controller_->release(status, latency_ms, retry_after_ms);
+    }
+    requests_++;
+    bytes_sent_ += body.size();
+    bytes_received_ += response.body.size();
+
+    if (ok && status == 200) {
+      std::vector<Report> reports;
+      ok = parse_report_results(response.body, reports, &error);
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_status_ = status;
+      if (!ok) {
+        last_error_ = error;
+        return false;
+      }
+      out.insert(out.end(), reports.begin(), reports.end());
+      return true;
+    }
+
+    bool retry = (status == 0 || status == 429 || status == 503) && attempt < max_retries_;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      last_status_ = status;
+      last_error_ = ok ? "HTTP " + std::to_string(status) : error;
+    }
+    if (!retry) {
+      return false;
+    }
+    retries_++;
+    // The controller holds back the next acquire() for the pause; without one, wait here.
+    if (!controller_) {
+      int64_t pause = retry_after_ms >= 0 ? retry_after_ms : AimdParams().default_retry_after_ms;
+      std::this_thread::sleep_for(std::chrono::milliseconds(pause));
+    }
+  }
+}
+
+bool HttpSource::query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                       std::vector<Report> &out) {
+  if (ids.empty()) {
+    return true;
+  }
+  size_t parts = (ids.size() + max_ids_ - 1) / max_ids_;
+  auto part = [&](size_t i) {
+    return std::vector<Digest>(ids.begin() + i * max_ids_, ids.begin() + std::min(ids.size(), (i + 1) * max_ids_));
+  };
+  if (parts == 1 || !controller_) {
+    for (size_t i = 0; i < parts; i++) {
+      if (!fetch(part(i), start_ms, end_ms, out)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // The threads only bound the concurrency; the controller decides how many requests are in flight.
+  std::vector<std::vector<Report>> results(parts);
+  size_t threads = std::max<size_t>(1, size_t(controller_->params().max_limit));
+  bool ok = run_parts(parts, threads, [&](size_t i) { return fetch(part(i), start_ms, end_ms, results[i]); });
+  for (const std::vector<Report> &r : results) {
+    out.insert(out.end(), r.begin(), r.end());
+  }
+  return ok;
+}
+
+bool HttpSource::run_parts(size_t parts, size_t threads, const std::function<bool(size_t)> &fn) {
+  std::atomic<size_t> next{0};
+  std::atomic<bool> ok{true};
+  auto drain = [&] {
+    for (size_t i; ok && (i = next++) < parts;) {
+      if (!fn(i)) {
+        ok = false;
+      }
+    }
+  };
+  std::mutex done_mu;
+  std::condition_variable done_cv;
+  // The calling thread takes parts as well.
+  size_t running = std::min(parts, threads) - 1;
+  auto helper = [&] {
+    drain();
+    // Notified under the lock: the caller may return, and destroy done_cv, as soon as it is released.
+    std::lock_guard<std::mutex> lock(done_mu);
+    if (--running == 0) {
+      done_cv.notify_one();
+    }
+  };
+  {
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    while (threads_.size() + 1 < threads) {
+      threads_.emplace_back([this] { work(); });
+    }
+    for (size_t i = 0; i < running; i++) {
+      jobs_.emplace_back(&next, helper);
+    }
+  }
+  pool_cv_.notify_all();
+  drain();
+
+  // Helpers still queued behind other queries have nothing left to do.
+  size_t dropped = 0;
+  {
+    std::lock_guard<std::mutex> lock(pool_mu_);
+    for (auto it = jobs_.begin(); it != jobs_.end();) {
+      if (it->first == &next) {
+        it = jobs_.erase(it);
+        dropped++;
+      } else {
+        ++it;
+      }
+    }
+  }
+  std::unique_lock<std::mutex> lock(done_mu);
+  running -= dropped;
+  done_cv.wait(lock, [&] { return running == 0; });
+  return ok;
+}
+
+void HttpSource::work() {
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(pool_mu_);
+      pool_cv_.wait(lock, [&] { return stop_ || !jobs_.empty(); });
+      if (jobs_.empty()) {
+        return;
+      }
+      job = std::move(jobs_.front().second);
+      jobs_.pop_front();
+    }
+    job();
+  }
+}
+
+} // namespace sendmy
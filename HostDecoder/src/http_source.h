@@ -0,0 +1,90 @@
+#ifndef SENDMY_HTTP_SOURCE_H
+#define SENDMY_HTTP_SOURCE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "aimd.h"
+#include "http_client.h"
+#include "report_source.h"
+
+namespace sendmy {
+
+// Queries an acsnservice/fetch compatible endpoint, with the request body built like ReportsFetcher.m.
+// Authentication is whatever headers the caller adds; the mock server needs none.
+//
+// Queries with more than max_ids ids are split into several requests. With a controller set, those
+// run concurrently within its limit, and throttled or failed requests are retried after the pause
+// it imposes. The requests go out from a set of threads that is started on the first split query
+// and kept for the lifetime of the source, and from the querying thread. query() may be called
+// from several threads.
+class HttpSource : public ReportSource {
+ public:
+  HttpSource() = default;
+  ~HttpSource();
+  HttpSource(const HttpSource &) = delete;
+  HttpSource &operator=(const HttpSource &) = delete;
+
+  // url is the full fetch endpoint, e.g. http://127.0.0.1:8081/acsnservice/fetch.
+  bool open(const std::string &url, std::string *error = nullptr);
+  void add_header(const std::string &name, const std::string &value);
+
+  void set_max_ids(size_t max_ids) { max_ids_ = max_ids ? max_ids : 1; }
+  // Enables concurrent requests and retries. May be null. Must outlive the source.
+  void set_controller(AimdController *controller) { controller_ = controller; }
+  void set_max_retries(int retries) { max_retries_ = retries; }
+
+  bool query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+             std::vector<Report> &out) override;
+
+  int last_status() const;
+  std::string last_error() const;
+  uint64_t requests() const { return requests_; }
+  uint64_t retries() const { return retries_; }
+  uint64_t bytes_sent() const { return bytes_sent_; }
+  uint64_t bytes_received() const { return bytes_received_; }
+
+ private:
+  // Sends one request, retrying throttled ones while retries are left.
+  bool fetch(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms, std::vector<Report> &out);
+  // Calls fn for parts 0 to parts - 1 on the calling thread and up to threads - 1 request threads,
+  // and stops handing out parts after the first false.
+  bool run_parts(size_t parts, size_t threads, const std::function<bool(size_t)> &fn);
+  void work();
+
+  Url url_;
+  HttpHeaders headers_;
+  size_t max_ids_ = 2048;
+  AimdController *controller_ = nullptr;
+  int max_retries_ = 5;
+
+  mutable std::mutex mutex_;
+  int last_status_ = 0;
+  std::string last_error_;
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> retries_{0};
+  std::atomic<uint64_t> bytes_sent_{0};
+  std::atomic<uint64_t> bytes_received_{0};
+
+  // Request threads and their jobs, each tagged with the run_parts() call it belongs to.
+  std::mutex pool_mu_;
+  std::condition_variable pool_cv_;
+  std::deque<std::pair<const void *, std::function<void()>>> jobs_;
+  bool stop_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Builds the {"search": [{"endDate", "ids", "startDate"}]} request body.
+std::string build_fetch_body(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms);
+
+} // namespace sendmy
+
+#endif // SENDMY_HTTP_SOURCE_H
@@ -0,0 +1,293 @@
+#include "json.h"
+
+#include <cstdint>
+#include <cstdlib>
+
+namespace sendmy {
+
+namespace {
+
+class Parser {
+ public:
+  explicit Parser(std::string_view text) : text_(text) {}
+
+  bool parse(JsonValue &out, std::string *error) {
+    if (!value(out, 0)) {
+      if (error) {
+        *error = error_ + " at offset " + std::to_string(pos_);
+      }
+      return false;
+    }
+    skip_ws();
+    if (pos_ != text_.size()) {
+      if (error) {
+        *error = "trailing characters at offset " + std::to_string(pos_);
+      }
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  static constexpr int kMaxDepth = 64;
+
+  void skip_ws() {
+    while (pos_ < text_.size() &&
+           (text_[pos_] == ' ' || text_[pos_] == '\t' || text_[pos_] == '\n' || text_[pos_] == '\r')) {
+      pos_++;
+    }
+  }
+
+  bool fail(const char *what) {
+    error_ = what;
+    return false;
+  }
+
+  bool literal(std::string_view word) {
+    if (text_.substr(pos_, word.size()) != word) {
+      return fail("invalid literal");
+    }
+    pos_ += word.size();
+    return true;
+  }
+
+  bool value(JsonValue &out, int depth) {
+    if (depth > kMaxDepth) {
+      return fail("nesting too deep");
+    }
+    skip_ws();
+    if (pos_ >= text_.size()) {
+      return fail("unexpected end of input");
+    }
+    char c = text_[pos_];
+    if (c == '{') {
+      out.type = JsonValue::Type::Object;
+      pos_++;
+      skip_ws();
+      if (pos_ < text_.size() && text_[pos_] == '}') {
+        pos_++;
+        return true;
+      }
+      while (true) {
+        skip_ws();
+        std::string key;
+        if (pos_ >= text_.size() || text_[pos_] != '"' || !string(key)) {
+          return fail("expected object key");
+        }
+        skip_ws();
+        if (pos_ >= text_.size() || text_[pos_] != ':') {
+          return fail("expected ':'");
+        }
+        pos_++;
+        out.object.emplace_back(std::move(key), JsonValue());
+        if (!value(out.object.back().second, depth + 1)) {
+          return false;
+        }
+        skip_ws();
+        if (pos_ < text_.size() && text_[pos_] == ',') {
+          pos_++;
+          continue;
+        }
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+          pos_++;
+          return true;
+        }
+        return fail("expected ',' or '}'");
+      }
+    }
+    if (c == '[') {
+      out.type = JsonValue::Type::Array;
+      pos_++;
+      skip_ws();
+      if (pos_ < text_.size() && text_[pos_] == ']') {
+        pos_++;
+        return true;
+      }
+      while (true) {
+        out.array.emplace_back();
+        if (!value(out.array.back(), depth + 1)) {
+          return false;
+        }
+        skip_ws();
+        if (pos_ < text_.size() && text_[pos_] == ',') {
+          pos_++;
+          continue;
+        }
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+          pos_++;
+          return true;
+        }
+        return fail("expected ',' or ']'");
+      }
+    }
+    if (c == '"') {
+      out.type = JsonValue::Type::String;
+      return string(out.string);
+    }
+    if (c == 't') {
+      out.type = JsonValue::Type::Bool;
+      out.boolean = true;
+      return literal("true");
+    }
+    if (c == 'f') {
+      out.type = JsonValue::Type::Bool;
+      return literal("false");
+    }
+    if (c == 'n') {
+      return literal("null");
+    }
+    return number(out);
+  }
+
+  bool number(JsonValue &out) {
+    size_t start = pos_;
+    while (pos_ < text_.size()) {
+      char c = text_[pos_];
+      if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E') {
+        pos_++;
+      } else {
+        break;
+      }
+    }
+    if (start == pos_) {
+      return fail("unexpected character");
+    }
+    std::string digits(text_.substr(start, pos_ - start));
+    char *end = nullptr;
+    out.type = JsonValue::Type::Number;
+    out.number = strtod(digits.c_str(), &end);
+    if (end != digits.c_str() + digits.size()) {
+      return fail("invalid number");
+    }
+    return true;
+  }
+
+  static void append_utf8(std::string &out, uint32_t cp) {
+    if (cp < 0x80) {
+      out += char(cp);
+    } else if (cp < 0x800) {
+      out += char(0xc0 | (cp >> 6));
+      out += char(0x80 | (cp & 0x3f));
+    } else if (cp < 0x10000) {
+      out += char(0xe0 | (cp >> 12));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    } else {
+      out += char(0xf0 | (cp >> 18));
+      out += char(0x80 | ((cp >> 12) & 0x3f));
+      out += char(0x80 | ((cp >> 6) & 0x3f));
+      out += char(0x80 | (cp & 0x3f));
+    }
+  }
+
+  bool hex4(uint32_t &cp) {
+    if (pos_ + 4 > text_.size()) {
+      return fail("truncated escape");
+    }
+    cp = 0;
+    for (int i = 0; i < 4; i++) {
+      char c = text_[pos_++];
+      cp <<= 4;
+      if (c >= '0' && c <= '9') cp |= uint32_t(c - '0');
+      else if (c >= 'a' && c <= 'f') cp |= uint32_t(c - 'a' + 10);
+      else if (c >= 'A' && c <= 'F') cp |= uint32_t(c - 'A' + 10);
+      else return fail("invalid escape");
+    }
+    return true;
+  }
+
+  bool string(std::string &out) {
+    pos_++; // opening quote
+    while (pos_ < text_.size()) {
+      char c = text_[pos_++];
+      if (c == '"') {
+        return true;
+      }
+      if (c != '\\') {
+        out += c;
+        continue;
+      }
+      if (pos_ >= text_.size()) {
+        break;
+      }
+      char e = text_[pos_++];
+      switch (e) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+          uint32_t cp;
+          if (!hex4(cp)) {
+            return false;
+          }
+          if (cp >= 0xd800 && cp < 0xdc00 && text_.substr(pos_, 2) == "\\u") {
+            pos_ += 2;
+            uint32_t lo;
+            if (!hex4(lo)) {
+              return false;
+            }
+            cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+          }
+          append_utf8(out, cp);
+          break;
+        }
+        default:
+          return fail("invalid escape");
+      }
+    }
+    return fail("unterminated string");
+  }
+
+  std::string_view text_;
+  size_t pos_ = 0;
+  std::string error_;
+};
+
+} // namespace
+
+const JsonValue *JsonValue::get(std::string_view key) const {
+  if (type != Type::Object) {
+    return nullptr;
+  }
+  for (const auto &member : object) {
+    if (member.first == key) {
+      return &member.second;
+    }
+  }
+  return nullptr;
+}
+
+bool json_parse(std::string_view text, JsonValue &out, std::string *error) {
+  out = JsonValue();
+  return Parser(text).parse(out, error);
+}
+
+void json_append_string(std::string &out, std::string_view s) {
+  static const char kHex[] = "0123456789abcdef";
+  out += '"';
+  for (char c : s) {
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default:
+        if (uint8_t(c) < 0x20) {
+          out += "\\u00";
+          out += kHex[(c >> 4) & 0xf];
+          out += kHex[c & 0xf];
+        } else {
+          out += c;
+        }
+    }
+  }
+  out += '"';
+}
+
+} // namespace sendmy
@@ -0,0 +1,34 @@
+#ifndef SENDMY_JSON_H
+#define SENDMY_JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace sendmy {
+
+// Minimal JSON document model, just enough for the acsnservice/fetch responses.
+struct JsonValue {
+  enum class Type { Null, Bool, Number, String, Array, Object };
+
+  Type type = Type::Null;
+  bool boolean = false;
+  double number = 0;
+  std::string string;
+  std::vector<JsonValue> array;
+  std::vector<std::pair<std::string, JsonValue>> object;
+
+  // Returns the member with the given key, or nullptr if this is not an object or has no such key.
+  const JsonValue *get(std::string_view key) const;
+};
+
+// Parses a complete JSON document. On failure returns false and describes the problem in error.
+bool json_parse(std::string_view text, JsonValue &out, std::string *error = nullptr);
+
+// Appends s to out as a quoted JSON string.
+void json_append_string(std::string &out, std::string_view s);
+
+} // namespace sendmy
+
+#endif // SENDMY_JSON_H
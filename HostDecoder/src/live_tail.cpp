@@ -0,0 +1,164 @@
+#include "live_tail.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace sendmy {
+
+void LiveTail::follow(const MessageParams &params) {
+  Followed f;
+  f.decoder = std::make_unique<MessageDecoder>(uint32_t(followed_.size()), params, index_);
+  f.decoder->set_cache(cache_);
+  f.decoder->set_checkpoints(checkpoints_);
+  f.restored = f.decoder->resolved_chunks() > 0;
+  followed_.push_back(std::move(f));
+}
+
+bool LiveTail::done() const {
+  for (const Followed &f : followed_) {
+    if (!f.decoder->finished()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool LiveTail::advance(Followed &f, int64_t now_ms) {
+  MessageDecoder &d = *f.decoder;
+  switch (d.pending()) {
+  case MessageDecoder::Pending::Empty:
+    return false;
+  case MessageDecoder::Pending::Alias:
+    if (now_ms - f.pending_since_ms < params_.alias_settle_ms) {
+      return false;
+    }
+    break;
+  case MessageDecoder::Pending::Solid:
+  case MessageDecoder::Pending::Blind:
+    break;
+  }
+  d.resolve_chunk();
+  f.pending_since_ms = -1;
+  emit(f, now_ms);
+  return true;
+}
+
+void LiveTail::emit(Followed &f, int64_t now_ms) {
+  const MessageDecoder &d = *f.decoder;
+  f.stream.update(d, [&](const DecodedByte &b) {
+    sink_.on_byte(TailByte{&d.params(), b.offset_from_end, b.value, b.confidence, f.newest_published_ms, now_ms});
+  });
+  if (d.finished()) {
+    sink_.on_finished(d.params(), d.message());
+  }
+}
+
+bool LiveTail::query(std::vector<Report> &out) {
+  // (from, id) for every pending candidate. An id two messages share is asked for once, from the
+  // older cursor.
+  std::vector<std::pair<int64_t, Digest>> wanted;
+  std::vector<Digest> ids;
+  for (Followed &f : followed_) {
+    if (f.decoder->finished()) {
+      continue;
+    }
+    ids.clear();
+    f.decoder->prepare_chunk(ids);
+    int64_t from = params_.start_ms;
+    if (f.newest_published_ms > 0) {
+      from = std::max(from, f.newest_published_ms - params_.overlap_ms);
+    }
+    for (const Digest &id : ids) {
+      wanted.emplace_back(from, id);
+    }
+  }
+  std::sort(wanted.begin(), wanted.end(), [](const auto &a, const auto &b) {
+    return a.second != b.second ? a.second < b.second : a.first < b.first;
+  });
+  wanted.erase(std::unique(wanted.begin(), wanted.end(),
+                           [](const auto &a, const auto &b) { return a.second == b.second; }),
+               wanted.end());
+  // In cursor order, so each request starts at its first id's cursor and the messages that are
+  // caught up share requests.
+  std::stable_sort(wanted.begin(), wanted.end(), [](const auto &a, const auto &b) { return a.first < b.first; });
+
+  size_t max_ids = std::max<size_t>(params_.max_ids_per_request, 1);
+  for (size_t first = 0; first < wanted.size(); first += max_ids) {
+    size_t last = std::min(wanted.size(), first + max_ids);
+    ids.clear();
+    for (size_t i = first; i < last; i++) {
+      ids.push_back(wanted[i].second);
+    }
+    requests_++;
+    if (!source_.query(ids, wanted[first].first, INT64_MAX, out)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int64_t LiveTail::poll(int64_t now_ms, bool *ok) {
+  polls_++;
+  if (ok) {
+    *ok = true;
+  }
+  bool progressed = false;
+  for (Followed &f : followed_) {
+    if (f.restored) {
+      f.restored = false;
+      emit(f, now_ms);
+    }
+  }
+  std::vector<Report> reports;
+  // A resolved chunk makes the next one queryable, whose reports may well be in already.
+  for (bool again = true; again;) {
+    again = false;
+    reports.clear();
+    bool pending = false;
+    for (Followed &f : followed_) {
+      if (!f.decoder->finished()) {
+        pending = true;
+        if (f.pending_since_ms < 0) {
+          f.pending_since_ms = now_ms;
+          f.newest_published_ms = 0;
+        }
+      }
+    }
+    if (!pending) {
+      break;
+    }
+    if (!query(reports)) {
+      if (ok) {
+        *ok = false;
+      }
+      break;
+    }
+    for (const Report &r : reports) {
+      index_.for_each(r.id, [&](const IndexEntry &entry) {
+        if (entry.message < followed_.size()) {
+          Followed &f = followed_[entry.message];
+          f.decoder->add_report(entry, r);
+          f.newest_published_ms = std::max(f.newest_published_ms, r.date_published_ms);
+        }
+      });
+    }
+    for (Followed &f : followed_) {
+      if (!f.decoder->finished() && advance(f, now_ms)) {
+        again = progressed = true;
+      }
+    }
+  }
+
+  interval_ms_ = progressed ? params_.min_interval_ms
+                            : std::min(params_.max_interval_ms, int64_t(double(interval_ms_) * params_.backoff));
+  // Wake up in time to settle aliased chunks.
+  int64_t delay = interval_ms_;
+  for (const Followed &f : followed_) {
+    if (!f.decoder->finished() && f.decoder->pending() == MessageDecoder::Pending::Alias) {
+      delay = std::min(delay, std::max(params_.min_interval_ms, f.pending_since_ms + params_.alias_settle_ms - now_ms));
+    }
+  }
+  return delay;
+}
+
+} // namespace sendmy
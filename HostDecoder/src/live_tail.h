@@ -0,0 +1,111 @@
+#ifndef SENDMY_LIVE_TAIL_H
+#define SENDMY_LIVE_TAIL_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "report_source.h"
+
+namespace sendmy {
+
+struct TailParams {
+  // Poll interval while chunks keep resolving, and the limit it backs off to when idle.
+  int64_t min_interval_ms = 1000;
+  int64_t max_interval_ms = 60000;
+  double backoff = 2;
+  // A chunk whose only reports are those of the previous chunk's key is taken as 0 after this long
+  // without a better candidate showing up.
+  int64_t alias_settle_ms = 30000;
+  // Reports published before this are ignored.
+  int64_t start_ms = 0;
+  // A message's pending chunk is re-queried from this far before its newest report, for reports
+  // that show up with a slightly older datePublished (clock skew, backend lag). The duplicates
+  // are dropped by the vote.
+  int64_t overlap_ms = 60 * 1000;
+  size_t max_ids_per_request = 2048;
+};
+
+// A byte that became final, counted from the end of the message (the modem sends it backwards).
+struct TailByte {
+  const MessageParams *message;
+  size_t offset_from_end;
+  uint8_t byte;
+  // See MessageDecoder::byte_confidence().
+  float confidence;
+  // datePublished of the newest report that went into the chunk completing the byte.
+  int64_t published_ms;
+  // When the byte was decoded.
+  int64_t decoded_ms;
+};
+
+class TailSink {
+ public:
+  virtual ~TailSink() = default;
+  virtual void on_byte(const TailByte &byte) = 0;
+  // The message ended; message is the whole decoded message in its original order.
+  virtual void on_finished(const MessageParams &params, const std::vector<uint8_t> &message) = 0;
+};
+
+// Follows a set of messages as their reports come in, polling faster while chunks resolve and backing
+// off while nothing happens. The pending chunks of all messages are packed into shared requests.
+// Bytes are handed to the sink as soon as they are final.
+//
+// The reports of a pending chunk add up over the polls, so each poll only asks for what was
+// published since the newest report of the chunk so far; a request starts at the oldest such
+// cursor among the messages it carries.
+class LiveTail {
+ public:
+  LiveTail(ReportSource &source, TailSink &sink, const TailParams &params = TailParams())
+      : source_(source), sink_(sink), params_(params), interval_ms_(params.min_interval_ms) {}
+
+  void set_cache(CandidateCache *cache) { cache_ = cache; }
+  // Messages followed afterwards resume from and keep writing checkpoints in store.
+  void set_checkpoints(CheckpointStore *store) { checkpoints_ = store; }
+  void follow(const MessageParams &params);
+
+  // Queries all unfinished messages and resolves what it can, repeating while chunks resolve.
+  // Returns the delay until the next poll. False in *ok if the source failed.
+  int64_t poll(int64_t now_ms, bool *ok = nullptr);
+
+  // True once every followed message has ended.
+  bool done() const;
+  uint64_t polls() const { return polls_; }
+  uint64_t requests() const { return requests_; }
+
+ private:
+  struct Followed {
+    std::unique_ptr<MessageDecoder> decoder;
+    // When the pending chunk was first queried, for the alias timeout.
+    int64_t pending_since_ms = -1;
+    // Newest datePublished among the pending chunk's reports, 0 before the first one.
+    int64_t newest_published_ms = 0;
+    ByteStream stream;
+    // Resumed from a checkpoint; its bytes go to the sink on the first poll.
+    bool restored = false;
+  };
+
+  // Resolves the pending chunk of f if the reports allow; true if it did.
+  bool advance(Followed &f, int64_t now_ms);
+  void emit(Followed &f, int64_t now_ms);
+  // Queries the pending chunks of the unfinished messages, each from its cursor.
+  bool query(std::vector<Report> &out);
+
+  ReportSource &source_;
+  TailSink &sink_;
+  TailParams params_;
+  CandidateCache *cache_ = nullptr;
+  CheckpointStore *checkpoints_ = nullptr;
+  DigestIndex index_;
+  std::vector<Followed> followed_;
+  int64_t interval_ms_;
+  uint64_t polls_ = 0;
+  uint64_t requests_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_LIVE_TAIL_H
@@ -0,0 +1,337 @@
+#include "message_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "checkpoint.h"
+
+namespace sendmy {
+
+namespace {
+
+template <typename T> void put(std::string &out, T value) {
+  // Little endian, whatever the host.
+  for (size_t i = 0; i < sizeof(T); i++) {
+    out.push_back(char(uint64_t(value) >> (8 * i)));
+  }
+}
+
+template <typename T> bool get(std::string_view &in, T &value) {
+  if (in.size() < sizeof(T)) {
+    return false;
+  }
+  uint64_t v = 0;
+  for (size_t i = 0; i < sizeof(T); i++) {
+    v |= uint64_t(uint8_t(in[i])) << (8 * i);
+  }
+  value = T(v);
+  in.remove_prefix(sizeof(T));
+  return true;
+}
+
+enum StateFlags : uint8_t { kFinished = 1, kHasPrev = 2, kSpanValid = 4 };
+
+} // namespace
+
+MessageDecoder::MessageDecoder(uint32_t handle, const MessageParams &params, DigestIndex &index)
+    : handle_(handle), params_(params), index_(index), vote_(params.vote) {
+  if (params_.chunk_len == 0 || params_.chunk_len > kMaxChunkLen) {
+    params_.chunk_len = 4;
+  }
+  state_ = MessageState(params_.chunk_len);
+}
+
+void MessageDecoder::set_checkpoints(CheckpointStore *store) {
+  checkpoints_ = store;
+  if (checkpoints_ && resolved_chunks() == 0 && !prepared_) {
+    checkpoints_->load(*this);
+  }
+}
+
+void MessageDecoder::save_state(std::string &out) const {
+  put<uint32_t>(out, state_.chunks());
+  put<uint64_t>(out, solid_bits_);
+  put<uint8_t>(out, (finished_ ? kFinished : 0) | (has_prev_ ? kHasPrev : 0) |
+                        (last_vote_.span.valid ? kSpanValid : 0));
+  out.append(reinterpret_cast<const char *>(prev_digest_.data()), kDigestLen);
+  put<int16_t>(out, int16_t(last_vote_.value));
+  put<int32_t>(out, last_vote_.span.lo);
+  put<int32_t>(out, last_vote_.span.hi);
+  for (size_t j = 0; j < (state_.bits() + 7) / 8; j++) {
+    out.push_back(char(state_.byte_from_end(j)));
+  }
+  // Margins only feed the byte confidences, a byte each is plenty.
+  for (float m : margins_) {
+    out.push_back(char(std::lround(std::clamp(m, 0.0f, 1.0f) * 255)));
+  }
+  out.append(reinterpret_cast<const char *>(state_.prefix().data()), kPayloadLen);
+}
+
+bool MessageDecoder::restore_state(std::string_view in) {
+  if (resolved_chunks() != 0 || prepared_) {
+    return false;
+  }
+  uint32_t chunks;
+  uint64_t solid_bits;
+  uint8_t flags;
+  int16_t vote_value;
+  TimeSpan span;
+  if (!get(in, chunks) || !get(in, solid_bits) || !get(in, flags) || in.size() < kDigestLen) {
+    return false;
+  }
+  Digest prev;
+  memcpy(prev.data(), in.data(), kDigestLen);
+  in.remove_prefix(kDigestLen);
+  if (!get(in, vote_value) || !get(in, span.lo) || !get(in, span.hi)) {
+    return false;
+  }
+  size_t cl = params_.chunk_len;
+  size_t packed = (size_t(chunks) * cl + 7) / 8;
+  if (chunks > params_.max_chunks || solid_bits > size_t(chunks) * cl || in.size() != packed + chunks + kPayloadLen) {
+    return false;
+  }
+
+  MessageState state(params_.chunk_len);
+  const uint8_t *bits = reinterpret_cast<const uint8_t *>(in.data());
+  for (size_t i = 0; i < chunks; i++) {
+    unsigned value = 0;
+    for (size_t b = 0; b < cl; b++) {
+      size_t bit = i * cl + b;
+      value |= unsigned((bits[bit / 8] >> (bit % 8)) & 1) << b;
+    }
+    state.append(uint8_t(value));
+  }
+  // The prefix is rebuilt from the chunks, the stored copy guards against a mismatched file.
+  if (memcmp(state.prefix().data(), bits + packed + chunks, kPayloadLen) != 0) {
+    return false;
+  }
+
+  state_ = std::move(state);
+  margins_.clear();
+  for (size_t i = 0; i < chunks; i++) {
+    margins_.push_back(float(bits[packed + i]) / 255);
+  }
+  solid_bits_ = solid_bits;
+  finished_ = flags & kFinished;
+  has_prev_ = flags & kHasPrev;
+  prev_digest_ = prev;
+  last_vote_ = Vote();
+  last_vote_.value = vote_value;
+  last_vote_.span = span;
+  last_vote_.span.valid = flags & kSpanValid;
+  last_vote_.margin = margins_.empty() ? 0 : margins_.back();
+  return true;
+}
+
+CandidateKey MessageDecoder::pending_key() const {
+  return CandidateKey{params_.modem_id, params_.message_id, params_.chunk_len, resolved_chunks(), state_.prefix()};
+}
+
+void MessageDecoder::prepare_chunk(std::vector<Digest> &ids) {
+  if (!finished_ && !prepared_) {
+    scratch_.clear();
+    generate_candidates_cached(cache_, pending_key(), scratch_);
+  }
+  prepare_chunk(ids, scratch_);
+}
+
+void MessageDecoder::prepare_chunk(std::vector<Digest> &ids, const std::vector<Candidate> &generated) {
+  if (finished_) {
+    return;
+  }
+  uint32_t chunk = resolved_chunks();
+  if (!prepared_) {
+    for (const Candidate &c : generated) {
+      candidates_.add(c);
+      index_.insert(c.digest, IndexEntry{handle_, c.chunk, c.value});
+    }
+    vote_.reset();
+    prepared_ = true;
+  }
+  size_t first, last;
+  candidates_.range(chunk, first, last);
+  for (size_t i = first; i < last; i++) {
+    ids.push_back(candidates_.digest(i));
+  }
+}
+
+void MessageDecoder::add_report(const IndexEntry &entry, const Report &report) {
+  if (entry.message != handle_ || !prepared_ || entry.chunk != resolved_chunks()) {
+    return;
+  }
+  vote_.add(entry.value, report);
+}
+
+void MessageDecoder::retire_chunk(uint32_t chunk) {
+  size_t first, last;
+  candidates_.range(chunk, first, last);
+  for (size_t i = first; i < last; i++) {
+    index_.erase(candidates_.digest(i), IndexEntry{handle_, chunk, candidates_.value(i)});
+  }
+  candidates_.drop_before(chunk + 1);
+}
+
+bool MessageDecoder::blind_chunk() const {
+  size_t first, last;
+  candidates_.range(resolved_chunks(), first, last);
+  bool blind = first < last;
+  for (size_t i = first; i < last; i++) {
+    blind = blind && candidates_.digest(i) == candidates_.digest(first);
+  }
+  return blind && resolved_chunks() + 1 < params_.max_chunks;
+}
+
+int MessageDecoder::alias_value() const {
+  size_t first, last;
+  candidates_.range(resolved_chunks(), first, last);
+  int alias = -1;
+  for (size_t i = first; i < last && has_prev_; i++) {
+    if (candidates_.digest(i) == prev_digest_) {
+      alias = candidates_.value(i);
+    }
+  }
+  return alias;
+}
+
+MessageDecoder::Pending MessageDecoder::pending() const {
+  if (finished_ || !prepared_) {
+    return Pending::Empty;
+  }
+  if (blind_chunk()) {
+    return Pending::Blind;
+  }
+  int alias = alias_value();
+  Vote vote = vote_.decide(last_vote_.span, alias);
+  if (vote.value < 0) {
+    return Pending::Empty;
+  }
+  return vote.value == alias ? Pending::Alias : Pending::Solid;
+}
+
+bool MessageDecoder::resolve_chunk() {
+  if (finished_ || !prepared_) {
+    return !finished_;
+  }
+  bool more = resolve_pending();
+  if (checkpoints_ && checkpoints_->due(last_checkpoint_ms_, finished_)) {
+    checkpoints_->save(*this);
+  }
+  return more;
+}
+
+bool MessageDecoder::resolve_pending() {
+  prepared_ = false;
+  uint32_t chunk = resolved_chunks();
+  size_t first, last;
+  candidates_.range(chunk, first, last);
+
+  // When the chunk offset wraps the firmware XORs it outside of the key, so every candidate maps to
+  // the same key. The chunk carries no information then; keep a 0 and move on to the next one.
+  if (blind_chunk()) {
+    retire_chunk(chunk);
+    state_.append(0);
+    margins_.push_back(0);
+    solid_bits_ = state_.bits();
+    return true;
+  }
+
+  int alias = alias_value();
+  Vote vote = vote_.decide(last_vote_.span, alias);
+  if (vote.value < 0) {
+    retire_chunk(chunk);
+    finished_ = true;
+    return false;
+  }
+
+  size_t chosen = first;
+  while (candidates_.value(chosen) != vote.value) {
+    chosen++;
+  }
+  state_.append(uint8_t(vote.value));
+  margins_.push_back(float(vote.margin));
+  prev_digest_ = candidates_.digest(chosen);
+  has_prev_ = true;
+  if (vote.value != alias) {
+    solid_bits_ = state_.bits();
+  }
+  last_vote_ = vote;
+  retire_chunk(chunk);
+
+  // A whole byte of zero chunks is indistinguishable from the modem having stopped sending.
+  if (state_.bits() - solid_bits_ >= 8 || state_.chunks() >= params_.max_chunks) {
+    finished_ = true;
+    return false;
+  }
+  return true;
+}
+
+size_t MessageDecoder::complete_bytes() const {
+  // Until the message ends, trailing aliased zeros may still turn out to be its end.
+  return finished_ ? complete_message_bits(state_, solid_bits_, true) / 8 : solid_bits_ / 8;
+}
+
+float MessageDecoder::byte_confidence(size_t offset_from_end) const {
+  size_t cl = params_.chunk_len;
+  size_t first = offset_from_end * 8 / cl;
+  size_t last = std::min(margins_.size(), (offset_from_end * 8 + 7) / cl + 1);
+  float confidence = first < last ? 1.0f : 0.0f;
+  for (size_t i = first; i < last; i++) {
+    confidence = std::min(confidence, margins_[i]);
+  }
+  return confidence;
+}
+
+std::vector<uint8_t> MessageDecoder::message() const {
+  std::vector<uint8_t> out(complete_message_bits(state_, solid_bits_, finished_) / 8);
+  state_.copy_message(out.size(), out.data());
+  return out;
+}
+
+void ByteStream::update(const MessageDecoder &decoder, const ByteCallback &fn) {
+  for (size_t n = decoder.complete_bytes(); emitted_ < n; emitted_++) {
+    if (fn) {
+      fn(DecodedByte{emitted_, decoder.state().byte_from_end(emitted_), decoder.byte_confidence(emitted_)});
+    }
+  }
+}
+
+void dispatch_reports(const DigestIndex &index, const std::vector<Report> &reports,
+                      std::vector<MessageDecoder *> &decoders) {
+  for (const Report &r : reports) {
+    index.for_each(r.id, [&](const IndexEntry &entry) {
+      if (entry.message < decoders.size() && decoders[entry.message]) {
+        decoders[entry.message]->add_report(entry, r);
+      }
+    });
+  }
+}
+
+std::vector<uint8_t> decode_message(ReportSource &source, const MessageParams &params, int64_t start_ms,
+                                    int64_t end_ms, CandidateCache *cache, const ByteCallback &on_byte,
+                                    CheckpointStore *checkpoints) {
+  DigestIndex index;
+  MessageDecoder decoder(0, params, index);
+  decoder.set_cache(cache);
+  decoder.set_checkpoints(checkpoints);
+  std::vector<MessageDecoder *> decoders = {&decoder};
+  std::vector<Digest> ids;
+  std::vector<Report> reports;
+  ByteStream stream;
+  stream.update(decoder, on_byte);
+  bool more = !decoder.finished();
+  while (more) {
+    ids.clear();
+    reports.clear();
+    decoder.prepare_chunk(ids);
+    if (!source.query(ids, start_ms, end_ms, reports)) {
+      break;
+    }
+    dispatch_reports(index, reports, decoders);
+    more = decoder.resolve_chunk();
+    stream.update(decoder, on_byte);
+  }
+  return decoder.message();
+}
+
+} // namespace sendmy
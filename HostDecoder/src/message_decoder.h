@@ -0,0 +1,170 @@
+#ifndef SENDMY_MESSAGE_DECODER_H
+#define SENDMY_MESSAGE_DECODER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "candidate_store.h"
+#include "chunk_vote.h"
+#include "digest_index.h"
+#include "encoding.h"
+#include "message_state.h"
+#include "report.h"
+#include "report_source.h"
+#include "types.h"
+
+namespace sendmy {
+
+class CheckpointStore;
+
+struct MessageParams {
+  uint32_t modem_id = 0;
+  uint32_t message_id = 0;
+  uint32_t chunk_len = 4;
+  // Safety net against decoding garbage forever.
+  uint32_t max_chunks = 1u << 20;
+  VoteParams vote;
+};
+
+// Decodes one message chunk by chunk.
+//
+// For every chunk the decoder generates the 2^chunk_len candidate keys on top of the chain prefix
+// of the chunks resolved so far and registers them in a (possibly shared) DigestIndex. Reports
+// looked up in that index are fed back with add_report() and resolve_chunk() picks the value.
+class MessageDecoder {
+ public:
+  // `handle` identifies this decoder in the index entries and must be unique per index.
+  MessageDecoder(uint32_t handle, const MessageParams &params, DigestIndex &index);
+
+  // Serves candidate sets from (and stores them into) a persistent cache. May be null.
+  void set_cache(CandidateCache *cache) { cache_ = cache; }
+
+  // Resumes from the message's checkpoint in store, if there is one, and writes a new checkpoint
+  // after resolved chunks as often as the store's interval allows. Must be set before the first
+  // chunk is prepared. May be null.
+  void set_checkpoints(CheckpointStore *store);
+
+  // Appends the resolved state (chunk values, chain position, last vote) in a compact binary form.
+  // The pending chunk is not part of it; it is simply queried again after a restore.
+  void save_state(std::string &out) const;
+  // Restores state written by save_state() for the same params into a fresh decoder.
+  bool restore_state(std::string_view in);
+
+  // Generates and indexes the candidates of the next chunk and appends their digests to ids.
+  // Calling it again before resolve_chunk() appends the same digests without regenerating them.
+  void prepare_chunk(std::vector<Digest> &ids);
+  // Same, with the candidates of pending_key() generated by the caller, possibly on another thread.
+  void prepare_chunk(std::vector<Digest> &ids, const std::vector<Candidate> &generated);
+  // Key of the candidate set the next prepare_chunk() needs.
+  CandidateKey pending_key() const;
+
+  // Tallies a report that the index attributed to this decoder. Reports for other chunks are ignored.
+  void add_report(const IndexEntry &entry, const Report &report);
+
+  // Decides the pending chunk from the tallied reports. Returns false once the message has ended.
+  bool resolve_chunk();
+
+  // What resolve_chunk() would rest on right now. Live decoding waits while a chunk is Empty, and
+  // for a while when it is Alias: the reports may just be those of the previous chunk.
+  enum class Pending { Empty, Alias, Solid, Blind };
+  Pending pending() const;
+
+  bool finished() const { return finished_; }
+  uint32_t handle() const { return handle_; }
+  const MessageParams &params() const { return params_; }
+  uint32_t resolved_chunks() const { return state_.chunks(); }
+  // Outcome of the vote on the most recently resolved chunk.
+  const Vote &last_vote() const { return last_vote_; }
+  const MessageState &state() const { return state_; }
+
+  // Number of bytes, counted from the end of the message, that are decoded for good.
+  size_t complete_bytes() const;
+
+  // Confidence in a byte, counted from the end: the lowest vote margin among the chunks it was
+  // decoded from, 0 if the firmware dropped some of its bits.
+  float byte_confidence(size_t offset_from_end) const;
+
+  // The decoded message in its original byte order. The modem sends the last byte first, so
+  // this is only complete once finished() is true.
+  std::vector<uint8_t> message() const;
+
+ private:
+  // True if every candidate of the pending chunk maps to the same key.
+  bool blind_chunk() const;
+  // Value of the pending chunk that reuses the previous chunk's key, or -1.
+  int alias_value() const;
+
+  // Removes the candidates of a decided chunk from the index and the store.
+  void retire_chunk(uint32_t chunk);
+  // resolve_chunk() without the checkpoint.
+  bool resolve_pending();
+
+  uint32_t handle_;
+  MessageParams params_;
+  DigestIndex &index_;
+  CandidateCache *cache_ = nullptr;
+  CheckpointStore *checkpoints_ = nullptr;
+  // Steady clock time of the last checkpoint, -1 for none.
+  int64_t last_checkpoint_ms_ = -1;
+
+  MessageState state_;
+  // Digest the last resolved chunk was published under. A value of 0 for the next chunk leaves
+  // the payload unchanged and therefore aliases that key.
+  Digest prev_digest_{};
+  bool has_prev_ = false;
+
+  // Candidates of the unresolved chunk; scratch_ is the reused generation buffer.
+  CandidateStore candidates_;
+  std::vector<Candidate> scratch_;
+  ChunkVote vote_;
+  Vote last_vote_;
+  // Vote margin of every resolved chunk.
+  std::vector<float> margins_;
+  bool prepared_ = false;
+
+  // Number of bits up to the last chunk that was not resolved through the aliased key.
+  size_t solid_bits_ = 0;
+  bool finished_ = false;
+};
+
+// A byte that became final. The modem sends the message backwards, so bytes arrive by their
+// offset from the end; the length is only known when the message ends.
+struct DecodedByte {
+  size_t offset_from_end;
+  uint8_t value;
+  float confidence;
+};
+
+using ByteCallback = std::function<void(const DecodedByte &)>;
+
+// Hands out the bytes of a decoder as they become final, each exactly once.
+class ByteStream {
+ public:
+  // Calls fn for every byte that became final since the last call.
+  void update(const MessageDecoder &decoder, const ByteCallback &fn);
+  size_t emitted() const { return emitted_; }
+
+ private:
+  size_t emitted_ = 0;
+};
+
+// Feeds reports to the decoders they belong to, looked up through the shared index.
+void dispatch_reports(const DigestIndex &index, const std::vector<Report> &reports,
+                      std::vector<MessageDecoder *> &decoders);
+
+// Decodes a single message, issuing one query per chunk. If on_byte is set, every byte is passed
+// to it as soon as it is final, one chunk round trip after its last chunk was queried. With
+// checkpoints the decode resumes where a previous run stopped; bytes restored from the checkpoint
+// are passed to on_byte right away.
+std::vector<uint8_t> decode_message(ReportSource &source, const MessageParams &params, int64_t start_ms,
+                                    int64_t end_ms, CandidateCache *cache = nullptr,
+                                    const ByteCallback &on_byte = nullptr,
+                                    CheckpointStore *checkpoints = nullptr);
+
+} // namespace sendmy
+
+#endif // SENDMY_MESSAGE_DECODER_H
@@ -0,0 +1,52 @@
+#include "message_state.h"
+
+#include "encoding.h"
+
+namespace sendmy {
+
+void MessageState::append(uint8_t value) {
+  size_t pos = bits();
+  size_t end = pos + chunk_len_;
+  if ((end + 63) / 64 > words_.size()) {
+    words_.push_back(0);
+  }
+  uint64_t v = value & ((1u << chunk_len_) - 1);
+  words_[pos / 64] |= v << (pos % 64);
+  if (pos % 64 + chunk_len_ > 64) {
+    words_[pos / 64 + 1] |= v >> (64 - pos % 64);
+  }
+  place_chunk(prefix_, chunks_, value, chunk_len_);
+  chunks_++;
+}
+
+uint8_t MessageState::chunk(uint32_t index) const {
+  size_t pos = size_t(index) * chunk_len_;
+  uint64_t v = words_[pos / 64] >> (pos % 64);
+  if (pos % 64 + chunk_len_ > 64) {
+    v |= words_[pos / 64 + 1] << (64 - pos % 64);
+  }
+  return uint8_t(v & ((1u << chunk_len_) - 1));
+}
+
+void MessageState::copy_message(size_t len, uint8_t *out) const {
+  for (size_t j = 0; j < len; j++) {
+    out[len - 1 - j] = byte_from_end(j);
+  }
+}
+
+size_t complete_message_bits(const MessageState &state, size_t solid_bits, bool finished) {
+  size_t total = state.bits();
+  if (!finished || total - solid_bits < 8) {
+    return total & ~size_t(7);
+  }
+  // The message ended in a run of zero chunks. If the last real chunk only spills a few bits
+  // into the next byte it is the final, padded chunk; otherwise the byte it starts is part of
+  // the message and its remaining bits are zero.
+  size_t spill = solid_bits % 8;
+  if (spill && spill < state.chunk_len()) {
+    return solid_bits - spill;
+  }
+  return (solid_bits + 7) & ~size_t(7);
+}
+
+} // namespace sendmy
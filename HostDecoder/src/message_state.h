@@ -0,0 +1,51 @@
+#ifndef SENDMY_MESSAGE_STATE_H
+#define SENDMY_MESSAGE_STATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// Decode state of one message: the resolved chunk values packed into a bit vector, and the chain
+// prefix (the 20 byte payload the modem has XORed those values into).
+//
+// Bits are stored in transmission order, LSB first: chunk i occupies bits [i * chunk_len,
+// (i + 1) * chunk_len), which is also where the modem took them from counting from the last
+// message byte. Byte j of the packed buffer is therefore byte j from the end of the message.
+class MessageState {
+ public:
+  explicit MessageState(uint32_t chunk_len = 4) : chunk_len_(chunk_len) {}
+
+  // Appends the value of the next chunk and advances the chain prefix in place. O(1) amortized.
+  void append(uint8_t value);
+
+  uint32_t chunk_len() const { return chunk_len_; }
+  uint32_t chunks() const { return chunks_; }
+  size_t bits() const { return size_t(chunks_) * chunk_len_; }
+  uint8_t chunk(uint32_t index) const;
+  uint8_t byte_from_end(size_t j) const {
+    return uint8_t(words_[j / 8] >> (8 * (j % 8)));
+  }
+  // Payload after the last appended chunk.
+  const Payload &prefix() const { return prefix_; }
+
+  // Writes the last len bytes of the message, in original order. len must not exceed bits() / 8.
+  void copy_message(size_t len, uint8_t *out) const;
+
+ private:
+  uint32_t chunk_len_;
+  uint32_t chunks_ = 0;
+  std::vector<uint64_t> words_;
+  Payload prefix_{};
+};
+
+// Number of message bits in a decode that has resolved state.bits() bits, of which the last
+// solid_bits came from a real (not aliased) key. See MessageDecoder for why these differ.
+size_t complete_message_bits(const MessageState &state, size_t solid_bits, bool finished);
+
+} // namespace sendmy
+
+#endif // SENDMY_MESSAGE_STATE_H
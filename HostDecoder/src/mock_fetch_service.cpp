@@ -0,0 +1,327 @@
+#include "mock_fetch_service.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <strings.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "base64.h"
+#include "json.h"
+
+namespace sendmy {
+
+namespace {
+
+constexpr const char *kFetchPath = "/acsnservice/fetch";
+constexpr size_t kMaxRequestBytes = 64 << 20;
+constexpr int kIoTimeoutMs = 30000;
+
+uint64_t now_ns() {
+  return uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+void raise_max(std::atomic<uint64_t> &max, uint64_t v) {
+  uint64_t cur = max.load();
+  while (v > cur && !max.compare_exchange_weak(cur, v)) {
+  }
+}
+
+void raise_max(std::atomic<uint32_t> &max, uint32_t v) {
+  uint32_t cur = max.load();
+  while (v > cur && !max.compare_exchange_weak(cur, v)) {
+  }
+}
+
+// ReportsFetcher.m sends the dates as strings, be lenient and take numbers too.
+bool json_int(const JsonValue *v, int64_t &out) {
+  if (v && v->type == JsonValue::Type::Number) {
+    out = int64_t(v->number);
+    return true;
+  }
+  if (v && v->type == JsonValue::Type::String && !v->string.empty()) {
+    char *end;
+    out = strtoll(v->string.c_str(), &end, 10);
+    return *end == 0;
+  }
+  return false;
+}
+
+bool send_all(int fd, const std::string &data) {
+  for (size_t sent = 0; sent < data.size();) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    sent += size_t(n);
+  }
+  return true;
+}
+
+std::string http_response(int status, const char *reason, const std::string &body) {
+  return "HTTP/1.1 " + std::to_string(status) + " " + reason +
+         "\r\nContent-Type: application/json\r\nConnection: close\r\nContent-Length: " +
+         std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+} // namespace
+
+MockFetchService::~MockFetchService() { stop(); }
+
+void MockFetchService::add(std::vector<Report> reports) {
+  if (reports_.empty()) {
+    reports_ = std::move(reports);
+  } else {
+    reports_.insert(reports_.end(), std::make_move_iterator(reports.begin()), std::make_move_iterator(reports.end()));
+  }
+}
+
+std::string MockFetchService::url() const {
+  return "http://127.0.0.1:" + std::to_string(port_) + kFetchPath;
+}
+
+bool MockFetchService::start(uint16_t port, unsigned threads, std::string *error) {
+  auto fail = [&](const std::string &what) {
+    if (error) {
+      *error = what + ": " + strerror(errno);
+    }
+    if (listen_fd_ >= 0) {
+      close(listen_fd_);
+      listen_fd_ = -1;
+    }
+    return false;
+  };
+
+  std::sort(reports_.begin(), reports_.end(), [](const Report &a, const Report &b) {
+    return a.id != b.id ? a.id < b.id : a.date_published_ms < b.date_published_ms;
+  });
+  by_id_.clear();
+  by_id_.reserve(reports_.size());
+  for (uint32_t i = 0, first = 0; i <= reports_.size(); i++) {
+    if (i == reports_.size() || reports_[i].id != reports_[first].id) {
+      if (i > first) {
+        by_id_.emplace(reports_[first].id, std::make_pair(first, i));
+      }
+      first = i;
+    }
+  }
+
+  listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listen_fd_ < 0) {
+    return fail("socket");
+  }
+  int one = 1;
+  setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  struct sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  addr.sin_port = htons(port);
+  socklen_t len = sizeof(addr);
+  if (bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) != 0) {
+    return fail("bind");
+  }
+  if (listen(listen_fd_, 1024) != 0) {
+    return fail("listen");
+  }
+  getsockname(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), &len);
+  port_ = ntohs(addr.sin_port);
+
+  stopping_ = false;
+  acceptor_ = std::thread([this] { accept_loop(); });
+  for (unsigned i = 0; i < std::max(1u, threads); i++) {
+    workers_.emplace_back([this] { serve_loop(); });
+  }
+  return true;
+}
+
+void MockFetchService::stop() {
+  if (listen_fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  ready_.notify_all();
+  acceptor_.join();
+  for (std::thread &t : workers_) {
+    t.join();
+  }
+  workers_.clear();
+  for (int fd : connections_) {
+    close(fd);
+  }
+  connections_.clear();
+  close(listen_fd_);
+  listen_fd_ = -1;
+}
+
+void MockFetchService::accept_loop() {
+  while (!stopping_) {
+    struct pollfd p = {listen_fd_, POLLIN, 0};
+    if (poll(&p, 1, 100) <= 0) {
+      continue;
+    }
+    int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      continue;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      connections_.push_back(fd);
+    }
+    ready_.notify_one();
+  }
+}
+
+void MockFetchService::serve_loop() {
+  while (true) {
+    int fd;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      ready_.wait(lock, [this] { return stopping_ || !connections_.empty(); });
+      if (connections_.empty()) {
+        return;
+      }
+      fd = connections_.front();
+      connections_.pop_front();
+    }
+    serve(fd);
+    close(fd);
+  }
+}
+
+void MockFetchService::serve(int fd) {
+  struct timeval tv = {kIoTimeoutMs / 1000, 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  std::string raw;
+  size_t head_end = std::string::npos;
+  size_t content_length = 0;
+  char buf[16384];
+  while (head_end == std::string::npos || raw.size() < head_end + 4 + content_length) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0 || raw.size() > kMaxRequestBytes) {
+      return;
+    }
+    raw.append(buf, size_t(n));
+    if (head_end == std::string::npos && (head_end = raw.find("\r\n\r\n")) != std::string::npos) {
+      for (size_t line = raw.find("\r\n") + 2; line < head_end; line = raw.find("\r\n", line) + 2) {
+        if (strncasecmp(raw.c_str() + line, "Content-Length:", 15) == 0) {
+          content_length = strtoul(raw.c_str() + line + 15, nullptr, 10);
+        }
+      }
+    }
+  }
+  bytes_in_ += raw.size();
+
+  uint64_t t0 = now_ns();
+  raise_max(max_in_flight_, ++in_flight_);
+  std::string request_line = raw.substr(0, raw.find("\r\n"));
+  std::string body;
+  std::string response;
+  if (request_line.compare(0, 5 + strlen(kFetchPath), std::string("POST ") + kFetchPath) != 0) {
+    errors_++;
+    response = http_response(404, "Not Found", "");
+  } else if (!answer(raw.substr(head_end + 4, content_length), body)) {
+    errors_++;
+    response = http_response(400, "Bad Request", "");
+  } else {
+    response = http_response(200, "OK", body);
+  }
+  send_all(fd, response);
+  in_flight_--;
+  uint64_t ns = now_ns() - t0;
+  busy_ns_ += ns;
+  raise_max(max_request_ns_, ns);
+  bytes_out_ += response.size();
+}
+
+bool MockFetchService::answer(const std::string &body, std::string &response) {
+  JsonValue doc;
+  const JsonValue *search;
+  if (!json_parse(body, doc) || !(search = doc.get("search")) || search->type != JsonValue::Type::Array) {
+    return false;
+  }
+  int64_t now_ms = now_ms_;
+  uint64_t ids = 0;
+  uint64_t results = 0;
+  response = "{\"results\":[";
+  for (const JsonValue &s : search->array) {
+    const JsonValue *id_list = s.get("ids");
+    int64_t start_ms, end_ms;
+    if (!id_list || id_list->type != JsonValue::Type::Array || !json_int(s.get("startDate"), start_ms) ||
+        !json_int(s.get("endDate"), end_ms)) {
+      return false;
+    }
+    end_ms = std::min(end_ms, now_ms == INT64_MAX ? now_ms : now_ms + 1);
+    for (const JsonValue &id : id_list->array) {
+      Digest digest;
+      if (id.type != JsonValue::Type::String || !base64_decode_digest(id.string, digest)) {
+        return false;
+      }
+      ids++;
+      auto it = by_id_.find(digest);
+      if (it == by_id_.end()) {
+        continue;
+      }
+      auto first = reports_.begin() + it->second.first;
+      auto last = reports_.begin() + it->second.second;
+      first = std::lower_bound(first, last, start_ms,
+                               [](const Report &r, int64_t ms) { return r.date_published_ms < ms; });
+      for (; first != last && first->date_published_ms < end_ms; ++first) {
+        if (results++) {
+          response += ",";
+        }
+        append_report_json(*first, response);
+      }
+    }
+  }
+  response += "],\"statusCode\":\"200\"}";
+  requests_++;
+  ids_ += ids;
+  results_ += results;
+  return true;
+}
+
+FetchServiceStats MockFetchService::stats() const {
+  FetchServiceStats s;
+  s.requests = requests_;
+  s.ids = ids_;
+  s.results = results_;
+  s.bytes_in = bytes_in_;
+  s.bytes_out = bytes_out_;
+  s.errors = errors_;
+  s.busy_ms = double(busy_ns_) / 1e6;
+  s.max_request_ms = double(max_request_ns_) / 1e6;
+  s.max_in_flight = max_in_flight_;
+  return s;
+}
+
+size_t MockFetchService::memory_bytes() const {
+  size_t bytes = reports_.capacity() * sizeof(Report);
+  for (const Report &r : reports_) {
+    bytes += r.payload.capacity();
+  }
+  // One node per id plus the bucket array.
+  bytes += by_id_.size() * (sizeof(Digest) + sizeof(std::pair<uint32_t, uint32_t>) + 2 * sizeof(void *)) +
+           by_id_.bucket_count() * sizeof(void *);
+  return bytes;
+}
+
+} // namespace sendmy
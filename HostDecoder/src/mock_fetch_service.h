@@ -0,0 +1,103 @@
+#ifndef SENDMY_MOCK_FETCH_SERVICE_H
+#define SENDMY_MOCK_FETCH_SERVICE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "report.h"
+#include "types.h"
+
+namespace sendmy {
+
+// Server side counters of a MockFetchService.
+struct FetchServiceStats {
+  uint64_t requests = 0;
+  uint64_t ids = 0;
+  uint64_t results = 0;
+  uint64_t bytes_in = 0;
+  uint64_t bytes_out = 0;
+  // Malformed requests, answered with 400 or 404.
+  uint64_t errors = 0;
+  // Time spent answering, from the end of the request to the end of the response.
+  double busy_ms = 0;
+  double max_request_ms = 0;
+  uint32_t max_in_flight = 0;
+};
+
+// An acsnservice/fetch endpoint on 127.0.0.1, serving reports from memory for simulations.
+//
+// Unlike mock/mock_fetch_server.py it is meant to be loaded with millions of reports and queried
+// hard: reports are indexed by their raw digest, sorted by datePublished within an id, and requests
+// are answered by a fixed pool of threads. Like the real backend and the Python mock, a report is
+// only returned once its datePublished has passed, here by the clock set with set_now_ms().
+class MockFetchService {
+ public:
+  MockFetchService() = default;
+  ~MockFetchService();
+  MockFetchService(const MockFetchService &) = delete;
+  MockFetchService &operator=(const MockFetchService &) = delete;
+
+  // Adds reports. Only allowed before start().
+  void add(std::vector<Report> reports);
+
+  // Builds the index and starts answering on `port` (0 for any free one) with `threads` threads.
+  bool start(uint16_t port = 0, unsigned threads = 4, std::string *error = nullptr);
+  void stop();
+
+  uint16_t port() const { return port_; }
+  std::string url() const;
+
+  // Reports published after now_ms are withheld. Defaults to returning everything.
+  void set_now_ms(int64_t now_ms) { now_ms_ = now_ms; }
+
+  // Answers a request body, as the HTTP handler does. Returns false if it is malformed.
+  bool answer(const std::string &body, std::string &response);
+
+  FetchServiceStats stats() const;
+  size_t reports() const { return reports_.size(); }
+  size_t distinct_ids() const { return by_id_.size(); }
+  // Heap bytes held by the reports and the index.
+  size_t memory_bytes() const;
+
+ private:
+  void accept_loop();
+  void serve_loop();
+  void serve(int fd);
+
+  std::vector<Report> reports_;
+  // [first, last) range of an id in reports_.
+  std::unordered_map<Digest, std::pair<uint32_t, uint32_t>, DigestHash> by_id_;
+  std::atomic<int64_t> now_ms_{INT64_MAX};
+
+  int listen_fd_ = -1;
+  uint16_t port_ = 0;
+  std::atomic<bool> stopping_{false};
+  std::thread acceptor_;
+  std::vector<std::thread> workers_;
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<int> connections_;
+
+  std::atomic<uint64_t> requests_{0};
+  std::atomic<uint64_t> ids_{0};
+  std::atomic<uint64_t> results_{0};
+  std::atomic<uint64_t> bytes_in_{0};
+  std::atomic<uint64_t> bytes_out_{0};
+  std::atomic<uint64_t> errors_{0};
+  std::atomic<uint64_t> busy_ns_{0};
+  std::atomic<uint64_t> max_request_ns_{0};
+  std::atomic<uint32_t> in_flight_{0};
+  std::atomic<uint32_t> max_in_flight_{0};
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_MOCK_FETCH_SERVICE_H
@@ -0,0 +1,238 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "query_scheduler.h"
+
+namespace sendmy {
+
+namespace {
+
+uint64_t now_ns() {
+  return uint64_t(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+}
+
+} // namespace
+
+struct Pipeline::ResolvedAwaiter {
+  Message &message;
+  bool await_ready() const noexcept { return message.resolved; }
+  void await_suspend(std::coroutine_handle<> h) { message.waiting = h; }
+  void await_resume() { message.resolved = false; }
+};
+
+uint32_t Pipeline::add(const MessageParams &params) {
+  uint32_t handle = uint32_t(messages_.size());
+  Message m;
+  m.decoder = std::make_unique<MessageDecoder>(handle, params, index_);
+  m.decoder->set_cache(cache_);
+  m.decoder->set_checkpoints(checkpoints_);
+  messages_.push_back(std::move(m));
+  return handle;
+}
+
+Task Pipeline::message_loop(uint32_t handle) {
+  Message &m = messages_[handle];
+  MessageDecoder &d = *m.decoder;
+  std::vector<Candidate> generated;
+  std::vector<Digest> ids;
+  while (!d.finished()) {
+    generating_++;
+    CandidateKey key = d.pending_key();
+    generated.clear();
+    if (!cache_ || !cache_->lookup(key, generated)) {
+      auto generate = generate_pool_->run([&] {
+        uint64_t t0 = now_ns();
+        generate_candidates(key.modem_id, key.prefix, key.chunk, key.chunk_len, generated);
+        generate_.add(now_ns() - t0);
+      });
+      co_await generate;
+      if (cache_ && cache_->writable()) {
+        cache_->store(key, generated);
+      }
+    }
+    ids.clear();
+    uint64_t t0 = now_ns();
+    d.prepare_chunk(ids, generated);
+    decode_.busy_ns += now_ns() - t0;
+    generating_--;
+    // Awaiters are named: GCC 12 destroys temporaries in co_await expressions twice.
+    auto push = to_query_->push(Pending{handle, std::move(ids)});
+    co_await push;
+    ResolvedAwaiter resolved{m};
+    co_await resolved;
+  }
+  if (--active_messages_ == 0) {
+    to_query_->close();
+  }
+}
+
+Task Pipeline::query_loop() {
+  std::optional<Pending> carry;
+  for (;;) {
+    std::optional<Pending> first = std::move(carry);
+    carry.reset();
+    if (!first) {
+      auto pop = to_query_->pop();
+      first = co_await pop;
+    }
+    if (!first || failed_) {
+      break;
+    }
+    // Pack everything that is queued by now; whatever does not fit opens the next request.
+    Batch batch;
+    batch.handles.push_back(first->handle);
+    batch.ids = std::move(first->ids);
+    while (std::optional<Pending> next = to_query_->try_pop()) {
+      if (batch.ids.size() + next->ids.size() > params_.max_ids_per_request) {
+        carry = std::move(next);
+        break;
+      }
+      batch.handles.push_back(next->handle);
+      batch.ids.insert(batch.ids.end(), next->ids.begin(), next->ids.end());
+    }
+    // An extra request costs a round trip, waiting for a message still in generation costs its
+    // generation time; wait for the messages that will be ready sooner than a round trip.
+    while (!carry && generating_ > 0 && batch.ids.size() < params_.max_ids_per_request &&
+           double(generating_) * generate_.mean_ns(0) / generate_.workers < query_.mean_ns(1e18)) {
+      auto pop = to_query_->pop();
+      std::optional<Pending> next = co_await pop;
+      if (!next) {
+        break;
+      }
+      if (batch.ids.size() + next->ids.size() > params_.max_ids_per_request) {
+        carry = std::move(next);
+        break;
+      }
+      batch.handles.push_back(next->handle);
+      batch.ids.insert(batch.ids.end(), next->ids.begin(), next->ids.end());
+    }
+    ids_queried_ += batch.ids.size();
+
+    bool ok = false;
+    auto query = query_pool_->run([&] {
+      uint64_t t0 = now_ns();
+      uint64_t requests = 0;
+      ok = query_packed(source_, batch.ids, params_.max_ids_per_request, start_ms_, end_ms_, batch.reports,
+                        &requests);
+      requests_ += requests;
+      query_.add(now_ns() - t0);
+    });
+    co_await query;
+    if (!ok) {
+      failed_ = true;
+      to_query_->close();
+      break;
+    }
+    auto push = to_decode_->push(std::move(batch));
+    co_await push;
+  }
+  if (--active_queries_ == 0) {
+    to_decode_->close();
+  }
+}
+
+Task Pipeline::decode_loop() {
+  // Reports only go to the messages of their batch; the others may have the same chunk queued and
+  // would count the report twice.
+  std::vector<MessageDecoder *> targets(messages_.size(), nullptr);
+  for (;;) {
+    auto pop = to_decode_->pop();
+    std::optional<Batch> batch = co_await pop;
+    if (!batch) {
+      break;
+    }
+    uint64_t t0 = now_ns();
+    for (uint32_t h : batch->handles) {
+      targets[h] = messages_[h].decoder.get();
+    }
+    dispatch_reports(index_, batch->reports, targets);
+    for (uint32_t h : batch->handles) {
+      targets[h] = nullptr;
+      Message &m = messages_[h];
+      m.decoder->resolve_chunk();
+      if (on_byte_) {
+        m.stream.update(*m.decoder, [&](const DecodedByte &b) { on_byte_(h, b); });
+      }
+      m.resolved = true;
+      if (m.waiting) {
+        loop_.post(std::exchange(m.waiting, {}));
+      }
+    }
+    decode_.add(now_ns() - t0);
+  }
+}
+
+bool Pipeline::run(int64_t start_ms, int64_t end_ms) {
+  unsigned threads = params_.generate_threads ? params_.generate_threads
+                                              : std::max(1u, std::thread::hardware_concurrency());
+  unsigned slots = std::max(1u, params_.query_slots);
+  WorkerPool generate_pool(loop_, threads);
+  WorkerPool query_pool(loop_, slots);
+  Channel<Pending> to_query(loop_, params_.queue_depth);
+  Channel<Batch> to_decode(loop_, slots);
+  generate_pool_ = &generate_pool;
+  query_pool_ = &query_pool;
+  to_query_ = &to_query;
+  to_decode_ = &to_decode;
+  start_ms_ = start_ms;
+  end_ms_ = end_ms;
+  failed_ = false;
+  generate_.reset(threads);
+  query_.reset(slots);
+  decode_.reset(1);
+  uint64_t t0 = now_ns();
+
+  std::vector<Task> tasks;
+  active_messages_ = 0;
+  for (uint32_t h = 0; h < messages_.size(); h++) {
+    Message &m = messages_[h];
+    // Bytes restored from a checkpoint are final already.
+    if (on_byte_) {
+      m.stream.update(*m.decoder, [&](const DecodedByte &b) { on_byte_(h, b); });
+    }
+    if (!m.decoder->finished()) {
+      tasks.push_back(message_loop(h));
+      active_messages_++;
+    }
+  }
+  if (active_messages_ == 0) {
+    to_query.close();
+  }
+  active_queries_ = slots;
+  for (unsigned i = 0; i < slots; i++) {
+    tasks.push_back(query_loop());
+  }
+  tasks.push_back(decode_loop());
+  for (const Task &t : tasks) {
+    loop_.post(t.handle());
+  }
+  loop_.run();
+
+  wall_ns_ = now_ns() - t0;
+  // After a failure the message coroutines are left waiting for their chunks; destroying the
+  // tasks unwinds them.
+  tasks.clear();
+  generate_pool_ = query_pool_ = nullptr;
+  to_query_ = nullptr;
+  to_decode_ = nullptr;
+  return !failed_;
+}
+
+std::vector<StageStats> Pipeline::stage_stats() const {
+  std::vector<StageStats> out;
+  for (const auto &[name, stage] : {std::pair<const char *, const Stage *>{"generate", &generate_},
+                                    {"query", &query_},
+                                    {"decode", &decode_}}) {
+    double busy_ms = double(stage->busy_ns) / 1e6;
+    double wall_ms = double(wall_ns_) / 1e6 * stage->workers;
+    out.push_back(StageStats{name, stage->workers, stage->items, busy_ms, wall_ms > 0 ? busy_ms / wall_ms : 0});
+  }
+  return out;
+}
+
+} // namespace sendmy
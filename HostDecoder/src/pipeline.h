@@ -0,0 +1,146 @@
+#ifndef SENDMY_PIPELINE_H
+#define SENDMY_PIPELINE_H
+
+#include <atomic>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "coro.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "report_source.h"
+
+namespace sendmy {
+
+struct PipelineParams {
+  // Candidate generation (EC and hashing) threads, 0 for one per core.
+  unsigned generate_threads = 0;
+  // Requests in flight at a time. More than one needs a source that can be queried concurrently
+  // (HttpSource can, a ReportStore backed SyncedSource cannot).
+  unsigned query_slots = 1;
+  // Upper bound on the ids in one request.
+  size_t max_ids_per_request = 2048;
+  // Messages waiting for a request slot before generation stalls.
+  size_t queue_depth = 256;
+};
+
+// Busy time of one pipeline stage over a run.
+struct StageStats {
+  const char *name;
+  unsigned workers;
+  uint64_t items;
+  double busy_ms;
+  // busy_ms / (wall time x workers).
+  double utilization;
+};
+
+// Decodes many messages with candidate generation, querying and decoding overlapped.
+//
+// Every message is a coroutine that has the candidates of its next chunk generated on the
+// generation pool, indexes them and queues its ids. A query coroutine per slot packs whatever ids
+// are queued into one request and runs it on an I/O thread, so the CPU keeps generating for other
+// messages while requests are in flight. The decode coroutine resolves the chunks of each response
+// as it arrives, which sends those messages back to generation. A free query slot waits for messages
+// still in generation only while that is cheaper than a round trip, so the messages split into as
+// many cohorts as keep both the CPU and the slots busy. The queues between the stages are bounded.
+// Index, decoders and queues are only touched on the thread that calls run().
+class Pipeline {
+ public:
+  Pipeline(ReportSource &source, const PipelineParams &params = PipelineParams())
+      : source_(source), params_(params) {}
+
+  void set_cache(CandidateCache *cache) { cache_ = cache; }
+  // Messages added afterwards resume from and keep writing checkpoints in store.
+  void set_checkpoints(CheckpointStore *store) { checkpoints_ = store; }
+  // Called with the message handle for every byte as soon as it is final.
+  void set_byte_callback(std::function<void(uint32_t, const DecodedByte &)> fn) { on_byte_ = std::move(fn); }
+
+  // Adds a message and returns its handle.
+  uint32_t add(const MessageParams &params);
+
+  // Decodes until every message has ended. Returns false if the source failed.
+  bool run(int64_t start_ms, int64_t end_ms);
+
+  const MessageDecoder &decoder(uint32_t handle) const { return *messages_[handle].decoder; }
+  size_t size() const { return messages_.size(); }
+  uint64_t requests() const { return requests_; }
+  uint64_t ids_queried() const { return ids_queried_; }
+
+  // Generate, query and decode stage statistics of the last run(). Each run() starts them over,
+  // and so the per-item means the query slots use to decide whether to wait for generation.
+  std::vector<StageStats> stage_stats() const;
+
+ private:
+  struct Message {
+    std::unique_ptr<MessageDecoder> decoder;
+    ByteStream stream;
+    // Set by the decode stage once the queried chunk is resolved; the message coroutine waits on it.
+    bool resolved = false;
+    std::coroutine_handle<> waiting;
+  };
+  struct Pending {
+    uint32_t handle;
+    std::vector<Digest> ids;
+  };
+  struct Batch {
+    std::vector<uint32_t> handles;
+    std::vector<Digest> ids;
+    std::vector<Report> reports;
+  };
+  struct Stage {
+    std::atomic<uint64_t> items{0};
+    std::atomic<uint64_t> busy_ns{0};
+    unsigned workers = 1;
+    void add(uint64_t ns) {
+      items++;
+      busy_ns += ns;
+    }
+    double mean_ns(double unknown) const { return items ? double(busy_ns) / double(items) : unknown; }
+    void reset(unsigned n) {
+      items = 0;
+      busy_ns = 0;
+      workers = n;
+    }
+  };
+  struct ResolvedAwaiter;
+
+  Task message_loop(uint32_t handle);
+  Task query_loop();
+  Task decode_loop();
+
+  ReportSource &source_;
+  PipelineParams params_;
+  CandidateCache *cache_ = nullptr;
+  CheckpointStore *checkpoints_ = nullptr;
+  std::function<void(uint32_t, const DecodedByte &)> on_byte_;
+  DigestIndex index_;
+  std::vector<Message> messages_;
+
+  // State of the current run().
+  EventLoop loop_;
+  WorkerPool *generate_pool_ = nullptr;
+  WorkerPool *query_pool_ = nullptr;
+  Channel<Pending> *to_query_ = nullptr;
+  Channel<Batch> *to_decode_ = nullptr;
+  int64_t start_ms_ = 0;
+  int64_t end_ms_ = 0;
+  size_t active_messages_ = 0;
+  // Messages between resolving a chunk and queueing the ids of the next.
+  size_t generating_ = 0;
+  unsigned active_queries_ = 0;
+  bool failed_ = false;
+
+  Stage generate_, query_, decode_;
+  uint64_t wall_ns_ = 0;
+  std::atomic<uint64_t> requests_{0};
+  uint64_t ids_queried_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_PIPELINE_H
@@ -0,0 +1,84 @@
+#include "query_scheduler.h"
+
+#include <algorithm>
+
+namespace sendmy {
+
+bool query_packed(ReportSource &source, std::vector<Digest> ids, size_t max_ids, int64_t start_ms,
+                  int64_t end_ms, std::vector<Report> &out, uint64_t *requests) {
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  max_ids = std::max<size_t>(max_ids, 1);
+  std::vector<Digest> part;
+  for (size_t first = 0; first < ids.size(); first += max_ids) {
+    part.assign(ids.begin() + first, ids.begin() + std::min(ids.size(), first + max_ids));
+    if (requests) {
+      (*requests)++;
+    }
+    if (!source.query(part, start_ms, end_ms, out)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+uint32_t QueryScheduler::add(const MessageParams &params) {
+  uint32_t handle = uint32_t(decoders_.size());
+  decoders_.push_back(std::make_unique<MessageDecoder>(handle, params, index_));
+  decoders_.back()->set_cache(cache_);
+  decoders_.back()->set_checkpoints(checkpoints_);
+  streams_.emplace_back();
+  if (!decoders_.back()->finished()) {
+    ready_.push_back(handle);
+  }
+  return handle;
+}
+
+bool QueryScheduler::run(int64_t start_ms, int64_t end_ms) {
+  std::vector<MessageDecoder *> decoders;
+  for (uint32_t h = 0; h < decoders_.size(); h++) {
+    decoders.push_back(decoders_[h].get());
+    // Bytes restored from a checkpoint are final already.
+    if (on_byte_) {
+      streams_[h].update(*decoders_[h], [&](const DecodedByte &b) { on_byte_(h, b); });
+    }
+  }
+  std::vector<uint32_t> batch;
+  std::vector<Digest> ids;
+  std::vector<Report> reports;
+
+  while (!ready_.empty()) {
+    batch.clear();
+    ids.clear();
+    reports.clear();
+    while (!ready_.empty()) {
+      size_t before = ids.size();
+      decoders_[ready_.front()]->prepare_chunk(ids);
+      // The candidates stay prepared, the message just goes into the next request.
+      if (ids.size() > params_.max_ids_per_request && before > 0) {
+        ids.resize(before);
+        break;
+      }
+      batch.push_back(ready_.front());
+      ready_.pop_front();
+    }
+
+    ids_queried_ += ids.size();
+    if (!query_packed(source_, ids, params_.max_ids_per_request, start_ms, end_ms, reports, &requests_)) {
+      return false;
+    }
+    dispatch_reports(index_, reports, decoders);
+    for (uint32_t h : batch) {
+      bool more = decoders_[h]->resolve_chunk();
+      if (on_byte_) {
+        streams_[h].update(*decoders_[h], [&](const DecodedByte &b) { on_byte_(h, b); });
+      }
+      if (more) {
+        ready_.push_back(h);
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace sendmy
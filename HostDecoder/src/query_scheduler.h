@@ -0,0 +1,74 @@
+#ifndef SENDMY_QUERY_SCHEDULER_H
+#define SENDMY_QUERY_SCHEDULER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "candidate_cache.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "report_source.h"
+
+namespace sendmy {
+
+struct SchedulerParams {
+  // Upper bound on the ids in one request.
+  size_t max_ids_per_request = 2048;
+};
+
+// Queries ids (deduplicated) in as few requests of at most max_ids as possible.
+// Counts the requests it issued in *requests if given.
+bool query_packed(ReportSource &source, std::vector<Digest> ids, size_t max_ids, int64_t start_ms,
+                  int64_t end_ms, std::vector<Report> &out, uint64_t *requests = nullptr);
+
+// Decodes many messages at once with requests packed across them.
+//
+// Messages wait in a FIFO. Each request takes the pending chunks of the messages at the head of
+// the queue until the next one would not fit, the reports are routed back through a shared
+// DigestIndex, and the messages whose chunk resolved rejoin the queue at the tail. Requests are
+// therefore full except for the last few, and their number follows the total number of
+// candidate ids instead of messages x chunks.
+class QueryScheduler {
+ public:
+  QueryScheduler(ReportSource &source, const SchedulerParams &params = SchedulerParams())
+      : source_(source), params_(params) {}
+
+  void set_cache(CandidateCache *cache) { cache_ = cache; }
+  // Messages added afterwards resume from and keep writing checkpoints in store.
+  void set_checkpoints(CheckpointStore *store) { checkpoints_ = store; }
+  // Called with the message handle for every byte as soon as it is final.
+  void set_byte_callback(std::function<void(uint32_t, const DecodedByte &)> fn) { on_byte_ = std::move(fn); }
+
+  // Adds a message and returns its handle.
+  uint32_t add(const MessageParams &params);
+
+  // Decodes until every message has ended. Returns false if the source failed.
+  bool run(int64_t start_ms, int64_t end_ms);
+
+  const MessageDecoder &decoder(uint32_t handle) const { return *decoders_[handle]; }
+  size_t size() const { return decoders_.size(); }
+  uint64_t requests() const { return requests_; }
+  uint64_t ids_queried() const { return ids_queried_; }
+
+ private:
+  ReportSource &source_;
+  SchedulerParams params_;
+  CandidateCache *cache_ = nullptr;
+  CheckpointStore *checkpoints_ = nullptr;
+  DigestIndex index_;
+  std::vector<std::unique_ptr<MessageDecoder>> decoders_;
+  std::vector<ByteStream> streams_;
+  std::function<void(uint32_t, const DecodedByte &)> on_byte_;
+  std::deque<uint32_t> ready_;
+  uint64_t requests_ = 0;
+  uint64_t ids_queried_ = 0;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_QUERY_SCHEDULER_H
@@ -0,0 +1,92 @@
+#include "report.h"
+
+#include <cstdio>
+
+#include "base64.h"
+#include "json.h"
+
+namespace sendmy {
+
+namespace {
+
+// Reports published before 2020 are in seconds rather than milliseconds, see FindMyReport.
+constexpr double kMillisThreshold = 1577836800.0 * 1000;
+
+} // namespace
+
+bool parse_report_results(std::string_view json, std::vector<Report> &out, std::string *error) {
+  JsonValue doc;
+  if (!json_parse(json, doc, error)) {
+    return false;
+  }
+  const JsonValue *results = doc.get("results");
+  if (!results || results->type != JsonValue::Type::Array) {
+    if (error) {
+      *error = "missing results array";
+    }
+    return false;
+  }
+
+  for (const JsonValue &entry : results->array) {
+    const JsonValue *id = entry.get("id");
+    const JsonValue *payload = entry.get("payload");
+    const JsonValue *published = entry.get("datePublished");
+    if (!id || id->type != JsonValue::Type::String || !payload || payload->type != JsonValue::Type::String ||
+        !published || published->type != JsonValue::Type::Number) {
+      continue;
+    }
+
+    Report report;
+    if (!base64_decode_digest(id->string, report.id)) {
+      continue;
+    }
+    report.payload.resize(payload->string.size());
+    long len = base64_decode(payload->string, report.payload.data(), report.payload.size());
+    if (len < 5) {
+      continue;
+    }
+    report.payload.resize(size_t(len));
+
+    double date = published->number;
+    report.date_published_ms = int64_t(date < kMillisThreshold ? date * 1000 : date);
+    report.timestamp = int32_t((uint32_t(report.payload[0]) << 24) | (uint32_t(report.payload[1]) << 16) |
+                               (uint32_t(report.payload[2]) << 8) | uint32_t(report.payload[3]));
+    report.confidence = report.payload[4];
+
+    const JsonValue *status = entry.get("statusCode");
+    if (status && status->type == JsonValue::Type::Number) {
+      report.status_code = int(status->number);
+    }
+    out.push_back(std::move(report));
+  }
+  return true;
+}
+
+void append_report_json(const Report &report, std::string &out) {
+  char id[kDigestBase64Len];
+  char published[24];
+  base64_encode_digest(report.id, id);
+  snprintf(published, sizeof(published), "%lld", (long long)report.date_published_ms);
+  out += "{\"datePublished\":";
+  out += published;
+  out += ",\"payload\":\"";
+  out += base64_encode(report.payload.data(), report.payload.size());
+  out += "\",\"id\":\"";
+  out.append(id, sizeof(id));
+  out += "\",\"statusCode\":";
+  out += std::to_string(report.status_code);
+  out += "}";
+}
+
+void write_report_results(const std::vector<Report> &reports, std::string &out) {
+  out += "{\"results\":[";
+  for (size_t i = 0; i < reports.size(); i++) {
+    if (i) {
+      out += ",";
+    }
+    append_report_json(reports[i], out);
+  }
+  out += "]}\n";
+}
+
+} // namespace sendmy
@@ -0,0 +1,40 @@
+#ifndef SENDMY_REPORT_H
+#define SENDMY_REPORT_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "types.h"
+
+namespace sendmy {
+
+// Seconds between the Unix epoch and the Cocoa reference date (2001-01-01) used in report payloads.
+constexpr int64_t kCocoaEpochOffset = 978307200;
+
+// One entry of the acsnservice/fetch "results" array, see FindMyReport in the DataFetcher.
+struct Report {
+  // Report id, already decoded from base64.
+  Digest id;
+  // When the backend published the report, in milliseconds since the Unix epoch.
+  int64_t date_published_ms = 0;
+  // When the finder saw the advertisement, in seconds since the Cocoa reference date.
+  int32_t timestamp = 0;
+  uint8_t confidence = 0;
+  int status_code = 0;
+  std::vector<uint8_t> payload;
+};
+
+// Parses a FindMyReportResults document ({"results": [...]}) and appends the reports to out.
+// Entries with a malformed id or payload are skipped, a malformed document fails as a whole.
+bool parse_report_results(std::string_view json, std::vector<Report> &out, std::string *error = nullptr);
+
+// Appends reports to out as a FindMyReportResults document that parse_report_results() reads back.
+void write_report_results(const std::vector<Report> &reports, std::string &out);
+// Appends one entry of the results array.
+void append_report_json(const Report &report, std::string &out);
+
+} // namespace sendmy
+
+#endif // SENDMY_REPORT_H
@@ -0,0 +1,45 @@
+#include "report_matcher.h"
+
+#include "report_source.h"
+
+namespace sendmy {
+
+void ReportMatcher::add(const Digest &digest, const IndexEntry &entry) {
+  index_.insert(digest, entry);
+  keys_.push_back(BinaryFuseFilter::key(digest));
+  built_ = false;
+}
+
+bool ReportMatcher::build() {
+  built_ = filter_.build(keys_);
+  return built_;
+}
+
+bool ReportMatcher::match_file(const std::string &path, std::vector<Report> &out, std::string *error) {
+  // An empty or stale filter would reject the reports of every digest it does not hold.
+  if (prefilter_ && !built_) {
+    if (error) {
+      *error = "report matcher used before build()";
+    }
+    return false;
+  }
+  std::string json;
+  if (!read_file(path, json)) {
+    if (error) {
+      *error = "cannot read " + path;
+    }
+    return false;
+  }
+  std::vector<Report> reports;
+  if (!parse_report_results(json, reports, error)) {
+    return false;
+  }
+  for (Report &r : reports) {
+    if (match(r, [](const IndexEntry &, const Report &) {})) {
+      out.push_back(std::move(r));
+    }
+  }
+  return true;
+}
+
+} // namespace sendmy
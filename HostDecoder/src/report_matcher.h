@@ -0,0 +1,79 @@
+#ifndef SENDMY_REPORT_MATCHER_H
+#define SENDMY_REPORT_MATCHER_H
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "digest_index.h"
+#include "fuse_filter.h"
+#include "report.h"
+#include "types.h"
+
+namespace sendmy {
+
+struct MatchStats {
+  uint64_t reports = 0;
+  // Reports the prefilter let through to the exact lookup.
+  uint64_t probed = 0;
+  uint64_t matched = 0;
+};
+
+// Picks the reports of tracked messages out of bulk report dumps.
+//
+// The candidate digests to look for are added up front; build() then freezes them into a binary
+// fuse filter in front of the exact DigestIndex. Almost every report of a large archive belongs to
+// none of the tracked messages, and the filter rejects those with one probe; only the rest (the
+// matches plus 1/256 false positives) pays for the index lookup.
+class ReportMatcher {
+ public:
+  explicit ReportMatcher(size_t expected_digests = 256) : index_(expected_digests) {}
+
+  // Digests added after build() are not in the filter until the next build().
+  void add(const Digest &digest, const IndexEntry &entry);
+  bool build();
+  bool built() const { return built_; }
+
+  // Without the prefilter every report goes straight to the index, for comparison.
+  void set_prefilter(bool enabled) { prefilter_ = enabled; }
+
+  // Calls fn(const IndexEntry &, const Report &) for every entry report's id maps to. Returns true
+  // if there was any. With the prefilter, build() has to come first.
+  template <typename Fn>
+  bool match(const Report &report, Fn &&fn) {
+    assert(built_ || !prefilter_);
+    stats_.reports++;
+    if (prefilter_ && !filter_.contains(report.id)) {
+      return false;
+    }
+    stats_.probed++;
+    bool hit = false;
+    index_.for_each(report.id, [&](const IndexEntry &entry) {
+      hit = true;
+      fn(entry, report);
+    });
+    stats_.matched += hit;
+    return hit;
+  }
+
+  // Parses a FindMyReportResults dump and appends the reports that match to out. Fails if the
+  // prefilter is on and not built for the current digests.
+  bool match_file(const std::string &path, std::vector<Report> &out, std::string *error = nullptr);
+
+  const MatchStats &stats() const { return stats_; }
+  const BinaryFuseFilter &filter() const { return filter_; }
+  size_t size() const { return index_.size(); }
+
+ private:
+  DigestIndex index_;
+  std::vector<uint64_t> keys_;
+  BinaryFuseFilter filter_;
+  bool prefilter_ = true;
+  bool built_ = false;
+  MatchStats stats_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_REPORT_MATCHER_H
@@ -0,0 +1,58 @@
+#include "report_source.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace sendmy {
+
+bool read_file(const std::string &path, std::string &out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    return false;
+  }
+  std::ostringstream buf;
+  buf << in.rdbuf();
+  out = buf.str();
+  return true;
+}
+
+bool DumpSource::load(const std::string &path, std::string *error) {
+  std::string json;
+  if (!read_file(path, json)) {
+    if (error) {
+      *error = "cannot read " + path;
+    }
+    return false;
+  }
+  size_t first = reports_.size();
+  if (!parse_report_results(json, reports_, error)) {
+    return false;
+  }
+  for (size_t i = first; i < reports_.size(); i++) {
+    by_id_.emplace(reports_[i].id, i);
+  }
+  return true;
+}
+
+void DumpSource::add(const std::vector<Report> &reports) {
+  for (const Report &r : reports) {
+    by_id_.emplace(r.id, reports_.size());
+    reports_.push_back(r);
+  }
+}
+
+bool DumpSource::query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                       std::vector<Report> &out) {
+  for (const Digest &id : ids) {
+    auto range = by_id_.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+      const Report &r = reports_[it->second];
+      if (r.date_published_ms >= start_ms && r.date_published_ms < end_ms) {
+        out.push_back(r);
+      }
+    }
+  }
+  return true;
+}
+
+} // namespace sendmy
@@ -0,0 +1,47 @@
+#ifndef SENDMY_REPORT_SOURCE_H
+#define SENDMY_REPORT_SOURCE_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "report.h"
+#include "types.h"
+
+namespace sendmy {
+
+// Anything that can answer an acsnservice/fetch style query.
+class ReportSource {
+ public:
+  virtual ~ReportSource() = default;
+
+  // Appends all reports for the given ids published in [start_ms, end_ms) to out.
+  // Returns false if the query could not be answered at all.
+  virtual bool query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                     std::vector<Report> &out) = 0;
+};
+
+// Answers queries from a FindMyReportResults dump on disk, e.g. an exported fetch response.
+class DumpSource : public ReportSource {
+ public:
+  bool load(const std::string &path, std::string *error = nullptr);
+  // Adds reports that are already parsed, e.g. simulated ones.
+  void add(const std::vector<Report> &reports);
+
+  bool query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+             std::vector<Report> &out) override;
+
+  size_t size() const { return reports_.size(); }
+
+ private:
+  std::vector<Report> reports_;
+  std::unordered_multimap<Digest, size_t, DigestHash> by_id_;
+};
+
+// Reads a whole file into out.
+bool read_file(const std::string &path, std::string &out);
+
+} // namespace sendmy
+
+#endif // SENDMY_REPORT_SOURCE_H
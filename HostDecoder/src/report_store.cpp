@@ -0,0 +1,379 @@
+#include "report_store.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sendmy {
+
+namespace {
+
+constexpr uint32_t kMagic = 0x53524d53; // "SMRS"
+constexpr uint32_t kVersion = 1;
+constexpr size_t kMinColumnBytes = 64 * 1024;
+
+const char *const kColumnFiles[] = {"digest.col",   "published.col",   "timestamp.col", "confidence.col",
+                                    "status.col",   "payload_end.col", "payload.blob"};
+
+struct Meta {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t rows;
+  uint64_t payload_bytes;
+};
+
+struct SyncRecord {
+  uint8_t id[kDigestLen];
+  int64_t from_ms;
+  int64_t until_ms;
+};
+
+bool write_all(int fd, const void *data, size_t len) {
+  const uint8_t *p = static_cast<const uint8_t *>(data);
+  while (len > 0) {
+    ssize_t n = write(fd, p, len);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    len -= size_t(n);
+  }
+  return true;
+}
+
+} // namespace
+
+bool ReportStore::Column::open(const std::string &path) {
+  fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+  return st.st_size == 0 || reserve(size_t(st.st_size));
+}
+
+bool ReportStore::Column::reserve(size_t bytes) {
+  if (bytes <= capacity && base) {
+    return true;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    return false;
+  }
+  size_t grown = std::max({bytes, capacity * 2, kMinColumnBytes});
+  if (size_t(st.st_size) < grown && ftruncate(fd, off_t(grown)) != 0) {
+    return false;
+  }
+  grown = std::max(grown, size_t(st.st_size));
+  void *p = mmap(nullptr, grown, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    return false;
+  }
+  if (base) {
+    munmap(base, capacity);
+  }
+  base = static_cast<uint8_t *>(p);
+  capacity = grown;
+  return true;
+}
+
+void ReportStore::Column::close() {
+  if (base) {
+    munmap(base, capacity);
+  }
+  if (fd >= 0) {
+    ::close(fd);
+  }
+  *this = Column();
+}
+
+ReportStore::~ReportStore() { close(); }
+
+bool ReportStore::open(const std::string &dir, std::string *error) {
+  close();
+  auto fail = [&](const std::string &what) {
+    if (error) {
+      *error = what + ": " + strerror(errno);
+    }
+    close();
+    return false;
+  };
+
+  if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) {
+    return fail("cannot create " + dir);
+  }
+  dir_ = dir;
+  std::string meta_path = dir + "/meta";
+  meta_fd_ = ::open(meta_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (meta_fd_ < 0) {
+    return fail("cannot open " + meta_path);
+  }
+  if (flock(meta_fd_, LOCK_EX | LOCK_NB) != 0) {
+    return fail("store " + dir + " is in use");
+  }
+
+  Meta meta = {};
+  ssize_t n = pread(meta_fd_, &meta, sizeof(meta), 0);
+  if (n == 0) {
+    meta = {kMagic, kVersion, 0, 0};
+  } else if (n != ssize_t(sizeof(meta)) || meta.magic != kMagic || meta.version != kVersion) {
+    errno = EINVAL;
+    return fail("not a report store: " + dir);
+  }
+
+  for (int c = 0; c < kColumnCount; c++) {
+    if (!columns_[c].open(dir + "/" + kColumnFiles[c])) {
+      return fail(std::string("cannot map ") + kColumnFiles[c]);
+    }
+  }
+  // Rows are only committed once the meta file says so; anything past that is from a torn insert.
+  rows_ = meta.rows;
+  payload_bytes_ = meta.payload_bytes;
+  if (columns_[kDigestCol].capacity < rows_ * kDigestLen ||
+      columns_[kPublishedCol].capacity < rows_ * sizeof(int64_t) ||
+      columns_[kPayloadEndCol].capacity < rows_ * sizeof(uint64_t) ||
+      columns_[kPayloadCol].capacity < payload_bytes_) {
+    errno = EINVAL;
+    return fail("truncated report store " + dir);
+  }
+  for (size_t i = 0; i < rows_; i++) {
+    index_row(i);
+  }
+  if (n == 0 && !write_meta()) {
+    return fail("cannot write " + meta_path);
+  }
+  if (!load_sync_log(dir + "/sync.log")) {
+    return fail("cannot open " + dir + "/sync.log");
+  }
+  return true;
+}
+
+void ReportStore::close() {
+  for (Column &c : columns_) {
+    c.close();
+  }
+  if (sync_fd_ >= 0) {
+    ::close(sync_fd_);
+    sync_fd_ = -1;
+  }
+  if (meta_fd_ >= 0) {
+    ::close(meta_fd_);
+    meta_fd_ = -1;
+  }
+  rows_ = 0;
+  payload_bytes_ = 0;
+  by_id_.clear();
+  blocks_.clear();
+  synced_.clear();
+}
+
+bool ReportStore::write_meta() {
+  Meta meta = {kMagic, kVersion, rows_, payload_bytes_};
+  return pwrite(meta_fd_, &meta, sizeof(meta), 0) == ssize_t(sizeof(meta));
+}
+
+bool ReportStore::load_sync_log(const std::string &path) {
+  sync_fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+  if (sync_fd_ < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(sync_fd_, &st) != 0) {
+    return false;
+  }
+  size_t records = size_t(st.st_size) / sizeof(SyncRecord);
+  std::vector<SyncRecord> log(records);
+  if (records && pread(sync_fd_, log.data(), records * sizeof(SyncRecord), 0) !=
+                     ssize_t(records * sizeof(SyncRecord))) {
+    return false;
+  }
+  for (const SyncRecord &r : log) {
+    Digest id;
+    memcpy(id.data(), r.id, kDigestLen);
+    synced_[id] = SyncRange{r.from_ms, r.until_ms};
+  }
+
+  // Drop a torn trailing record, and compact once superseded records dominate the log.
+  bool torn = size_t(st.st_size) % sizeof(SyncRecord) != 0;
+  if (!torn && records <= 2 * synced_.size() + 1024) {
+    return true;
+  }
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    return false;
+  }
+  log.clear();
+  for (const auto &[id, range] : synced_) {
+    SyncRecord r;
+    memcpy(r.id, id.data(), kDigestLen);
+    r.from_ms = range.from_ms;
+    r.until_ms = range.until_ms;
+    log.push_back(r);
+  }
+  bool ok = write_all(fd, log.data(), log.size() * sizeof(SyncRecord)) && fsync(fd) == 0;
+  ::close(fd);
+  if (!ok || rename(tmp.c_str(), path.c_str()) != 0) {
+    unlink(tmp.c_str());
+    return false;
+  }
+  ::close(sync_fd_);
+  sync_fd_ = ::open(path.c_str(), O_RDWR | O_APPEND | O_CLOEXEC);
+  return sync_fd_ >= 0;
+}
+
+size_t ReportStore::payload_begin(size_t row) const {
+  return row ? column<uint64_t>(kPayloadEndCol)[row - 1] : 0;
+}
+
+void ReportStore::index_row(size_t row) {
+  Digest id;
+  memcpy(id.data(), columns_[kDigestCol].base + row * kDigestLen, kDigestLen);
+  by_id_.emplace(id, uint32_t(row));
+  int64_t published = column<int64_t>(kPublishedCol)[row];
+  if (row % kBlockRows == 0) {
+    blocks_.emplace_back(published, published);
+  } else {
+    blocks_.back().first = std::min(blocks_.back().first, published);
+    blocks_.back().second = std::max(blocks_.back().second, published);
+  }
+}
+
+bool ReportStore::same_report(size_t row, const Report &r) const {
+  size_t begin = payload_begin(row);
+  size_t end = column<uint64_t>(kPayloadEndCol)[row];
+  return column<int64_t>(kPublishedCol)[row] == r.date_published_ms && end - begin == r.payload.size() &&
+         memcmp(columns_[kPayloadCol].base + begin, r.payload.data(), r.payload.size()) == 0;
+}
+
+size_t ReportStore::insert(const std::vector<Report> &reports) {
+  if (!is_open()) {
+    return 0;
+  }
+  size_t added = 0;
+  for (const Report &r : reports) {
+    auto range = by_id_.equal_range(r.id);
+    bool duplicate = false;
+    for (auto it = range.first; it != range.second && !duplicate; ++it) {
+      duplicate = same_report(it->second, r);
+    }
+    if (duplicate) {
+      continue;
+    }
+
+    size_t row = rows_;
+    size_t payload_end = payload_bytes_ + r.payload.size();
+    if (!columns_[kDigestCol].reserve((row + 1) * kDigestLen) ||
+        !columns_[kPublishedCol].reserve((row + 1) * sizeof(int64_t)) ||
+        !columns_[kTimestampCol].reserve((row + 1) * sizeof(int32_t)) ||
+        !columns_[kConfidenceCol].reserve(row + 1) ||
+        !columns_[kStatusCol].reserve((row + 1) * sizeof(int32_t)) ||
+        !columns_[kPayloadEndCol].reserve((row + 1) * sizeof(uint64_t)) ||
+        !columns_[kPayloadCol].reserve(payload_end)) {
+      break;
+    }
+    memcpy(columns_[kDigestCol].base + row * kDigestLen, r.id.data(), kDigestLen);
+    column<int64_t>(kPublishedCol)[row] = r.date_published_ms;
+    column<int32_t>(kTimestampCol)[row] = r.timestamp;
+    column<uint8_t>(kConfidenceCol)[row] = r.confidence;
+    column<int32_t>(kStatusCol)[row] = r.status_code;
+    column<uint64_t>(kPayloadEndCol)[row] = payload_end;
+    if (!r.payload.empty()) {
+      memcpy(columns_[kPayloadCol].base + payload_bytes_, r.payload.data(), r.payload.size());
+    }
+    rows_++;
+    payload_bytes_ = payload_end;
+    index_row(row);
+    added++;
+  }
+  if (added) {
+    write_meta();
+  }
+  return added;
+}
+
+Report ReportStore::row(size_t i) const {
+  Report r;
+  memcpy(r.id.data(), columns_[kDigestCol].base + i * kDigestLen, kDigestLen);
+  r.date_published_ms = column<int64_t>(kPublishedCol)[i];
+  r.timestamp = column<int32_t>(kTimestampCol)[i];
+  r.confidence = column<uint8_t>(kConfidenceCol)[i];
+  r.status_code = column<int32_t>(kStatusCol)[i];
+  const uint8_t *payload = columns_[kPayloadCol].base;
+  r.payload.assign(payload + payload_begin(i), payload + column<uint64_t>(kPayloadEndCol)[i]);
+  return r;
+}
+
+void ReportStore::lookup(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                         std::vector<Report> &out) const {
+  const int64_t *published = column<int64_t>(kPublishedCol);
+  for (const Digest &id : ids) {
+    auto range = by_id_.equal_range(id);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (published[it->second] >= start_ms && published[it->second] < end_ms) {
+        out.push_back(row(it->second));
+      }
+    }
+  }
+}
+
+void ReportStore::scan(int64_t start_ms, int64_t end_ms, std::vector<Report> &out) const {
+  const int64_t *published = column<int64_t>(kPublishedCol);
+  for (size_t b = 0; b < blocks_.size(); b++) {
+    if (blocks_[b].second < start_ms || blocks_[b].first >= end_ms) {
+      continue;
+    }
+    size_t last = std::min(rows_, (b + 1) * kBlockRows);
+    for (size_t i = b * kBlockRows; i < last; i++) {
+      if (published[i] >= start_ms && published[i] < end_ms) {
+        out.push_back(row(i));
+      }
+    }
+  }
+}
+
+bool ReportStore::synced_range(const Digest &id, SyncRange &out) const {
+  auto it = synced_.find(id);
+  if (it == synced_.end()) {
+    return false;
+  }
+  out = it->second;
+  return true;
+}
+
+void ReportStore::mark_synced(const std::vector<Digest> &ids, const SyncRange &range) {
+  if (!is_open() || ids.empty()) {
+    return;
+  }
+  std::vector<SyncRecord> log;
+  log.reserve(ids.size());
+  for (const Digest &id : ids) {
+    SyncRange &current = synced_[id];
+    if (current.from_ms == range.from_ms && current.until_ms == range.until_ms) {
+      continue;
+    }
+    current = range;
+    SyncRecord r;
+    memcpy(r.id, id.data(), kDigestLen);
+    r.from_ms = range.from_ms;
+    r.until_ms = range.until_ms;
+    log.push_back(r);
+  }
+  if (!log.empty()) {
+    write_all(sync_fd_, log.data(), log.size() * sizeof(SyncRecord));
+  }
+}
+
+} // namespace sendmy
@@ -0,0 +1,106 @@
+#ifndef SENDMY_REPORT_STORE_H
+#define SENDMY_REPORT_STORE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "report.h"
+#include "types.h"
+
+namespace sendmy {
+
+// Local, append-only store of fetched reports, so repeated polling only has to download new data.
+//
+// A store is a directory of column files (digest, datePublished, timestamp, confidence, status,
+// payload end offset, payload bytes), each memory-mapped and grown in place. A small meta file
+// holds the committed row count and is rewritten after the columns, so rows torn by a crash are
+// ignored on the next open. The digest index and the per-block datePublished ranges used to skip
+// blocks in time scans are rebuilt in memory on open.
+//
+// Besides the reports, the store keeps a sync cursor per report id: the datePublished range that
+// has already been fetched for it. Cursors live in an append-only log where later records win.
+//
+// One process opens a store at a time (enforced with flock). Writes go through shared mappings and
+// survive a crash of the process, not of the host. The layout uses native byte order.
+class ReportStore {
+ public:
+  // Fetched datePublished range of one id, [from_ms, until_ms).
+  struct SyncRange {
+    int64_t from_ms = 0;
+    int64_t until_ms = 0;
+  };
+
+  ReportStore() = default;
+  ~ReportStore();
+  ReportStore(const ReportStore &) = delete;
+  ReportStore &operator=(const ReportStore &) = delete;
+
+  // Opens the store in dir, creating it if needed.
+  bool open(const std::string &dir, std::string *error = nullptr);
+  void close();
+  bool is_open() const { return meta_fd_ >= 0; }
+
+  // Appends the reports not already stored, identical (id, datePublished, payload) being duplicates.
+  // Returns the number of rows added.
+  size_t insert(const std::vector<Report> &reports);
+
+  // Appends the stored reports for ids published in [start_ms, end_ms) to out.
+  void lookup(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms, std::vector<Report> &out) const;
+
+  // Appends all stored reports published in [start_ms, end_ms) to out.
+  void scan(int64_t start_ms, int64_t end_ms, std::vector<Report> &out) const;
+
+  size_t rows() const { return rows_; }
+  Report row(size_t i) const;
+
+  // Returns false if nothing was fetched for id yet.
+  bool synced_range(const Digest &id, SyncRange &out) const;
+  // Records that the reports of ids published in range are stored.
+  void mark_synced(const std::vector<Digest> &ids, const SyncRange &range);
+
+ private:
+  struct Column {
+    int fd = -1;
+    uint8_t *base = nullptr;
+    size_t capacity = 0;
+
+    bool open(const std::string &path);
+    bool reserve(size_t bytes);
+    void close();
+  };
+
+  enum ColumnId { kDigestCol, kPublishedCol, kTimestampCol, kConfidenceCol, kStatusCol, kPayloadEndCol,
+                  kPayloadCol, kColumnCount };
+
+  static constexpr size_t kBlockRows = 1024;
+
+  template <typename T> const T *column(ColumnId id) const {
+    return reinterpret_cast<const T *>(columns_[id].base);
+  }
+  template <typename T> T *column(ColumnId id) { return reinterpret_cast<T *>(columns_[id].base); }
+
+  size_t payload_begin(size_t row) const;
+  bool same_report(size_t row, const Report &r) const;
+  void index_row(size_t row);
+  bool write_meta();
+  bool load_sync_log(const std::string &path);
+
+  std::string dir_;
+  int meta_fd_ = -1;
+  int sync_fd_ = -1;
+  Column columns_[kColumnCount];
+  size_t rows_ = 0;
+  size_t payload_bytes_ = 0;
+  std::unordered_multimap<Digest, uint32_t, DigestHash> by_id_;
+  // Min and max datePublished of every kBlockRows rows.
+  std::vector<std::pair<int64_t, int64_t>> blocks_;
+  std::unordered_map<Digest, SyncRange, DigestHash> synced_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_REPORT_STORE_H
@@ -0,0 +1,33 @@
+#ifndef SENDMY_SHA256_H
+#define SENDMY_SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "types.h"
+
+namespace sendmy {
+
+class Sha256 {
+ public:
+  Sha256() { reset(); }
+
+  void reset();
+  void update(const uint8_t *data, size_t len);
+  void finish(uint8_t *out);
+
+ private:
+  void compress(const uint8_t *block);
+
+  uint32_t state_[8];
+  uint8_t buffer_[64];
+  uint64_t total_len_;
+  size_t buffer_len_;
+};
+
+// One-shot hash, used for the 28 byte advertised keys.
+Digest sha256(const uint8_t *data, size_t len);
+
+} // namespace sendmy
+
+#endif // SENDMY_SHA256_H
@@ -0,0 +1,68 @@
+#include "synced_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <utility>
+
+namespace sendmy {
+
+int64_t now_ms() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+bool SyncedSource::query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+                         std::vector<Report> &out) {
+  // Nothing can be published in the future, so the fetched range stops at now.
+  int64_t hi = std::min(end_ms, now_ms());
+  using Range = std::pair<int64_t, int64_t>;
+  // Keyed by the end of the missing range. Ids sharing an end are fetched together from the
+  // earliest start among them; whatever that re-downloads is dropped as duplicates on insert.
+  std::map<int64_t, std::pair<int64_t, std::vector<Digest>>> fetch;
+  std::map<Range, std::vector<Digest>> synced;
+  auto need = [&fetch](const Digest &id, int64_t from, int64_t to) {
+    auto it = fetch.try_emplace(to, from, std::vector<Digest>()).first;
+    it->second.first = std::min(it->second.first, from);
+    it->second.second.push_back(id);
+  };
+
+  for (const Digest &id : ids) {
+    if (hi <= start_ms) {
+      break;
+    }
+    ReportStore::SyncRange have;
+    if (store_.synced_range(id, have) && have.from_ms <= hi && start_ms <= have.until_ms) {
+      if (start_ms < have.from_ms) {
+        need(id, start_ms, have.from_ms);
+      }
+      if (hi > have.until_ms - params_.overlap_ms) {
+        need(id, std::max(start_ms, have.until_ms - params_.overlap_ms), hi);
+      }
+      synced[{std::min(start_ms, have.from_ms), std::max(hi, have.until_ms)}].push_back(id);
+    } else {
+      need(id, start_ms, hi);
+      synced[{start_ms, hi}].push_back(id);
+    }
+  }
+
+  std::vector<Report> fetched;
+  for (const auto &[to, group] : fetch) {
+    fetched.clear();
+    upstream_queries_++;
+    upstream_ids_ += group.second.size();
+    if (!upstream_.query(group.second, group.first, to, fetched)) {
+      return false;
+    }
+    reports_fetched_ += fetched.size();
+    reports_added_ += store_.insert(fetched);
+  }
+  for (const auto &[range, group] : synced) {
+    store_.mark_synced(group, ReportStore::SyncRange{range.first, range.second});
+  }
+
+  store_.lookup(ids, start_ms, end_ms, out);
+  return true;
+}
+
+} // namespace sendmy
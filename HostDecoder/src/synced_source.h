@@ -0,0 +1,48 @@
+#ifndef SENDMY_SYNCED_SOURCE_H
+#define SENDMY_SYNCED_SOURCE_H
+
+#include <cstdint>
+#include <vector>
+
+#include "report_source.h"
+#include "report_store.h"
+
+namespace sendmy {
+
+struct SyncParams {
+  // Ranges after a cursor are re-fetched from this far before it, for reports that show up with a
+  // slightly older datePublished (clock skew, backend lag). The duplicates are dropped on insert.
+  int64_t overlap_ms = 60 * 1000;
+};
+
+// Answers queries from a ReportStore, fetching from upstream only the datePublished ranges that
+// the store has not seen for each id yet. Repeated polling then only downloads new reports.
+class SyncedSource : public ReportSource {
+ public:
+  SyncedSource(ReportStore &store, ReportSource &upstream, const SyncParams &params = SyncParams())
+      : store_(store), upstream_(upstream), params_(params) {}
+
+  bool query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms,
+             std::vector<Report> &out) override;
+
+  uint64_t upstream_queries() const { return upstream_queries_; }
+  uint64_t upstream_ids() const { return upstream_ids_; }
+  uint64_t reports_fetched() const { return reports_fetched_; }
+  uint64_t reports_added() const { return reports_added_; }
+
+ private:
+  ReportStore &store_;
+  ReportSource &upstream_;
+  SyncParams params_;
+  uint64_t upstream_queries_ = 0;
+  uint64_t upstream_ids_ = 0;
+  uint64_t reports_fetched_ = 0;
+  uint64_t reports_added_ = 0;
+};
+
+// Milliseconds since the Unix epoch.
+int64_t now_ms();
+
+} // namespace sendmy
+
+#endif // SENDMY_SYNCED_SOURCE_H
@@ -0,0 +1,37 @@
+#ifndef SENDMY_TYPES_H
+#define SENDMY_TYPES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace sendmy {
+
+// Layout of an advertised key, see set_addr_and_payload_for_byte() in the firmware:
+// [2 byte magic] [4 byte modem_id] [2 byte tweak] [20 byte payload]
+constexpr size_t kAdvKeyLen = 28;
+constexpr size_t kPayloadLen = 20;
+constexpr size_t kPayloadOffset = 8;
+constexpr size_t kDigestLen = 32;
+
+// Largest chunk length the firmware can encode into a single uint8_t value.
+constexpr uint32_t kMaxChunkLen = 8;
+
+using AdvKey = std::array<uint8_t, kAdvKeyLen>;
+using Payload = std::array<uint8_t, kPayloadLen>;
+// SHA-256 of an advertised key, i.e. the report id used by the Find My backend.
+using Digest = std::array<uint8_t, kDigestLen>;
+
+// Digests are uniformly distributed, their leading bytes make a good hash.
+struct DigestHash {
+  size_t operator()(const Digest &d) const {
+    size_t h;
+    memcpy(&h, d.data(), sizeof(h));
+    return h;
+  }
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_TYPES_H
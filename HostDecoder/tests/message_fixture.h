@@ -0,0 +1,79 @@
+// Reports for a message as a lossless channel would deliver them, built from the host key
+// derivation (which test_encoding checks against the firmware), for the decoder tests.
+
+#ifndef SENDMY_TESTS_MESSAGE_FIXTURE_H
+#define SENDMY_TESTS_MESSAGE_FIXTURE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "encoding.h"
+#include "report.h"
+#include "sha256.h"
+
+namespace sendmy {
+
+// Chunk values in the order the modem sends them, like send_data_once_blocking(): from the last
+// byte of the message to the first, low bits first.
+inline std::vector<uint8_t> chunk_values(const std::vector<uint8_t> &message, uint32_t chunk_len) {
+  std::vector<uint8_t> values;
+  size_t bits = message.size() * 8;
+  for (size_t offset = 0; offset < bits; offset += chunk_len) {
+    unsigned v = 0;
+    for (uint32_t b = 0; b < chunk_len && offset + b < bits; b++) {
+      size_t bit = offset + b;
+      v |= unsigned((message[message.size() - 1 - bit / 8] >> (bit % 8)) & 1) << b;
+    }
+    values.push_back(uint8_t(v));
+  }
+  return values;
+}
+
+// Report id of chunk `index` with `value`, on top of the payload after the chunks before it.
+inline Digest chunk_digest(uint32_t modem_id, const Payload &prefix, uint32_t index, uint8_t value,
+                           uint32_t chunk_len) {
+  Payload payload = prefix;
+  place_chunk(payload, index, value, chunk_len);
+  AdvKey key;
+  find_valid_key(modem_id, payload, key);
+  return sha256(key.data(), key.size());
+}
+
+// A report for id, seen at timestamp (Cocoa seconds) and published a minute later. `serial` tells
+// the sightings apart, like the encrypted part of a real payload.
+inline Report make_report(const Digest &id, int32_t timestamp, uint32_t serial, uint8_t confidence = 2) {
+  Report r;
+  r.id = id;
+  r.timestamp = timestamp;
+  r.date_published_ms = (int64_t(timestamp) + kCocoaEpochOffset + 60) * 1000;
+  r.confidence = confidence;
+  r.payload.assign(88, 0);
+  for (int i = 0; i < 4; i++) {
+    r.payload[i] = uint8_t(uint32_t(timestamp) >> (24 - 8 * i));
+    r.payload[5 + i] = uint8_t(serial >> (24 - 8 * i));
+  }
+  r.payload[4] = confidence;
+  return r;
+}
+
+// `copies` reports for every chunk of values, chunk i seen around t0 + 60 * i.
+inline std::vector<Report> chain_reports(uint32_t modem_id, const std::vector<uint8_t> &values, uint32_t chunk_len,
+                                         int32_t t0, int copies = 3) {
+  std::vector<Report> reports;
+  Payload prefix{};
+  for (uint32_t i = 0; i < values.size(); i++) {
+    Digest id = chunk_digest(modem_id, prefix, i, values[i], chunk_len);
+    place_chunk(prefix, i, values[i], chunk_len);
+    for (int c = 0; c < copies; c++) {
+      reports.push_back(make_report(id, t0 + int32_t(60 * i + c), i * 16 + uint32_t(c)));
+    }
+  }
+  return reports;
+}
+
+inline std::vector<uint8_t> bytes_of(const std::string &s) { return std::vector<uint8_t>(s.begin(), s.end()); }
+
+} // namespace sendmy
+
+#endif // SENDMY_TESTS_MESSAGE_FIXTURE_H
@@ -0,0 +1,102 @@
+// Checks how AimdController reacts to each kind of response, and that metrics_text() is valid
+// Prometheus text exposition: every metric is a HELP line, a TYPE line and `<name> <value>\n`.
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "aimd.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static std::vector<std::string> split_lines(const std::string &text) {
+  std::vector<std::string> lines;
+  size_t start = 0;
+  for (size_t nl; (nl = text.find('\n', start)) != std::string::npos; start = nl + 1) {
+    lines.push_back(text.substr(start, nl - start));
+  }
+  // Anything after the last newline is a truncated line.
+  CHECK(start == text.size());
+  return lines;
+}
+
+static void check_metrics_text(const std::string &prefix) {
+  AimdController controller;
+  controller.acquire();
+  controller.release(200, 10);
+  std::string text = controller.metrics_text(prefix);
+  std::vector<std::string> lines = split_lines(text);
+  CHECK(lines.size() == 3 * 10);
+  for (size_t i = 0; i + 2 < lines.size(); i += 3) {
+    CHECK(lines[i].rfind("# HELP " + prefix, 0) == 0);
+    std::string name = lines[i].substr(7, lines[i].find(' ', 7) - 7);
+    const std::string &type = lines[i + 1];
+    CHECK(type == "# TYPE " + name + " gauge" || type == "# TYPE " + name + " counter");
+    const std::string &sample = lines[i + 2];
+    CHECK(sample.rfind(name + " ", 0) == 0);
+    std::string value = sample.substr(std::min(sample.size(), name.size() + 1));
+    char *end;
+    strtod(value.c_str(), &end);
+    CHECK(!value.empty() && *end == 0);
+  }
+}
+
+static double limit_after(int status, int times) {
+  AimdParams params;
+  params.initial_limit = 8;
+  params.default_retry_after_ms = 0;
+  AimdController controller(params);
+  for (int i = 0; i < times; i++) {
+    controller.acquire();
+    // No latency keeps the once-per-round-trip rule out of the way.
+    controller.release(status, 0, 0);
+  }
+  return controller.metrics().limit;
+}
+
+static void check_status_classes() {
+  CHECK(limit_after(200, 4) > 8);
+  CHECK(limit_after(204, 4) > 8);
+  CHECK(limit_after(429, 1) == 4);
+  CHECK(limit_after(503, 1) == 4);
+  CHECK(limit_after(0, 1) == 4);
+  CHECK(limit_after(500, 1) == 4);
+  CHECK(limit_after(502, 1) == 4);
+  CHECK(limit_after(504, 1) == 4);
+  CHECK(limit_after(400, 4) == 8);
+  CHECK(limit_after(404, 4) == 8);
+
+  AimdController controller;
+  for (int status : {200, 400, 500, 0, 429}) {
+    controller.acquire();
+    controller.release(status, 0, 0);
+  }
+  AimdMetrics m = controller.metrics();
+  CHECK(m.successes == 1);
+  CHECK(m.errors == 3);
+  CHECK(m.throttled == 1);
+}
+
+int main() {
+  check_metrics_text("sendmy_fetch_");
+  // Long names used to overflow a fixed line buffer.
+  check_metrics_text("sendmy_fetch_a_rather_long_prefix_for_a_deployment_with_many_decoders_");
+  check_status_classes();
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+// Checks BeamDecoder on messages where greedy decoding goes wrong: a colliding value with more
+// reports than the real one wins the chunk and leaves the greedy decoder without a continuation,
+// and a chunk of 0, whose key aliases the previous chunk, competes with a weak wrong value. The
+// beam has to recover the message in both cases.
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "beam_decoder.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "message_fixture.h"
+#include "report_source.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static const int32_t kT0 = 700000000;
+static const int64_t kEndMs = int64_t(4e12);
+
+static std::vector<uint8_t> decode_greedy(const std::vector<Report> &reports, const MessageParams &params) {
+  DumpSource source;
+  source.add(reports);
+  return decode_message(source, params, 0, kEndMs);
+}
+
+static std::vector<uint8_t> decode_beam(const std::vector<Report> &reports, const MessageParams &params,
+                                        uint32_t width) {
+  DumpSource source;
+  source.add(reports);
+  BeamParams beam;
+  beam.width = width;
+  return decode_message_beam(source, params, beam, 0, kEndMs);
+}
+
+// Reports for `value` at chunk `index` of the chain of values, which was not sent: `copies` of
+// them, seen `delay` seconds after the real chunk.
+static std::vector<Report> wrong_reports(uint32_t modem_id, const std::vector<uint8_t> &values, uint32_t chunk_len,
+                                         uint32_t index, uint8_t value, int copies, int32_t delay,
+                                         uint8_t confidence) {
+  Payload prefix{};
+  for (uint32_t i = 0; i < index; i++) {
+    place_chunk(prefix, i, values[i], chunk_len);
+  }
+  Digest id = chunk_digest(modem_id, prefix, index, value, chunk_len);
+  std::vector<Report> reports;
+  for (int c = 0; c < copies; c++) {
+    reports.push_back(make_report(id, kT0 + int32_t(60 * index) + delay + c, 0x10000 + uint32_t(c), confidence));
+  }
+  return reports;
+}
+
+static void check_colliding_value() {
+  MessageParams params;
+  params.modem_id = 0x5e000201;
+  params.chunk_len = 4;
+  std::vector<uint8_t> message = bytes_of("beam search");
+  std::vector<uint8_t> values = chunk_values(message, params.chunk_len);
+  std::vector<Report> reports = chain_reports(params.modem_id, values, params.chunk_len, kT0);
+
+  // Twice the reports of the real value, at the same time and with more confidence.
+  const uint32_t index = 5;
+  uint8_t wrong = uint8_t((values[index] + 7) % 16);
+  CHECK(wrong != 0 && wrong != values[index]);
+  std::vector<Report> extra = wrong_reports(params.modem_id, values, params.chunk_len, index, wrong, 6, 5, 3);
+  reports.insert(reports.end(), extra.begin(), extra.end());
+
+  // Greedy takes the collision and finds nothing after it: only the bytes before it survive.
+  std::vector<uint8_t> greedy = decode_greedy(reports, params);
+  CHECK(greedy.size() < message.size());
+  CHECK(decode_beam(reports, params, 1) == greedy);
+  CHECK(decode_beam(reports, params, 4) == message);
+}
+
+static void check_alias_penalty() {
+  MessageParams params;
+  params.modem_id = 0x5e000202;
+  params.chunk_len = 4;
+  // '0' is 0x30: its low chunk is 0 and keeps the key of the chunk before it.
+  std::vector<uint8_t> message = bytes_of("a0b");
+  std::vector<uint8_t> values = chunk_values(message, params.chunk_len);
+  const uint32_t index = 2;
+  CHECK(values[index] == 0);
+  std::vector<Report> reports = chain_reports(params.modem_id, values, params.chunk_len, kT0);
+  CHECK(decode_beam(reports, params, 1) == message);
+
+  // One low-confidence report for a wrong value, two hours late: too weak to beat the aliased key
+  // outright, so both are extended. The wrong value still scores above the penalized alias, and
+  // a beam of one follows it into a dead end.
+  std::vector<Report> extra = wrong_reports(params.modem_id, values, params.chunk_len, index, 9, 1, 7200, 0);
+  reports.insert(reports.end(), extra.begin(), extra.end());
+  CHECK(decode_beam(reports, params, 1).size() < message.size());
+  CHECK(decode_beam(reports, params, 2) == message);
+  CHECK(decode_greedy(reports, params) == message);
+}
+
+int main() {
+  check_colliding_value();
+  check_alias_penalty();
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+// Checks CandidateCache: stored candidates come back from a second mapping of the file, a key is
+// stored once, and stores into a full table fail and are counted.
+
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "candidate_cache.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static CandidateKey make_key(uint32_t chunk) { return CandidateKey{0x5e000001, 0, 2, chunk, Payload{}}; }
+
+static std::vector<Candidate> make_candidates(uint32_t chunk) {
+  std::vector<Candidate> candidates;
+  for (uint8_t v = 0; v < 4; v++) {
+    Candidate c{chunk, v, {}};
+    c.digest[0] = uint8_t(chunk);
+    c.digest[1] = v;
+    candidates.push_back(c);
+  }
+  return candidates;
+}
+
+static bool same_candidates(const std::vector<Candidate> &a, const std::vector<Candidate> &b) {
+  if (a.size() != b.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < a.size(); i++) {
+    if (a[i].chunk != b[i].chunk || a[i].value != b[i].value || a[i].digest != b[i].digest) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main() {
+  char tmpl[] = "/tmp/sendmy-test-candidate-cache-XXXXXX";
+  const char *dir = mkdtemp(tmpl);
+  if (!dir) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::string path = std::string(dir) + "/cache";
+  CandidateCache cache;
+  CHECK(cache.open(path, CandidateCache::Mode::ReadWrite, 3));
+  for (uint32_t chunk = 0; chunk < 3; chunk++) {
+    CHECK(cache.store(make_key(chunk), make_candidates(chunk)));
+  }
+  // Already there: not stored again, and not a full table.
+  CHECK(!cache.store(make_key(1), make_candidates(1)));
+  CHECK(cache.rejected() == 0);
+  // Every slot is taken.
+  CHECK(!cache.store(make_key(3), make_candidates(3)));
+  CHECK(!cache.store(make_key(4), make_candidates(4)));
+  CHECK(cache.rejected() == 2);
+
+  CandidateCache reader;
+  CHECK(reader.open(path, CandidateCache::Mode::ReadOnly));
+  CHECK(!reader.store(make_key(5), make_candidates(5)));
+  CHECK(reader.rejected() == 0);
+  for (uint32_t chunk = 0; chunk < 5; chunk++) {
+    std::vector<Candidate> out;
+    CHECK(reader.lookup(make_key(chunk), out) == (chunk < 3));
+    if (chunk < 3) {
+      CHECK(same_candidates(out, make_candidates(chunk)));
+    }
+  }
+  CHECK(reader.hits() == 3);
+  CHECK(reader.misses() == 2);
+  std::filesystem::remove_all(dir);
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
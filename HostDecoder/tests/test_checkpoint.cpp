@@ -0,0 +1,183 @@
+// Checks CheckpointStore: a decode resumes from its checkpoint without any query, damaged files
+// (a flipped body byte, truncation) are ignored, the interval limits how often a message is
+// written, and stores can save from several threads.
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "checkpoint.h"
+#include "digest_index.h"
+#include "message_decoder.h"
+#include "message_fixture.h"
+#include "report_source.h"
+
+using namespace sendmy;
+
+// Checked from several threads in check_threads().
+static std::atomic<int> failures{0};
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static const int64_t kEndMs = int64_t(4e12);
+
+static std::vector<uint8_t> decode(const std::vector<Report> &reports, const MessageParams &params,
+                                   CheckpointStore *store) {
+  DumpSource source;
+  source.add(reports);
+  return decode_message(source, params, 0, kEndMs, nullptr, nullptr, store);
+}
+
+// Decodes the message once to get its checkpoint written, and returns the path.
+static std::string decode_once(CheckpointStore &store, const MessageParams &params, const std::vector<uint8_t> &message) {
+  auto reports = chain_reports(params.modem_id, chunk_values(message, params.chunk_len), params.chunk_len, 700000000);
+  CHECK(decode(reports, params, &store) == message);
+  return store.path(params);
+}
+
+static bool loads(CheckpointStore &store, const MessageParams &params) {
+  DigestIndex index;
+  MessageDecoder decoder(0, params, index);
+  return store.load(decoder);
+}
+
+static void check_round_trip(const std::string &dir) {
+  CheckpointStore store;
+  CHECK(store.open(dir));
+  MessageParams params;
+  params.modem_id = 0x5e000001;
+  params.chunk_len = 3;
+  std::vector<uint8_t> message = bytes_of("checkpoint");
+  decode_once(store, params, message);
+  CHECK(store.saves() >= 1);
+
+  // No reports at all: everything has to come from the checkpoint.
+  CHECK(decode({}, params, &store) == message);
+  CHECK(store.restores() == 1);
+
+  DigestIndex index;
+  MessageDecoder decoder(0, params, index);
+  decoder.set_checkpoints(&store);
+  CHECK(decoder.finished());
+  CHECK(decoder.message() == message);
+
+  // Another message id, chunk length or modem does not pick it up.
+  MessageParams other = params;
+  other.message_id = 1;
+  CHECK(!loads(store, other));
+  other = params;
+  other.chunk_len = 4;
+  CHECK(!loads(store, other));
+}
+
+static void check_damaged_files(const std::string &dir) {
+  CheckpointStore store;
+  CHECK(store.open(dir));
+  MessageParams params;
+  params.modem_id = 0x5e000002;
+  std::string path = decode_once(store, params, bytes_of("damaged"));
+  std::string good;
+  CHECK(read_file(path, good));
+  CHECK(loads(store, params));
+
+  // A flipped bit anywhere in the body fails the CRC.
+  for (size_t pos : {good.size() - 1, good.size() / 2 + 16}) {
+    std::string bad = good;
+    bad[pos] ^= 0x10;
+    CHECK(write_file_atomic(path, bad.data(), bad.size()));
+    CHECK(!loads(store, params));
+  }
+  // So does a wrong CRC in the header.
+  std::string bad = good;
+  bad[24] ^= 1;
+  CHECK(write_file_atomic(path, bad.data(), bad.size()));
+  CHECK(!loads(store, params));
+
+  // Truncated anywhere, including inside the header.
+  for (size_t len : {good.size() - 1, good.size() / 2, size_t(20), size_t(0)}) {
+    CHECK(write_file_atomic(path, good.data(), len));
+    CHECK(!loads(store, params));
+  }
+  // A decode then starts from scratch and the damaged file is replaced.
+  std::vector<uint8_t> message = bytes_of("damaged");
+  auto reports = chain_reports(params.modem_id, chunk_values(message, params.chunk_len), params.chunk_len, 700000000);
+  CHECK(decode(reports, params, &store) == message);
+  CHECK(loads(store, params));
+}
+
+static void check_interval(const std::string &dir) {
+  MessageParams params;
+  params.modem_id = 0x5e000003;
+  params.chunk_len = 2;
+  std::vector<uint8_t> message = bytes_of("interval");
+  size_t chunks = chunk_values(message, params.chunk_len).size();
+
+  CheckpointStore every;
+  CHECK(every.open(dir + "/every"));
+  every.set_interval_ms(0);
+  decode_once(every, params, message);
+  // One per resolved chunk, plus the chunks past the end that found nothing.
+  CHECK(every.saves() > chunks);
+
+  // The first chunk and the end of the message, nothing in between.
+  CheckpointStore rare;
+  CHECK(rare.open(dir + "/rare"));
+  rare.set_interval_ms(3600 * 1000);
+  decode_once(rare, params, message);
+  CHECK(rare.saves() == 2);
+  CHECK(loads(rare, params));
+}
+
+static void check_threads(const std::string &dir) {
+  CheckpointStore store;
+  CHECK(store.open(dir));
+  store.set_interval_ms(0);
+  std::vector<std::thread> threads;
+  for (uint32_t t = 0; t < 4; t++) {
+    threads.emplace_back([&store, t] {
+      MessageParams params;
+      params.modem_id = 0x5e000100 + t;
+      std::vector<uint8_t> message = bytes_of("thread " + std::to_string(t));
+      decode_once(store, params, message);
+      decode_once(store, params, message);
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  for (uint32_t t = 0; t < 4; t++) {
+    MessageParams params;
+    params.modem_id = 0x5e000100 + t;
+    CHECK(loads(store, params));
+  }
+}
+
+int main() {
+  char tmpl[] = "/tmp/sendmy-test-checkpoint-XXXXXX";
+  const char *dir = mkdtemp(tmpl);
+  if (!dir) {
+    perror("mkdtemp");
+    return 1;
+  }
+  check_round_trip(std::string(dir) + "/round-trip");
+  check_damaged_files(std::string(dir) + "/damaged");
+  check_interval(dir);
+  check_threads(std::string(dir) + "/threads");
+  std::filesystem::remove_all(dir);
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures.load());
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,152 @@
+// Checks DigestIndex against a plain list of (digest, entry) pairs: probe runs that wrap around the
+// end of the table, backward-shift deletion from every position of a run, and one digest held by
+// several entries, as a chunk value of 0 produces.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "digest_index.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+// A digest whose hash, and so home slot, is `hash`, told apart from others by `id`.
+static Digest make_digest(uint64_t hash, uint32_t id) {
+  Digest d{};
+  memcpy(d.data(), &hash, sizeof(hash));
+  memcpy(d.data() + sizeof(hash), &id, sizeof(id));
+  return d;
+}
+
+static bool same_entry(const IndexEntry &a, const IndexEntry &b) {
+  return a.message == b.message && a.chunk == b.chunk && a.value == b.value && a.lane == b.lane;
+}
+
+using Pairs = std::vector<std::pair<Digest, IndexEntry>>;
+
+// The index holds exactly the pairs of the model, and lookups of every digest find all of its
+// entries.
+static void check_matches(const DigestIndex &index, const Pairs &model) {
+  CHECK(index.size() == model.size());
+  for (const auto &[digest, entry] : model) {
+    size_t expected = 0, found = 0, matching = 0;
+    for (const auto &other : model) {
+      expected += other.first == digest;
+    }
+    index.for_each(digest, [&](const IndexEntry &e) {
+      found++;
+      matching += same_entry(e, entry);
+    });
+    CHECK(found == expected);
+    CHECK(matching == 1);
+    CHECK(index.find(digest) != nullptr);
+  }
+}
+
+static void check_wraparound() {
+  // 32 slots, and 16 entries before it grows.
+  DigestIndex index(16);
+  CHECK(index.capacity() == 32);
+  Pairs model;
+  // Six digests at home 30 fill 30, 31, 0, 1, 2 and 3; one at home 0 lands behind them at 4 and one
+  // at home 3 at 5.
+  for (uint32_t i = 0; i < 6; i++) {
+    model.push_back({make_digest(30, i), IndexEntry{i, 0, 0}});
+  }
+  model.push_back({make_digest(0, 6), IndexEntry{6, 0, 0}});
+  model.push_back({make_digest(3, 7), IndexEntry{7, 0, 0}});
+  for (const auto &[digest, entry] : model) {
+    index.insert(digest, entry);
+  }
+  CHECK(index.capacity() == 32);
+  check_matches(index, model);
+  CHECK(index.find(make_digest(1, 99)) == nullptr);
+
+  // Remove from the front, across the wrap and from the end of the run; the entries behind each hole
+  // have to move back past slot 0 for lookups to reach them.
+  for (size_t pick : {1, 0, 3, 4, 0, 1}) {
+    pick %= model.size();
+    CHECK(index.erase(model[pick].first, model[pick].second));
+    CHECK(!index.erase(model[pick].first, model[pick].second));
+    model.erase(model.begin() + pick);
+    check_matches(index, model);
+  }
+}
+
+static void check_shared_digest() {
+  DigestIndex index;
+  Digest d = make_digest(0x1234, 0);
+  IndexEntry a{1, 3, 0}, b{1, 4, 0}, c{1, 4, 0, 2};
+  index.insert(d, a);
+  index.insert(d, b);
+  index.insert(d, c);
+  // The same pair again is a no-op.
+  index.insert(d, b);
+  CHECK(index.size() == 3);
+  check_matches(index, {{d, a}, {d, b}, {d, c}});
+
+  CHECK(index.erase(d, b));
+  CHECK(!index.erase(d, b));
+  check_matches(index, {{d, a}, {d, c}});
+  CHECK(!index.erase(d, IndexEntry{1, 3, 1}));
+  CHECK(index.erase(d, a));
+  CHECK(index.erase(d, c));
+  CHECK(index.size() == 0);
+  CHECK(index.find(d) == nullptr);
+}
+
+// Random inserts and erases over a handful of home slots around the end of the table, with repeated
+// digests, against the model. Growing the table moves the homes, so the run keeps below half load.
+static void check_random_operations() {
+  std::mt19937_64 rng(1);
+  for (int round = 0; round < 200; round++) {
+    DigestIndex index(32);
+    size_t slots = index.capacity();
+    Pairs model;
+    for (int op = 0; op < 400; op++) {
+      bool erase = !model.empty() && (model.size() * 2 + 2 > slots || rng() % 3 == 0);
+      if (erase) {
+        size_t pick = rng() % model.size();
+        CHECK(index.erase(model[pick].first, model[pick].second));
+        model.erase(model.begin() + pick);
+      } else {
+        uint64_t home = (slots - 4 + rng() % 8) % slots;
+        Digest digest = make_digest(home, uint32_t(rng() % 4));
+        IndexEntry entry{uint32_t(rng() % 3), uint32_t(rng() % 3), uint8_t(rng() % 2)};
+        bool present = std::any_of(model.begin(), model.end(), [&](const auto &p) {
+          return p.first == digest && same_entry(p.second, entry);
+        });
+        index.insert(digest, entry);
+        if (!present) {
+          model.push_back({digest, entry});
+        }
+      }
+      check_matches(index, model);
+    }
+    CHECK(index.capacity() == slots);
+  }
+}
+
+int main() {
+  check_wraparound();
+  check_shared_digest();
+  check_random_operations();
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,67 @@
+// Checks the host key derivation against the firmware's own: for every chunk length, place_chunk()
+// and find_valid_key() have to give the key set_addr_and_payload_for_byte() advertises, chunk after
+// chunk, past the point where the offsets wrap around the payload.
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+#include "encoding.h"
+
+extern "C" {
+#include "modem.h"
+}
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+// The key the firmware advertises, from the random address (bytes 0-5 without the top two bits of
+// byte 0) and the Offline Finding payload (the rest, and those two bits).
+static AdvKey advertised_key() {
+  AdvKey key;
+  key[0] = uint8_t((rnd_addr[0] & 0x3f) | (adv_data[29] << 6));
+  for (int i = 1; i < 6; i++) {
+    key[i] = rnd_addr[i];
+  }
+  memcpy(&key[6], &adv_data[7], 22);
+  return key;
+}
+
+static void check_chunk_len(uint32_t chunk_len, std::mt19937_64 &rng) {
+  modem_id = 0x5e000000 | uint32_t(rng() & 0xffffff);
+  // Twice around the 20 payload bytes.
+  uint32_t chunks = 2 * (8 * kPayloadLen / chunk_len) + 3;
+  Payload payload{};
+  for (uint32_t i = 0; i < chunks; i++) {
+    uint8_t value = uint8_t(rng() & (0xff >> (8 - chunk_len)));
+    uint16_t tries = set_addr_and_payload_for_byte(i, 0, value, chunk_len);
+    place_chunk(payload, i, value, chunk_len);
+    AdvKey key;
+    CHECK(find_valid_key(modem_id, payload, key));
+    CHECK(key == advertised_key());
+    CHECK((key[6] << 8 | key[7]) == tries - 1);
+  }
+}
+
+int main() {
+  std::mt19937_64 rng(1);
+  for (uint32_t chunk_len = 1; chunk_len <= kMaxChunkLen; chunk_len++) {
+    for (int message = 0; message < 4; message++) {
+      check_chunk_len(chunk_len, rng);
+    }
+  }
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,123 @@
+// Checks HttpSource against an in-process MockFetchService: queries split into many requests, from
+// several threads at once, return what a DumpSource holding the same reports returns, and the
+// request threads are started once and reused instead of once per query.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <thread>
+#include <vector>
+
+#include "aimd.h"
+#include "http_source.h"
+#include "message_fixture.h"
+#include "mock_fetch_service.h"
+#include "report_source.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static size_t thread_count() {
+  size_t n = 0;
+  for (const auto &entry : std::filesystem::directory_iterator("/proc/self/task")) {
+    (void)entry;
+    n++;
+  }
+  return n;
+}
+
+// Report ids and serials, which tell the copies apart, in a comparable order.
+static std::vector<std::pair<Digest, uint8_t>> summary(const std::vector<Report> &reports) {
+  std::vector<std::pair<Digest, uint8_t>> s;
+  for (const Report &r : reports) {
+    s.emplace_back(r.id, r.payload[8]);
+  }
+  std::sort(s.begin(), s.end());
+  return s;
+}
+
+int main() {
+  // 40 ids with a few reports each, and as many without any.
+  std::vector<Digest> ids;
+  std::vector<Report> reports;
+  for (uint32_t i = 0; i < 80; i++) {
+    Digest id = chunk_digest(0x5e000401, Payload{}, 0, uint8_t(i), 8);
+    ids.push_back(id);
+    for (uint32_t c = 0; c < (i % 2 ? 0 : 1 + i % 3); c++) {
+      reports.push_back(make_report(id, 700000000 + int32_t(60 * i + c), c));
+    }
+  }
+  DumpSource dump;
+  dump.add(reports);
+
+  MockFetchService service;
+  service.add(reports);
+  std::string error;
+  if (!service.start(0, 4, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  AimdParams aimd;
+  aimd.max_limit = 4;
+  AimdController controller(aimd);
+  HttpSource source;
+  CHECK(source.open(service.url()));
+  source.set_max_ids(3);
+  source.set_controller(&controller);
+
+  std::vector<Report> expected;
+  CHECK(dump.query(ids, 0, INT64_MAX, expected));
+  size_t before = thread_count();
+  std::vector<Report> out;
+  CHECK(source.query(ids, 0, INT64_MAX, out));
+  CHECK(summary(out) == summary(expected));
+  // Three request threads next to the calling one, for the limit of four.
+  size_t with_pool = thread_count();
+  CHECK(with_pool == before + 3);
+
+  // Four threads querying overlapping slices at once share them.
+  std::vector<std::thread> threads;
+  std::vector<int> ok(4, 0);
+  for (size_t t = 0; t < 4; t++) {
+    threads.emplace_back([&, t] {
+      std::vector<Digest> slice(ids.begin() + long(t * 10), ids.end());
+      std::vector<Report> want, got;
+      dump.query(slice, 0, INT64_MAX, want);
+      bool all = true;
+      for (int q = 0; q < 10; q++) {
+        got.clear();
+        all = all && source.query(slice, 0, INT64_MAX, got) && summary(got) == summary(want);
+      }
+      ok[t] = all;
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  CHECK(std::count(ok.begin(), ok.end(), 1) == 4);
+  CHECK(thread_count() == with_pool);
+  // 3 ids per request: 27 for all 80 ids, then 27, 24, 20 and 17 per round of the slices.
+  CHECK(source.requests() == 27 + 10 * (27 + 24 + 20 + 17));
+
+  // A failing request fails the query.
+  service.stop();
+  out.clear();
+  source.set_max_retries(0);
+  CHECK(!source.query(ids, 0, INT64_MAX, out));
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
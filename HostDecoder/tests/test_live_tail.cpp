@@ -0,0 +1,117 @@
+// Checks LiveTail against reports that get published while it polls: the message comes out byte by
+// byte and ends, and polls only fetch what was published since the newest report of each pending
+// chunk, instead of everything since the start.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "live_tail.h"
+#include "message_fixture.h"
+#include "report_source.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+// Serves the reports published up to `now_ms`, and counts what it hands out.
+class ClockedSource : public ReportSource {
+ public:
+  explicit ClockedSource(const std::vector<Report> &reports) { dump_.add(reports); }
+
+  bool query(const std::vector<Digest> &ids, int64_t start_ms, int64_t end_ms, std::vector<Report> &out) override {
+    queries++;
+    if (start_ms > 0) {
+      narrowed++;
+    }
+    size_t before = out.size();
+    bool ok = dump_.query(ids, start_ms, std::min(end_ms, now_ms + 1), out);
+    returned += out.size() - before;
+    return ok;
+  }
+
+  int64_t now_ms = 0;
+  uint64_t queries = 0;
+  uint64_t narrowed = 0;
+  uint64_t returned = 0;
+
+ private:
+  DumpSource dump_;
+};
+
+class CollectSink : public TailSink {
+ public:
+  void on_byte(const TailByte &b) override {
+    if (b.offset_from_end == bytes.size()) {
+      bytes.push_back(b.byte);
+    }
+  }
+  void on_finished(const MessageParams &, const std::vector<uint8_t> &m) override {
+    finished++;
+    message = m;
+  }
+
+  std::vector<uint8_t> bytes;
+  std::vector<uint8_t> message;
+  int finished = 0;
+};
+
+// Polls every 10 s of simulated time until the message ends, and returns the reports fetched.
+static uint64_t tail(const std::vector<Report> &reports, const MessageParams &params,
+                     const std::vector<uint8_t> &message, int64_t overlap_ms, uint64_t *narrowed) {
+  ClockedSource source(reports);
+  CollectSink sink;
+  TailParams tp;
+  tp.alias_settle_ms = 120 * 1000;
+  tp.overlap_ms = overlap_ms;
+  LiveTail live(source, sink, tp);
+  live.follow(params);
+  int64_t first = reports.front().date_published_ms;
+  for (source.now_ms = first - 10000; !live.done() && source.now_ms < first + 3600 * 1000; source.now_ms += 10000) {
+    live.poll(source.now_ms);
+  }
+  CHECK(live.done());
+  CHECK(sink.finished == 1);
+  CHECK(sink.message == message);
+  std::reverse(sink.bytes.begin(), sink.bytes.end());
+  CHECK(sink.bytes == message);
+  CHECK(live.requests() == source.queries);
+  *narrowed = source.narrowed;
+  return source.returned;
+}
+
+int main() {
+  MessageParams params;
+  params.modem_id = 0x5e000301;
+  params.chunk_len = 4;
+  // '0' is 0x30, whose 0 chunk waits out the alias timeout with its key's reports coming back.
+  std::vector<uint8_t> message = bytes_of("tail 0 f");
+  // Ten copies per chunk, published over a few minutes.
+  std::vector<Report> reports =
+      chain_reports(params.modem_id, chunk_values(message, params.chunk_len), params.chunk_len, 700000000, 10);
+  std::sort(reports.begin(), reports.end(),
+            [](const Report &a, const Report &b) { return a.date_published_ms < b.date_published_ms; });
+
+  uint64_t narrowed = 0;
+  uint64_t with_cursor = tail(reports, params, message, 60 * 1000, &narrowed);
+  CHECK(narrowed > 0);
+  // An overlap reaching back past the start turns the cursor off.
+  uint64_t without_narrowed = 0;
+  uint64_t without_cursor = tail(reports, params, message, INT64_MAX / 2, &without_narrowed);
+  CHECK(without_narrowed == 0);
+  CHECK(with_cursor < without_cursor);
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,183 @@
+// Checks BinaryFuseFilter and ReportMatcher: no false negatives at any size, down to one and two
+// keys and with duplicate keys, a false positive rate near 1/256, and a matcher that refuses to
+// match dumps before its filter is built.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "checkpoint.h"
+#include "fuse_filter.h"
+#include "message_fixture.h"
+#include "report_matcher.h"
+
+using namespace sendmy;
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+static Digest random_digest(std::mt19937_64 &rng) {
+  Digest d;
+  for (uint8_t &b : d) {
+    b = uint8_t(rng());
+  }
+  return d;
+}
+
+static void check_no_false_negatives(std::mt19937_64 &rng) {
+  for (size_t n : {1, 2, 3, 4, 5, 7, 10, 31, 100, 1000, 100000}) {
+    std::vector<uint64_t> keys(n);
+    for (uint64_t &k : keys) {
+      k = rng();
+    }
+    BinaryFuseFilter filter;
+    CHECK(filter.build(keys));
+    CHECK(filter.size() == n);
+    size_t missing = 0;
+    for (uint64_t k : keys) {
+      missing += !filter.contains(k);
+    }
+    CHECK(missing == 0);
+  }
+
+  // Small keys, close together, as well.
+  for (size_t n : {1, 2}) {
+    std::vector<uint64_t> keys;
+    for (uint64_t k = 0; k < n; k++) {
+      keys.push_back(k);
+    }
+    BinaryFuseFilter filter;
+    CHECK(filter.build(keys));
+    for (uint64_t k : keys) {
+      CHECK(filter.contains(k));
+    }
+  }
+
+  BinaryFuseFilter empty;
+  CHECK(empty.build({}));
+  CHECK(!empty.contains(uint64_t(0)));
+}
+
+static void check_duplicates(std::mt19937_64 &rng) {
+  // One key many times, and a set where every key is there up to four times.
+  BinaryFuseFilter single;
+  CHECK(single.build(std::vector<uint64_t>(50, 42)));
+  CHECK(single.size() == 1);
+  CHECK(single.contains(uint64_t(42)));
+
+  std::vector<uint64_t> unique(500), keys;
+  for (uint64_t &k : unique) {
+    k = rng();
+    for (uint64_t c = 0; c <= rng() % 4; c++) {
+      keys.push_back(k);
+    }
+  }
+  std::shuffle(keys.begin(), keys.end(), rng);
+  BinaryFuseFilter filter;
+  CHECK(filter.build(keys));
+  CHECK(filter.size() == unique.size());
+  for (uint64_t k : unique) {
+    CHECK(filter.contains(k));
+  }
+}
+
+static void check_false_positive_rate(std::mt19937_64 &rng) {
+  std::vector<uint64_t> keys(20000);
+  for (uint64_t &k : keys) {
+    k = rng();
+  }
+  BinaryFuseFilter filter;
+  CHECK(filter.build(keys));
+  // 1/256 of a million is 3906 with a standard deviation of 62.
+  const int probes = 1000000;
+  int positives = 0;
+  for (int i = 0; i < probes; i++) {
+    positives += filter.contains(rng());
+  }
+  double rate = double(positives) / probes;
+  CHECK(rate > 0.8 / 256 && rate < 1.2 / 256);
+  // About 9 bits per key.
+  CHECK(filter.size_bytes() * 8 < keys.size() * 10);
+}
+
+static void check_matcher(std::mt19937_64 &rng, const std::string &dir) {
+  std::vector<Digest> tracked;
+  ReportMatcher matcher;
+  for (uint32_t v = 0; v < 16; v++) {
+    tracked.push_back(random_digest(rng));
+    matcher.add(tracked.back(), IndexEntry{1, 0, uint8_t(v)});
+  }
+  std::vector<Report> reports;
+  for (uint32_t i = 0; i < 200; i++) {
+    Digest id = i % 10 == 0 ? tracked[i % tracked.size()] : random_digest(rng);
+    reports.push_back(make_report(id, 700000000 + int32_t(i), i));
+  }
+  std::string json;
+  write_report_results(reports, json);
+  std::string path = dir + "/reports.json";
+  CHECK(write_file_atomic(path, json.data(), json.size()));
+
+  // Before build() the filter holds nothing and would drop every report.
+  std::vector<Report> out;
+  std::string error;
+  CHECK(!matcher.built());
+  CHECK(!matcher.match_file(path, out, &error));
+  CHECK(!error.empty());
+  CHECK(out.empty());
+
+  CHECK(matcher.build());
+  CHECK(matcher.match_file(path, out, &error));
+  CHECK(out.size() == 20);
+  for (const Report &r : out) {
+    CHECK(std::find(tracked.begin(), tracked.end(), r.id) != tracked.end());
+  }
+
+  // A digest added later invalidates the filter until the next build().
+  matcher.add(reports[1].id, IndexEntry{2, 0, 0});
+  CHECK(!matcher.built());
+  CHECK(!matcher.match_file(path, out, &error));
+  CHECK(matcher.build());
+  out.clear();
+  CHECK(matcher.match_file(path, out, &error));
+  CHECK(out.size() == 21);
+
+  // Without the prefilter the index alone needs no build().
+  ReportMatcher plain;
+  plain.set_prefilter(false);
+  plain.add(tracked[0], IndexEntry{1, 0, 0});
+  out.clear();
+  CHECK(plain.match_file(path, out, &error));
+  // Reports 0, 80 and 160.
+  CHECK(out.size() == 3);
+}
+
+int main() {
+  char tmpl[] = "/tmp/sendmy-test-report-matcher-XXXXXX";
+  const char *dir = mkdtemp(tmpl);
+  if (!dir) {
+    perror("mkdtemp");
+    return 1;
+  }
+  std::mt19937_64 rng(1);
+  check_no_false_negatives(rng);
+  check_duplicates(rng);
+  check_false_positive_rate(rng);
+  check_matcher(rng, dir);
+  std::filesystem::remove_all(dir);
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,308 @@
+// Cross-checks the micro-ecc builds against the generic code paths. Every build of this program
+// runs the same deterministic inputs, for every curve it supports, through
+//
+//   - uECC_compute_public_key + uECC_compress + uECC_decompress, which must round-trip,
+//   - uECC_valid_compressed_public_key, which must agree with uECC_decompress followed by
+//     uECC_valid_public_key,
+//   - and, where uECC.c exports the VLI API, uECC_vli_modInv_vartime against uECC_vli_modInv and
+//     uECC_vli_jacobi_vartime against Euler's criterion, modulo every curve's p and n.
+//
+// The results are written to a file (--write) or compared with one (--expect). ctest has the stock
+// multi-curve build with the original constant-time routines and no assembly write the reference,
+// and compares the specialized, MULX-less and 32- and 8-bit word builds with it. Decompressed points
+// are only recorded for x on the curve: the square root of a non-residue is not specified.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "uECC.h"
+#include "uECC_vli.h"
+
+static int failures = 0;
+
+#define CHECK(cond)                                                              \
+  do {                                                                           \
+    if (!(cond)) {                                                               \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);  \
+      failures++;                                                                \
+    }                                                                            \
+  } while (0)
+
+struct CurveEntry {
+  const char *name;
+  uECC_Curve curve;
+};
+
+static std::vector<CurveEntry> supported_curves() {
+  std::vector<CurveEntry> curves;
+#if uECC_SUPPORTS_secp160r1
+  curves.push_back({"secp160r1", uECC_secp160r1()});
+#endif
+#if uECC_SUPPORTS_secp192r1
+  curves.push_back({"secp192r1", uECC_secp192r1()});
+#endif
+#if uECC_SUPPORTS_secp224r1
+  curves.push_back({"secp224r1", uECC_secp224r1()});
+#endif
+#if uECC_SUPPORTS_secp256r1
+  curves.push_back({"secp256r1", uECC_secp256r1()});
+#endif
+#if uECC_SUPPORTS_secp256k1
+  curves.push_back({"secp256k1", uECC_secp256k1()});
+#endif
+  return curves;
+}
+
+static std::string hex(const uint8_t *bytes, size_t size) {
+  static const char digits[] = "0123456789abcdef";
+  std::string out;
+  for (size_t i = 0; i < size; i++) {
+    out += digits[bytes[i] >> 4];
+    out += digits[bytes[i] & 15];
+  }
+  return out;
+}
+
+// Result lines, "<curve> <check> <case> <value>".
+static std::vector<std::string> results;
+
+static void record(const char *curve, const char *check, size_t index, const std::string &value) {
+  results.push_back(std::string(curve) + " " + check + " " + std::to_string(index) + " " + value);
+}
+
+static void check_public_keys(const CurveEntry &c, size_t count) {
+  int priv_size = uECC_curve_private_key_size(c.curve);
+  int pub_size = uECC_curve_public_key_size(c.curve);
+  std::mt19937_64 rng(1);
+  std::vector<uint8_t> priv(priv_size), pub(pub_size), back(pub_size), compressed(pub_size / 2 + 1);
+  for (size_t i = 0; i < count; i++) {
+    for (uint8_t &b : priv) {
+      b = uint8_t(rng());
+    }
+    if (priv_size > pub_size / 2) {
+      // secp160r1: n is just above 2^160, keep the keys below it.
+      priv[0] = 0;
+    }
+    if (!uECC_compute_public_key(priv.data(), pub.data(), c.curve)) {
+      record(c.name, "pub", i, "invalid");
+      continue;
+    }
+    record(c.name, "pub", i, hex(pub.data(), pub.size()));
+    CHECK(uECC_valid_public_key(pub.data(), c.curve));
+    uECC_compress(pub.data(), compressed.data(), c.curve);
+    CHECK(uECC_valid_compressed_public_key(compressed.data(), c.curve));
+    uECC_decompress(compressed.data(), back.data(), c.curve);
+    CHECK(back == pub);
+  }
+}
+
+static void check_compressed_keys(const CurveEntry &c, size_t count) {
+  int pub_size = uECC_curve_public_key_size(c.curve);
+  std::mt19937_64 rng(2);
+  std::vector<uint8_t> compressed(pub_size / 2 + 1), point(pub_size);
+  for (size_t i = 0; i < count; i++) {
+    compressed[0] = uint8_t(0x02 | (rng() & 1));
+    for (size_t j = 1; j < compressed.size(); j++) {
+      compressed[j] = uint8_t(rng());
+    }
+    int valid = uECC_valid_compressed_public_key(compressed.data(), c.curve);
+    uECC_decompress(compressed.data(), point.data(), c.curve);
+    CHECK(valid == uECC_valid_public_key(point.data(), c.curve));
+    record(c.name, "decompress", i, valid ? hex(point.data(), point.size()) : "none");
+  }
+}
+
+#if uECC_ENABLE_VLI_API
+
+static const int kMaxWords = 32 / uECC_WORD_SIZE;
+
+struct Modulus {
+  const char *name;
+  const uECC_word_t *mod;
+  wordcount_t num_words;
+  int num_bytes;
+};
+
+// A uniformly random value below mod, drawn bytewise so that every word size sees the same values.
+static void random_below(uECC_word_t *out, const Modulus &m, std::mt19937_64 &rng) {
+  uint8_t top[32], bytes[32];
+  uECC_vli_nativeToBytes(top, m.num_bytes, m.mod);
+  uint8_t mask = 0xff;
+  while ((mask >> 1) >= top[0]) {
+    mask >>= 1;
+  }
+  do {
+    for (int i = 0; i < m.num_bytes; i++) {
+      bytes[i] = uint8_t(rng());
+    }
+    bytes[0] &= mask;
+    uECC_vli_bytesToNative(out, bytes, m.num_bytes);
+  } while (uECC_vli_cmp(m.mod, out, m.num_words) != 1);
+}
+
+// Euler's criterion, input^((mod - 1) / 2) with the generic modular multiplication.
+static int euler_symbol(const uECC_word_t *input, const Modulus &m) {
+  uECC_word_t one[kMaxWords] = {1};
+  uECC_word_t exponent[kMaxWords], power[kMaxWords];
+  uECC_vli_sub(exponent, m.mod, one, m.num_words);
+  uECC_vli_rshift1(exponent, m.num_words);
+  uECC_vli_set(power, one, m.num_words);
+  for (bitcount_t bit = uECC_vli_numBits(exponent, m.num_words); bit-- > 0;) {
+    uECC_vli_modMult(power, power, power, m.mod, m.num_words);
+    if (uECC_vli_testBit(exponent, bit)) {
+      uECC_vli_modMult(power, power, input, m.mod, m.num_words);
+    }
+  }
+  if (uECC_vli_isZero(power, m.num_words)) {
+    return 0;
+  }
+  return uECC_vli_equal(power, one, m.num_words) ? 1 : -1;
+}
+
+static std::string native_hex(const uECC_word_t *value, const Modulus &m) {
+  uint8_t bytes[32];
+  uECC_vli_nativeToBytes(bytes, m.num_bytes, value);
+  return hex(bytes, m.num_bytes);
+}
+
+static void check_inverse(const char *curve, const Modulus &m, size_t count) {
+  std::mt19937_64 rng(3);
+  uECC_word_t input[kMaxWords], inverse[kMaxWords], product[kMaxWords];
+  uECC_word_t one[kMaxWords] = {1};
+  std::string check = std::string("inverse-") + m.name;
+  for (size_t i = 0; i < count; i++) {
+    random_below(input, m, rng);
+    uECC_vli_modInv(inverse, input, m.mod, m.num_words);
+    if (!uECC_vli_isZero(input, m.num_words)) {
+      uECC_vli_modMult(product, inverse, input, m.mod, m.num_words);
+      CHECK(uECC_vli_equal(product, one, m.num_words));
+    }
+#if uECC_VARTIME_PUBLIC
+    uECC_vli_modInv_vartime(product, input, m.mod, m.num_words);
+    CHECK(uECC_vli_equal(product, inverse, m.num_words));
+#endif
+    record(curve, check.c_str(), i, native_hex(inverse, m));
+  }
+}
+
+// Checks the Jacobi symbol on squares and on squares times a non-residue, whose symbols are known,
+// and on a few random values against Euler's criterion, which costs a full exponentiation.
+static void check_jacobi(const char *curve, const Modulus &m, size_t count, size_t euler_count) {
+  std::mt19937_64 rng(4);
+  uECC_word_t one[kMaxWords] = {1};
+  uECC_word_t non_residue[kMaxWords] = {2};
+  while (euler_symbol(non_residue, m) != -1) {
+    uECC_vli_add(non_residue, non_residue, one, m.num_words);
+  }
+  std::string check = std::string("jacobi-") + m.name;
+  uECC_word_t value[kMaxWords];
+  for (size_t i = 0; i < count; i++) {
+    random_below(value, m, rng);
+    int expected;
+    if (i < euler_count) {
+      expected = euler_symbol(value, m);
+    } else {
+      int zero = uECC_vli_isZero(value, m.num_words);
+      uECC_vli_modMult(value, value, value, m.mod, m.num_words);
+      expected = zero ? 0 : 1;
+      if (i & 1) {
+        uECC_vli_modMult(value, value, non_residue, m.mod, m.num_words);
+        expected = -expected;
+      }
+    }
+#if uECC_VARTIME_PUBLIC
+    CHECK(uECC_vli_jacobi_vartime(value, m.mod, m.num_words) == expected);
+#endif
+    record(curve, check.c_str(), i, native_hex(value, m) + ":" + std::to_string(expected));
+  }
+}
+
+static void check_vli(const CurveEntry &c) {
+  Modulus p = {"p", uECC_curve_p(c.curve), wordcount_t(uECC_curve_num_words(c.curve)),
+               int(uECC_curve_num_bytes(c.curve))};
+  Modulus n = {"n", uECC_curve_n(c.curve), wordcount_t(uECC_curve_num_n_words(c.curve)),
+               int(uECC_curve_num_n_bytes(c.curve))};
+  for (const Modulus &m : {p, n}) {
+    check_inverse(c.name, m, 2000);
+    check_jacobi(c.name, m, 2000, 20);
+  }
+}
+
+#endif // uECC_ENABLE_VLI_API
+
+static bool write_results(const char *path) {
+  std::ofstream out(path);
+  for (const std::string &line : results) {
+    out << line << '\n';
+  }
+  return bool(out);
+}
+
+static bool expect_results(const char *path) {
+  std::ifstream in(path);
+  if (!in) {
+    fprintf(stderr, "cannot read %s\n", path);
+    return false;
+  }
+  std::unordered_map<std::string, std::string> reference;
+  for (std::string line; std::getline(in, line);) {
+    size_t split = line.rfind(' ');
+    reference[line.substr(0, split)] = line.substr(split + 1);
+  }
+  size_t mismatches = 0;
+  for (const std::string &line : results) {
+    size_t split = line.rfind(' ');
+    auto it = reference.find(line.substr(0, split));
+    if (it == reference.end() || it->second != line.substr(split + 1)) {
+      if (mismatches++ < 10) {
+        fprintf(stderr, "differs from the reference: %s\n", line.c_str());
+      }
+    }
+  }
+  if (mismatches) {
+    fprintf(stderr, "%zu of %zu results differ from the reference\n", mismatches, results.size());
+  }
+  return mismatches == 0;
+}
+
+int main(int argc, char **argv) {
+  const char *write_path = nullptr;
+  const char *expect_path = nullptr;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--write")) {
+      write_path = argv[i + 1];
+    } else if (!strcmp(argv[i], "--expect")) {
+      expect_path = argv[i + 1];
+    } else {
+      fprintf(stderr, "usage: %s [--write FILE] [--expect FILE]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  for (const CurveEntry &c : supported_curves()) {
+    check_public_keys(c, 100);
+    check_compressed_keys(c, 2000);
+#if uECC_ENABLE_VLI_API
+    check_vli(c);
+#endif
+  }
+
+  if (write_path && !write_results(write_path)) {
+    fprintf(stderr, "cannot write %s\n", write_path);
+    failures++;
+  }
+  if (expect_path && !expect_results(expect_path)) {
+    failures++;
+  }
+  if (failures) {
+    fprintf(stderr, "%d checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
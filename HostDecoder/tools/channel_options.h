@@ -0,0 +1,59 @@
+// Command line options shared by the tools that simulate the finder crowd (see channel_sim.h).
+
+#ifndef SENDMY_TOOLS_CHANNEL_OPTIONS_H
+#define SENDMY_TOOLS_CHANNEL_OPTIONS_H
+
+#include <cstdlib>
+#include <cstring>
+
+#include "channel_sim.h"
+
+namespace sendmy {
+
+class ChannelOptions {
+ public:
+  static constexpr const char *kUsage =
+      "  channel: [--finders-per-hour R] [--dwell-s S] [--pickup P] [--report-interval-s S]\n"
+      "           [--duplicate P] [--delay-median-s S] [--delay-sigma S]\n";
+
+  // Returns how many arguments starting at argv[i] were consumed, 0 if argv[i] is not a channel
+  // option and -1 if its value is missing.
+  int parse(int argc, char **argv, int i) {
+    static const struct {
+      const char *name;
+      double ChannelParams::*field;
+    } options[] = {
+        {"--finders-per-hour", &ChannelParams::finders_per_hour},
+        {"--dwell-s", &ChannelParams::dwell_s},
+        {"--pickup", &ChannelParams::pickup},
+        {"--report-interval-s", &ChannelParams::report_interval_s},
+        {"--duplicate", &ChannelParams::duplicate},
+        {"--delay-median-s", &ChannelParams::delay_median_s},
+        {"--delay-sigma", &ChannelParams::delay_sigma},
+    };
+    for (const auto &o : options) {
+      if (!strcmp(argv[i], o.name)) {
+        if (i + 1 >= argc) {
+          return -1;
+        }
+        params_.*o.field = strtod(argv[i + 1], nullptr);
+        return 2;
+      }
+    }
+    return 0;
+  }
+
+  bool valid() const {
+    return params_.finders_per_hour >= 0 && params_.dwell_s > 0 && params_.pickup >= 0 && params_.pickup <= 1 &&
+           params_.duplicate >= 0 && params_.duplicate < 1 && params_.delay_sigma >= 0;
+  }
+
+  const ChannelParams &params() const { return params_; }
+
+ private:
+  ChannelParams params_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_TOOLS_CHANNEL_OPTIONS_H
@@ -0,0 +1,447 @@
+// Searches the modem's transmit profile (chunk length, repetitions, dwell per key and advertising
+// interval) for the one that gets a mix of message sizes through a finder crowd fastest.
+//
+//   sendmy-autotune [--payload-sizes 16] [--chunk-lens 1-8] [--repetitions 1,3,10,30,100]
+//                   [--dwell-ms 20,100,500] [--adv-interval-ms 100,1000] [--trials 4] [--rounds 3]
+//                   [--keep 0.33] [--horizon-h 24] [--rtt-ms 150] [--decoder-keys-per-s N]
+//                   [--modem cafe0000] [--seed N] <channel>
+//
+// --payload-sizes is the distribution of message lengths, LEN[:WEIGHT],... (e.g. 8:6,32:3,100:1).
+// The channel options describe the finder crowd of channel_sim.h, simulated or fitted to reports
+// of real devices.
+//
+// Every trial runs the firmware's modem core (main/modem.c with the host stand-ins of
+// Firmware/ESP32/host) with the profile on a random message, puts its advertisements through the
+// crowd and finds the earliest datePublished at which the reports decode the message, like
+// sendmy-sim-channel does. Trial n gets the same message and channel seed under every profile.
+// A trial that doesn't decode within --horizon-h counts as the whole horizon.
+//
+// The decoder's side is added to that: decode_message() makes one round trip per chunk, plus one
+// to find the end, and generates 2^chunk_len candidate keys for each. That costs
+// chunks * (--rtt-ms + 2^chunk_len / keys_per_s), with the key rate measured on this host unless
+// --decoder-keys-per-s gives the decoder machine's.
+//
+// The search is successive halving: every round runs all profiles still in the race for twice
+// the trials of the round before and keeps the --keep best. The profiles of the last round go to
+// stdout as CSV, best first, and the winner to stderr in the form the firmware's /profile
+// endpoint takes. With --decoder-keys-per-s the output only depends on the arguments.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "adv_capture.h"
+#include "channel_options.h"
+#include "channel_sim.h"
+#include "message_decoder.h"
+#include "report_source.h"
+
+extern "C" {
+#include "freertos/task.h"
+#include "gap_pcap.h"
+#include "modem.h"
+}
+
+using namespace sendmy;
+
+namespace {
+
+constexpr int64_t kEpochMs = 1700000000000;
+// The firmware takes messages of up to 100 bytes.
+constexpr uint32_t kMaxMessageLen = 100;
+
+struct SizeClass {
+  uint32_t len;
+  double weight;
+};
+
+struct TrialResult {
+  bool decoded = false;
+  // Time to decode, the horizon if the trial failed.
+  double ttd_s = 0;
+};
+
+struct Contender {
+  modem_profile_t profile;
+  // Per size class, one entry per trial run so far.
+  std::vector<std::vector<TrialResult>> trials;
+  double decoded = 0;
+  double ttd_s = 0;
+  double decoder_s = 0;
+  double airtime_s = 0;
+  double cost_s = 0;
+  // Advertising events per message, the power the profile takes.
+  double events = 0;
+};
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--payload-sizes LEN[:WEIGHT],...] [--chunk-lens LIST] [--repetitions LIST]\n"
+          "          [--dwell-ms LIST] [--adv-interval-ms LIST] [--trials N] [--rounds N] [--keep F]\n"
+          "          [--horizon-h H] [--rtt-ms MS] [--decoder-keys-per-s N] [--modem <hex id>] [--seed N]\n"
+          "          <channel>\n"
+          "  LIST: values and ranges, e.g. 1-8 or 1,3,10\n%s",
+          argv0, ChannelOptions::kUsage);
+}
+
+bool parse_list(const char *s, std::vector<uint32_t> &out) {
+  out.clear();
+  while (*s) {
+    char *end;
+    uint32_t first = uint32_t(strtoul(s, &end, 10));
+    uint32_t last = first;
+    if (end == s) {
+      return false;
+    }
+    if (*end == '-') {
+      s = end + 1;
+      last = uint32_t(strtoul(s, &end, 10));
+      if (end == s || last < first) {
+        return false;
+      }
+    }
+    for (uint32_t v = first; v <= last; v++) {
+      out.push_back(v);
+    }
+    if (*end == ',') {
+      end++;
+    } else if (*end) {
+      return false;
+    }
+    s = end;
+  }
+  return !out.empty();
+}
+
+bool parse_sizes(const char *s, std::vector<SizeClass> &out) {
+  out.clear();
+  while (*s) {
+    char *end;
+    SizeClass c{uint32_t(strtoul(s, &end, 10)), 1};
+    if (end == s || c.len == 0 || c.len > kMaxMessageLen) {
+      return false;
+    }
+    if (*end == ':') {
+      s = end + 1;
+      c.weight = strtod(s, &end);
+      if (end == s || !(c.weight > 0)) {
+        return false;
+      }
+    }
+    out.push_back(c);
+    if (*end == ',') {
+      end++;
+    } else if (*end) {
+      return false;
+    }
+    s = end;
+  }
+  return !out.empty();
+}
+
+void collect_frame(void *ctx, uint64_t t_us, const uint8_t *frame, size_t len) {
+  add_adv_frame(*static_cast<AdvCapture *>(ctx), int64_t(t_us), frame, len);
+}
+
+uint32_t chunk_count(uint32_t len, uint32_t chunk_len) { return (len * 8 + chunk_len - 1) / chunk_len; }
+
+// Runs the modem core with profile on message, from kEpochMs on. Repetitions that would start
+// after horizon_ms can't be reported in time and are left out.
+void transmit(const modem_profile_t &profile, std::vector<uint8_t> &message, uint32_t advdelay_seed,
+              int64_t horizon_ms, AdvCapture &capture) {
+  host_reset_tick_count();
+  modem_set_profile(&profile);
+  gap_pcap_seed(advdelay_seed);
+  gap_pcap_set_sink(collect_frame, &capture, uint64_t(kEpochMs) * 1000);
+  for (uint32_t r = 0; r < profile.repetitions; r++) {
+    if (kEpochMs + int64_t(xTaskGetTickCount()) * portTICK_PERIOD_MS >= horizon_ms) {
+      break;
+    }
+    send_data_once_blocking(message.data(), uint32_t(message.size()), profile.chunk_len, 0);
+  }
+  gap_pcap_set_sink(nullptr, nullptr, 0);
+}
+
+bool decodes(const std::vector<Report> &reports, const MessageParams &params, int64_t end_ms,
+             const std::vector<uint8_t> &message) {
+  DumpSource source;
+  source.add(reports);
+  std::vector<uint8_t> out = decode_message(source, params, 0, end_ms, nullptr);
+  // The modem sends the last byte first; compare from the end.
+  return out.size() >= message.size() && std::equal(message.rbegin(), message.rend(), out.rbegin());
+}
+
+TrialResult run_trial(const modem_profile_t &profile, uint32_t modem, uint32_t len, uint64_t seed,
+                      const ChannelParams &channel, double horizon_h) {
+  std::mt19937_64 rng(seed);
+  std::vector<uint8_t> message(len);
+  for (uint8_t &b : message) {
+    b = uint8_t(' ' + rng() % 95);
+  }
+  int64_t horizon_ms = kEpochMs + int64_t(horizon_h * 3600e3);
+  AdvCapture capture;
+  transmit(profile, message, uint32_t(rng()), horizon_ms, capture);
+
+  std::vector<Report> reports;
+  simulate_channel(capture, channel, rng(), reports);
+  reports.resize(size_t(std::lower_bound(reports.begin(), reports.end(), horizon_ms,
+                                         [](const Report &r, int64_t ms) { return r.date_published_ms < ms; }) -
+                        reports.begin()));
+
+  // Nothing decodes before every key has a report; usually that is also when it does.
+  std::vector<int64_t> first(capture.keys.size(), INT64_MAX);
+  for (const Report &r : reports) {
+    auto it = capture.index.find(r.id);
+    if (it != capture.index.end()) {
+      first[it->second] = std::min(first[it->second], r.date_published_ms);
+    }
+  }
+  int64_t cutoff_ms = first.empty() ? horizon_ms : *std::max_element(first.begin(), first.end());
+  cutoff_ms = std::min(cutoff_ms, horizon_ms);
+
+  MessageParams params;
+  params.modem_id = modem;
+  params.chunk_len = profile.chunk_len;
+  TrialResult result;
+  result.ttd_s = horizon_h * 3600;
+  if (!decodes(reports, params, cutoff_ms + 1, message)) {
+    if (cutoff_ms == horizon_ms || !decodes(reports, params, horizon_ms, message)) {
+      return result;
+    }
+    // A bad vote needed more reports: search the later ones.
+    size_t lo = size_t(std::upper_bound(reports.begin(), reports.end(), cutoff_ms,
+                                        [](int64_t ms, const Report &r) { return ms < r.date_published_ms; }) -
+                       reports.begin());
+    size_t hi = reports.size() - 1;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo) / 2;
+      if (decodes(reports, params, reports[mid].date_published_ms + 1, message)) {
+        hi = mid;
+      } else {
+        lo = mid + 1;
+      }
+    }
+    cutoff_ms = reports[lo].date_published_ms;
+  }
+  result.decoded = true;
+  result.ttd_s = double(cutoff_ms - kEpochMs) / 1000;
+  return result;
+}
+
+// Contender keys per second decode_message() generates on this host, from lossless decodes of a
+// message at the largest chunk length.
+double measure_keys_per_s(uint32_t modem) {
+  modem_profile_t profile = MODEM_PROFILE_DEFAULT;
+  profile.chunk_len = kMaxChunkLen;
+  profile.repetitions = 1;
+  std::vector<uint8_t> message(16, 'x');
+  AdvCapture capture;
+  transmit(profile, message, 1, INT64_MAX, capture);
+  std::vector<Report> reports;
+  ideal_channel(capture, reports);
+  MessageParams params;
+  params.modem_id = modem;
+  params.chunk_len = kMaxChunkLen;
+
+  uint64_t keys = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  double s = 0;
+  do {
+    decodes(reports, params, INT64_MAX, message);
+    keys += uint64_t(chunk_count(uint32_t(message.size()), kMaxChunkLen) + 1) << kMaxChunkLen;
+    s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  } while (s < 0.5);
+  return double(keys) / s;
+}
+
+void score(Contender &c, const std::vector<SizeClass> &sizes, double rtt_s, double keys_per_s) {
+  const modem_profile_t &p = c.profile;
+  double total_weight = 0;
+  c.decoded = c.ttd_s = c.decoder_s = c.airtime_s = c.cost_s = c.events = 0;
+  // Events per key and repetition: the first starts with the advertisement, the next one interval
+  // plus 5 ms of advDelay on average later.
+  double events_per_key = 1 + std::floor(std::max(0.0, double(p.dwell_ms) - 1) / (p.adv_interval_ms + 5.0));
+  for (size_t s = 0; s < sizes.size(); s++) {
+    const std::vector<TrialResult> &trials = c.trials[s];
+    double w = sizes[s].weight;
+    uint32_t chunks = chunk_count(sizes[s].len, p.chunk_len);
+    double decoded = 0, ttd = 0;
+    for (const TrialResult &t : trials) {
+      decoded += t.decoded ? 1 : 0;
+      ttd += t.ttd_s;
+    }
+    decoded /= double(trials.size());
+    ttd /= double(trials.size());
+    double decoder = (chunks + 1) * (rtt_s + double(1u << p.chunk_len) / keys_per_s);
+    c.decoded += w * decoded;
+    c.ttd_s += w * ttd;
+    c.decoder_s += w * decoder;
+    c.airtime_s += w * double(p.repetitions) * chunks * p.dwell_ms / 1000;
+    c.events += w * double(p.repetitions) * chunks * events_per_key;
+    total_weight += w;
+  }
+  c.decoded /= total_weight;
+  c.ttd_s /= total_weight;
+  c.decoder_s /= total_weight;
+  c.airtime_s /= total_weight;
+  c.events /= total_weight;
+  c.cost_s = c.ttd_s + c.decoder_s;
+}
+
+// Cheapest first; among equals the one that advertises least, then the one with the longer interval.
+bool better(const Contender &a, const Contender &b) {
+  if (a.cost_s != b.cost_s) {
+    return a.cost_s < b.cost_s;
+  }
+  if (a.events != b.events) {
+    return a.events < b.events;
+  }
+  return a.profile.adv_interval_ms > b.profile.adv_interval_ms;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  ChannelOptions channel;
+  std::vector<SizeClass> sizes = {{16, 1}};
+  std::vector<uint32_t> chunk_lens = {1, 2, 3, 4, 5, 6, 7, 8};
+  std::vector<uint32_t> repetitions = {1, 3, 10, 30, 100};
+  std::vector<uint32_t> dwells = {20, 100, 500};
+  std::vector<uint32_t> intervals = {100, 1000};
+  uint32_t trials = 4;
+  uint32_t rounds = 3;
+  double keep = 0.33;
+  double horizon_h = 24;
+  double rtt_ms = 150;
+  double keys_per_s = 0;
+  uint32_t modem = 0xcafe0000;
+  uint64_t seed = 1;
+
+  for (int i = 1; i < argc; i += 2) {
+    int used = channel.parse(argc, argv, i);
+    if (used > 0) {
+      continue;
+    }
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    bool ok = true;
+    if (!strcmp(arg, "--payload-sizes")) {
+      ok = parse_sizes(val, sizes);
+    } else if (!strcmp(arg, "--chunk-lens")) {
+      ok = parse_list(val, chunk_lens);
+    } else if (!strcmp(arg, "--repetitions")) {
+      ok = parse_list(val, repetitions);
+    } else if (!strcmp(arg, "--dwell-ms")) {
+      ok = parse_list(val, dwells);
+    } else if (!strcmp(arg, "--adv-interval-ms")) {
+      ok = parse_list(val, intervals);
+    } else if (!strcmp(arg, "--trials")) {
+      trials = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--rounds")) {
+      rounds = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--keep")) {
+      keep = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--horizon-h")) {
+      horizon_h = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--rtt-ms")) {
+      rtt_ms = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--decoder-keys-per-s")) {
+      keys_per_s = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--modem")) {
+      modem = uint32_t(strtoul(val, nullptr, 16));
+    } else if (!strcmp(arg, "--seed")) {
+      seed = strtoull(val, nullptr, 10);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (trials == 0 || rounds == 0 || !(keep > 0 && keep <= 1) || !(horizon_h > 0) || rtt_ms < 0 ||
+      keys_per_s < 0 || !channel.valid()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  std::vector<Contender> race;
+  for (uint32_t c : chunk_lens) {
+    for (uint32_t r : repetitions) {
+      for (uint32_t d : dwells) {
+        for (uint32_t a : intervals) {
+          Contender cand;
+          cand.profile = {c, r, d, a};
+          // The firmware's own range check.
+          if (modem_set_profile(&cand.profile) != ESP_OK) {
+            fprintf(stderr, "profile out of range: chunk_len %" PRIu32 ", %" PRIu32 " repetitions, dwell %" PRIu32
+                            " ms, interval %" PRIu32 " ms\n",
+                    c, r, d, a);
+            return 2;
+          }
+          cand.trials.resize(sizes.size());
+          race.push_back(cand);
+        }
+      }
+    }
+  }
+  if (keys_per_s == 0) {
+    keys_per_s = measure_keys_per_s(modem);
+    fprintf(stderr, "decoder generates %.0f keys/s on this host\n", keys_per_s);
+  }
+
+  auto t0 = std::chrono::steady_clock::now();
+  uint32_t have = 0;
+  for (uint32_t round = 0; round < rounds; round++) {
+    uint32_t want = trials << round;
+    for (Contender &c : race) {
+      for (size_t s = 0; s < sizes.size(); s++) {
+        for (uint32_t t = have; t < want; t++) {
+          c.trials[s].push_back(
+              run_trial(c.profile, modem, sizes[s].len, seed + (uint64_t(s) << 32) + t, channel.params(), horizon_h));
+        }
+      }
+      score(c, sizes, rtt_ms / 1000, keys_per_s);
+    }
+    have = want;
+    std::sort(race.begin(), race.end(), better);
+    const Contender &best = race.front();
+    fprintf(stderr,
+            "round %" PRIu32 ": %zu profiles, %" PRIu32 " trials each, %.1f s; best chunk_len %" PRIu32
+            ", %" PRIu32 " repetitions, dwell %" PRIu32 " ms, interval %" PRIu32 " ms: %.0f s\n",
+            round + 1, race.size(), want, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count(),
+            best.profile.chunk_len, best.profile.repetitions, best.profile.dwell_ms, best.profile.adv_interval_ms,
+            best.cost_s);
+    if (round + 1 < rounds) {
+      race.resize(std::max<size_t>(1, size_t(std::ceil(double(race.size()) * keep))));
+    }
+  }
+
+  printf("rank,chunk_len,repetitions,dwell_ms,adv_interval_ms,trials,decoded,time_to_decode_s,decoder_s,airtime_s,"
+         "events,expected_s\n");
+  for (size_t i = 0; i < race.size(); i++) {
+    const Contender &c = race[i];
+    printf("%zu,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%.3f,%.1f,%.2f,%.1f,%.0f,%.1f\n", i + 1,
+           c.profile.chunk_len, c.profile.repetitions, c.profile.dwell_ms, c.profile.adv_interval_ms, have, c.decoded,
+           c.ttd_s, c.decoder_s, c.airtime_s, c.events, c.cost_s);
+  }
+  const modem_profile_t &p = race.front().profile;
+  fprintf(stderr,
+          "best profile, %.0f s expected (%.0f%% decoded within %.1f h); set it with\n"
+          "  curl --data 'chunk_len=%" PRIu32 "&repetitions=%" PRIu32 "&dwell_ms=%" PRIu32 "&adv_interval_ms=%" PRIu32
+          "' http://<modem>/profile\n",
+          race.front().cost_s, 100 * race.front().decoded, horizon_h, p.chunk_len, p.repetitions, p.dwell_ms,
+          p.adv_interval_ms);
+  return 0;
+}
@@ -0,0 +1,85 @@
+// Times the micro-ecc operations the firmware and the decoder run, on the host:
+// is_valid_pubkey (uECC_valid_compressed_public_key) for every candidate key counter, the
+// uECC_decompress + uECC_valid_public_key it replaced, and uECC_compute_public_key + uECC_compress.
+//
+//   sendmy-bench-ecc [--keys 20000] [--privs 500]
+//
+// sendmy-bench-ecc links the uECC build the decoder uses, sendmy-bench-ecc-generic the stock
+// multi-curve build with function pointer dispatch, for comparison.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "uECC.h"
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+int main(int argc, char **argv) {
+  size_t keys = 20000;
+  size_t privs = 500;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (!strcmp(argv[i], "--keys")) {
+      keys = strtoul(argv[i + 1], nullptr, 10);
+    } else if (!strcmp(argv[i], "--privs")) {
+      privs = strtoul(argv[i + 1], nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--keys N] [--privs N]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  const struct uECC_Curve_t *curve = uECC_secp224r1();
+  std::mt19937_64 rng(1);
+  std::vector<uint8_t> xs(keys * 28);
+  for (uint8_t &b : xs) {
+    b = uint8_t(rng());
+  }
+
+  // Same as is_valid_pubkey() in the firmware: a Jacobi symbol, no square root.
+  size_t valid = 0;
+  uint8_t compressed[29];
+  uint8_t point[56];
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < keys; i++) {
+    compressed[0] = 0x02;
+    memcpy(compressed + 1, &xs[i * 28], 28);
+    valid += uECC_valid_compressed_public_key(compressed, curve);
+  }
+  double s = seconds_since(t0);
+  printf("is_valid_pubkey:         %8.2f us/op  (%zu of %zu valid)\n", s / double(keys) * 1e6, valid, keys);
+
+  // The full decompression, which the old check ran.
+  valid = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < keys; i++) {
+    compressed[0] = 0x02;
+    memcpy(compressed + 1, &xs[i * 28], 28);
+    uECC_decompress(compressed, point, curve);
+    valid += uECC_valid_public_key(point, curve);
+  }
+  s = seconds_since(t0);
+  printf("decompress + validate:   %8.2f us/op  (%zu of %zu valid)\n", s / double(keys) * 1e6, valid, keys);
+
+  uint8_t priv[28];
+  uint8_t pub[56];
+  uint8_t checksum = 0;
+  t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < privs; i++) {
+    for (uint8_t &b : priv) {
+      b = uint8_t(rng());
+    }
+    priv[0] &= 0x7f;
+    uECC_compute_public_key(priv, pub, curve);
+    uECC_compress(pub, compressed, curve);
+    checksum ^= compressed[1];
+  }
+  s = seconds_since(t0);
+  printf("compute_public_key:      %8.2f us/op  (checksum %02x)\n", s / double(privs) * 1e6, checksum);
+  return 0;
+}
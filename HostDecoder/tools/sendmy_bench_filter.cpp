@@ -0,0 +1,128 @@
+// Measures how fast bulk report dumps are matched against the candidate digests of many tracked
+// messages, with and without the binary fuse prefilter, on one core.
+//
+//   sendmy-bench-filter [--messages 2000] [--reports 1000000] [--match-rate 0.001] [--passes 5]
+//                       [--dump reports.json]
+//
+// Digests are uniformly distributed, so random ones stand in for real candidates and report ids.
+// With --dump the reports of a real FindMyReportResults file are parsed and matched as well.
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "report_matcher.h"
+
+using namespace sendmy;
+
+static double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+static Digest random_digest(std::mt19937_64 &rng) {
+  Digest d;
+  for (size_t i = 0; i < kDigestLen; i += 8) {
+    uint64_t v = rng();
+    memcpy(d.data() + i, &v, 8);
+  }
+  return d;
+}
+
+int main(int argc, char **argv) {
+  uint32_t messages = 2000;
+  uint32_t per_message = 16;
+  size_t report_count = 1000000;
+  double match_rate = 0.001;
+  int passes = 5;
+  std::string dump;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const char *arg = argv[i];
+    const char *val = argv[i + 1];
+    if (!strcmp(arg, "--messages")) {
+      messages = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--reports")) {
+      report_count = strtoul(val, nullptr, 10);
+    } else if (!strcmp(arg, "--match-rate")) {
+      match_rate = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--passes")) {
+      passes = atoi(val);
+    } else if (!strcmp(arg, "--dump")) {
+      dump = val;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--messages N] [--reports N] [--match-rate R] [--passes N] [--dump reports.json]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  // The pending chunk of every tracked message has 16 candidates (4 bit chunks).
+  std::mt19937_64 rng(1);
+  std::vector<Digest> candidates;
+  ReportMatcher matcher(size_t(messages) * per_message);
+  for (uint32_t m = 0; m < messages; m++) {
+    for (uint32_t v = 0; v < per_message; v++) {
+      candidates.push_back(random_digest(rng));
+      matcher.add(candidates.back(), IndexEntry{m, 0, uint8_t(v)});
+    }
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  if (!matcher.build()) {
+    fprintf(stderr, "filter construction failed\n");
+    return 1;
+  }
+  double build_s = seconds_since(t0);
+  const BinaryFuseFilter &filter = matcher.filter();
+  printf("%zu candidate digests: filter %zu bytes (%.2f bits/key), built in %.1f ms\n", filter.size(),
+         filter.size_bytes(), 8.0 * double(filter.size_bytes()) / double(filter.size()), build_s * 1e3);
+
+  std::vector<Report> reports(report_count);
+  std::uniform_real_distribution<double> coin(0, 1);
+  for (Report &r : reports) {
+    r.id = coin(rng) < match_rate ? candidates[rng() % candidates.size()] : random_digest(rng);
+  }
+
+  uint64_t sink = 0;
+  auto count = [&](const IndexEntry &e, const Report &) { sink += e.value; };
+  for (bool prefilter : {false, true}) {
+    ReportMatcher &m = matcher;
+    m.set_prefilter(prefilter);
+    MatchStats before = m.stats();
+    t0 = std::chrono::steady_clock::now();
+    for (int p = 0; p < passes; p++) {
+      for (const Report &r : reports) {
+        m.match(r, count);
+      }
+    }
+    double s = seconds_since(t0);
+    uint64_t n = m.stats().reports - before.reports;
+    uint64_t probed = m.stats().probed - before.probed;
+    uint64_t matched = m.stats().matched - before.matched;
+    printf("%-13s %6.1f M reports/s per core, %" PRIu64 " index lookups, %" PRIu64 " matches", 
+           prefilter ? "prefilter:" : "index only:", double(n) / s / 1e6, probed, matched);
+    if (prefilter) {
+      printf(", false positive rate %.4f", double(probed - matched) / double(n - matched));
+    }
+    printf("\n");
+  }
+
+  if (!dump.empty()) {
+    std::vector<Report> out;
+    std::string error;
+    uint64_t seen = matcher.stats().reports;
+    t0 = std::chrono::steady_clock::now();
+    if (!matcher.match_file(dump, out, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    double s = seconds_since(t0);
+    printf("%s: %" PRIu64 " reports parsed and matched at %.2f M reports/s, %zu matches\n", dump.c_str(),
+           matcher.stats().reports - seen, double(matcher.stats().reports - seen) / s / 1e6, out.size());
+  }
+  return sink == 42 ? 3 : 0;
+}
@@ -0,0 +1,185 @@
+// Decodes a Send My message from a FindMyReportResults dump or an acsnservice/fetch endpoint.
+//
+//   sendmy-decode --modem cafe0000 --chunk-len 4 --reports reports.json [--cache candidates.cache]
+//   sendmy-decode --modem cafe0000 --url http://127.0.0.1:8081/acsnservice/fetch --store reports.store
+//
+// --chunk-len has to be the chunk_len of the modem's transmit profile (default 4, see GET /profile
+// on the modem). A --modem <hex id>:<message>:<chunk len> line of sendmy-discover sets both for
+// that modem.
+//
+// With several --modem options the messages are decoded together, with their queries packed into
+// shared requests, and printed as "<modem>:<message>: <text>" lines. Candidate generation runs on
+// --threads threads (default one per core) while requests are in flight, and the utilization of
+// each stage is printed at the end.
+//
+// --stream additionally prints every byte as a JSON line as soon as it is final:
+//   {"modem":"cafe0000","offset_from_end":0,"byte":103,"confidence":1,"elapsed_ms":41}
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "beam_decoder.h"
+#include "message_decoder.h"
+#include "pipeline.h"
+#include "source_options.h"
+
+using namespace sendmy;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s --modem <hex id>[:message[:chunk len]]... [--chunk-len N] [--message N] [--from-ms T]\n"
+          "          [--to-ms T] [--beam WIDTH | --stream] [--threads N] [--query-slots N] <source>\n%s",
+          argv0, SourceOptions::kUsage);
+}
+
+// One --modem option; -1 for the message and chunk length means the general options apply.
+struct ModemOption {
+  uint32_t modem_id;
+  long message_id;
+  long chunk_len;
+};
+
+int main(int argc, char **argv) {
+  MessageParams params;
+  BeamParams beam;
+  PipelineParams pipeline;
+  beam.width = 1;
+  SourceOptions options;
+  std::vector<ModemOption> modems;
+  int64_t start_ms = 0;
+  int64_t end_ms = INT64_MAX;
+  bool stream = false;
+
+  for (int i = 1; i < argc;) {
+    int used = options.parse(argc, argv, i);
+    if (used > 0) {
+      i += used;
+      continue;
+    }
+    const char *arg = argv[i];
+    if (!strcmp(arg, "--stream")) {
+      stream = true;
+      i++;
+      continue;
+    }
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(arg, "--modem")) {
+      char *end;
+      ModemOption m{uint32_t(strtoul(val, &end, 16)), -1, -1};
+      if (*end == ':') {
+        m.message_id = long(strtoul(end + 1, &end, 10));
+      }
+      if (*end == ':') {
+        m.chunk_len = long(strtoul(end + 1, &end, 10));
+      }
+      modems.push_back(m);
+    } else if (!strcmp(arg, "--chunk-len")) {
+      params.chunk_len = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--message")) {
+      params.message_id = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--threads")) {
+      pipeline.generate_threads = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--query-slots")) {
+      pipeline.query_slots = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--beam")) {
+      beam.width = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--from-ms")) {
+      start_ms = strtoll(val, nullptr, 10);
+    } else if (!strcmp(arg, "--to-ms")) {
+      end_ms = strtoll(val, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i += 2;
+  }
+  bool lens_valid = params.chunk_len >= 1 && params.chunk_len <= kMaxChunkLen;
+  for (const ModemOption &m : modems) {
+    lens_valid = lens_valid && (m.chunk_len == -1 || (m.chunk_len >= 1 && m.chunk_len <= long(kMaxChunkLen)));
+  }
+  if (modems.empty() || !options.valid() || !lens_valid || (beam.width > 1 && (modems.size() > 1 || stream))) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  if (!options.open(pipeline.max_ids_per_request)) {
+    return 1;
+  }
+  ReportSource &source = options.source();
+  CandidateCache *cache = options.cache();
+
+  auto t0 = std::chrono::steady_clock::now();
+  auto print_byte = [&](uint32_t modem, const DecodedByte &b) {
+    long long elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - t0).count();
+    printf("{\"modem\":\"%08" PRIx32 "\",\"offset_from_end\":%zu,\"byte\":%u,\"confidence\":%.3g,"
+           "\"elapsed_ms\":%lld}\n",
+           modem, b.offset_from_end, b.value, double(b.confidence), elapsed);
+    fflush(stdout);
+  };
+
+  std::vector<uint8_t> message;
+  Pipeline fleet(source, pipeline);
+  fleet.set_cache(cache);
+  fleet.set_checkpoints(options.checkpoints());
+  if (stream) {
+    fleet.set_byte_callback(
+        [&](uint32_t h, const DecodedByte &b) { print_byte(fleet.decoder(h).params().modem_id, b); });
+  }
+  if (modems.size() > 1) {
+    for (const ModemOption &m : modems) {
+      MessageParams p = params;
+      p.modem_id = m.modem_id;
+      p.message_id = m.message_id >= 0 ? uint32_t(m.message_id) : params.message_id;
+      p.chunk_len = m.chunk_len >= 0 ? uint32_t(m.chunk_len) : params.chunk_len;
+      fleet.add(p);
+    }
+    if (!fleet.run(start_ms, end_ms)) {
+      fprintf(stderr, "query failed\n");
+    }
+    fprintf(stderr, "%zu messages: %" PRIu64 " ids in %" PRIu64 " requests\n", fleet.size(), fleet.ids_queried(),
+            fleet.requests());
+    for (const StageStats &s : fleet.stage_stats()) {
+      fprintf(stderr, "stage %-8s %8" PRIu64 " items, %9.1f ms busy, %5.1f%% of %u worker(s)\n", s.name, s.items,
+              s.busy_ms, 100 * s.utilization, s.workers);
+    }
+  } else {
+    params.modem_id = modems[0].modem_id;
+    if (modems[0].message_id >= 0) {
+      params.message_id = uint32_t(modems[0].message_id);
+    }
+    if (modems[0].chunk_len >= 0) {
+      params.chunk_len = uint32_t(modems[0].chunk_len);
+    }
+    message = beam.width > 1 ? decode_message_beam(source, params, beam, start_ms, end_ms, cache)
+                             : decode_message(source, params, start_ms, end_ms, cache,
+                                              stream ? ByteCallback([&](const DecodedByte &b) {
+                                                print_byte(params.modem_id, b);
+                                              })
+                                                     : ByteCallback(),
+                                              options.checkpoints());
+  }
+  options.report();
+
+  for (uint32_t h = 0; h < fleet.size(); h++) {
+    const MessageDecoder &d = fleet.decoder(h);
+    std::vector<uint8_t> text = d.message();
+    printf("%08" PRIx32 ":%" PRIu32 ": ", d.params().modem_id, d.params().message_id);
+    fwrite(text.data(), 1, text.size(), stdout);
+    fputc('\n', stdout);
+  }
+  if (fleet.size() == 0) {
+    fwrite(message.data(), 1, message.size(), stdout);
+    fputc('\n', stdout);
+  }
+  return 0;
+}
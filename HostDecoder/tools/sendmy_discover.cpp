@@ -0,0 +1,115 @@
+// Scans a range of modem ids for messages and prints the ones with reports.
+//
+//   sendmy-discover --from-modem cafe0000 --count 10000 --url http://127.0.0.1:8081/acsnservice/fetch
+//
+// Output lines are "<modem>:<message>:<chunk len> reports=<n> first=<unix s> last=<unix s>", ready to
+// be fed to sendmy-decode --modem. --chunk-len takes the chunk_len of the modems' transmit profile
+// (default 4), or a list like 4,6 when it is not known; every length costs 2^len keys per id. A first
+// chunk of 0 leaves the payload empty and has the same key at every length, so such a modem is
+// listed once per length.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "discovery.h"
+#include "report.h"
+#include "source_options.h"
+
+using namespace sendmy;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--from-modem <hex id>] [--count N] [--chunk-len N[,N...]] [--threads N] [--from-ms T]\n"
+          "          [--to-ms T] <source>\n%s",
+          argv0, SourceOptions::kUsage);
+}
+
+int main(int argc, char **argv) {
+  DiscoveryParams params;
+  std::vector<uint32_t> chunk_lens;
+  SourceOptions options;
+  int64_t start_ms = 0;
+  int64_t end_ms = INT64_MAX;
+
+  for (int i = 1; i < argc;) {
+    int used = options.parse(argc, argv, i);
+    if (used > 0) {
+      i += used;
+      continue;
+    }
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(arg, "--from-modem")) {
+      params.first_modem = uint32_t(strtoul(val, nullptr, 16));
+    } else if (!strcmp(arg, "--count")) {
+      params.count = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--chunk-len")) {
+      chunk_lens.clear();
+      for (char *end = const_cast<char *>(val); *end;) {
+        chunk_lens.push_back(uint32_t(strtoul(end, &end, 10)));
+        if (*end && *end++ != ',') {
+          chunk_lens.push_back(0);
+          break;
+        }
+      }
+    } else if (!strcmp(arg, "--threads")) {
+      params.threads = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--from-ms")) {
+      start_ms = strtoll(val, nullptr, 10);
+    } else if (!strcmp(arg, "--to-ms")) {
+      end_ms = strtoll(val, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i += 2;
+  }
+  if (chunk_lens.empty()) {
+    chunk_lens.push_back(params.chunk_len);
+  }
+  bool lens_valid = true;
+  for (uint32_t len : chunk_lens) {
+    lens_valid = lens_valid && len >= 1 && len <= kMaxChunkLen;
+  }
+  if (!options.valid() || params.count == 0 || !lens_valid) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!options.open(params.batch_ids)) {
+    return 1;
+  }
+
+  DiscoveryStats stats;
+  std::vector<ActiveModem> active;
+  for (uint32_t len : chunk_lens) {
+    params.chunk_len = len;
+    std::vector<ActiveModem> found =
+        discover_modems(options.source(), params, start_ms, end_ms, options.cache(), &stats);
+    active.insert(active.end(), found.begin(), found.end());
+  }
+  std::stable_sort(active.begin(), active.end(),
+                   [](const ActiveModem &a, const ActiveModem &b) { return a.modem_id < b.modem_id; });
+  size_t modems = 0;
+  for (size_t i = 0; i < active.size(); i++) {
+    modems += i == 0 || active[i].modem_id != active[i - 1].modem_id;
+  }
+  for (const ActiveModem &m : active) {
+    printf("%08" PRIx32 ":%" PRIu32 ":%" PRIu32 " reports=%" PRIu32 " first=%" PRId64 " last=%" PRId64 "\n",
+           m.modem_id, m.message_id, m.chunk_len, m.reports, int64_t(m.first_seen) + kCocoaEpochOffset,
+           int64_t(m.last_seen) + kCocoaEpochOffset);
+  }
+  fprintf(stderr,
+          "%zu of %" PRIu32 " modem ids active; %" PRIu64 " candidates generated in %.2fs, %" PRIu64
+          " queries in %.2fs\n",
+          modems, params.count, stats.candidates, stats.generate_s, stats.queries, stats.query_s);
+  options.report();
+  return 0;
+}
@@ -0,0 +1,214 @@
+// Simulates the finder crowd between a modem and the reports backend and measures how long the
+// message takes to decode.
+//
+//   sendmy-sim-channel --capture modem.pcap --modem cafe0000 [--chunk-len 4] [--trials N] [--seed N]
+//                      [--horizon-h H] [--expect TEXT] [--out reports.json] [--cache FILE] <channel>
+//
+// The capture is the modem's advertisement stream, e.g. from sendmy-modem-capture in
+// Firmware/ESP32/host. Every trial runs the channel simulation with its own seed (--seed + trial)
+// and decodes the reports with decode_message(). The time to decode is the earliest datePublished
+// at which the reports published so far decode to the expected message: --expect, or what the
+// lossless channel (every key reported once, at once) decodes to. Trials that don't decode within
+// --horizon-h hours of the first advertisement count as lost.
+//
+// One CSV row per trial goes to stdout, a summary with the time-to-decode percentiles, the goodput
+// and the decoder's CPU time to stderr. Only the CPU time varies between runs with the same seed. Goodput is decoded bytes per hour of a modem that sends the next message as
+// soon as the last one decoded, or gives up on it at the horizon. --out writes the reports of
+// the first trial as a FindMyReportResults document, for sendmy-decode or the mock server.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "adv_capture.h"
+#include "candidate_cache.h"
+#include "channel_options.h"
+#include "channel_sim.h"
+#include "message_decoder.h"
+#include "report_source.h"
+
+using namespace sendmy;
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s --capture modem.pcap --modem <hex id> [--chunk-len N] [--trials N] [--seed N]\n"
+          "          [--horizon-h H] [--expect TEXT] [--out reports.json] [--cache FILE] <channel>\n%s",
+          argv0, ChannelOptions::kUsage);
+}
+
+static std::vector<uint8_t> decode(const std::vector<Report> &reports, const MessageParams &params, int64_t end_ms,
+                                   CandidateCache *cache) {
+  DumpSource source;
+  source.add(reports);
+  return decode_message(source, params, 0, end_ms, cache);
+}
+
+// Number of bytes at the end of the message that came out right. The modem sends the last byte first.
+static size_t common_suffix(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+  size_t n = 0;
+  while (n < a.size() && n < b.size() && a[a.size() - 1 - n] == b[b.size() - 1 - n]) {
+    n++;
+  }
+  return n;
+}
+
+static double percentile(const std::vector<double> &sorted, double p) {
+  return sorted[std::min(sorted.size() - 1, size_t(p * double(sorted.size())))];
+}
+
+int main(int argc, char **argv) {
+  ChannelOptions channel;
+  MessageParams params;
+  const char *capture_path = nullptr;
+  const char *out_path = nullptr;
+  const char *cache_path = nullptr;
+  const char *expect = nullptr;
+  bool have_modem = false;
+  uint32_t trials = 1;
+  uint64_t seed = 1;
+  double horizon_h = 24;
+
+  for (int i = 1; i < argc; i += 2) {
+    int used = channel.parse(argc, argv, i);
+    if (used > 0) {
+      continue;
+    }
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(arg, "--capture")) {
+      capture_path = val;
+    } else if (!strcmp(arg, "--modem")) {
+      params.modem_id = uint32_t(strtoul(val, nullptr, 16));
+      have_modem = true;
+    } else if (!strcmp(arg, "--chunk-len")) {
+      params.chunk_len = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--trials")) {
+      trials = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--seed")) {
+      seed = strtoull(val, nullptr, 10);
+    } else if (!strcmp(arg, "--horizon-h")) {
+      horizon_h = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--expect")) {
+      expect = val;
+    } else if (!strcmp(arg, "--out")) {
+      out_path = val;
+    } else if (!strcmp(arg, "--cache")) {
+      cache_path = val;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  if (!capture_path || !have_modem || params.chunk_len == 0 || params.chunk_len > kMaxChunkLen || trials == 0 ||
+      !channel.valid()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  AdvCapture capture;
+  std::string error;
+  if (!read_adv_capture(capture_path, capture, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  if (capture.frames.empty()) {
+    fprintf(stderr, "%s: no Offline Finding advertisements\n", capture_path);
+    return 1;
+  }
+  CandidateCache cache_file;
+  CandidateCache *cache = nullptr;
+  if (cache_path) {
+    if (!cache_file.open(cache_path, CandidateCache::Mode::ReadWrite, CandidateCache::kDefaultCapacity, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+    cache = &cache_file;
+  }
+
+  int64_t start_ms = capture.frames.front().time_us / 1000;
+  int64_t horizon_ms = start_ms + int64_t(horizon_h * 3600e3);
+  std::vector<uint8_t> reference;
+  if (expect) {
+    reference.assign(expect, expect + strlen(expect));
+  } else {
+    std::vector<Report> ideal;
+    ideal_channel(capture, ideal);
+    reference = decode(ideal, params, INT64_MAX, cache);
+  }
+  fprintf(stderr, "%zu keys, %zu frames (%" PRIu64 " skipped) over %.1f s; expecting %zu bytes: ",
+          capture.keys.size(), capture.frames.size(), capture.skipped,
+          double(capture.frames.back().time_us - capture.frames.front().time_us) / 1e6, reference.size());
+  fwrite(reference.data(), 1, reference.size(), stderr);
+  fputc('\n', stderr);
+
+  printf("trial,seed,finders,pickups,reports,keys_reported,decoded,time_to_decode_s,bytes_at_horizon\n");
+  std::vector<double> ttd;
+  double busy_h = 0;
+  uint64_t decoded_bytes = 0;
+  double decode_s = 0;
+  for (uint32_t t = 0; t < trials; t++) {
+    std::vector<Report> reports;
+    ChannelStats stats = simulate_channel(capture, channel.params(), seed + t, reports);
+    if (t == 0 && out_path) {
+      std::string json;
+      write_report_results(reports, json);
+      FILE *f = fopen(out_path, "wb");
+      if (!f || fwrite(json.data(), 1, json.size(), f) != json.size() || fclose(f) != 0) {
+        perror(out_path);
+        return 1;
+      }
+    }
+    size_t within = size_t(std::lower_bound(reports.begin(), reports.end(), horizon_ms,
+                                            [](const Report &r, int64_t ms) { return r.date_published_ms < ms; }) -
+                           reports.begin());
+    reports.resize(within);
+
+    // Binary search for the fewest reports (in publication order) that decode the message. A
+    // later report can in principle spoil a vote that was right, which this does not look for.
+    auto t0 = std::chrono::steady_clock::now();
+    std::vector<uint8_t> at_horizon = decode(reports, params, horizon_ms, cache);
+    decode_s += std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+    bool decoded = at_horizon == reference;
+    double ttd_s = 0;
+    if (decoded) {
+      size_t lo = 0, hi = reports.size();
+      while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (decode(reports, params, reports[mid].date_published_ms + 1, cache) == reference) {
+          hi = mid;
+        } else {
+          lo = mid + 1;
+        }
+      }
+      int64_t cutoff_ms = reports.empty() ? start_ms : reports[std::min(lo, reports.size() - 1)].date_published_ms;
+      ttd_s = double(cutoff_ms - start_ms) / 1000;
+      ttd.push_back(ttd_s);
+      busy_h += ttd_s / 3600;
+      decoded_bytes += reference.size();
+    } else {
+      busy_h += horizon_h;
+    }
+    printf("%" PRIu32 ",%" PRIu64 ",%" PRIu64 ",%" PRIu64 ",%zu,%" PRIu64 ",%d,%.1f,%zu\n", t, seed + t,
+           stats.finders, stats.pickups, reports.size(), stats.keys_reported, decoded ? 1 : 0, ttd_s,
+           common_suffix(at_horizon, reference));
+  }
+
+  fprintf(stderr, "decoded %zu of %" PRIu32 " within %.1f h", ttd.size(), trials, horizon_h);
+  if (!ttd.empty()) {
+    std::sort(ttd.begin(), ttd.end());
+    fprintf(stderr, "; time to decode p10 %.0f s, p50 %.0f s, p90 %.0f s, p99 %.0f s, max %.0f s",
+            percentile(ttd, 0.1), percentile(ttd, 0.5), percentile(ttd, 0.9), percentile(ttd, 0.99), ttd.back());
+  }
+  fprintf(stderr, "\ngoodput %.1f bytes/h; decoding all reports of a trial took %.1f ms on average\n",
+          busy_h > 0 ? double(decoded_bytes) / busy_h : 0.0, 1e3 * decode_s / trials);
+  return 0;
+}
@@ -0,0 +1,335 @@
+// Runs a fleet of virtual modems against an in-process mock of acsnservice/fetch and decodes all
+// their messages with concurrent decoder workers, to size the fetch side before deploying devices.
+//
+//   sendmy-sim-fleet [--modems 1000] [--first-modem 5e000000] [--message-len 16[:32]] [--chunk-len 4]
+//                    [--repetitions 50] [--spread-h H] [--horizon-h H] [--seed N] [--workers 4]
+//                    [--query-slots 1] [--max-ids 2048] [--server-threads 4] [--out fleet.json] <channel>
+//
+// Every modem runs the firmware's own modem core (main/modem.c, built with the host stand-ins of
+// Firmware/ESP32/host) on a virtual clock of its own that starts at a random point of the first
+// --spread-h hours. Its advertisements go through the finder crowd of channel_sim.h, and all
+// reports end up in a MockFetchService. The decoder workers then split the messages between them,
+// each running a Pipeline over HTTP against the service, with reports up to --horizon-h hours after
+// the spread visible.
+//
+// Progress and a summary go to stderr, the measurements as one JSON object to stdout: decode
+// throughput, the service's query load and the memory of the service's index and the process.
+// --out also writes the reports as a FindMyReportResults dump for mock/mock_fetch_server.py.
+
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "adv_capture.h"
+#include "channel_options.h"
+#include "channel_sim.h"
+#include "http_source.h"
+#include "mock_fetch_service.h"
+#include "pipeline.h"
+
+extern "C" {
+#include "freertos/task.h"
+#include "gap_pcap.h"
+#include "modem.h"
+}
+
+using namespace sendmy;
+
+namespace {
+
+constexpr int64_t kEpochMs = 1700000000000;
+
+struct Modem {
+  uint32_t id;
+  std::vector<uint8_t> message;
+};
+
+struct WorkerResult {
+  double seconds = 0;
+  uint64_t requests = 0;
+  uint64_t ids = 0;
+  uint64_t messages = 0;
+  uint64_t complete = 0;
+  uint64_t bytes = 0;
+  bool failed = false;
+};
+
+void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s [--modems N] [--first-modem <hex id>] [--message-len MIN[:MAX]] [--chunk-len N]\n"
+          "          [--repetitions N] [--spread-h H] [--horizon-h H] [--seed N] [--workers N]\n"
+          "          [--query-slots N] [--max-ids N] [--server-threads N] [--out fleet.json] <channel>\n%s",
+          argv0, ChannelOptions::kUsage);
+}
+
+double seconds_since(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+}
+
+// VmRSS or VmHWM of this process in KiB.
+long status_kb(const char *field) {
+  FILE *f = fopen("/proc/self/status", "r");
+  char line[256];
+  long kb = 0;
+  size_t n = strlen(field);
+  while (f && fgets(line, sizeof(line), f)) {
+    if (!strncmp(line, field, n) && line[n] == ':') {
+      kb = strtol(line + n + 1, nullptr, 10);
+    }
+  }
+  if (f) {
+    fclose(f);
+  }
+  return kb;
+}
+
+void collect_frame(void *ctx, uint64_t t_us, const uint8_t *frame, size_t len) {
+  add_adv_frame(*static_cast<AdvCapture *>(ctx), int64_t(t_us), frame, len);
+}
+
+// Number of bytes at the end of the message that came out right. The modem sends the last byte first.
+size_t common_suffix(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+  size_t n = 0;
+  while (n < a.size() && n < b.size() && a[a.size() - 1 - n] == b[b.size() - 1 - n]) {
+    n++;
+  }
+  return n;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  ChannelOptions channel;
+  uint32_t modem_count = 1000;
+  uint32_t first_modem = 0x5e000000;
+  uint32_t min_len = 16, max_len = 16;
+  uint32_t chunk_len = 4;
+  uint32_t repetitions = 50;
+  double spread_h = 1;
+  double horizon_h = 6;
+  uint64_t seed = 1;
+  unsigned workers = 4;
+  unsigned query_slots = 1;
+  size_t max_ids = 2048;
+  unsigned server_threads = 4;
+  const char *out_path = nullptr;
+
+  for (int i = 1; i < argc; i += 2) {
+    int used = channel.parse(argc, argv, i);
+    if (used > 0) {
+      continue;
+    }
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(arg, "--modems")) {
+      modem_count = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--first-modem")) {
+      first_modem = uint32_t(strtoul(val, nullptr, 16));
+    } else if (!strcmp(arg, "--message-len")) {
+      char *end;
+      min_len = max_len = uint32_t(strtoul(val, &end, 10));
+      if (*end == ':') {
+        max_len = uint32_t(strtoul(end + 1, nullptr, 10));
+      }
+    } else if (!strcmp(arg, "--chunk-len")) {
+      chunk_len = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--repetitions")) {
+      repetitions = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--spread-h")) {
+      spread_h = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--horizon-h")) {
+      horizon_h = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--seed")) {
+      seed = strtoull(val, nullptr, 10);
+    } else if (!strcmp(arg, "--workers")) {
+      workers = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--query-slots")) {
+      query_slots = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--max-ids")) {
+      max_ids = strtoul(val, nullptr, 10);
+    } else if (!strcmp(arg, "--server-threads")) {
+      server_threads = unsigned(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--out")) {
+      out_path = val;
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+  }
+  // The firmware takes messages of up to 100 bytes.
+  if (modem_count == 0 || min_len == 0 || max_len < min_len || max_len > 100 || chunk_len == 0 ||
+      chunk_len > kMaxChunkLen || repetitions == 0 || workers == 0 || query_slots == 0 || max_ids == 0 ||
+      !channel.valid()) {
+    usage(argv[0]);
+    return 2;
+  }
+
+  // Phase 1: the modems advertise, the finders report.
+  auto t0 = std::chrono::steady_clock::now();
+  std::mt19937_64 rng(seed);
+  std::vector<Modem> modems(modem_count);
+  std::vector<Report> reports;
+  uint64_t keys = 0, frames = 0, keys_reported = 0;
+  gap_pcap_seed(uint32_t(seed));
+  for (uint32_t i = 0; i < modem_count; i++) {
+    Modem &m = modems[i];
+    m.id = first_modem + i;
+    m.message.resize(min_len + rng() % (max_len - min_len + 1));
+    for (uint8_t &b : m.message) {
+      b = uint8_t(' ' + rng() % 95);
+    }
+    int64_t start_us = kEpochMs * 1000 + int64_t(double(rng() >> 11) * 0x1.0p-53 * spread_h * 3600e6);
+
+    AdvCapture capture;
+    int64_t now_us = int64_t(xTaskGetTickCount()) * portTICK_PERIOD_MS * 1000;
+    gap_pcap_set_sink(collect_frame, &capture, uint64_t(start_us - now_us));
+    modem_id = m.id;
+    for (uint32_t r = 0; r < repetitions; r++) {
+      send_data_once_blocking(m.message.data(), uint32_t(m.message.size()), chunk_len, 0);
+    }
+    gap_pcap_set_sink(nullptr, nullptr, 0);
+
+    ChannelStats stats = simulate_channel(capture, channel.params(), seed + i, reports);
+    keys += capture.keys.size();
+    frames += capture.frames.size();
+    keys_reported += stats.keys_reported;
+    if ((i + 1) % 1000 == 0) {
+      fprintf(stderr, "%" PRIu32 " modems, %zu reports\n", i + 1, reports.size());
+    }
+  }
+  double generate_s = seconds_since(t0);
+  long rss_generated_kb = status_kb("VmRSS");
+  fprintf(stderr, "%" PRIu32 " modems: %" PRIu64 " keys, %" PRIu64 " frames, %zu reports (%" PRIu64
+                  " keys reported) in %.1f s\n",
+          modem_count, keys, frames, reports.size(), keys_reported, generate_s);
+
+  if (out_path) {
+    std::string json;
+    write_report_results(reports, json);
+    FILE *f = fopen(out_path, "wb");
+    if (!f || fwrite(json.data(), 1, json.size(), f) != json.size() || fclose(f) != 0) {
+      perror(out_path);
+      return 1;
+    }
+  }
+
+  // Phase 2: the service indexes everything and publishes up to the horizon.
+  int64_t end_ms = kEpochMs + int64_t((spread_h + horizon_h) * 3600e3);
+  MockFetchService service;
+  service.add(std::move(reports));
+  service.set_now_ms(end_ms);
+  std::string error;
+  t0 = std::chrono::steady_clock::now();
+  if (!service.start(0, server_threads, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+  double index_s = seconds_since(t0);
+  long rss_served_kb = status_kb("VmRSS");
+  fprintf(stderr, "service at %s: %zu reports for %zu ids, %.1f MB, indexed in %.2f s\n", service.url().c_str(),
+          service.reports(), service.distinct_ids(), double(service.memory_bytes()) / 1e6, index_s);
+
+  // Phase 3: the decoder workers query the service concurrently.
+  std::vector<WorkerResult> results(workers);
+  std::vector<std::thread> threads;
+  t0 = std::chrono::steady_clock::now();
+  for (unsigned w = 0; w < workers; w++) {
+    threads.emplace_back([&, w] {
+      WorkerResult &res = results[w];
+      auto start = std::chrono::steady_clock::now();
+      HttpSource source;
+      if (!source.open(service.url())) {
+        res.failed = true;
+        return;
+      }
+      source.set_max_ids(max_ids);
+      PipelineParams pipeline;
+      pipeline.generate_threads = 1;
+      pipeline.query_slots = query_slots;
+      pipeline.max_ids_per_request = max_ids;
+      Pipeline fleet(source, pipeline);
+      std::vector<const Modem *> mine;
+      for (size_t i = w; i < modems.size(); i += workers) {
+        MessageParams params;
+        params.modem_id = modems[i].id;
+        params.chunk_len = chunk_len;
+        fleet.add(params);
+        mine.push_back(&modems[i]);
+      }
+      res.failed = !fleet.run(0, end_ms);
+      for (uint32_t h = 0; h < fleet.size(); h++) {
+        size_t n = common_suffix(fleet.decoder(h).message(), mine[h]->message);
+        res.messages++;
+        res.complete += n == mine[h]->message.size();
+        res.bytes += n;
+      }
+      res.requests = fleet.requests();
+      res.ids = fleet.ids_queried();
+      res.seconds = seconds_since(start);
+    });
+  }
+  for (std::thread &t : threads) {
+    t.join();
+  }
+  double decode_s = seconds_since(t0);
+  service.stop();
+
+  WorkerResult total;
+  for (const WorkerResult &r : results) {
+    total.messages += r.messages;
+    total.complete += r.complete;
+    total.bytes += r.bytes;
+    total.failed = total.failed || r.failed;
+  }
+  FetchServiceStats s = service.stats();
+  long peak_kb = status_kb("VmHWM");
+  fprintf(stderr,
+          "decoded %" PRIu64 " of %" PRIu64 " messages completely, %" PRIu64 " bytes, in %.1f s with %u workers: "
+          "%.1f messages/s, %.0f bytes/s\n"
+          "service: %" PRIu64 " requests, %" PRIu64 " ids, %" PRIu64 " results, %.1f MB out; %.0f requests/s, "
+          "%.0f ids/s; %.2f ms per request (max %.1f ms), up to %" PRIu32 " in flight\n"
+          "memory: %.1f MB after generation, %.1f MB serving, %.1f MB peak\n",
+          total.complete, total.messages, total.bytes, decode_s, workers, double(total.complete) / decode_s,
+          double(total.bytes) / decode_s, s.requests, s.ids, s.results, double(s.bytes_out) / 1e6,
+          double(s.requests) / decode_s, double(s.ids) / decode_s, s.requests ? s.busy_ms / double(s.requests) : 0.0,
+          s.max_request_ms, s.max_in_flight, rss_generated_kb / 1024.0, rss_served_kb / 1024.0, peak_kb / 1024.0);
+  if (total.failed) {
+    fprintf(stderr, "some queries failed\n");
+  }
+
+  printf("{\"modems\":%" PRIu32 ",\"chunk_len\":%" PRIu32 ",\"repetitions\":%" PRIu32 ",\"workers\":%u,"
+         "\"query_slots\":%u,\"server_threads\":%u,\n",
+         modem_count, chunk_len, repetitions, workers, query_slots, server_threads);
+  printf(" \"generate\":{\"keys\":%" PRIu64 ",\"frames\":%" PRIu64 ",\"reports\":%zu,\"seconds\":%.3f},\n", keys,
+         frames, service.reports(), generate_s);
+  printf(" \"decode\":{\"messages\":%" PRIu64 ",\"complete\":%" PRIu64 ",\"bytes\":%" PRIu64 ",\"seconds\":%.3f,"
+         "\"messages_per_s\":%.2f,\"bytes_per_s\":%.1f,\"workers\":[",
+         total.messages, total.complete, total.bytes, decode_s, double(total.complete) / decode_s,
+         double(total.bytes) / decode_s);
+  for (unsigned w = 0; w < workers; w++) {
+    printf("%s{\"seconds\":%.3f,\"requests\":%" PRIu64 ",\"ids\":%" PRIu64 ",\"complete\":%" PRIu64 "}",
+           w ? "," : "", results[w].seconds, results[w].requests, results[w].ids, results[w].complete);
+  }
+  printf("]},\n");
+  printf(" \"service\":{\"reports\":%zu,\"ids\":%zu,\"index_bytes\":%zu,\"index_seconds\":%.3f,\"requests\":%" PRIu64
+         ",\"ids_queried\":%" PRIu64 ",\"results\":%" PRIu64 ",\"bytes_in\":%" PRIu64 ",\"bytes_out\":%" PRIu64
+         ",\"errors\":%" PRIu64 ",\"busy_ms\":%.1f,\"max_request_ms\":%.2f,\"max_in_flight\":%" PRIu32
+         ",\"requests_per_s\":%.1f,\"ids_per_s\":%.0f},\n",
+         service.reports(), service.distinct_ids(), service.memory_bytes(), index_s, s.requests, s.ids, s.results,
+         s.bytes_in, s.bytes_out, s.errors, s.busy_ms, s.max_request_ms, s.max_in_flight,
+         double(s.requests) / decode_s, double(s.ids) / decode_s);
+  printf(" \"memory_kb\":{\"generated\":%ld,\"serving\":%ld,\"peak\":%ld}}\n", rss_generated_kb, rss_served_kb,
+         peak_kb);
+  return total.failed ? 1 : 0;
+}
@@ -0,0 +1,213 @@
+// Follows Send My messages live and prints each byte as soon as it is decoded.
+//
+//   sendmy-tail --url http://127.0.0.1:8081/acsnservice/fetch --follow cafe0000 --follow cafe0001:1
+//               [--store reports.store] [--socket /tmp/sendmy.sock]
+//
+// Events are JSON lines, written to stdout or to every client connected to the UNIX socket:
+//   {"modem":"cafe0000","message":0,"offset_from_end":3,"byte":111,"confidence":0.97,"latency_ms":812}
+//   {"modem":"cafe0000","message":0,"finished":true,"text":"..."}
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "json.h"
+#include "live_tail.h"
+#include "source_options.h"
+
+using namespace sendmy;
+
+static volatile sig_atomic_t stop = 0;
+
+static void on_signal(int) { stop = 1; }
+
+static void usage(const char *argv0) {
+  fprintf(stderr,
+          "usage: %s --follow <hex modem>[:message]... [--chunk-len N] [--socket PATH] [--from-ms T]\n"
+          "          [--min-interval-ms T] [--max-interval-ms T] [--alias-settle-ms T] <source>\n%s",
+          argv0, SourceOptions::kUsage);
+}
+
+// Writes event lines to stdout, or to the clients of a listening UNIX socket.
+class LineSink : public TailSink {
+ public:
+  bool listen(const std::string &path) {
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (listen_fd_ < 0 || path.size() >= sizeof(addr.sun_path)) {
+      return false;
+    }
+    memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    unlink(path.c_str());
+    return bind(listen_fd_, reinterpret_cast<struct sockaddr *>(&addr), sizeof(addr)) == 0 &&
+           ::listen(listen_fd_, 16) == 0;
+  }
+
+  // Sleeps up to timeout_ms, accepting subscribers in the meantime.
+  void wait(int64_t timeout_ms) {
+    if (listen_fd_ < 0) {
+      poll(nullptr, 0, int(timeout_ms));
+      return;
+    }
+    struct pollfd p = {listen_fd_, POLLIN, 0};
+    if (poll(&p, 1, int(timeout_ms)) > 0) {
+      int fd;
+      while ((fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC)) >= 0) {
+        clients_.push_back(fd);
+      }
+    }
+  }
+
+  void on_byte(const TailByte &b) override {
+    latencies_.push_back(b.decoded_ms - b.published_ms);
+    char line[160];
+    snprintf(line, sizeof(line),
+             "{\"modem\":\"%08" PRIx32 "\",\"message\":%" PRIu32 ",\"offset_from_end\":%zu,\"byte\":%u,"
+             "\"confidence\":%.3g,\"latency_ms\":%" PRId64 "}\n",
+             b.message->modem_id, b.message->message_id, b.offset_from_end, b.byte, double(b.confidence),
+             b.decoded_ms - b.published_ms);
+    write_line(line);
+  }
+
+  void on_finished(const MessageParams &params, const std::vector<uint8_t> &message) override {
+    char head[96];
+    snprintf(head, sizeof(head), "{\"modem\":\"%08" PRIx32 "\",\"message\":%" PRIu32 ",\"finished\":true,\"text\":",
+             params.modem_id, params.message_id);
+    std::string line = head;
+    json_append_string(line, std::string(message.begin(), message.end()));
+    line += "}\n";
+    write_line(line);
+  }
+
+  // Publication to decode latencies of all bytes so far.
+  std::vector<int64_t> &latencies() { return latencies_; }
+
+ private:
+  void write_line(const std::string &line) {
+    if (listen_fd_ < 0) {
+      fputs(line.c_str(), stdout);
+      fflush(stdout);
+      return;
+    }
+    // Subscribers that cannot keep up are dropped rather than stalling the decoder.
+    clients_.erase(std::remove_if(clients_.begin(), clients_.end(),
+                                  [&](int fd) {
+                                    if (send(fd, line.data(), line.size(), MSG_NOSIGNAL | MSG_DONTWAIT) ==
+                                        ssize_t(line.size())) {
+                                      return false;
+                                    }
+                                    close(fd);
+                                    return true;
+                                  }),
+                   clients_.end());
+  }
+
+  int listen_fd_ = -1;
+  std::vector<int> clients_;
+  std::vector<int64_t> latencies_;
+};
+
+int main(int argc, char **argv) {
+  TailParams tail_params;
+  SourceOptions options;
+  std::vector<MessageParams> follow;
+  uint32_t chunk_len = 4;
+  std::string socket_path;
+
+  for (int i = 1; i < argc;) {
+    int used = options.parse(argc, argv, i);
+    if (used > 0) {
+      i += used;
+      continue;
+    }
+    const char *arg = argv[i];
+    const char *val = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (used < 0 || !val) {
+      usage(argv[0]);
+      return 2;
+    }
+    if (!strcmp(arg, "--follow")) {
+      MessageParams p;
+      char *end;
+      p.modem_id = uint32_t(strtoul(val, &end, 16));
+      p.message_id = *end == ':' ? uint32_t(strtoul(end + 1, nullptr, 10)) : 0;
+      follow.push_back(p);
+    } else if (!strcmp(arg, "--chunk-len")) {
+      chunk_len = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--socket")) {
+      socket_path = val;
+    } else if (!strcmp(arg, "--from-ms")) {
+      tail_params.start_ms = strtoll(val, nullptr, 10);
+    } else if (!strcmp(arg, "--min-interval-ms")) {
+      tail_params.min_interval_ms = strtoll(val, nullptr, 10);
+    } else if (!strcmp(arg, "--max-interval-ms")) {
+      tail_params.max_interval_ms = strtoll(val, nullptr, 10);
+    } else if (!strcmp(arg, "--alias-settle-ms")) {
+      tail_params.alias_settle_ms = strtoll(val, nullptr, 10);
+    } else {
+      usage(argv[0]);
+      return 2;
+    }
+    i += 2;
+  }
+  if (follow.empty() || !options.valid() || chunk_len == 0 || chunk_len > kMaxChunkLen) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (!options.open(tail_params.max_ids_per_request)) {
+    return 1;
+  }
+  ReportSource &source = options.source();
+
+  LineSink sink;
+  if (!socket_path.empty() && !sink.listen(socket_path)) {
+    fprintf(stderr, "cannot listen on %s: %s\n", socket_path.c_str(), strerror(errno));
+    return 1;
+  }
+
+  signal(SIGINT, on_signal);
+  signal(SIGTERM, on_signal);
+
+  LiveTail tail(source, sink, tail_params);
+  tail.set_cache(options.cache());
+  tail.set_checkpoints(options.checkpoints());
+  for (MessageParams &p : follow) {
+    p.chunk_len = chunk_len;
+    tail.follow(p);
+  }
+  while (!stop && !tail.done()) {
+    bool ok;
+    int64_t delay = tail.poll(now_ms(), &ok);
+    if (!ok) {
+      fprintf(stderr, "query failed: %s\n", options.remote() ? options.http().last_error().c_str() : "dump");
+    }
+    sink.wait(delay);
+  }
+
+  options.report();
+  std::vector<int64_t> &lat = sink.latencies();
+  if (!lat.empty()) {
+    std::sort(lat.begin(), lat.end());
+    fprintf(stderr,
+            "%zu bytes in %" PRIu64 " polls, %" PRIu64 " requests; publish to decode latency ms: median %" PRId64
+            ", p90 %" PRId64 ", max %" PRId64 "\n",
+            lat.size(), tail.polls(), tail.requests(), lat[lat.size() / 2], lat[lat.size() * 9 / 10], lat.back());
+  }
+  if (!socket_path.empty()) {
+    unlink(socket_path.c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,212 @@
+// Command line options shared by the tools that read reports: where they come from (a dump or an
+// endpoint), the local report store, the candidate cache, decode checkpoints and request shaping.
+
+#ifndef SENDMY_TOOLS_SOURCE_OPTIONS_H
+#define SENDMY_TOOLS_SOURCE_OPTIONS_H
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "aimd.h"
+#include "candidate_cache.h"
+#include "checkpoint.h"
+#include "http_source.h"
+#include "report_source.h"
+#include "report_store.h"
+#include "synced_source.h"
+
+namespace sendmy {
+
+class SourceOptions {
+ public:
+  static constexpr const char *kUsage =
+      "  source:  --reports <file.json>... | --url <fetch url> [--header 'Name: value']...\n"
+      "           [--store DIR] [--cache FILE [--cache-readonly] [--cache-capacity N]] [--max-ids N]\n"
+      "           [--concurrency MAX] [--metrics FILE] [--checkpoints DIR] [--checkpoint-interval-ms MS]\n";
+
+  // Returns how many arguments starting at argv[i] were consumed, 0 if argv[i] is not a source option
+  // and -1 if its value is missing.
+  int parse(int argc, char **argv, int i) {
+    const char *arg = argv[i];
+    if (!strcmp(arg, "--cache-readonly")) {
+      cache_readonly_ = true;
+      return 1;
+    }
+    static const char *const with_value[] = {"--reports", "--url",     "--header",      "--store",  "--cache",
+                                             "--cache-capacity", "--max-ids", "--concurrency", "--metrics",
+                                             "--checkpoints", "--checkpoint-interval-ms"};
+    bool known = false;
+    for (const char *o : with_value) {
+      known = known || !strcmp(arg, o);
+    }
+    if (!known) {
+      return 0;
+    }
+    if (i + 1 >= argc) {
+      return -1;
+    }
+    const char *val = argv[i + 1];
+    if (!strcmp(arg, "--reports")) {
+      reports_paths_.push_back(val);
+    } else if (!strcmp(arg, "--url")) {
+      url_ = val;
+    } else if (!strcmp(arg, "--header")) {
+      headers_.push_back(val);
+    } else if (!strcmp(arg, "--store")) {
+      store_path_ = val;
+    } else if (!strcmp(arg, "--cache")) {
+      cache_path_ = val;
+    } else if (!strcmp(arg, "--cache-capacity")) {
+      cache_capacity_ = uint32_t(strtoul(val, nullptr, 10));
+    } else if (!strcmp(arg, "--max-ids")) {
+      max_ids_ = strtoul(val, nullptr, 10);
+    } else if (!strcmp(arg, "--concurrency")) {
+      aimd_.max_limit = strtod(val, nullptr);
+    } else if (!strcmp(arg, "--checkpoints")) {
+      checkpoints_path_ = val;
+    } else if (!strcmp(arg, "--checkpoint-interval-ms")) {
+      checkpoints_.set_interval_ms(strtoll(val, nullptr, 10));
+    } else {
+      metrics_path_ = val;
+    }
+    return 2;
+  }
+
+  bool valid() const { return reports_paths_.empty() != url_.empty(); }
+  bool remote() const { return !url_.empty(); }
+
+  // Opens everything that was configured. Errors are printed. batch_ids is the number of ids the
+  // caller should put into one query: the request size, times the concurrency for an endpoint.
+  bool open(size_t &batch_ids) {
+    std::string error;
+    batch_ids = max_ids_ ? max_ids_ : 2048;
+    ReportSource *upstream = &dump_;
+    if (remote()) {
+      if (!http_.open(url_, &error)) {
+        fprintf(stderr, "%s\n", error.c_str());
+        return false;
+      }
+      for (const std::string &h : headers_) {
+        size_t colon = h.find(':');
+        if (colon == std::string::npos) {
+          fprintf(stderr, "malformed header %s\n", h.c_str());
+          return false;
+        }
+        size_t value = h.find_first_not_of(' ', colon + 1);
+        http_.add_header(h.substr(0, colon), value == std::string::npos ? "" : h.substr(value));
+      }
+      controller_ = std::make_unique<AimdController>(aimd_);
+      if (aimd_.max_limit >= 1) {
+        // Batches span several requests, sent concurrently within the controller's limit.
+        http_.set_max_ids(batch_ids);
+        http_.set_controller(controller_.get());
+        batch_ids *= size_t(aimd_.max_limit);
+      }
+      upstream = &http_;
+    } else {
+      for (const std::string &path : reports_paths_) {
+        if (!dump_.load(path, &error)) {
+          fprintf(stderr, "failed to load reports: %s\n", error.c_str());
+          return false;
+        }
+      }
+      fprintf(stderr, "loaded %zu reports\n", dump_.size());
+    }
+
+    source_ = upstream;
+    if (!store_path_.empty()) {
+      if (!store_.open(store_path_, &error)) {
+        fprintf(stderr, "failed to open store: %s\n", error.c_str());
+        return false;
+      }
+      synced_ = std::make_unique<SyncedSource>(store_, *upstream);
+      source_ = synced_.get();
+    }
+
+    if (!cache_path_.empty() &&
+        !cache_.open(cache_path_, cache_readonly_ ? CandidateCache::Mode::ReadOnly : CandidateCache::Mode::ReadWrite,
+                     cache_capacity_, &error)) {
+      fprintf(stderr, "ignoring cache: %s\n", error.c_str());
+    }
+    if (!checkpoints_path_.empty() && !checkpoints_.open(checkpoints_path_, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return false;
+    }
+    return true;
+  }
+
+  ReportSource &source() { return *source_; }
+  CandidateCache *cache() { return cache_.is_open() ? &cache_ : nullptr; }
+  CheckpointStore *checkpoints() { return checkpoints_.is_open() ? &checkpoints_ : nullptr; }
+  HttpSource &http() { return http_; }
+  const std::string &url() const { return url_; }
+
+  // Prints cache, store and request statistics to stderr and writes the metrics file.
+  void report() {
+    if (cache_.is_open()) {
+      fprintf(stderr, "candidate cache: %" PRIu64 " hits, %" PRIu64 " misses\n", cache_.hits(), cache_.misses());
+      if (cache_.rejected()) {
+        fprintf(stderr, "candidate cache: full, %" PRIu64 " chunks not stored (use a new file with a larger "
+                        "--cache-capacity)\n", cache_.rejected());
+      }
+    }
+    if (checkpoints_.is_open()) {
+      fprintf(stderr, "checkpoints: %" PRIu64 " restored, %" PRIu64 " written\n", checkpoints_.restores(),
+              checkpoints_.saves());
+    }
+    if (synced_) {
+      fprintf(stderr,
+              "report store: %zu rows, %" PRIu64 " upstream queries for %" PRIu64 " ids, %" PRIu64
+              " reports fetched, %" PRIu64 " new\n",
+              store_.rows(), synced_->upstream_queries(), synced_->upstream_ids(), synced_->reports_fetched(),
+              synced_->reports_added());
+    }
+    if (!controller_) {
+      return;
+    }
+    AimdMetrics m = controller_->metrics();
+    fprintf(stderr,
+            "http: %" PRIu64 " requests (%" PRIu64 " retries), %" PRIu64 " bytes sent, %" PRIu64
+            " bytes received; concurrency limit %.1f, %" PRIu64 " throttled, %" PRIu64 " latency spikes\n",
+            http_.requests(), http_.retries(), http_.bytes_sent(), http_.bytes_received(), m.limit, m.throttled,
+            m.latency_spikes);
+    if (!metrics_path_.empty()) {
+      FILE *f = fopen(metrics_path_.c_str(), "w");
+      if (f) {
+        fputs(controller_->metrics_text().c_str(), f);
+        fclose(f);
+      }
+    }
+  }
+
+ private:
+  std::vector<std::string> reports_paths_;
+  std::string url_;
+  std::vector<std::string> headers_;
+  std::string store_path_;
+  std::string cache_path_;
+  bool cache_readonly_ = false;
+  uint32_t cache_capacity_ = CandidateCache::kDefaultCapacity;
+  std::string metrics_path_;
+  std::string checkpoints_path_;
+  size_t max_ids_ = 0;
+  AimdParams aimd_;
+
+  DumpSource dump_;
+  HttpSource http_;
+  std::unique_ptr<AimdController> controller_;
+  ReportStore store_;
+  std::unique_ptr<SyncedSource> synced_;
+  ReportSource *source_ = nullptr;
+  CandidateCache cache_;
+  CheckpointStore checkpoints_;
+};
+
+} // namespace sendmy
+
+#endif // SENDMY_TOOLS_SOURCE_OPTIONS_H